@@ -1,4 +1,7 @@
 #include <Logger.h>
+#include <imgui.h>
+#include <imgui_helper.h>
+#include <imgui_extra_widget.h>
 #include "BackgroundTask.h"
 
 namespace json = imgui_json;
@@ -9,6 +12,8 @@ namespace MEC
 {
 BackgroundTask::Holder CreateBgtask_Vidstab(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
 BackgroundTask::Holder CreateBgtask_SceneDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
+BackgroundTask::Holder CreateBgtask_SilenceDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
+BackgroundTask::Holder CreateBgtask_BlackFreezeDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr);
 
 BackgroundTask::Holder BackgroundTask::CreateBackgroundTask(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
 {
@@ -22,10 +27,106 @@ BackgroundTask::Holder BackgroundTask::CreateBackgroundTask(const json::value& j
         return CreateBgtask_Vidstab(jnTask, hSettings, hTxMgr);
     else if (strTaskType == "SceneDetect")
         return CreateBgtask_SceneDetect(jnTask, hSettings, hTxMgr);
+    else if (strTaskType == "SilenceDetect")
+        return CreateBgtask_SilenceDetect(jnTask, hSettings, hTxMgr);
+    else if (strTaskType == "BlackFreezeDetect")
+        return CreateBgtask_BlackFreezeDetect(jnTask, hSettings, hTxMgr);
     else
     {
         Log(Error) << "FAILED to create 'BackgroundTask'! Unsupported task type '" << strTaskType << "'." << endl;
         return nullptr;
     }
 }
-}
\ No newline at end of file
+
+double BackgroundTask::Metrics::GetFps() const
+{
+    if (dActiveSeconds <= 0)
+        return 0;
+    return (double)i64ProcessedFrames/dActiveSeconds;
+}
+
+double BackgroundTask::Metrics::GetEtaSeconds() const
+{
+    if (fProgress >= 1.f)
+        return 0;
+    const auto dFps = GetFps();
+    if (i64TotalFrames > 0 && dFps > 0)
+        return (double)(i64TotalFrames > i64ProcessedFrames ? i64TotalFrames-i64ProcessedFrames : 0)/dFps;
+    if (fProgress > 0 && dActiveSeconds > 0)
+        return dActiveSeconds*(1.f-fProgress)/fProgress;
+    return -1;
+}
+
+json::value BackgroundTask::Metrics::SaveAsJson() const
+{
+    json::value jnMetrics;
+    jnMetrics["processed_frames"] = json::number(i64ProcessedFrames);
+    jnMetrics["total_frames"] = json::number(i64TotalFrames);
+    jnMetrics["decode_seconds"] = json::number(dDecodeSeconds);
+    jnMetrics["filter_seconds"] = json::number(dFilterSeconds);
+    jnMetrics["encode_seconds"] = json::number(dEncodeSeconds);
+    jnMetrics["active_seconds"] = json::number(dActiveSeconds);
+    jnMetrics["progress"] = json::number(fProgress);
+    jnMetrics["fps"] = json::number(GetFps());
+    jnMetrics["eta_seconds"] = json::number(GetEtaSeconds());
+    return std::move(jnMetrics);
+}
+
+void BackgroundTask::Metrics::DrawCompact() const
+{
+    const ImColor tTagClr(KNOWNIMGUICOLOR_GRAY);
+    const ImColor tValueClr(KNOWNIMGUICOLOR_LIGHTGREEN);
+    ImGui::TextColored(tTagClr, "Progress:"); ImGui::SameLine(0, 4);
+    ImGui::TextColored(tValueClr, "%.1f%%", fProgress*100); ImGui::SameLine(0, 12);
+    ImGui::TextColored(tTagClr, "Speed:"); ImGui::SameLine(0, 4);
+    ImGui::TextColored(tValueClr, "%.1f fps", GetFps()); ImGui::SameLine(0, 12);
+    ImGui::TextColored(tTagClr, "ETA:"); ImGui::SameLine(0, 4);
+    const auto dEta = GetEtaSeconds();
+    if (dEta < 0)
+        ImGui::TextColored(tValueClr, "--");
+    else
+        ImGui::TextColored(tValueClr, "%s", ImGuiHelper::MillisecToString((int64_t)(dEta*1000), 1).c_str());
+    const double dStageTotal = dDecodeSeconds+dFilterSeconds+dEncodeSeconds;
+    if (dStageTotal > 0)
+    {
+        ImGui::SameLine(0, 12);
+        ImGui::TextColored(tTagClr, "Decode/Filter/Encode:"); ImGui::SameLine(0, 4);
+        ImGui::TextColored(tValueClr, "%.0f%%/%.0f%%/%.0f%%", dDecodeSeconds*100/dStageTotal, dFilterSeconds*100/dStageTotal, dEncodeSeconds*100/dStageTotal);
+    }
+}
+
+void BackgroundTask::MetricsRecorder::SetActive(bool bActive)
+{
+    lock_guard<mutex> lk(m_mtxActiveLock);
+    const auto tNow = chrono::steady_clock::now();
+    if (bActive)
+    {
+        if (m_iActiveCount++ == 0)
+            m_tActiveStartTp = tNow;
+    }
+    else if (m_iActiveCount > 0)
+    {
+        if (--m_iActiveCount == 0)
+            m_i64ActiveMicrosec += chrono::duration_cast<chrono::microseconds>(tNow-m_tActiveStartTp).count();
+    }
+}
+
+BackgroundTask::Metrics BackgroundTask::MetricsRecorder::GetSnapshot(float fProgress) const
+{
+    Metrics tMetrics;
+    tMetrics.i64ProcessedFrames = m_i64ProcessedFrames;
+    tMetrics.i64TotalFrames = m_i64TotalFrames;
+    tMetrics.dDecodeSeconds = (double)m_ai64StageMicrosec[STAGE_DECODE]/1e6;
+    tMetrics.dFilterSeconds = (double)m_ai64StageMicrosec[STAGE_FILTER]/1e6;
+    tMetrics.dEncodeSeconds = (double)m_ai64StageMicrosec[STAGE_ENCODE]/1e6;
+    tMetrics.fProgress = fProgress;
+    {
+        lock_guard<mutex> lk(m_mtxActiveLock);
+        int64_t i64ActiveMicrosec = m_i64ActiveMicrosec;
+        if (m_iActiveCount > 0)
+            i64ActiveMicrosec += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now()-m_tActiveStartTp).count();
+        tMetrics.dActiveSeconds = (double)i64ActiveMicrosec/1e6;
+    }
+    return tMetrics;
+}
+}
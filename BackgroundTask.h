@@ -1,12 +1,16 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 #include <imgui_json.h>
 #include <ThreadUtils.h>
 #include <Logger.h>
 #include <SharedSettings.h>
 #include <MediaParser.h>
 #include <TextureManager.h>
+#include "MecTracer.h"
 
 namespace MEC
 {
@@ -24,6 +28,102 @@ namespace MEC
         };
         virtual void SetCallbacks(Callbacks* pCb) = 0;
 
+        enum Priority
+        {
+            PRIORITY_LOW = 0,
+            PRIORITY_NORMAL,
+            PRIORITY_HIGH,
+        };
+        virtual Priority GetPriority() const = 0;
+        virtual void SetPriority(Priority ePriority) = 0;
+
+        // The kind of resource a task mostly consumes at its current stage, used by the scheduler to limit
+        // how many tasks of the same kind are running together.
+        enum ResourceClass
+        {
+            RC_DECODE = 0,
+            RC_ENCODE,
+            RC_IO,
+            RC_COUNT,
+        };
+        virtual ResourceClass GetResourceClass() const = 0;
+        // How many worker threads the task may run at the same time. The scheduler shares the worker budget of a resource
+        // class among the running tasks of that class and updates this limit. Tasks working in a single thread ignore it.
+        virtual void SetMaxWorkerCount(int iMaxCnt) = 0;
+        virtual int GetMaxWorkerCount() const = 0;
+
+        // Throughput and timing figures of a task, used to size the background work
+        struct Metrics
+        {
+            int64_t i64ProcessedFrames{0};  // frames processed in the current run, a resumed task starts from 0 again
+            int64_t i64TotalFrames{0};      // frames to process in the current run, 0 if unknown
+            double dDecodeSeconds{0};       // time spent in each stage, summed over all the worker threads
+            double dFilterSeconds{0};
+            double dEncodeSeconds{0};
+            double dActiveSeconds{0};       // wall time while any worker is running, paused time is excluded
+            float fProgress{0};
+
+            double GetFps() const;
+            double GetEtaSeconds() const;   // -1 if it can't be estimated yet
+            imgui_json::value SaveAsJson() const;
+            void DrawCompact() const;
+        };
+        virtual Metrics GetMetrics() const = 0;
+
+        // Collects the metrics from the processing loops of a task, all the methods are thread-safe
+        class MetricsRecorder
+        {
+        public:
+            enum Stage
+            {
+                STAGE_DECODE = 0,
+                STAGE_FILTER,
+                STAGE_ENCODE,
+                STAGE_COUNT,
+            };
+
+            void SetTotalFrames(int64_t i64TotalFrames) { m_i64TotalFrames = i64TotalFrames; }
+            void AddFrames(int64_t i64Count = 1) { m_i64ProcessedFrames += i64Count; }
+            void AddStageTime(Stage eStage, int64_t i64Microsec) { m_ai64StageMicrosec[eStage] += i64Microsec; }
+            // Every worker thread calls 'SetActive(true)' when it starts or resumes, and 'SetActive(false)' when it pauses or quits
+            void SetActive(bool bActive);
+            Metrics GetSnapshot(float fProgress) const;
+            static const char* GetStageTraceName(Stage eStage)
+            {
+                static const char* const s_apcTraceNames[STAGE_COUNT] = { "Bgtask::Decode", "Bgtask::Filter", "Bgtask::Encode" };
+                return s_apcTraceNames[eStage];
+            }
+
+            class StageTimer
+            {
+            public:
+                StageTimer(MetricsRecorder& tRecorder, Stage eStage)
+                    : m_tRecorder(tRecorder), m_eStage(eStage), m_tStartTp(std::chrono::steady_clock::now()) {}
+                ~StageTimer()
+                {
+                    const auto tEndTp = std::chrono::steady_clock::now();
+                    const auto i64Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(tEndTp-m_tStartTp).count();
+                    m_tRecorder.AddStageTime(m_eStage, i64Elapsed);
+                    if (Tracer::IsEnabled())
+                        Tracer::AddCompleteEvent(GetStageTraceName(m_eStage), m_tStartTp, tEndTp);
+                }
+
+            private:
+                MetricsRecorder& m_tRecorder;
+                Stage m_eStage;
+                std::chrono::steady_clock::time_point m_tStartTp;
+            };
+
+        private:
+            std::atomic_int64_t m_i64ProcessedFrames{0};
+            std::atomic_int64_t m_i64TotalFrames{0};
+            std::atomic_int64_t m_ai64StageMicrosec[STAGE_COUNT]{};
+            mutable std::mutex m_mtxActiveLock;
+            int m_iActiveCount{0};
+            int64_t m_i64ActiveMicrosec{0};
+            std::chrono::steady_clock::time_point m_tActiveStartTp;
+        };
+
         virtual bool Pause() = 0;
         virtual bool IsPaused() const = 0;
         virtual bool Resume() = 0;
@@ -0,0 +1,1165 @@
+#include <cstdint>
+#include <sstream>
+#include <ios>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <TimeUtils.h>
+#include <FileSystemUtils.h>
+#include <FFUtils.h>
+#include <MediaParser.h>
+#include <VideoClip.h>
+#include <imgui.h>
+#include "BackgroundTask.h"
+#include "SharedSourceDecoder.h"
+#include "MediaTimeline.h"
+extern "C"
+{
+#include "libavutil/avutil.h"
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+#include "libswscale/swscale.h"
+}
+
+
+namespace json = imgui_json;
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+// Detects the intervals of a source file which are usually removed while editing long recordings. The 'SilenceDetect'
+// type finds the audio intervals whose loudness stays below a threshold, and the 'BlackFreezeDetect' type finds the
+// video intervals of black frames or frozen frames. The source is decoded in one streaming pass, and the pass can be
+// resumed from where it stopped. The video frames are read through the 'SharedSourceDecoder', so the detection shares
+// the decode with the other analyses of the same source, while the audio is decoded by the task itself.
+class BgtaskIntervalDetect : public BackgroundTask
+{
+public:
+    enum DetectType
+    {
+        SILENCE = 0,
+        BLACK_FREEZE,
+    };
+
+    enum IntervalKind
+    {
+        IK_SILENCE = 0,
+        IK_BLACK,
+        IK_FREEZE,
+        IK_COUNT,
+    };
+
+    BgtaskIntervalDetect(const string& name, DetectType eType, MediaCore::SharedSettings::Holder hSettings)
+        : m_name(name), m_eDetectType(eType), m_hSettings(hSettings)
+    {
+        m_pLogger = GetLogger(name);
+    }
+
+    ~BgtaskIntervalDetect()
+    {
+        CloseSource();
+    }
+
+    bool Initialize(const json::value& jnTask)
+    {
+        string strAttrName;
+        // read 'task_dir'
+        strAttrName = "task_dir";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            m_strTaskDir = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << m_strTaskDir << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            strAttrName = "task_hash";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_number())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'number' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = (size_t)jnTask[strAttrName].get<json::number>();
+        }
+        else
+        {
+            strAttrName = "project_dir";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            string strAttrValue = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(strAttrValue))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << strAttrValue << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = SysUtils::GetTickHash();
+            ostringstream oss; oss << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash << dec;
+            const auto strWorkDirName = oss.str();
+            m_strTaskDir = SysUtils::JoinPath(strAttrValue, strWorkDirName);
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+                SysUtils::CreateDirectoryAt(m_strTaskDir, true);
+        }
+        // read 'source_url'
+        strAttrName = "source_url";
+        if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+        {
+            ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_strSrcUrl = jnTask[strAttrName].get<json::string>();
+        if (!SysUtils::IsFile(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << m_strSrcUrl << "' is NOT a FILE.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read 'priority'
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto iPriority = (int)jnTask[strAttrName].get<json::number>();
+            m_ePriority = (Priority)max((int)PRIORITY_LOW, min(iPriority, (int)PRIORITY_HIGH));
+        }
+        // read 'media_item_id'
+        strAttrName = "media_item_id";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_i64MediaItemId = jnTask[strAttrName].get<json::number>();
+        else
+            m_i64MediaItemId = -1;
+        // read detect arguments
+        strAttrName = "min_interval_duration";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_i64MinIntervalDur = (int64_t)jnTask[strAttrName].get<json::number>();
+        strAttrName = "silence_thresh_db";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_fSilenceThreshDb = (float)jnTask[strAttrName].get<json::number>();
+        strAttrName = "black_pixel_thresh";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_fBlackPixelThresh = (float)jnTask[strAttrName].get<json::number>();
+        strAttrName = "black_ratio";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_fBlackRatio = (float)jnTask[strAttrName].get<json::number>();
+        strAttrName = "freeze_noise";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_fFreezeNoise = (float)jnTask[strAttrName].get<json::number>();
+        strAttrName = "detect_freeze";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bDetectFreeze = jnTask[strAttrName].get<json::boolean>();
+        if (m_i64MinIntervalDur <= 0 || m_fBlackRatio <= 0 || m_fBlackRatio > 1 || m_fBlackPixelThresh < 0 || m_fBlackPixelThresh > 1)
+        {
+            ostringstream oss; oss << "INVALID detect arguments! min_interval_duration=" << m_i64MinIntervalDur << ", black_ratio=" << m_fBlackRatio
+                    << ", black_pixel_thresh=" << m_fBlackPixelThresh << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read task status
+        strAttrName = "detected_pos";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_i64DetectedPos = (int64_t)jnTask[strAttrName].get<json::number>();
+        strAttrName = "active_interval_starts";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
+        {
+            const auto& jnStarts = jnTask[strAttrName].get<json::array>();
+            for (int i = 0; i < IK_COUNT && i < jnStarts.size(); i++)
+                m_ai64ActiveStarts[i] = (int64_t)jnStarts[i].get<json::number>();
+        }
+        strAttrName = "intervals";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
+        {
+            const auto& jnIntervals = jnTask[strAttrName].get<json::array>();
+            for (const auto& jnElem : jnIntervals)
+                m_aIntervals.push_back(_Interval::FromJson(jnElem));
+        }
+        strAttrName = "result_hash";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_resultHash = (size_t)jnTask[strAttrName].get<json::number>();
+        {
+            ostringstream oss; oss << setw(16) << setfill('0') << hex << m_szHash << '.' << setw(16) << setfill('0') << m_resultHash << dec;
+            m_resultId = oss.str();
+        }
+
+        bool bFailed = false;
+        bool bDone = false;
+        strAttrName = "is_task_failed";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            bFailed = jnTask[strAttrName].get<json::boolean>();
+        if (bFailed)
+        {
+            strAttrName = "error_message";
+            if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+                m_errMsg = jnTask[strAttrName].get<json::string>();
+            SetState(FAILED, true);
+        }
+        else
+        {
+            strAttrName = "is_task_done";
+            if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+                bDone = jnTask[strAttrName].get<json::boolean>();
+            if (bDone)
+                SetState(DONE, true);
+        }
+        m_fProgress = bDone ? 1.f : 0.f;
+
+        // initialize ui vars
+        ostringstream oss; oss << "##" << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash << dec;
+        m_strTaskNameWithHash = oss.str();
+        oss.str(""); oss << "##ShowResultPopupDlg" << m_strTaskNameWithHash;
+        m_strShowResultPopupLabel = oss.str();
+
+        m_bInited = true;
+        return true;
+    }
+
+    void SetCallbacks(Callbacks* pCb) override
+    {
+        m_pCb = pCb;
+    }
+
+    Priority GetPriority() const override
+    {
+        return m_ePriority;
+    }
+
+    void SetPriority(Priority ePriority) override
+    {
+        m_ePriority = ePriority;
+    }
+
+    ResourceClass GetResourceClass() const override
+    {
+        return RC_DECODE;
+    }
+
+    // the detection runs in the task thread only
+    void SetMaxWorkerCount(int) override {}
+
+    int GetMaxWorkerCount() const override
+    {
+        return 1;
+    }
+
+    bool CanPause()
+    {
+        return m_eState == PROCESSING;
+    }
+
+    bool Pause() override
+    {
+        if (m_bPause)
+            return true;
+        m_bPauseCheckPointHit = false;
+        m_bPause = true;
+        return true;
+    }
+
+    bool IsPaused() const override
+    {
+        return m_bPause && m_bPauseCheckPointHit;
+    }
+
+    bool Resume() override
+    {
+        m_bPause = false;
+        return true;
+    }
+
+    bool DrawContent(const ImVec2& v2ViewSize) override
+    {
+        bool bRemoveThisTask = false;
+        ostringstream oss;
+        auto strLabel = m_strTaskNameWithHash;
+        ImGui::BeginChild(strLabel.c_str(), v2ViewSize, ImGuiChildFlags_Border|ImGuiChildFlags_AutoResizeY);
+        const auto v2AreaPos = ImGui::GetCursorPos();
+        const auto v2AreaAvailSize = ImGui::GetContentRegionAvail();
+        const ImColor tTaskTitleClr(KNOWNIMGUICOLOR_WHITESMOKE);
+        const auto v2TextPadding = ImGui::GetStyle().FramePadding;
+        const auto orgFontScale = ImGui::GetFont()->Scale;
+        ImGui::GetFont()->Scale = 1.2f;
+        ImGui::PushFont(ImGui::GetFont());
+        ImGui::TextColoredWithPadding(tTaskTitleClr, v2TextPadding, "%s", GetTaskTypeName().c_str()); ImGui::SameLine();
+        ImGui::GetFont()->Scale = orgFontScale;
+        ImGui::PopFont();
+
+        // >> draw top right control buttons
+        auto v2CurrPos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos({v2AreaPos.x+v2AreaAvailSize.x-90, v2CurrPos.y});
+        bool bDisableThisWidget;
+        oss << ICON_SAVE << m_strTaskNameWithHash;
+        strLabel = oss.str(); oss.str("");
+        const auto strMetaName = GetResultMetaName();
+        const auto& jnDetectResult = m_pCb->OnCheckMediaItemMetaData(m_strSrcUrl, strMetaName);
+        bool bSameResultId = false;
+        if (jnDetectResult.contains("result_id") && jnDetectResult["result_id"].is_string())
+        {
+            const string currResultId = jnDetectResult["result_id"].get<json::string>();
+            if (m_resultId == currResultId)
+                bSameResultId = true;
+        }
+        bDisableThisWidget = !IsDone() || bSameResultId;
+        ImGui::BeginDisabled(bDisableThisWidget);
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            json::value jnMetaValue;
+            json::array jnIntervals;
+            for (const auto& elem : m_aIntervals)
+                jnIntervals.push_back(elem.SaveAsJson());
+            jnMetaValue["intervals"] = jnIntervals;
+            jnMetaValue["result_id"] = m_resultId;
+            m_pCb->OnOutputMediaItemMetaData(m_strSrcUrl, strMetaName, jnMetaValue);
+        } ImGui::SameLine();
+        ImGui::ShowTooltipOnHover("Save the result as a META data of the source file.");
+        ImGui::EndDisabled();
+
+        oss.str(""); oss << (IsPaused() ? ICON_PLAY_FORWARD : ICON_PAUSE) << m_strTaskNameWithHash;
+        strLabel = oss.str();
+        bDisableThisWidget = !CanPause();
+        ImGui::BeginDisabled(bDisableThisWidget);
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            if (m_bPause)
+                Resume();
+            else
+                Pause();
+        } ImGui::SameLine();
+        ImGui::ShowTooltipOnHover(bDisableThisWidget
+                ? (IsWaiting() ? "Task hasn't started yet." : "Task is already stopped.")
+                : (m_bPause ? "Resume task" : "Pause task"));
+        ImGui::EndDisabled();
+        oss.str(""); oss << ICON_DELETE << m_strTaskNameWithHash;
+        strLabel = oss.str();
+        oss.str(""); oss << ICON_TRASH << " Task Deletion" << m_strTaskNameWithHash;
+        const auto strDelLabel = oss.str();
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            ImGui::OpenPopup(strDelLabel.c_str());
+        }
+        ImGui::ShowTooltipOnHover("Delete this task.");
+        const ImColor tTagClr(KNOWNIMGUICOLOR_LIGHTGRAY);
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "State: "); ImGui::SameLine(0, 10);
+        switch (m_eState)
+        {
+        case WAITING:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.1f), v2TextPadding, "Waiting");
+            break;
+        case PROCESSING:
+            if (m_bPause)
+                ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.1f), v2TextPadding, "Paused");
+            else
+                ImGui::TextColoredWithPadding(ImColor(0.3f, 0.3f, 0.85f), v2TextPadding, "Processing");
+            break;
+        case DONE:
+            ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "Done");
+            break;
+        case FAILED:
+            ImGui::TextColoredWithPadding(ImColor(0.85f, 0.3f, 0.3f), v2TextPadding, "FAILED");
+            break;
+        case CANCELLED:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.8f), v2TextPadding, "Cancelled");
+            break;
+        default:
+            ImGui::TextColoredWithPadding(ImColor(0.7f, 0.3f, 0.3f), v2TextPadding, "Unknown");
+        }
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Progress: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "%.02f%%", m_fProgress*100);
+        ImGui::SameLine(0, 20);
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Intervals: "); ImGui::SameLine(0, 10);
+        {
+            lock_guard<mutex> lk(m_mtxResultLock);
+            ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "%zu", m_aIntervals.size());
+        }
+        ImGui::SameLine(); v2CurrPos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos({v2AreaPos.x+v2AreaAvailSize.x-126, v2CurrPos.y});
+        oss.str(""); oss << ICON_WATCH << " Show Result" << m_strTaskNameWithHash;
+        strLabel = oss.str();
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            const auto bIsPopupOpen = ImGui::IsPopupOpen(m_strShowResultPopupLabel.c_str());
+            if (!bIsPopupOpen)
+                ImGui::OpenPopup(m_strShowResultPopupLabel.c_str());
+        }
+
+        if (ImGui::BeginPopupModal(strDelLabel.c_str(), nullptr, ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings))
+        {
+            bool bClosePopup = false;
+            const ImColor tWarnMsgClr(KNOWNIMGUICOLOR_PALEVIOLETRED);
+            ImGui::TextColoredWithPadding(tWarnMsgClr, {10, 6}, "This task and all of its intermediat result will be removed!");
+            if (ImGui::Button("  OK  "))
+            {
+                Cancel(); WaitDone();
+                bRemoveThisTask = true;
+                bClosePopup = true;
+            } ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+                bClosePopup = true;
+            if (bClosePopup)
+                ImGui::CloseCurrentPopup();
+            ImGui::EndPopup();
+        }
+
+        ImGui::SetNextWindowSize({500, 0});
+        if (ImGui::BeginPopupModal(m_strShowResultPopupLabel.c_str(), nullptr, ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings))
+        {
+            bool bClosePopup = false;
+            vector<_Interval> aIntervals;
+            {
+                lock_guard<mutex> lk(m_mtxResultLock);
+                aIntervals = m_aIntervals;
+            }
+            ImGuiTableFlags uiTableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_NoBordersInBody | ImGuiTableFlags_ScrollY
+                | ImGuiTableFlags_SizingFixedFit;
+            if (ImGui::BeginTable("Detected intervals", 4, uiTableFlags, ImVec2(0, m_u32IntervalTableHeight)))
+            {
+                ImGui::TableSetupColumn("Index", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoHide);
+                ImGui::TableSetupColumn("Kind", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableSetupColumn("Start", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableSetupColumn("End", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableHeadersRow();
+                static const char* s_aKindNames[] = { "Silence", "Black", "Freeze" };
+                ImGuiListClipper clipper;
+                clipper.Begin(aIntervals.size());
+                while (clipper.Step())
+                {
+                    for (int rowIdx = clipper.DisplayStart; rowIdx < clipper.DisplayEnd; rowIdx++)
+                    {
+                        const auto& tInterval = aIntervals[rowIdx];
+                        ImGui::TableNextRow();
+                        ImGui::TableSetColumnIndex(0); ImGui::Text("%d", rowIdx);
+                        ImGui::TableSetColumnIndex(1); ImGui::TextUnformatted(s_aKindNames[tInterval.iKind]);
+                        ImGui::TableSetColumnIndex(2); ImGui::TextUnformatted(MillisecToString(tInterval.i64Start).c_str());
+                        ImGui::TableSetColumnIndex(3); ImGui::TextUnformatted(MillisecToString(tInterval.i64End).c_str());
+                    }
+                }
+                ImGui::EndTable();
+            }
+            ImGui::Spacing();
+            if (ImGui::Button("  OK  "))
+                bClosePopup = true;
+            if (bClosePopup)
+                ImGui::CloseCurrentPopup();
+            ImGui::EndPopup();
+        }
+
+        ImGui::EndChild();
+        return bRemoveThisTask;
+    }
+
+    void DrawContentCompact() override
+    {
+        GetMetrics().DrawCompact();
+    }
+
+    Metrics GetMetrics() const override
+    {
+        return m_tMetricsRecorder.GetSnapshot(m_fProgress);
+    }
+
+    bool SaveAsJson(json::value& jnTask) override
+    {
+        jnTask = json::value();
+        // save basic info
+        jnTask["type"] = GetTaskTypeId();
+        jnTask["name"] = m_name;
+        jnTask["task_hash"] = json::number(m_szHash);
+        jnTask["task_dir"] = m_strTaskDir;
+        jnTask["source_url"] = m_strSrcUrl;
+        jnTask["media_item_id"] = json::number(m_i64MediaItemId);
+        jnTask["priority"] = json::number((int)m_ePriority);
+        // save detect arguments
+        jnTask["min_interval_duration"] = json::number(m_i64MinIntervalDur);
+        jnTask["silence_thresh_db"] = json::number(m_fSilenceThreshDb);
+        jnTask["black_pixel_thresh"] = json::number(m_fBlackPixelThresh);
+        jnTask["black_ratio"] = json::number(m_fBlackRatio);
+        jnTask["freeze_noise"] = json::number(m_fFreezeNoise);
+        jnTask["detect_freeze"] = m_bDetectFreeze;
+        // save task status
+        {
+            lock_guard<mutex> lk(m_mtxResultLock);
+            jnTask["detected_pos"] = json::number(m_i64DetectedPos);
+            json::array jnStarts;
+            for (int i = 0; i < IK_COUNT; i++)
+                jnStarts.push_back(json::number(m_ai64ActiveStarts[i]));
+            jnTask["active_interval_starts"] = jnStarts;
+            json::array jnIntervals;
+            for (const auto& elem : m_aIntervals)
+                jnIntervals.push_back(elem.SaveAsJson());
+            jnTask["intervals"] = jnIntervals;
+        }
+        jnTask["result_hash"] = json::number(m_resultHash);
+        jnTask["is_task_done"] = IsDone();
+        jnTask["is_task_failed"] = IsFailed();
+        jnTask["error_message"] = m_errMsg;
+        jnTask["metrics"] = GetMetrics().SaveAsJson();
+        return true;
+    }
+
+    string Save(const string& _strSavePath) override
+    {
+        json::value jnTask;
+        if (!SaveAsJson(jnTask))
+        {
+            m_pLogger->Log(Error) << "FAILED to save '" << m_name << "' as json!" << endl;
+            return "";
+        }
+        const auto strSavePath = _strSavePath.empty() ? SysUtils::JoinPath(m_strTaskDir, "task.json") : _strSavePath;
+        if (!jnTask.save(strSavePath))
+        {
+            m_pLogger->Log(Error) << "FAILED to save task json of '" << m_name << "' at location '" << strSavePath << "'!" << endl;
+            return "";
+        }
+        return strSavePath;
+    }
+
+    string GetTaskDir() const override
+    {
+        return m_strTaskDir;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Logger::Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+    string GetTaskTypeId() const
+    {
+        return m_eDetectType == SILENCE ? "SilenceDetect" : "BlackFreezeDetect";
+    }
+
+    string GetTaskTypeName() const
+    {
+        return m_eDetectType == SILENCE ? "Silence Detect" : "Black/Freeze Detect";
+    }
+
+    string GetResultMetaName() const
+    {
+        return m_eDetectType == SILENCE ? "SilenceDetectResult" : "BlackFreezeDetectResult";
+    }
+
+protected:
+    struct _Interval
+    {
+        int64_t i64Start;   // in millisecond, relative to the start of the source
+        int64_t i64End;
+        int iKind;
+
+        json::value SaveAsJson() const
+        {
+            json::value j;
+            j["start"] = json::number(i64Start);
+            j["end"] = json::number(i64End);
+            j["kind"] = json::number(iKind);
+            return std::move(j);
+        }
+
+        static _Interval FromJson(const json::value& j)
+        {
+            _Interval newinst{0, 0, IK_SILENCE};
+            string strAttrName;
+            strAttrName = "start";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64Start = (int64_t)j[strAttrName].get<json::number>();
+            strAttrName = "end";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64End = (int64_t)j[strAttrName].get<json::number>();
+            strAttrName = "kind";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.iKind = (int)j[strAttrName].get<json::number>();
+            if (newinst.iKind < 0 || newinst.iKind >= IK_COUNT)
+                newinst.iKind = IK_SILENCE;
+            return std::move(newinst);
+        }
+    };
+
+    bool _TaskProc() override
+    {
+        MEC_TRACE_SCOPE("Bgtask::Run");
+        m_pLogger->Log(INFO) << "Start background task '" << GetTaskTypeId() << "' for '" << m_strSrcUrl << "'." << endl;
+        if (!m_bInited)
+        {
+            ostringstream oss; oss << "Background task '" << GetTaskTypeId() << "' with name '" << m_name << "' is NOT initialized!";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!OpenSource())
+        {
+            m_pLogger->Log(Error) << m_errMsg << endl;
+            CloseSource();
+            return false;
+        }
+        if (m_i64DetectedPos > 0)
+            m_pLogger->Log(INFO) << "Resume '" << GetTaskTypeId() << "' from " << MillisecToString(m_i64DetectedPos) << "." << endl;
+
+        bool bPaused = false;
+        m_tMetricsRecorder.SetActive(true);
+        const bool bSucceeded = m_eDetectType == SILENCE ? DetectSilence(bPaused) : DetectBlackFreeze(bPaused);
+        if (!bPaused)
+            m_tMetricsRecorder.SetActive(false);
+        CloseSource();
+        if (!bSucceeded)
+            return false;
+        if (IsCancelled())
+        {
+            // the intervals found so far are kept for resuming, but the task is not finished
+            m_pLogger->Log(INFO) << "Background task '" << GetTaskTypeId() << "' for '" << m_strSrcUrl << "' is cancelled." << endl;
+            return false;
+        }
+
+        // close the intervals lasting till the end of the source
+        {
+            lock_guard<mutex> lk(m_mtxResultLock);
+            for (int i = 0; i < IK_COUNT; i++)
+                EndInterval(i, m_i64DetectedPos);
+            sort(m_aIntervals.begin(), m_aIntervals.end(), [] (const _Interval& a, const _Interval& b) {
+                return a.i64Start < b.i64Start;
+            });
+        }
+        m_resultHash = SysUtils::GetTickHash();
+        ostringstream oss;
+        oss << setw(16) << setfill('0') << hex << m_szHash << '.' << setw(16) << setfill('0') << m_resultHash << dec;
+        m_resultId = oss.str();
+        m_fProgress = 1.f;
+        m_pLogger->Log(INFO) << "Quit background task '" << GetTaskTypeId() << "' for '" << m_strSrcUrl << "', " << m_aIntervals.size() << " intervals are found." << endl;
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        return true;
+    }
+
+private:
+    bool OpenSource()
+    {
+        return m_eDetectType == SILENCE ? OpenAudioSource() : OpenVideoSource();
+    }
+
+    bool OpenAudioSource()
+    {
+        int fferr = avformat_open_input(&m_pAvfmtCtx, m_strSrcUrl.c_str(), nullptr, nullptr);
+        if (fferr < 0)
+        {
+            ostringstream oss; oss << "FAILED to open '" << m_strSrcUrl << "'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        fferr = avformat_find_stream_info(m_pAvfmtCtx, nullptr);
+        if (fferr < 0)
+        {
+            ostringstream oss; oss << "FAILED to find stream info of '" << m_strSrcUrl << "'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+        const AVCodec* pDecoder = nullptr;
+#else
+        AVCodec* pDecoder = nullptr;
+#endif
+        m_iStreamIdx = av_find_best_stream(m_pAvfmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &pDecoder, 0);
+        if (m_iStreamIdx < 0 || !pDecoder)
+        {
+            ostringstream oss; oss << "FAILED to find audio stream in '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_pStream = m_pAvfmtCtx->streams[m_iStreamIdx];
+        m_i64StreamStartTs = m_pStream->start_time != AV_NOPTS_VALUE ? m_pStream->start_time : 0;
+        if (m_pStream->duration > 0)
+            m_i64SrcDuration = av_rescale_q(m_pStream->duration, m_pStream->time_base, MILLISEC_TIMEBASE);
+        else if (m_pAvfmtCtx->duration > 0)
+            m_i64SrcDuration = m_pAvfmtCtx->duration/1000;
+        // discard the packets of the other streams as early as possible
+        for (unsigned i = 0; i < m_pAvfmtCtx->nb_streams; i++)
+        {
+            if ((int)i != m_iStreamIdx)
+                m_pAvfmtCtx->streams[i]->discard = AVDISCARD_ALL;
+        }
+        m_pDecCtx = avcodec_alloc_context3(pDecoder);
+        if (!m_pDecCtx)
+        {
+            m_errMsg = "FAILED to allocate decoder context!";
+            return false;
+        }
+        avcodec_parameters_to_context(m_pDecCtx, m_pStream->codecpar);
+        m_pDecCtx->thread_count = 0;
+        fferr = avcodec_open2(m_pDecCtx, pDecoder, nullptr);
+        if (fferr < 0)
+        {
+            ostringstream oss; oss << "FAILED to open decoder '" << pDecoder->name << "'! fferr=" << fferr << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    bool OpenVideoSource()
+    {
+        auto hParser = MediaCore::MediaParser::CreateInstance();
+        if (!hParser)
+        {
+            m_errMsg = "FAILED to create MediaParser instance!";
+            return false;
+        }
+        if (!hParser->Open(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "FAILED to open media parser for '" << m_strSrcUrl << "'! Error is '" << hParser->GetError() << "'.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        auto pVidstm = hParser->GetBestVideoStream();
+        if (!pVidstm)
+        {
+            ostringstream oss; oss << "FAILED to find video stream in '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        if (!m_hSettings)
+        {
+            // decode at the source attributes if the task is not given the project settings
+            m_hSettings = MediaCore::SharedSettings::CreateInstance();
+            m_hSettings->SetVideoOutWidth(pVidstm->width);
+            m_hSettings->SetVideoOutHeight(pVidstm->height);
+            m_hSettings->SetVideoOutFrameRate(pVidstm->realFrameRate);
+            m_hSettings->SetHwaccelManager(MediaCore::HwaccelManager::GetDefaultInstance());
+        }
+        const int64_t i64SrcDuration = static_cast<int64_t>(pVidstm->duration*1000);
+        m_hVclip = MediaCore::VideoClip::CreateVideoInstance(m_i64MediaItemId, hParser, m_hSettings, 0, i64SrcDuration, 0, 0, 0, true);
+        if (!m_hVclip)
+        {
+            ostringstream oss; oss << "FAILED to create VideoClip instance for '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_hSrcDecoder = SharedSourceDecoder::GetInstance(m_strSrcUrl, m_hSettings);
+        const auto tOutputFrameRate = m_hSettings->VideoOutFrameRate();
+        m_tVidTimeBase = { tOutputFrameRate.den, tOutputFrameRate.num };
+        m_i64SrcDuration = m_hVclip->Duration();
+        return true;
+    }
+
+    int ReceiveFrame(AVFrame* pAvfrm)
+    {
+        MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+        return avcodec_receive_frame(m_pDecCtx, pAvfrm);
+    }
+
+    void CloseSource()
+    {
+        if (m_pSwsCtx)
+        {
+            sws_freeContext(m_pSwsCtx);
+            m_pSwsCtx = nullptr;
+        }
+        if (m_pDecCtx)
+            avcodec_free_context(&m_pDecCtx);
+        if (m_pAvfmtCtx)
+            avformat_close_input(&m_pAvfmtCtx);
+        m_pStream = nullptr;
+        m_iStreamIdx = -1;
+        m_hVclip = nullptr;
+        m_hSrcDecoder = nullptr;
+    }
+
+    // Returns true while the task is paused, the metrics are not recorded meanwhile
+    bool CheckPaused(bool& bPaused)
+    {
+        if (m_bPause)
+        {
+            if (!bPaused)
+            {
+                m_tMetricsRecorder.SetActive(false);
+                bPaused = true;
+            }
+            m_bPauseCheckPointHit = true;
+            this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+            return true;
+        }
+        if (bPaused)
+        {
+            m_tMetricsRecorder.SetActive(true);
+            bPaused = false;
+        }
+        return false;
+    }
+
+    void UpdateProgress()
+    {
+        if (m_i64SrcDuration > 0)
+            m_fProgress = min((float)((double)m_i64DetectedPos/m_i64SrcDuration), 1.f);
+    }
+
+    bool DetectSilence(bool& bPaused)
+    {
+        if (m_i64DetectedPos > 0)
+        {
+            // resume from the last detected position, the frames before it are decoded but skipped
+            const int64_t i64SeekTs = av_rescale_q(m_i64DetectedPos, MILLISEC_TIMEBASE, m_pStream->time_base)+m_i64StreamStartTs;
+            if (av_seek_frame(m_pAvfmtCtx, m_iStreamIdx, i64SeekTs, AVSEEK_FLAG_BACKWARD) < 0)
+                m_pLogger->Log(WARN) << "FAILED to seek to " << MillisecToString(m_i64DetectedPos) << ", detect from the beginning." << endl;
+        }
+        const int64_t i64ResumePos = m_i64DetectedPos;
+        AVPacket* pAvpkt = av_packet_alloc();
+        AVFrame* pAvfrm = av_frame_alloc();
+        bool bEof = false, bFailed = false;
+        while (!IsCancelled() && !bEof)
+        {
+            if (CheckPaused(bPaused))
+                continue;
+
+            int fferr;
+            {
+                MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                fferr = av_read_frame(m_pAvfmtCtx, pAvpkt);
+            }
+            if (fferr == AVERROR_EOF)
+            {
+                // flush the decoder
+                avcodec_send_packet(m_pDecCtx, nullptr);
+                bEof = true;
+            }
+            else if (fferr < 0)
+            {
+                ostringstream oss; oss << "FAILED to read packet from '" << m_strSrcUrl << "'! fferr=" << fferr << ".";
+                m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                bFailed = true;
+                break;
+            }
+            else
+            {
+                const bool bIsTargetStream = pAvpkt->stream_index == m_iStreamIdx;
+                if (bIsTargetStream)
+                {
+                    MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                    fferr = avcodec_send_packet(m_pDecCtx, pAvpkt);
+                }
+                av_packet_unref(pAvpkt);
+                if (!bIsTargetStream)
+                    continue;
+                if (fferr < 0 && fferr != AVERROR(EAGAIN))
+                {
+                    m_pLogger->Log(WARN) << "'avcodec_send_packet()' FAILED with fferr=" << fferr << ", skip this packet." << endl;
+                    continue;
+                }
+            }
+
+            while ((fferr = ReceiveFrame(pAvfrm)) >= 0)
+            {
+                int64_t i64FrmPts = pAvfrm->best_effort_timestamp;
+                if (i64FrmPts == AV_NOPTS_VALUE)
+                    i64FrmPts = pAvfrm->pts;
+                const int64_t i64FrmPos = i64FrmPts == AV_NOPTS_VALUE ? m_i64DetectedPos
+                        : av_rescale_q(i64FrmPts-m_i64StreamStartTs, m_pStream->time_base, MILLISEC_TIMEBASE);
+                if (i64FrmPos >= i64ResumePos)
+                {
+                    MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                    ProcessAudioFrame(pAvfrm, i64FrmPos);
+                    m_tMetricsRecorder.AddFrames();
+                }
+                av_frame_unref(pAvfrm);
+                UpdateProgress();
+            }
+            if (fferr != AVERROR(EAGAIN) && fferr != AVERROR_EOF)
+            {
+                ostringstream oss; oss << "'avcodec_receive_frame()' FAILED with fferr=" << fferr << ".";
+                m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                bFailed = true;
+                break;
+            }
+        }
+        av_frame_free(&pAvfrm);
+        av_packet_free(&pAvpkt);
+        return !bFailed;
+    }
+
+    bool DetectBlackFreeze(bool& bPaused)
+    {
+        ImMatToAVFrameConverter tMat2AvfrmCvter;
+        tMat2AvfrmCvter.SetOutPixelFormat(AV_PIX_FMT_YUV420P);
+        auto hSrcReader = m_hSrcDecoder->AttachReader(this);
+        // resume from the frame at the last detected position
+        int64_t i64FrmIdx = av_rescale_q(m_i64DetectedPos, MILLISEC_TIMEBASE, m_tVidTimeBase);
+        if (i64FrmIdx > 0)
+            m_hVclip->SeekTo(av_rescale_q(i64FrmIdx, m_tVidTimeBase, MILLISEC_TIMEBASE));
+        bool bEof = false;
+        while (!IsCancelled() && !bEof)
+        {
+            if (CheckPaused(bPaused))
+                continue;
+
+            const int64_t i64FrmPos = av_rescale_q(i64FrmIdx, m_tVidTimeBase, MILLISEC_TIMEBASE);
+            MediaCore::VideoFrame::Holder hVfrm;
+            {
+                MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                hVfrm = m_hSrcDecoder->ReadSourceFrame(hSrcReader, m_hVclip, i64FrmPos, bEof);
+            }
+            i64FrmIdx++;
+            if (!hVfrm)
+                continue;
+            // the frame may be shared with the other analyses, it's only read here
+            const AVFrame* pAvfrm = nullptr;
+            SelfFreeAVFramePtr hCvtAvfrmPtr;
+            ImMatWrapper_AVFrame tAvfrmWrapper;
+            auto tNativeData = hVfrm->GetNativeData();
+            if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+                pAvfrm = (const AVFrame*)tNativeData.pData;
+            else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+                pAvfrm = ((SelfFreeAVFramePtr*)tNativeData.pData)->get();
+            else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+            {
+                const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+                if (vmat.device != IM_DD_CPU)
+                {
+                    hCvtAvfrmPtr = AllocSelfFreeAVFramePtr();
+                    tMat2AvfrmCvter.ConvertImage(vmat, hCvtAvfrmPtr.get(), i64FrmIdx);
+                }
+                else
+                {
+                    tAvfrmWrapper.SetMat(vmat);
+                    hCvtAvfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+                }
+                pAvfrm = hCvtAvfrmPtr.get();
+            }
+            if (!pAvfrm)
+                continue;
+            {
+                MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                ProcessVideoFrame(pAvfrm, i64FrmPos);
+                m_tMetricsRecorder.AddFrames();
+            }
+            UpdateProgress();
+        }
+        return true;
+    }
+
+    // Interval state machine, called with 'm_mtxResultLock' held
+    void UpdateIntervalState(int iKind, bool bActive, int64_t i64Pos)
+    {
+        if (bActive)
+        {
+            if (m_ai64ActiveStarts[iKind] < 0)
+                m_ai64ActiveStarts[iKind] = i64Pos;
+        }
+        else
+        {
+            EndInterval(iKind, i64Pos);
+        }
+    }
+
+    void EndInterval(int iKind, int64_t i64EndPos)
+    {
+        const int64_t i64Start = m_ai64ActiveStarts[iKind];
+        if (i64Start < 0)
+            return;
+        if (i64EndPos-i64Start >= m_i64MinIntervalDur)
+            m_aIntervals.push_back({i64Start, i64EndPos, iKind});
+        m_ai64ActiveStarts[iKind] = -1;
+    }
+
+    static double GetSampleValue(const uint8_t* p, AVSampleFormat ePackedFmt)
+    {
+        switch (ePackedFmt)
+        {
+        case AV_SAMPLE_FMT_U8:
+            return ((double)*p-128)/128;
+        case AV_SAMPLE_FMT_S16:
+            return (double)*((const int16_t*)p)/32768;
+        case AV_SAMPLE_FMT_S32:
+            return (double)*((const int32_t*)p)/2147483648.;
+        case AV_SAMPLE_FMT_FLT:
+            return *((const float*)p);
+        case AV_SAMPLE_FMT_DBL:
+            return *((const double*)p);
+        default:
+            return 0;
+        }
+    }
+
+    // Audio is measured in windows of SILENCE_WINDOW_MS, a window is silent if its RMS over all the channels is below the threshold
+    void ProcessAudioFrame(const AVFrame* pAvfrm, int64_t i64FrmPos)
+    {
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(57, 28, 100)
+        const int iChannels = pAvfrm->ch_layout.nb_channels;
+#else
+        const int iChannels = pAvfrm->channels;
+#endif
+        const int iSampleRate = pAvfrm->sample_rate;
+        if (iChannels <= 0 || iSampleRate <= 0)
+            return;
+        const auto eSmpfmt = (AVSampleFormat)pAvfrm->format;
+        const auto ePackedFmt = av_get_packed_sample_fmt(eSmpfmt);
+        const bool bIsPlanar = av_sample_fmt_is_planar(eSmpfmt);
+        const int iBytesPerSample = av_get_bytes_per_sample(eSmpfmt);
+        const int64_t i64WinSamples = (int64_t)iSampleRate*SILENCE_WINDOW_MS/1000;
+        const double dThreshPower = pow(10., m_fSilenceThreshDb/10.);
+        lock_guard<mutex> lk(m_mtxResultLock);
+        for (int i = 0; i < pAvfrm->nb_samples; i++)
+        {
+            if (m_i64WinSampleCnt == 0)
+                m_i64WinStartPos = i64FrmPos+(int64_t)i*1000/iSampleRate;
+            for (int ch = 0; ch < iChannels; ch++)
+            {
+                const uint8_t* p = bIsPlanar ? pAvfrm->extended_data[ch]+i*iBytesPerSample
+                        : pAvfrm->extended_data[0]+(i*iChannels+ch)*iBytesPerSample;
+                const double dValue = GetSampleValue(p, ePackedFmt);
+                m_dWinSumSq += dValue*dValue;
+            }
+            m_i64WinSampleCnt++;
+            if (m_i64WinSampleCnt >= i64WinSamples)
+            {
+                const double dPower = m_dWinSumSq/(m_i64WinSampleCnt*iChannels);
+                UpdateIntervalState(IK_SILENCE, dPower < dThreshPower, m_i64WinStartPos);
+                m_i64DetectedPos = m_i64WinStartPos+SILENCE_WINDOW_MS;
+                m_dWinSumSq = 0;
+                m_i64WinSampleCnt = 0;
+            }
+        }
+    }
+
+    // Video frames are measured on a down-scaled luma plane. A frame is black if most of its pixels are dark, and it's
+    // frozen if it barely differs from the previous frame.
+    void ProcessVideoFrame(const AVFrame* pAvfrm, int64_t i64FrmPos)
+    {
+        if (pAvfrm->width <= 0 || pAvfrm->height <= 0)
+            return;
+        const int iLumaW = min(pAvfrm->width, LUMA_PLANE_WIDTH);
+        const int iLumaH = max((int)((int64_t)pAvfrm->height*iLumaW/pAvfrm->width), 1);
+        m_pSwsCtx = sws_getCachedContext(m_pSwsCtx, pAvfrm->width, pAvfrm->height, (AVPixelFormat)pAvfrm->format,
+                iLumaW, iLumaH, AV_PIX_FMT_GRAY8, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        if (!m_pSwsCtx)
+            return;
+        vector<uint8_t> aLuma(iLumaW*iLumaH);
+        uint8_t* apDst[4] = { aLuma.data(), nullptr, nullptr, nullptr };
+        int aiDstStride[4] = { iLumaW, 0, 0, 0 };
+        sws_scale(m_pSwsCtx, pAvfrm->data, pAvfrm->linesize, 0, pAvfrm->height, apDst, aiDstStride);
+
+        const int iBlackThresh = (int)(m_fBlackPixelThresh*255);
+        int64_t i64DarkCnt = 0, i64Sad = 0;
+        const bool bHasPrev = m_bDetectFreeze && m_aPrevLuma.size() == aLuma.size();
+        for (size_t i = 0; i < aLuma.size(); i++)
+        {
+            if (aLuma[i] <= iBlackThresh)
+                i64DarkCnt++;
+            if (bHasPrev)
+                i64Sad += abs((int)aLuma[i]-(int)m_aPrevLuma[i]);
+        }
+        const bool bIsBlack = (double)i64DarkCnt/aLuma.size() >= m_fBlackRatio;
+        const bool bIsFrozen = bHasPrev && (double)i64Sad/aLuma.size() <= m_fFreezeNoise*255;
+        lock_guard<mutex> lk(m_mtxResultLock);
+        UpdateIntervalState(IK_BLACK, bIsBlack, i64FrmPos);
+        if (m_bDetectFreeze)
+        {
+            // a black interval is not reported as frozen as well
+            UpdateIntervalState(IK_FREEZE, bIsFrozen && !bIsBlack, m_ai64ActiveStarts[IK_FREEZE] < 0 ? m_i64DetectedPos : i64FrmPos);
+            m_aPrevLuma.swap(aLuma);
+        }
+        m_i64DetectedPos = i64FrmPos;
+    }
+
+private:
+    static constexpr int LUMA_PLANE_WIDTH = 160;
+    static const int64_t SILENCE_WINDOW_MS;
+
+    string m_name;
+    DetectType m_eDetectType;
+    ALogger* m_pLogger;
+    string m_errMsg;
+    Callbacks* m_pCb{nullptr};
+    bool m_bInited{false};
+    size_t m_szHash;
+    string m_strTaskDir;
+    string m_strSrcUrl;
+    int64_t m_i64MediaItemId{-1};
+    size_t m_resultHash{0};
+    string m_resultId;
+    // detect arguments
+    int64_t m_i64MinIntervalDur{1000};
+    float m_fSilenceThreshDb{-50.f};
+    float m_fBlackPixelThresh{0.1f};
+    float m_fBlackRatio{0.98f};
+    float m_fFreezeNoise{0.003f};
+    bool m_bDetectFreeze{true};
+    // decoding context
+    MediaCore::SharedSettings::Holder m_hSettings;
+    MediaCore::VideoClip::Holder m_hVclip;
+    SharedSourceDecoder::Holder m_hSrcDecoder;
+    AVRational m_tVidTimeBase{1, 25};
+    AVFormatContext* m_pAvfmtCtx{nullptr};
+    AVCodecContext* m_pDecCtx{nullptr};
+    AVStream* m_pStream{nullptr};
+    int m_iStreamIdx{-1};
+    int64_t m_i64StreamStartTs{0};
+    int64_t m_i64SrcDuration{0};
+    SwsContext* m_pSwsCtx{nullptr};
+    // detect state
+    mutex m_mtxResultLock;
+    vector<_Interval> m_aIntervals;
+    int64_t m_ai64ActiveStarts[IK_COUNT]{-1, -1, -1};
+    int64_t m_i64DetectedPos{0};
+    double m_dWinSumSq{0};
+    int64_t m_i64WinSampleCnt{0};
+    int64_t m_i64WinStartPos{0};
+    vector<uint8_t> m_aPrevLuma;
+    float m_fProgress{0.f};
+    MetricsRecorder m_tMetricsRecorder;
+    // task control
+    Priority m_ePriority{PRIORITY_NORMAL};
+    bool m_bPause{false};
+    bool m_bPauseCheckPointHit{false};
+    // ui vars
+    string m_strTaskNameWithHash;
+    string m_strShowResultPopupLabel;
+    uint32_t m_u32IntervalTableHeight{350};
+};
+
+const int64_t BgtaskIntervalDetect::SILENCE_WINDOW_MS = 20;
+
+static const auto _BGTASK_INTERVALDETECT_DELETER = [] (BackgroundTask* p) {
+    BgtaskIntervalDetect* ptr = dynamic_cast<BgtaskIntervalDetect*>(p);
+    delete ptr;
+};
+
+static BackgroundTask::Holder CreateBgtask_IntervalDetect(const json::value& jnTask, BgtaskIntervalDetect::DetectType eType, const string& strDefaultName,
+        MediaCore::SharedSettings::Holder hSettings)
+{
+    string strTaskName;
+    string strAttrName = "name";
+    if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        strTaskName = jnTask["name"].get<json::string>();
+    else
+        strTaskName = strDefaultName;
+    auto p = new BgtaskIntervalDetect(strTaskName, eType, hSettings);
+    if (!p->Initialize(jnTask))
+    {
+        Log(Error) << "FAILED to create new '" << p->GetTaskTypeId() << "' background task! Error is '" << p->GetError() << "'." << endl;
+        delete p;
+        return nullptr;
+    }
+    p->Save("");
+    return BackgroundTask::Holder(p, _BGTASK_INTERVALDETECT_DELETER);
+}
+
+BackgroundTask::Holder CreateBgtask_SilenceDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
+{
+    return CreateBgtask_IntervalDetect(jnTask, BgtaskIntervalDetect::SILENCE, "BgtskSilenceDetect", hSettings);
+}
+
+BackgroundTask::Holder CreateBgtask_BlackFreezeDetect(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
+{
+    return CreateBgtask_IntervalDetect(jnTask, BgtaskIntervalDetect::BLACK_FREEZE, "BgtskBlackFreezeDetect", hSettings);
+}
+}
@@ -1,11 +1,17 @@
 #include <iomanip>
 #include <limits>
 #include <list>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <cstring>
 #include <TimeUtils.h>
 #include <MediaParser.h>
 #include <VideoClip.h>
 #include <FFUtils.h>
 #include "BackgroundTask.h"
+#include "SharedSourceDecoder.h"
 #include "MediaTimeline.h"
 extern "C"
 {
@@ -13,6 +19,7 @@ extern "C"
 #include "libavfilter/avfilter.h"
 #include "libavfilter/buffersrc.h"
 #include "libavfilter/buffersink.h"
+#include "libswscale/swscale.h"
 }
 
 
@@ -33,7 +40,6 @@ public:
 
     ~BgtaskSceneDetect()
     {
-        ReleaseFilterGraph();
     }
 
     bool Initialize(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
@@ -107,6 +113,13 @@ public:
             return false;
         }
         m_bIsImageSeq = jnTask[strAttrName].get<json::boolean>();
+        // read 'priority'
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto iPriority = (int)jnTask[strAttrName].get<json::number>();
+            m_ePriority = (Priority)max((int)PRIORITY_LOW, min(iPriority, (int)PRIORITY_HIGH));
+        }
         // read 'media_item_id'
         strAttrName = "media_item_id";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
@@ -298,11 +311,13 @@ public:
             return false;
         }
         m_hParseVclip = hVclip;
+        m_hSrcDecoder = SharedSourceDecoder::GetInstance(m_strSrcUrl, m_hSettings);
         auto hPreviewSettings = m_hSettings->Clone();
         hPreviewSettings->SetVideoOutWidth(m_u32PreviewWidth); hPreviewSettings->SetVideoOutHeight(m_u32PreviewHeight);
         m_hPreviewVclip = hVclip->Clone(hPreviewSettings);
         const auto tOutputFrameRate = m_hSettings->VideoOutFrameRate();
         m_tVidTimeBase = { tOutputFrameRate.den, tOutputFrameRate.num };
+        m_i64ParseFrameCount = av_rescale_q(m_hParseVclip->Duration(), MILLISEC_TIMEBASE, m_tVidTimeBase);
         m_hTxMgr = hTxMgr ? hTxMgr : RenderUtils::TextureManager::GetDefaultInstance();
         // read scene detect arguments
         strAttrName = "scene_detect_thresh";
@@ -319,6 +334,9 @@ public:
                 return false;
             }
         }
+        strAttrName = "use_native_scorer";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bUseNativeScorer = jnTask[strAttrName].get<json::boolean>();
         // read task status
         strAttrName = "parsed_frame_idx";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
@@ -337,6 +355,39 @@ public:
             for (const auto& jnElem : jnDiffScores)
                 m_aDiffScores.push_back((float)jnElem.get<json::number>());
         }
+        // the results of a finished task are kept in a binary file, which is loaded when they are needed
+        strAttrName = "result_file";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            m_strResultFileName = jnTask[strAttrName].get<json::string>();
+            m_bResultLoaded = false;
+        }
+        strAttrName = "parse_chunks";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
+        {
+            const auto& jnParseChunks = jnTask[strAttrName].get<json::array>();
+            for (const auto& jnElem : jnParseChunks)
+            {
+                auto tChunk = _ParseChunk::FromJson(jnElem);
+                if (jnElem.contains("result_file") && jnElem["result_file"].is_string())
+                {
+                    const auto strChunkFilePath = SysUtils::JoinPath(m_strTaskDir, jnElem["result_file"].get<json::string>());
+                    if (!ReadResultFile(strChunkFilePath, tChunk.aDiffScores, tChunk.aSceneCutPoints))
+                    {
+                        // parse the chunk again from its start
+                        m_pLogger->Log(WARN) << "FAILED to read scene detect chunk file '" << strChunkFilePath << "', the chunk will be parsed again." << endl;
+                        tChunk.aDiffScores.clear();
+                        tChunk.aSceneCutPoints.clear();
+                        tChunk.bDone = false;
+                    }
+                    else
+                    {
+                        tChunk.i64SavedScoreCnt = (int64_t)tChunk.aDiffScores.size();
+                    }
+                }
+                m_aParseChunks.push_back(std::move(tChunk));
+            }
+        }
         strAttrName = "result_hash";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
             m_resultHash = (size_t)jnTask[strAttrName].get<json::number>();
@@ -371,6 +422,10 @@ public:
         {
             m_fProgress = 1.f;
         }
+        else if (!m_aParseChunks.empty())
+        {
+            UpdateParseProgress();
+        }
         else
         {
             if (m_i64ParsedFrameIdx > 0)
@@ -392,6 +447,31 @@ public:
         m_pCb = pCb;
     }
 
+    Priority GetPriority() const override
+    {
+        return m_ePriority;
+    }
+
+    void SetPriority(Priority ePriority) override
+    {
+        m_ePriority = ePriority;
+    }
+
+    ResourceClass GetResourceClass() const override
+    {
+        return RC_DECODE;
+    }
+
+    void SetMaxWorkerCount(int iMaxCnt) override
+    {
+        m_i32MaxWorkerCnt = iMaxCnt < 1 ? 1 : iMaxCnt;
+    }
+
+    int GetMaxWorkerCount() const override
+    {
+        return m_i32MaxWorkerCnt;
+    }
+
     bool CanPause()
     {
         return m_eState == PROCESSING;
@@ -450,17 +530,30 @@ public:
         }
         bDisableThisWidget = !IsDone() || bSameResultId;
         ImGui::BeginDisabled(bDisableThisWidget);
-        if (ImGui::Button(strLabel.c_str()))
+        if (ImGui::Button(strLabel.c_str()) && LoadResultIfNeeded())
         {
+            // the per-frame scores are referenced by the path of the result file, only the cut points go into the meta data
             json::value jnMetaValue;
             json::array jnSceneCutPoints;
             for (const auto& elem : m_aSceneCutPoints)
-                jnSceneCutPoints.push_back(elem.SaveAsJson());
+            {
+                // 'position' is the cut position in the source, in millisecond
+                auto jnCutPoint = elem.SaveAsJson();
+                jnCutPoint["position"] = json::number(m_i64ParseStartOffset+FrameIndexToMillisec(elem.i64FrameIdx));
+                jnSceneCutPoints.push_back(jnCutPoint);
+            }
             jnMetaValue["scene_cut_points"] = jnSceneCutPoints;
-            json::array jnDiffScores;
-            for (const auto& elem : m_aDiffScores)
-                jnDiffScores.push_back(json::number(elem));
-            jnMetaValue["diff_scores"] = jnDiffScores;
+            if (!m_strResultFileName.empty())
+            {
+                jnMetaValue["diff_scores_file"] = SysUtils::JoinPath(m_strTaskDir, m_strResultFileName);
+            }
+            else
+            {
+                json::array jnDiffScores;
+                for (const auto& elem : m_aDiffScores)
+                    jnDiffScores.push_back(json::number(elem));
+                jnMetaValue["diff_scores"] = jnDiffScores;
+            }
             jnMetaValue["result_id"] = m_resultId;
             m_pCb->OnOutputMediaItemMetaData(m_strSrcUrl, TASK_RESULT_META_NAME, jnMetaValue);
         } ImGui::SameLine();
@@ -525,7 +618,7 @@ public:
         ImGui::SetCursorPos({v2AreaPos.x+v2AreaAvailSize.x-126, v2CurrPos.y});
         oss.str(""); oss << ICON_WATCH << " Show Result" << m_strTaskNameWithHash;
         strLabel = oss.str();
-        if (ImGui::Button(strLabel.c_str()))
+        if (ImGui::Button(strLabel.c_str()) && LoadResultIfNeeded())
         {
             const auto bIsPopupOpen = ImGui::IsPopupOpen(m_strShowResultPopupLabel.c_str());
             if (!bIsPopupOpen)
@@ -665,7 +758,12 @@ public:
 
     void DrawContentCompact() override
     {
+        GetMetrics().DrawCompact();
+    }
 
+    Metrics GetMetrics() const override
+    {
+        return m_tMetricsRecorder.GetSnapshot(m_fProgress);
     }
 
     bool SaveAsJson(json::value& jnTask) override
@@ -679,6 +777,7 @@ public:
         jnTask["source_url"] = m_strSrcUrl;
         jnTask["is_image_seq"] = m_bIsImageSeq;
         jnTask["media_item_id"] = json::number(m_i64MediaItemId);
+        jnTask["priority"] = json::number((int)m_ePriority);
         json::value jnSettings;
         if (!m_hSettings->SaveAsJson(jnSettings))
         {
@@ -702,20 +801,72 @@ public:
         jnTask["parse_length"] = json::number(m_i64ParseLength);
         // save scene detect parameters
         jnTask["scene_detect_thresh"] = json::number(m_fSceneDetectThresh);
+        jnTask["use_native_scorer"] = m_bUseNativeScorer;
         // save task status
         jnTask["parsed_frame_idx"] = json::number(m_i64ParsedFrameIdx);
-        json::array jnSceneCutPoints;
-        for (const auto& elem : m_aSceneCutPoints)
-            jnSceneCutPoints.push_back(elem.SaveAsJson());
-        jnTask["scene_cut_points"] = jnSceneCutPoints;
-        json::array jnDiffScores;
-        for (const auto& elem : m_aDiffScores)
-            jnDiffScores.push_back(json::number(elem));
-        jnTask["diff_scores"] = jnDiffScores;
+        {
+            // only the chunks that got new scores since the last save are written. their results are copied under
+            // the lock, the files are written after it's released so the parsing workers aren't blocked by the disk io.
+            json::array jnParseChunks;
+            list<pair<size_t, _ParseChunk>> aDirtyChunks;
+            {
+                lock_guard<mutex> lk(m_mtxChunkLock);
+                for (const auto& elem : m_aParseChunks)
+                {
+                    if (elem.i64SavedScoreCnt == (int64_t)elem.aDiffScores.size())
+                    {
+                        auto jnChunk = elem.SaveAsJson(false);
+                        jnChunk["result_file"] = GetChunkFileName(elem);
+                        jnParseChunks.push_back(jnChunk);
+                    }
+                    else
+                    {
+                        aDirtyChunks.push_back({jnParseChunks.size(), elem});
+                        jnParseChunks.push_back(json::value());
+                    }
+                }
+            }
+            for (auto& elem : aDirtyChunks)
+            {
+                const auto& tChunk = elem.second;
+                const auto strChunkFileName = GetChunkFileName(tChunk);
+                const auto strChunkFilePath = SysUtils::JoinPath(m_strTaskDir, strChunkFileName);
+                if (WriteResultFile(strChunkFilePath, tChunk.aDiffScores, tChunk.aSceneCutPoints))
+                {
+                    auto jnChunk = tChunk.SaveAsJson(false);
+                    jnChunk["result_file"] = strChunkFileName;
+                    jnParseChunks[elem.first] = jnChunk;
+                    MarkChunkSaved(tChunk);
+                }
+                else
+                {
+                    m_pLogger->Log(WARN) << "FAILED to write scene detect chunk file '" << strChunkFilePath << "', the chunk is saved in the task json." << endl;
+                    jnParseChunks[elem.first] = tChunk.SaveAsJson(true);
+                }
+            }
+            if (!jnParseChunks.empty())
+                jnTask["parse_chunks"] = jnParseChunks;
+        }
+        if (!m_strResultFileName.empty())
+        {
+            jnTask["result_file"] = m_strResultFileName;
+        }
+        else
+        {
+            json::array jnSceneCutPoints;
+            for (const auto& elem : m_aSceneCutPoints)
+                jnSceneCutPoints.push_back(elem.SaveAsJson());
+            jnTask["scene_cut_points"] = jnSceneCutPoints;
+            json::array jnDiffScores;
+            for (const auto& elem : m_aDiffScores)
+                jnDiffScores.push_back(json::number(elem));
+            jnTask["diff_scores"] = jnDiffScores;
+        }
         jnTask["result_hash"] = json::number(m_resultHash);
         jnTask["is_task_done"] = IsDone();
         jnTask["is_task_failed"] = IsFailed();
         jnTask["error_message"] = m_errMsg;
+        jnTask["metrics"] = GetMetrics().SaveAsJson();
         return true;
     }
 
@@ -754,6 +905,9 @@ public:
 public:
     static const string TASK_TYPE_NAME;
     static const string TASK_RESULT_META_NAME;
+    static const string RESULT_FILE_NAME;
+    static const char RESULT_FILE_MAGIC[];
+    static const uint32_t RESULT_FILE_VERSION;
 
 protected:
     struct _SceneCutPoint
@@ -783,8 +937,144 @@ protected:
         }
     };
 
+    struct _ParseChunk
+    {
+        int64_t i64StartFrmIdx{0};
+        int64_t i64EndFrmIdx{-1};       // exclusive, -1 means parsing till the end of the clip
+        list<float> aDiffScores;        // scores of the frames starting from 'i64StartFrmIdx'
+        vector<_SceneCutPoint> aSceneCutPoints;
+        bool bDone{false};
+        int64_t i64SavedScoreCnt{-1};   // score count in the chunk file, -1 means the file isn't written yet
+
+        int64_t GetNextFrameIndex() const
+        {
+            return i64StartFrmIdx+(int64_t)aDiffScores.size();
+        }
+
+        // the results are normally kept in a chunk file of the result file format, they're only put into the json
+        // if that file can't be written
+        json::value SaveAsJson(bool bWithResults) const
+        {
+            json::value j;
+            j["start_frame_index"] = json::number(i64StartFrmIdx);
+            j["end_frame_index"] = json::number(i64EndFrmIdx);
+            if (bWithResults)
+            {
+                json::array jnDiffScores;
+                for (const auto& elem : aDiffScores)
+                    jnDiffScores.push_back(json::number(elem));
+                j["diff_scores"] = jnDiffScores;
+                json::array jnSceneCutPoints;
+                for (const auto& elem : aSceneCutPoints)
+                    jnSceneCutPoints.push_back(elem.SaveAsJson());
+                j["scene_cut_points"] = jnSceneCutPoints;
+            }
+            j["is_done"] = bDone;
+            return std::move(j);
+        }
+
+        static _ParseChunk FromJson(const json::value& j)
+        {
+            _ParseChunk newinst;
+            string strAttrName;
+            strAttrName = "start_frame_index";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64StartFrmIdx = (int64_t)j[strAttrName].get<json::number>();
+            strAttrName = "end_frame_index";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64EndFrmIdx = (int64_t)j[strAttrName].get<json::number>();
+            strAttrName = "diff_scores";
+            if (j.contains(strAttrName) && j[strAttrName].is_array())
+            {
+                const auto& jnDiffScores = j[strAttrName].get<json::array>();
+                for (const auto& jnElem : jnDiffScores)
+                    newinst.aDiffScores.push_back((float)jnElem.get<json::number>());
+            }
+            strAttrName = "scene_cut_points";
+            if (j.contains(strAttrName) && j[strAttrName].is_array())
+            {
+                const auto& jnSceneCutPoints = j[strAttrName].get<json::array>();
+                for (const auto& jnElem : jnSceneCutPoints)
+                    newinst.aSceneCutPoints.push_back(_SceneCutPoint::FromJson(jnElem));
+            }
+            strAttrName = "is_done";
+            if (j.contains(strAttrName) && j[strAttrName].is_boolean())
+                newinst.bDone = j[strAttrName].get<json::boolean>();
+            return std::move(newinst);
+        }
+    };
+
+    struct _FilterGraph
+    {
+        AVFilterGraph* pFilterGraph{nullptr};
+        AVFilterContext* pBufsrcCtx{nullptr};
+        AVFilterContext* pBufsinkCtx{nullptr};
+        AVFilterInOut* pFilterOutputs{nullptr};
+        AVFilterInOut* pFilterInputs{nullptr};
+    };
+
+    // Scores the difference between successive frames on a decimated luma plane. It uses the same formula as
+    // ffmpeg's 'scene' filter, min(mafd, |mafd-prev_mafd|)/100, so the scores share the range of 'lavfi.scene_score'.
+    struct _NativeSceneScorer
+    {
+        SwsContext* pSwsCtx{nullptr};
+        int iLumaW{0}, iLumaH{0};
+        vector<uint8_t> aLumaBufs[2];
+        int iCurrBufIdx{0};
+        bool bHasPrevFrame{false};
+        double dPrevMafd{0};
+
+        ~_NativeSceneScorer()
+        {
+            if (pSwsCtx)
+                sws_freeContext(pSwsCtx);
+        }
+
+        bool Score(const AVFrame* pAvfrm, float& fScore)
+        {
+            if (iLumaW == 0)
+            {
+                iLumaW = min(pAvfrm->width, NATIVE_SCORER_LUMA_WIDTH);
+                iLumaH = max((int)((int64_t)pAvfrm->height*iLumaW/pAvfrm->width)&~1, 2);
+                aLumaBufs[0].resize(iLumaW*iLumaH);
+                aLumaBufs[1].resize(iLumaW*iLumaH);
+            }
+            pSwsCtx = sws_getCachedContext(pSwsCtx, pAvfrm->width, pAvfrm->height, (AVPixelFormat)pAvfrm->format,
+                    iLumaW, iLumaH, AV_PIX_FMT_GRAY8, SWS_AREA, nullptr, nullptr, nullptr);
+            if (!pSwsCtx)
+                return false;
+            auto& aCurrLuma = aLumaBufs[iCurrBufIdx];
+            uint8_t* apDstData[4] = { aCurrLuma.data(), nullptr, nullptr, nullptr };
+            int aiDstLinesize[4] = { iLumaW, 0, 0, 0 };
+            if (sws_scale(pSwsCtx, pAvfrm->data, pAvfrm->linesize, 0, pAvfrm->height, apDstData, aiDstLinesize) <= 0)
+                return false;
+            fScore = 0;
+            if (bHasPrevFrame)
+            {
+                const auto& aPrevLuma = aLumaBufs[iCurrBufIdx^1];
+                const double dMafd = (double)CalcSad(aPrevLuma.data(), aCurrLuma.data(), aCurrLuma.size())/aCurrLuma.size();
+                const double dDiff = fabs(dMafd-dPrevMafd);
+                fScore = av_clipf((float)(min(dMafd, dDiff)/100.), 0.f, 1.f);
+                dPrevMafd = dMafd;
+            }
+            bHasPrevFrame = true;
+            iCurrBufIdx ^= 1;
+            return true;
+        }
+
+        // plain loop with 32-bit accumulation, which the compiler turns into packed abs-diff instructions
+        static uint32_t CalcSad(const uint8_t* p1, const uint8_t* p2, size_t szLen)
+        {
+            uint32_t u32Sad = 0;
+            for (size_t i = 0; i < szLen; i++)
+                u32Sad += (uint32_t)abs((int)p1[i]-(int)p2[i]);
+            return u32Sad;
+        }
+    };
+
     bool _TaskProc () override
     {
+        MEC_TRACE_SCOPE("Bgtask::Run");
         m_pLogger->Log(INFO) << "Start background task 'SceneDetect' for '" << m_strSrcUrl << "'." << endl;
         if (!m_bInited)
         {
@@ -793,35 +1083,212 @@ protected:
             return false;
         }
 
-        float fStageProgress = 0.f, fStageShare = 0.5f, fAccumShares = 0.f;
-        bool bFilterGraphInited = false;
-        const int64_t i64ClipDur = m_hParseVclip->Duration();
-        ImMatToAVFrameConverter tMat2AvfrmCvter;
-        tMat2AvfrmCvter.SetOutPixelFormat(m_eFgInputPixfmt);
+        {
+            lock_guard<mutex> lk(m_mtxChunkLock);
+            if (m_aParseChunks.empty())
+                BuildParseChunks();
+            int64_t i64ParsedFrameCnt = 0;
+            for (const auto& tChunk : m_aParseChunks)
+                i64ParsedFrameCnt += tChunk.aDiffScores.size();
+            m_tMetricsRecorder.SetTotalFrames(max(m_i64ParseFrameCount-i64ParsedFrameCnt, (int64_t)0));
+        }
+
+        // Each chunk is parsed by its own reader and filter-graph. At most 'GetMaxWorkerCount()' chunks are parsed at
+        // the same time, a worker above a lowered limit leaves its chunk at the next frame and it's continued later.
+        atomic_bool bFailed{false};
+        struct _Worker
+        {
+            thread th;
+            shared_ptr<atomic_bool> hFinished;
+        };
+        list<_Worker> aWorkers;
+        vector<char> abChunkInWork(m_aParseChunks.size(), 0);
+        m_i32RunningWorkerCnt = 0;
+        m_i32PausedWorkerCnt = 0;
+        while (true)
+        {
+            if (!bFailed && !IsCancelled() && !m_bPause)
+            {
+                lock_guard<mutex> lk(m_mtxChunkLock);
+                for (size_t i = 0; i < m_aParseChunks.size() && m_i32RunningWorkerCnt < GetMaxWorkerCount(); i++)
+                {
+                    auto& tChunk = m_aParseChunks[i];
+                    if (tChunk.bDone || abChunkInWork[i])
+                        continue;
+                    auto hVclip = m_hParseVclip->Clone(m_hSettings);
+                    if (!hVclip)
+                    {
+                        m_errMsg = "FAILED to clone VideoClip instance for parsing chunk!"; m_pLogger->Log(Error) << m_errMsg << endl;
+                        bFailed = true;
+                        break;
+                    }
+                    abChunkInWork[i] = 1;
+                    m_i32RunningWorkerCnt++;
+                    _Worker tWorker;
+                    tWorker.hFinished = make_shared<atomic_bool>(false);
+                    auto hFinished = tWorker.hFinished;
+                    tWorker.th = thread([this, &tChunk, &abChunkInWork, &bFailed, hVclip, hFinished, i] () {
+                        bool bYielded = false;
+                        if (!ParseChunk(tChunk, hVclip, bFailed, bYielded))
+                            bFailed = true;
+                        {
+                            lock_guard<mutex> lk(m_mtxChunkLock);
+                            abChunkInWork[i] = 0;
+                        }
+                        // a yielded worker has given its running slot back already
+                        if (!bYielded)
+                            m_i32RunningWorkerCnt--;
+                        *hFinished = true;
+                    });
+                    ostringstream oss; oss << "SceneDet#" << tChunk.i64StartFrmIdx;
+                    Tracer::NameThread(tWorker.th, oss.str());
+                    aWorkers.push_back(std::move(tWorker));
+                }
+            }
+            auto itWorker = aWorkers.begin();
+            while (itWorker != aWorkers.end())
+            {
+                if (*itWorker->hFinished)
+                {
+                    itWorker->th.join();
+                    itWorker = aWorkers.erase(itWorker);
+                }
+                else
+                    itWorker++;
+            }
+            if (aWorkers.empty())
+            {
+                bool bAllDone = true;
+                {
+                    lock_guard<mutex> lk(m_mtxChunkLock);
+                    for (const auto& tChunk : m_aParseChunks)
+                        bAllDone &= tChunk.bDone;
+                }
+                if (bAllDone || bFailed || IsCancelled())
+                    break;
+            }
+            m_bPauseCheckPointHit = m_bPause && m_i32PausedWorkerCnt >= m_i32RunningWorkerCnt;
+            UpdateParseProgress();
+            this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+        }
+        UpdateParseProgress();
+        m_hParseVclip = nullptr;
+        if (bFailed)
+            return false;
+        if (IsCancelled())
+        {
+            m_pLogger->Log(INFO) << "Background task 'SceneDetect' for '" << m_strSrcUrl << "' is cancelled." << endl;
+            return true;
+        }
+        MergeChunkResults();
+        const auto strResultPath = SysUtils::JoinPath(m_strTaskDir, RESULT_FILE_NAME);
+        if (WriteResultFile(strResultPath, m_aDiffScores, m_aSceneCutPoints))
+            m_strResultFileName = RESULT_FILE_NAME;
+        else
+            m_pLogger->Log(WARN) << "FAILED to write scene detect result file '" << strResultPath << "', the result will be saved in the task json." << endl;
+
+        m_resultHash = SysUtils::GetTickHash();
+        ostringstream oss;
+        oss << setw(16) << setfill('0') << hex << m_szHash << '.' << setw(16) << setfill('0') << m_resultHash << dec;
+        m_resultId = oss.str();
+        m_fProgress = 1.f;
+        m_pLogger->Log(INFO) << "Quit background task 'SceneDetect' for '" << m_strSrcUrl << "'." << endl;
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        return true;
+    }
+
+private:
+    int64_t FrameIndexToMillisec(int64_t i64FrmIdx) const
+    {
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
-        const AVRational tb = { tFrameRate.den, tFrameRate.num };
-        int64_t i64FrmIdx = m_i64ParsedFrameIdx;
-        if (i64FrmIdx > 0)
+        return round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
+    }
+
+    // Split the parse range into equal chunks. Results restored from a task json saved before chunked parsing
+    // was introduced are distributed into the chunks, so parsing continues from where it stopped.
+    void BuildParseChunks()
+    {
+        const int64_t i64FrameCount = max(m_i64ParseFrameCount, (int64_t)1);
+        const uint32_t u32HwThreadCnt = max(thread::hardware_concurrency(), 2u);
+        int64_t i64ChunkCnt = min((int64_t)(u32HwThreadCnt/2), (int64_t)MAX_PARSE_CHUNK_COUNT);
+        i64ChunkCnt = max(min(i64ChunkCnt, i64FrameCount/MIN_PARSE_CHUNK_FRAMES), (int64_t)1);
+        const int64_t i64ChunkFrames = (i64FrameCount+i64ChunkCnt-1)/i64ChunkCnt;
+        auto itScore = m_aDiffScores.begin();
+        auto itCutPoint = m_aSceneCutPoints.begin();
+        m_aParseChunks.resize(i64ChunkCnt);
+        for (int64_t i = 0; i < i64ChunkCnt; i++)
         {
-            const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
-            m_hParseVclip->SeekTo(i64ReadPos);
+            auto& tChunk = m_aParseChunks[i];
+            tChunk.i64StartFrmIdx = i*i64ChunkFrames;
+            tChunk.i64EndFrmIdx = i < i64ChunkCnt-1 ? (i+1)*i64ChunkFrames : -1;
+            while (itScore != m_aDiffScores.end() && (tChunk.i64EndFrmIdx < 0 || tChunk.GetNextFrameIndex() < tChunk.i64EndFrmIdx))
+                tChunk.aDiffScores.push_back(*itScore++);
+            while (itCutPoint != m_aSceneCutPoints.end() && (tChunk.i64EndFrmIdx < 0 || itCutPoint->i64FrameIdx < tChunk.i64EndFrmIdx))
+                tChunk.aSceneCutPoints.push_back(*itCutPoint++);
+            tChunk.bDone = tChunk.i64EndFrmIdx >= 0 && tChunk.GetNextFrameIndex() >= tChunk.i64EndFrmIdx;
         }
+        m_pLogger->Log(DEBUG) << "Split parse range of " << i64FrameCount << " frames into " << i64ChunkCnt << " chunks." << endl;
+    }
 
+    bool ParseChunk(_ParseChunk& tChunk, MediaCore::VideoClip::Holder hVclip, const atomic_bool& bStop, bool& bYielded)
+    {
+        _FilterGraph tFg;
+        _NativeSceneScorer tNativeScorer;
+        ImMatToAVFrameConverter tMat2AvfrmCvter;
+        tMat2AvfrmCvter.SetOutPixelFormat(m_eFgInputPixfmt);
+        auto hSrcReader = m_hSrcDecoder->AttachReader(this);
+        // The two frames before the chunk start are also fed into the filter-graph, and their own scores are dropped.
+        // The score is min(mafd, |mafd-prev_mafd|), so the first frame of this chunk needs both its predecessor and the
+        // mafd between the two predecessors to get the same score as sequential parsing.
+        int64_t i64FrmIdx = tChunk.GetNextFrameIndex();
+        i64FrmIdx -= min(i64FrmIdx, (int64_t)SEED_FRAME_COUNT);
+        if (i64FrmIdx > 0)
+            hVclip->SeekTo(FrameIndexToMillisec(i64FrmIdx));
+        bYielded = false;
+
+        bool bPaused = false, bEof = false;
+        string strErrMsg;
         SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
-        while (!IsCancelled())
+        m_tMetricsRecorder.SetActive(true);
+        while (!IsCancelled() && !bStop)
         {
             if (m_bPause)
             {
-                m_bPauseCheckPointHit = true;
+                if (!bPaused)
+                {
+                    m_i32PausedWorkerCnt++;
+                    m_tMetricsRecorder.SetActive(false);
+                    bPaused = true;
+                }
                 this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
                 continue;
             }
+            if (bPaused)
+            {
+                m_i32PausedWorkerCnt--;
+                m_tMetricsRecorder.SetActive(true);
+                bPaused = false;
+            }
+            if (tChunk.i64EndFrmIdx >= 0 && i64FrmIdx >= tChunk.i64EndFrmIdx)
+                break;
+            int32_t i32RunningCnt = m_i32RunningWorkerCnt;
+            if (i32RunningCnt > GetMaxWorkerCount() && m_i32RunningWorkerCnt.compare_exchange_strong(i32RunningCnt, i32RunningCnt-1))
+            {
+                bYielded = true;
+                break;
+            }
 
             int fferr;
             SelfFreeAVFramePtr hFgInfrmPtr;
-            const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
-            bool bEof = false;
-            auto hVfrm = m_hParseVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+            MediaCore::VideoFrame::Holder hVfrm;
+            {
+                MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                hVfrm = m_hSrcDecoder->ReadSourceFrame(hSrcReader, hVclip, FrameIndexToMillisec(i64FrmIdx), bEof);
+            }
             ImMatWrapper_AVFrame tAvfrmWrapper;
             if (hVfrm)
             {
@@ -829,7 +1296,7 @@ protected:
                 if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
                     hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
                 else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
-                    hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
+                    hFgInfrmPtr = CloneSelfFreeAVFramePtr(((SelfFreeAVFramePtr*)tNativeData.pData)->get());  // the frame may be shared with other tasks
                 else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
                 {
                     const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
@@ -847,137 +1314,315 @@ protected:
             }
             if (hFgInfrmPtr)
             {
+                MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                m_tMetricsRecorder.AddFrames();
                 hFgInfrmPtr->pts = i64FrmIdx;
-                if (!bFilterGraphInited)
+                if (m_bUseNativeScorer)
                 {
-                    if (!SetupSceneDetectFilterGraph(hFgInfrmPtr.get()))
+                    float fScore;
+                    if (!tNativeScorer.Score(hFgInfrmPtr.get(), fScore))
                     {
-                        m_pLogger->Log(Error) << "'SetupSceneDetectFilterGraph()' FAILED!" << endl;
-                        return false;
+                        ostringstream oss; oss << "Background task 'SceneDetect' FAILED to score frame #" << i64FrmIdx << " with the native scorer.";
+                        strErrMsg = oss.str(); m_pLogger->Log(Error) << strErrMsg << endl;
+                        break;
                     }
-                    bFilterGraphInited = true;
-                }
-
-                fferr = av_buffersrc_add_frame(m_pBufsrcCtx, hFgInfrmPtr.get());
-                if (fferr < 0)
-                {
-                    ostringstream oss; oss << "Background task 'SceneDetect' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << (i64FrmIdx-1)
-                            << ". fferr=" << fferr << ".";
-                    m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                    return false;
+                    AddFrameScore(tChunk, i64FrmIdx, fScore);
+                    i64FrmIdx++;
                 }
-                m_i64ParsedFrameIdx = i64FrmIdx;
-                i64FrmIdx++;
-
-                av_frame_unref(hFgOutfrmPtr.get());
-                fferr = av_buffersink_get_frame(m_pBufsinkCtx, hFgOutfrmPtr.get());
-                if (fferr != AVERROR(EAGAIN))
+                else
                 {
-                    if (fferr == 0)
+                    if (!tFg.pFilterGraph)
                     {
-                        float fScore = 0;
-                        auto dictEntry = av_dict_get(hFgOutfrmPtr->metadata, "lavfi.scene_score", nullptr, 0);
-                        if (dictEntry)
-                            fScore = stof(dictEntry->value);
-                        m_aDiffScores.push_back(fScore);
-                        if (fScore >= m_fSceneDetectThresh)
+                        if (!SetupSceneDetectFilterGraph(tFg, hFgInfrmPtr.get(), strErrMsg))
                         {
-                            m_aSceneCutPoints.push_back({hFgOutfrmPtr->pts, fScore});
-                            int64_t mts = av_rescale_q(hFgOutfrmPtr->pts, tb, MILLISEC_TIMEBASE);
-                            m_pLogger->Log(INFO) << "Scene detect output: frame#" << hFgOutfrmPtr->pts << ", time=" << MillisecToString(mts) << ", score=" << fScore << endl;
+                            m_pLogger->Log(Error) << "'SetupSceneDetectFilterGraph()' FAILED! " << strErrMsg << endl;
+                            break;
                         }
                     }
-                    else
+
+                    fferr = av_buffersrc_add_frame(tFg.pBufsrcCtx, hFgInfrmPtr.get());
+                    if (fferr < 0)
                     {
-                        ostringstream oss; oss << "Background task 'SceneDetect' FAILED when invoking 'av_buffersink_get_frame()' at frame #" << (i64FrmIdx-1)
+                        ostringstream oss; oss << "Background task 'SceneDetect' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << i64FrmIdx
                                 << ". fferr=" << fferr << ".";
-                        m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                        return false;
+                        strErrMsg = oss.str(); m_pLogger->Log(Error) << strErrMsg << endl;
+                        break;
+                    }
+                    i64FrmIdx++;
+
+                    av_frame_unref(hFgOutfrmPtr.get());
+                    fferr = av_buffersink_get_frame(tFg.pBufsinkCtx, hFgOutfrmPtr.get());
+                    if (fferr != AVERROR(EAGAIN))
+                    {
+                        if (fferr == 0)
+                        {
+                            float fScore = 0;
+                            auto dictEntry = av_dict_get(hFgOutfrmPtr->metadata, "lavfi.scene_score", nullptr, 0);
+                            if (dictEntry)
+                                fScore = stof(dictEntry->value);
+                            AddFrameScore(tChunk, hFgOutfrmPtr->pts, fScore);
+                        }
+                        else
+                        {
+                            ostringstream oss; oss << "Background task 'SceneDetect' FAILED when invoking 'av_buffersink_get_frame()' at frame #" << (i64FrmIdx-1)
+                                    << ". fferr=" << fferr << ".";
+                            strErrMsg = oss.str(); m_pLogger->Log(Error) << strErrMsg << endl;
+                            break;
+                        }
                     }
                 }
             }
-            float fStageProgress = (float)((double)i64ReadPos/i64ClipDur);
-            m_fProgress = fAccumShares+(fStageProgress*fStageShare);
             if (bEof)
                 break;
         }
-        ReleaseFilterGraph();
-        m_hParseVclip = nullptr;
+        if (bPaused)
+            m_i32PausedWorkerCnt--;
+        else
+            m_tMetricsRecorder.SetActive(false);
+        ReleaseFilterGraph(tFg);
+        lock_guard<mutex> lk(m_mtxChunkLock);
+        if (!strErrMsg.empty())
+        {
+            m_errMsg = strErrMsg;
+            return false;
+        }
+        if (bEof || (tChunk.i64EndFrmIdx >= 0 && tChunk.GetNextFrameIndex() >= tChunk.i64EndFrmIdx))
+            tChunk.bDone = true;
+        return true;
+    }
 
-        m_resultHash = SysUtils::GetTickHash();
-        ostringstream oss;
-        oss << setw(16) << setfill('0') << hex << m_szHash << '.' << setw(16) << setfill('0') << m_resultHash << dec;
-        m_resultId = oss.str();
-        m_fProgress = 1.f;
-        m_pLogger->Log(INFO) << "Quit background task 'SceneDetect' for '" << m_strSrcUrl << "'." << endl;
+    void AddFrameScore(_ParseChunk& tChunk, int64_t i64FrmIdx, float fScore)
+    {
+        // skip the score of the seeding frame
+        if (i64FrmIdx < tChunk.GetNextFrameIndex())
+            return;
+        lock_guard<mutex> lk(m_mtxChunkLock);
+        tChunk.aDiffScores.push_back(fScore);
+        if (fScore >= m_fSceneDetectThresh)
+        {
+            tChunk.aSceneCutPoints.push_back({i64FrmIdx, fScore});
+            int64_t mts = av_rescale_q(i64FrmIdx, m_tVidTimeBase, MILLISEC_TIMEBASE);
+            m_pLogger->Log(INFO) << "Scene detect output: frame#" << i64FrmIdx << ", time=" << MillisecToString(mts) << ", score=" << fScore << endl;
+        }
+    }
+
+    void UpdateParseProgress()
+    {
+        int64_t i64ParsedFrameCnt = 0;
+        {
+            lock_guard<mutex> lk(m_mtxChunkLock);
+            for (const auto& tChunk : m_aParseChunks)
+                i64ParsedFrameCnt += tChunk.aDiffScores.size();
+        }
+        m_i64ParsedFrameIdx = i64ParsedFrameCnt;
+        if (m_i64ParseFrameCount > 0)
+            m_fProgress = min((float)((double)i64ParsedFrameCnt/m_i64ParseFrameCount), 1.f);
+    }
+
+    // Layout of the result file: 'MSDR' | u32 version | u64 score count | u64 cut point count | float scores[]
+    // | {i64 frame index, float score} cut points[]. All the fields are little-endian.
+    static void WriteLE(ostream& os, uint64_t u64Val, int iBytes)
+    {
+        char acBuf[8];
+        for (int i = 0; i < iBytes; i++)
+            acBuf[i] = (char)((u64Val>>(i*8))&0xff);
+        os.write(acBuf, iBytes);
+    }
+
+    static uint64_t ReadLE(const uint8_t* pBuf, int iBytes)
+    {
+        uint64_t u64Val = 0;
+        for (int i = 0; i < iBytes; i++)
+            u64Val |= (uint64_t)pBuf[i]<<(i*8);
+        return u64Val;
+    }
+
+    static uint32_t FloatToBits(float fVal)
+    {
+        uint32_t u32Bits;
+        memcpy(&u32Bits, &fVal, sizeof(u32Bits));
+        return u32Bits;
+    }
+
+    static float BitsToFloat(uint32_t u32Bits)
+    {
+        float fVal;
+        memcpy(&fVal, &u32Bits, sizeof(fVal));
+        return fVal;
+    }
+
+    static bool WriteResultFile(const string& strPath, const list<float>& aDiffScores, const vector<_SceneCutPoint>& aSceneCutPoints)
+    {
+        ofstream ofs(strPath, ios::out|ios::binary|ios::trunc);
+        if (!ofs.is_open())
+            return false;
+        ofs.write(RESULT_FILE_MAGIC, 4);
+        WriteLE(ofs, RESULT_FILE_VERSION, 4);
+        WriteLE(ofs, aDiffScores.size(), 8);
+        WriteLE(ofs, aSceneCutPoints.size(), 8);
+        for (const auto& elem : aDiffScores)
+            WriteLE(ofs, FloatToBits(elem), 4);
+        for (const auto& elem : aSceneCutPoints)
+        {
+            WriteLE(ofs, (uint64_t)elem.i64FrameIdx, 8);
+            WriteLE(ofs, FloatToBits(elem.fScore), 4);
+        }
+        return ofs.good();
+    }
+
+    static bool ReadResultFile(const string& strPath, list<float>& aDiffScores, vector<_SceneCutPoint>& aSceneCutPoints)
+    {
+        ifstream ifs(strPath, ios::in|ios::binary|ios::ate);
+        if (!ifs.is_open())
+            return false;
+        const int64_t i64FileSize = (int64_t)ifs.tellg();
+        const int64_t i64HeaderSize = 4+4+8+8;
+        if (i64FileSize < i64HeaderSize)
+            return false;
+        ifs.seekg(0);
+        uint8_t au8Header[i64HeaderSize];
+        ifs.read((char*)au8Header, i64HeaderSize);
+        if (!ifs.good() || memcmp(au8Header, RESULT_FILE_MAGIC, 4) != 0 || (uint32_t)ReadLE(au8Header+4, 4) != RESULT_FILE_VERSION)
+            return false;
+        const uint64_t u64ScoreCnt = ReadLE(au8Header+8, 8);
+        const uint64_t u64CutPointCnt = ReadLE(au8Header+16, 8);
+        // the counts come from the file, check them against its length before allocating anything
+        const uint64_t u64BodySize = (uint64_t)(i64FileSize-i64HeaderSize);
+        if (u64ScoreCnt > u64BodySize/4 || u64CutPointCnt > (u64BodySize-u64ScoreCnt*4)/12)
+            return false;
+        vector<uint8_t> aBody(u64ScoreCnt*4+u64CutPointCnt*12);
+        ifs.read((char*)aBody.data(), aBody.size());
+        if (!ifs.good())
+            return false;
+        const uint8_t* pBuf = aBody.data();
+        list<float> aScores;
+        for (uint64_t i = 0; i < u64ScoreCnt; i++, pBuf += 4)
+            aScores.push_back(BitsToFloat((uint32_t)ReadLE(pBuf, 4)));
+        vector<_SceneCutPoint> aCutPoints(u64CutPointCnt);
+        for (auto& elem : aCutPoints)
+        {
+            elem.i64FrameIdx = (int64_t)ReadLE(pBuf, 8);
+            elem.fScore = BitsToFloat((uint32_t)ReadLE(pBuf+8, 4));
+            pBuf += 12;
+        }
+        aDiffScores = std::move(aScores);
+        aSceneCutPoints = std::move(aCutPoints);
         return true;
     }
 
-    bool _AfterTaskProc() override
+    string GetChunkFileName(const _ParseChunk& tChunk) const
     {
-        ReleaseFilterGraph();
+        ostringstream oss; oss << "scene_detect_chunk." << tChunk.i64StartFrmIdx << ".bin";
+        return oss.str();
+    }
+
+    // record the score count written to the chunk file, the chunks may have been rebuilt or merged meanwhile
+    void MarkChunkSaved(const _ParseChunk& tSaved)
+    {
+        lock_guard<mutex> lk(m_mtxChunkLock);
+        for (auto& tChunk : m_aParseChunks)
+        {
+            if (tChunk.i64StartFrmIdx == tSaved.i64StartFrmIdx)
+            {
+                tChunk.i64SavedScoreCnt = (int64_t)tSaved.aDiffScores.size();
+                break;
+            }
+        }
+    }
+
+    bool LoadResultIfNeeded()
+    {
+        if (m_bResultLoaded)
+            return true;
+        const auto strResultPath = SysUtils::JoinPath(m_strTaskDir, m_strResultFileName);
+        if (!ReadResultFile(strResultPath, m_aDiffScores, m_aSceneCutPoints))
+        {
+            ostringstream oss; oss << "FAILED to read scene detect result file '" << strResultPath << "'!";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        m_bResultLoaded = true;
         return true;
     }
 
-private:
-    bool SetupSceneDetectFilterGraph(const AVFrame* pInAvfrm)
+    // concatenate the results of all the chunks in order, the chunks are dropped afterwards
+    void MergeChunkResults()
+    {
+        lock_guard<mutex> lk(m_mtxChunkLock);
+        list<float> aDiffScores;
+        vector<_SceneCutPoint> aSceneCutPoints;
+        for (auto& tChunk : m_aParseChunks)
+        {
+            aDiffScores.splice(aDiffScores.end(), tChunk.aDiffScores);
+            aSceneCutPoints.insert(aSceneCutPoints.end(), tChunk.aSceneCutPoints.begin(), tChunk.aSceneCutPoints.end());
+            const auto strChunkFilePath = SysUtils::JoinPath(m_strTaskDir, GetChunkFileName(tChunk));
+            if (SysUtils::IsFile(strChunkFilePath))
+                SysUtils::DeleteFileAt(strChunkFilePath);
+        }
+        m_aParseChunks.clear();
+        m_i64ParsedFrameIdx = aDiffScores.size();
+        m_aDiffScores = std::move(aDiffScores);
+        m_aSceneCutPoints = std::move(aSceneCutPoints);
+    }
+
+    bool SetupSceneDetectFilterGraph(_FilterGraph& tFg, const AVFrame* pInAvfrm, string& strErrMsg)
     {
         const AVFilter *buffersink = avfilter_get_by_name("buffersink");
         const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
 
-        m_pFilterGraph = avfilter_graph_alloc();
-        if (!m_pFilterGraph)
+        tFg.pFilterGraph = avfilter_graph_alloc();
+        if (!tFg.pFilterGraph)
         {
-            m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
+            strErrMsg = "FAILED to allocate new 'AVFilterGraph'!";
             return false;
         }
 
         int fferr;
         ostringstream oss;
-        m_eFgInputPixfmt = (AVPixelFormat)pInAvfrm->format;
+        const auto eInputPixfmt = (AVPixelFormat)pInAvfrm->format;
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
-        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)m_eFgInputPixfmt << ":sar=1"
+        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)eInputPixfmt << ":sar=1"
                 << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
         string bufsrcArg = oss.str();
-        m_pBufsrcCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
+        tFg.pBufsrcCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
+            strErrMsg = oss.str();
             return false;
         }
         AVFilterInOut* filtInOutPtr = avfilter_inout_alloc();
         if (!filtInOutPtr)
         {
-            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+            strErrMsg = "FAILED to allocate 'AVFilterInOut' instance!";
             return false;
         }
         filtInOutPtr->name       = av_strdup("in");
-        filtInOutPtr->filter_ctx = m_pBufsrcCtx;
+        filtInOutPtr->filter_ctx = tFg.pBufsrcCtx;
         filtInOutPtr->pad_idx    = 0;
         filtInOutPtr->next       = nullptr;
-        m_pFilterOutputs = filtInOutPtr;
+        tFg.pFilterOutputs = filtInOutPtr;
 
-        m_pBufsinkCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
+        tFg.pBufsinkCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
+            strErrMsg = oss.str();
             return false;
         }
         filtInOutPtr = avfilter_inout_alloc();
         if (!filtInOutPtr)
         {
-            m_errMsg = "FAILED to allocate 'AVFilterInOut' instance!";
+            strErrMsg = "FAILED to allocate 'AVFilterInOut' instance!";
             return false;
         }
         filtInOutPtr->name        = av_strdup("out");
-        filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
+        filtInOutPtr->filter_ctx  = tFg.pBufsinkCtx;
         filtInOutPtr->pad_idx     = 0;
         filtInOutPtr->next        = nullptr;
-        m_pFilterInputs = filtInOutPtr;
+        tFg.pFilterInputs = filtInOutPtr;
 
         const int iOutW = (int)m_hSettings->VideoOutWidth();
         const int iOutH = (int)m_hSettings->VideoOutHeight();
@@ -993,48 +1638,48 @@ private:
         }
         oss << "select='gte(scene\\,0)'";
         string filterArgs = oss.str();
-        fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
+        fferr = avfilter_graph_parse_ptr(tFg.pFilterGraph, filterArgs.c_str(), &tFg.pFilterInputs, &tFg.pFilterOutputs, nullptr);
         if (fferr < 0)
         {
             oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
-            m_errMsg = oss.str();
+            strErrMsg = oss.str();
             return false;
         }
         m_pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
 
-        fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
+        fferr = avfilter_graph_config(tFg.pFilterGraph, nullptr);
         if (fferr < 0)
         {
             oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
-            m_errMsg = oss.str();
+            strErrMsg = oss.str();
             return false;
         }
 
-        if (m_pFilterOutputs)
-            avfilter_inout_free(&m_pFilterOutputs);
-        if (m_pFilterInputs)
-            avfilter_inout_free(&m_pFilterInputs);
+        if (tFg.pFilterOutputs)
+            avfilter_inout_free(&tFg.pFilterOutputs);
+        if (tFg.pFilterInputs)
+            avfilter_inout_free(&tFg.pFilterInputs);
         return true;
     }
 
-    void ReleaseFilterGraph()
+    void ReleaseFilterGraph(_FilterGraph& tFg)
     {
-        if (m_pFilterOutputs)
+        if (tFg.pFilterOutputs)
         {
-            avfilter_inout_free(&m_pFilterOutputs);
-            m_pFilterOutputs = nullptr;
+            avfilter_inout_free(&tFg.pFilterOutputs);
+            tFg.pFilterOutputs = nullptr;
         }
-        if (m_pFilterInputs)
+        if (tFg.pFilterInputs)
         {
-            avfilter_inout_free(&m_pFilterInputs);
-            m_pFilterInputs = nullptr;
+            avfilter_inout_free(&tFg.pFilterInputs);
+            tFg.pFilterInputs = nullptr;
         }
-        m_pBufsrcCtx = nullptr;
-        m_pBufsinkCtx = nullptr;
-        if (m_pFilterGraph)
+        tFg.pBufsrcCtx = nullptr;
+        tFg.pBufsinkCtx = nullptr;
+        if (tFg.pFilterGraph)
         {
-            avfilter_graph_free(&m_pFilterGraph);
-            m_pFilterGraph = nullptr;
+            avfilter_graph_free(&tFg.pFilterGraph);
+            tFg.pFilterGraph = nullptr;
         }
     }
 
@@ -1046,19 +1691,16 @@ private:
     Callbacks* m_pCb{nullptr};
     bool m_bInited{false};
     string m_strTaskDir;
-    AVFilterGraph* m_pFilterGraph{nullptr};
-    AVFilterContext* m_pBufsrcCtx;
-    AVFilterContext* m_pBufsinkCtx;
-    AVFilterInOut* m_pFilterOutputs{nullptr};
-    AVFilterInOut* m_pFilterInputs{nullptr};
-    AVPixelFormat m_eFgInputPixfmt;
+    AVPixelFormat m_eFgInputPixfmt{AV_PIX_FMT_RGB24};
     string m_strTrfPath;
     string m_strSrcUrl;
     int64_t m_i64MediaItemId;
     int64_t m_i64ParseStartOffset, m_i64ParseLength;
+    int64_t m_i64ParseFrameCount{0};
     MediaCore::MediaParser::Holder m_hParser;
     MediaCore::VideoClip::Holder m_hParseVclip;
     MediaCore::VideoClip::Holder m_hPreviewVclip;
+    SharedSourceDecoder::Holder m_hSrcDecoder;
     RenderUtils::TextureManager::Holder m_hTxMgr;
     RenderUtils::ManagedTexture::Holder m_hPrevwTx1, m_hPrevwTx2;
     const MediaCore::VideoStream* m_pVidstm{nullptr};
@@ -1068,15 +1710,29 @@ private:
     bool m_bUseSrcAttr;
     // scene detect parameters
     float m_fSceneDetectThresh{0.4f};
+    bool m_bUseNativeScorer{false};
+    static constexpr int NATIVE_SCORER_LUMA_WIDTH = 160;
     // output
     size_t m_resultHash;
     string m_resultId;
     string m_strOutputPath;
     vector<_SceneCutPoint> m_aSceneCutPoints;
     list<float> m_aDiffScores;
+    string m_strResultFileName;
+    bool m_bResultLoaded{true};
     // task control
+    static const int MAX_PARSE_CHUNK_COUNT = 8;
+    static const int64_t MIN_PARSE_CHUNK_FRAMES = 300;
+    static const int SEED_FRAME_COUNT = 2;
+    vector<_ParseChunk> m_aParseChunks;
+    mutex m_mtxChunkLock;
+    atomic_int32_t m_i32RunningWorkerCnt{0};
+    atomic_int32_t m_i32PausedWorkerCnt{0};
+    atomic_int32_t m_i32MaxWorkerCnt{max((int)thread::hardware_concurrency()/2, 1)};
     int64_t m_i64ParsedFrameIdx{0};
     float m_fProgress{0.f};
+    MetricsRecorder m_tMetricsRecorder;
+    Priority m_ePriority{PRIORITY_NORMAL};
     bool m_bPause{false};
     bool m_bPauseCheckPointHit{false};
     // ui vars
@@ -1090,6 +1746,9 @@ private:
 
 const string BgtaskSceneDetect::TASK_TYPE_NAME = "Scene Detect";
 const string BgtaskSceneDetect::TASK_RESULT_META_NAME = "SceneDetectResult";
+const string BgtaskSceneDetect::RESULT_FILE_NAME = "scene_detect_result.bin";
+const char BgtaskSceneDetect::RESULT_FILE_MAGIC[] = "MSDR";
+const uint32_t BgtaskSceneDetect::RESULT_FILE_VERSION = 1;
 
 static const auto _BGTASK_SCENEDETECT_DELETER = [] (BackgroundTask* p) {
     BgtaskSceneDetect* ptr = dynamic_cast<BgtaskSceneDetect*>(p);
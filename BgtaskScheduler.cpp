@@ -0,0 +1,354 @@
+#include <list>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <sstream>
+#include "BgtaskScheduler.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+class BgtaskScheduler_Impl : public BgtaskScheduler
+{
+public:
+    BgtaskScheduler_Impl(const string& name, SysUtils::ThreadPoolExecutor::Holder hExctor)
+        : m_name(name), m_hExctor(hExctor)
+    {
+        m_pLogger = GetLogger(name);
+        m_aMaxConcurrency[BackgroundTask::RC_DECODE] = DEFAULT_MAX_DECODE_TASK_COUNT;
+        m_aMaxConcurrency[BackgroundTask::RC_ENCODE] = DEFAULT_MAX_ENCODE_TASK_COUNT;
+        m_aMaxConcurrency[BackgroundTask::RC_IO] = DEFAULT_MAX_IO_TASK_COUNT;
+        const int iHwWorkerCnt = max((int)thread::hardware_concurrency()/2, 1);
+        m_aWorkerBudget[BackgroundTask::RC_DECODE] = iHwWorkerCnt;
+        m_aWorkerBudget[BackgroundTask::RC_ENCODE] = iHwWorkerCnt;
+        m_aWorkerBudget[BackgroundTask::RC_IO] = DEFAULT_MAX_IO_TASK_COUNT;
+        m_thScheduleThread = thread(&BgtaskScheduler_Impl::ScheduleProc, this);
+        Tracer::NameThread(m_thScheduleThread, name);
+    }
+
+    ~BgtaskScheduler_Impl()
+    {
+        m_bQuit = true;
+        if (m_thScheduleThread.joinable())
+            m_thScheduleThread.join();
+    }
+
+    bool EnqueueTask(BackgroundTask::Holder hTask) override
+    {
+        if (!hTask)
+            return false;
+        lock_guard<mutex> lk(m_mtxTaskLock);
+        auto itFound = find_if(m_aTaskEntries.begin(), m_aTaskEntries.end(), [hTask] (const _TaskEntry& e) {
+            return e.hTask == hTask;
+        });
+        if (itFound != m_aTaskEntries.end())
+            return true;
+        _TaskEntry tEntry;
+        tEntry.hTask = hTask;
+        tEntry.u64Seq = m_u64NextSeq++;
+        m_aTaskEntries.push_back(tEntry);
+        m_pLogger->Log(DEBUG) << "Task #" << tEntry.u64Seq << " is queued with priority '" << GetPriorityName(hTask->GetPriority())
+                << "' and resource class '" << GetResourceClassName(hTask->GetResourceClass()) << "'." << endl;
+        return true;
+    }
+
+    bool RemoveTask(BackgroundTask::Holder hTask) override
+    {
+        lock_guard<mutex> lk(m_mtxTaskLock);
+        auto itRem = find_if(m_aTaskEntries.begin(), m_aTaskEntries.end(), [hTask] (const _TaskEntry& e) {
+            return e.hTask == hTask;
+        });
+        if (itRem == m_aTaskEntries.end())
+            return false;
+        if (itRem->bThrottled)
+            itRem->hTask->Resume();
+        m_aTaskEntries.erase(itRem);
+        return true;
+    }
+
+    void SetForegroundState(ForegroundState eState) override
+    {
+        if (m_eFgState == eState)
+            return;
+        m_pLogger->Log(DEBUG) << "Foreground state changed from " << (int)m_eFgState.load() << " to " << (int)eState << "." << endl;
+        m_eFgState = eState;
+    }
+
+    ForegroundState GetForegroundState() const override
+    {
+        return m_eFgState;
+    }
+
+    void SetMaxConcurrency(BackgroundTask::ResourceClass eClass, int iMaxCnt) override
+    {
+        if (eClass < 0 || eClass >= BackgroundTask::RC_COUNT)
+            return;
+        m_aMaxConcurrency[eClass] = iMaxCnt < 1 ? 1 : iMaxCnt;
+    }
+
+    int GetMaxConcurrency(BackgroundTask::ResourceClass eClass) const override
+    {
+        if (eClass < 0 || eClass >= BackgroundTask::RC_COUNT)
+            return 0;
+        return m_aMaxConcurrency[eClass];
+    }
+
+    void SetWorkerBudget(BackgroundTask::ResourceClass eClass, int iWorkerCnt) override
+    {
+        if (eClass < 0 || eClass >= BackgroundTask::RC_COUNT)
+            return;
+        m_aWorkerBudget[eClass] = iWorkerCnt < 1 ? 1 : iWorkerCnt;
+    }
+
+    int GetWorkerBudget(BackgroundTask::ResourceClass eClass) const override
+    {
+        if (eClass < 0 || eClass >= BackgroundTask::RC_COUNT)
+            return 0;
+        return m_aWorkerBudget[eClass];
+    }
+
+    TaskQueueState GetTaskQueueState(BackgroundTask::Holder hTask) const override
+    {
+        lock_guard<mutex> lk(m_mtxTaskLock);
+        auto itFound = find_if(m_aTaskEntries.begin(), m_aTaskEntries.end(), [hTask] (const _TaskEntry& e) {
+            return e.hTask == hTask;
+        });
+        if (itFound == m_aTaskEntries.end())
+            return QS_FINISHED;
+        return GetEntryQueueState(*itFound);
+    }
+
+    QueueStats GetQueueStats() const override
+    {
+        QueueStats tStats;
+        for (int i = 0; i < BackgroundTask::RC_COUNT; i++)
+        {
+            tStats.aMaxConcurrency[i] = GetEffectiveMaxConcurrency((BackgroundTask::ResourceClass)i);
+            tStats.aWorkerBudget[i] = m_aWorkerBudget[i];
+        }
+        lock_guard<mutex> lk(m_mtxTaskLock);
+        for (const auto& tEntry : m_aTaskEntries)
+        {
+            const auto eQueueState = GetEntryQueueState(tEntry);
+            if (eQueueState == QS_RUNNING)
+                tStats.aRunningCnt[tEntry.hTask->GetResourceClass()]++;
+            else if (eQueueState == QS_PENDING)
+                tStats.iPendingCnt++;
+            else if (eQueueState == QS_THROTTLED)
+                tStats.iThrottledCnt++;
+            else if (eQueueState == QS_USER_PAUSED)
+                tStats.iUserPausedCnt++;
+        }
+        return tStats;
+    }
+
+    void SetLogLevel(Logger::Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+private:
+    struct _TaskEntry
+    {
+        BackgroundTask::Holder hTask;
+        uint64_t u64Seq{0};
+        bool bDispatched{false};
+        bool bThrottled{false};
+    };
+
+    static bool IsTaskFinished(BackgroundTask::Holder hTask)
+    {
+        return hTask->IsDone() || hTask->IsFailed() || hTask->IsCancelled();
+    }
+
+    static TaskQueueState GetEntryQueueState(const _TaskEntry& tEntry)
+    {
+        if (IsTaskFinished(tEntry.hTask))
+            return QS_FINISHED;
+        if (!tEntry.bDispatched)
+            return QS_PENDING;
+        if (tEntry.bThrottled)
+            return QS_THROTTLED;
+        if (tEntry.hTask->IsPaused())
+            return QS_USER_PAUSED;
+        return QS_RUNNING;
+    }
+
+    int GetEffectiveMaxConcurrency(BackgroundTask::ResourceClass eClass) const
+    {
+        const auto eFgState = m_eFgState.load();
+        if (eFgState == FG_EXPORTING)
+            return 0;
+        if (eFgState == FG_PLAYING)
+            return min(m_aMaxConcurrency[eClass].load(), 1);
+        return m_aMaxConcurrency[eClass];
+    }
+
+    void ScheduleProc()
+    {
+        m_pLogger->Log(DEBUG) << "Enter ScheduleProc()..." << endl;
+        while (!m_bQuit)
+        {
+            Schedule();
+            this_thread::sleep_for(chrono::milliseconds(SCHEDULE_INTERVAL));
+        }
+        m_pLogger->Log(DEBUG) << "Leave ScheduleProc()." << endl;
+    }
+
+    void Schedule()
+    {
+        lock_guard<mutex> lk(m_mtxTaskLock);
+        // drop the finished tasks, and the ones cancelled before being dispatched
+        auto itEntry = m_aTaskEntries.begin();
+        while (itEntry != m_aTaskEntries.end())
+        {
+            if (IsTaskFinished(itEntry->hTask) || (!itEntry->bDispatched && itEntry->hTask->IsCancelled()))
+                itEntry = m_aTaskEntries.erase(itEntry);
+            else
+                itEntry++;
+        }
+
+        // tasks paused by the user don't take a slot, the others compete for the slots in the order of priority
+        vector<_TaskEntry*> aCandidates;
+        for (auto& tEntry : m_aTaskEntries)
+        {
+            if (GetEntryQueueState(tEntry) != QS_USER_PAUSED)
+                aCandidates.push_back(&tEntry);
+        }
+        stable_sort(aCandidates.begin(), aCandidates.end(), [] (const _TaskEntry* a, const _TaskEntry* b) {
+            return a->hTask->GetPriority() > b->hTask->GetPriority();
+        });
+
+        const auto eFgState = m_eFgState.load();
+        int aRunningCnt[BackgroundTask::RC_COUNT]{0};
+        vector<_TaskEntry*> aRunningEntries[BackgroundTask::RC_COUNT];
+        for (auto pEntry : aCandidates)
+        {
+            auto& hTask = pEntry->hTask;
+            const auto eClass = hTask->GetResourceClass();
+            bool bAllowed = aRunningCnt[eClass] < GetEffectiveMaxConcurrency(eClass);
+            if (eFgState == FG_PLAYING && hTask->GetPriority() < BackgroundTask::PRIORITY_HIGH)
+                bAllowed = false;
+            if (bAllowed)
+            {
+                aRunningCnt[eClass]++;
+                if (!pEntry->bDispatched)
+                {
+                    if (!m_hExctor || !m_hExctor->EnqueueTask(hTask))
+                    {
+                        m_pLogger->Log(Error) << "FAILED to dispatch task #" << pEntry->u64Seq << " to the executor!" << endl;
+                        aRunningCnt[eClass]--;
+                        continue;
+                    }
+                    pEntry->bDispatched = true;
+                    m_pLogger->Log(DEBUG) << "Task #" << pEntry->u64Seq << " is dispatched." << endl;
+                }
+                else if (pEntry->bThrottled)
+                {
+                    pEntry->bThrottled = false;
+                    hTask->Resume();
+                    m_pLogger->Log(DEBUG) << "Task #" << pEntry->u64Seq << " is resumed." << endl;
+                }
+                aRunningEntries[eClass].push_back(pEntry);
+            }
+            else if (pEntry->bDispatched)
+            {
+                // pause it again even if it's already throttled, in case it's resumed from the task ui
+                hTask->Pause();
+                if (!pEntry->bThrottled)
+                {
+                    pEntry->bThrottled = true;
+                    m_pLogger->Log(DEBUG) << "Task #" << pEntry->u64Seq << " is throttled." << endl;
+                }
+            }
+        }
+
+        // share the worker budget of each class among its running tasks, the higher priority ones get the remainder
+        for (int i = 0; i < BackgroundTask::RC_COUNT; i++)
+        {
+            const auto& aEntries = aRunningEntries[i];
+            if (aEntries.empty())
+                continue;
+            const int iTaskCnt = (int)aEntries.size();
+            const int iBudget = eFgState == FG_PLAYING ? iTaskCnt : max(m_aWorkerBudget[i].load(), iTaskCnt);
+            for (int j = 0; j < iTaskCnt; j++)
+            {
+                const int iWorkerCnt = iBudget/iTaskCnt+(j < iBudget%iTaskCnt ? 1 : 0);
+                auto& hTask = aEntries[j]->hTask;
+                if (hTask->GetMaxWorkerCount() != iWorkerCnt)
+                {
+                    hTask->SetMaxWorkerCount(iWorkerCnt);
+                    m_pLogger->Log(DEBUG) << "Task #" << aEntries[j]->u64Seq << " may run " << iWorkerCnt << " worker(s)." << endl;
+                }
+            }
+        }
+    }
+
+private:
+    static const int SCHEDULE_INTERVAL;
+    static const int DEFAULT_MAX_DECODE_TASK_COUNT;
+    static const int DEFAULT_MAX_ENCODE_TASK_COUNT;
+    static const int DEFAULT_MAX_IO_TASK_COUNT;
+
+    string m_name;
+    ALogger* m_pLogger;
+    SysUtils::ThreadPoolExecutor::Holder m_hExctor;
+    list<_TaskEntry> m_aTaskEntries;
+    mutable mutex m_mtxTaskLock;
+    uint64_t m_u64NextSeq{0};
+    atomic<ForegroundState> m_eFgState{FG_IDLE};
+    atomic_int m_aMaxConcurrency[BackgroundTask::RC_COUNT];
+    atomic_int m_aWorkerBudget[BackgroundTask::RC_COUNT];
+    thread m_thScheduleThread;
+    atomic_bool m_bQuit{false};
+};
+
+const int BgtaskScheduler_Impl::SCHEDULE_INTERVAL = 50;
+// every analysis task already runs several decoding workers itself
+const int BgtaskScheduler_Impl::DEFAULT_MAX_DECODE_TASK_COUNT = 2;
+const int BgtaskScheduler_Impl::DEFAULT_MAX_ENCODE_TASK_COUNT = 1;
+const int BgtaskScheduler_Impl::DEFAULT_MAX_IO_TASK_COUNT = 2;
+
+static const auto BGTASK_SCHEDULER_DELETER = [] (BgtaskScheduler* p) {
+    BgtaskScheduler_Impl* ptr = dynamic_cast<BgtaskScheduler_Impl*>(p);
+    delete ptr;
+};
+
+BgtaskScheduler::Holder BgtaskScheduler::CreateInstance(const string& name, SysUtils::ThreadPoolExecutor::Holder hExctor)
+{
+    return BgtaskScheduler::Holder(new BgtaskScheduler_Impl(name, hExctor), BGTASK_SCHEDULER_DELETER);
+}
+
+string BgtaskScheduler::GetResourceClassName(BackgroundTask::ResourceClass eClass)
+{
+    switch (eClass)
+    {
+    case BackgroundTask::RC_DECODE:
+        return "Decode";
+    case BackgroundTask::RC_ENCODE:
+        return "Encode";
+    case BackgroundTask::RC_IO:
+        return "IO";
+    default:
+        return "Unknown";
+    }
+}
+
+string BgtaskScheduler::GetPriorityName(BackgroundTask::Priority ePriority)
+{
+    switch (ePriority)
+    {
+    case BackgroundTask::PRIORITY_LOW:
+        return "Low";
+    case BackgroundTask::PRIORITY_NORMAL:
+        return "Normal";
+    case BackgroundTask::PRIORITY_HIGH:
+        return "High";
+    default:
+        return "Unknown";
+    }
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <ThreadUtils.h>
+#include <Logger.h>
+#include "BackgroundTask.h"
+
+namespace MEC
+{
+    // Decides when the background tasks are handed to the executor, and pauses/resumes them according to their
+    // priorities, the concurrency limit of each resource class, and what the foreground (preview playback or
+    // exporting) is doing. A task paused by the user is left alone and does not take a running slot.
+    struct BgtaskScheduler
+    {
+        using Holder = std::shared_ptr<BgtaskScheduler>;
+        static Holder CreateInstance(const std::string& name, SysUtils::ThreadPoolExecutor::Holder hExctor);
+
+        virtual bool EnqueueTask(BackgroundTask::Holder hTask) = 0;
+        virtual bool RemoveTask(BackgroundTask::Holder hTask) = 0;
+
+        enum ForegroundState
+        {
+            FG_IDLE = 0,
+            FG_PLAYING,     // only high priority tasks keep running, at most one of each resource class with one worker
+            FG_EXPORTING,   // all the tasks are paused
+        };
+        virtual void SetForegroundState(ForegroundState eState) = 0;
+        virtual ForegroundState GetForegroundState() const = 0;
+        virtual void SetMaxConcurrency(BackgroundTask::ResourceClass eClass, int iMaxCnt) = 0;
+        virtual int GetMaxConcurrency(BackgroundTask::ResourceClass eClass) const = 0;
+        // Total worker threads shared by the running tasks of a resource class, see 'BackgroundTask::SetMaxWorkerCount()'
+        virtual void SetWorkerBudget(BackgroundTask::ResourceClass eClass, int iWorkerCnt) = 0;
+        virtual int GetWorkerBudget(BackgroundTask::ResourceClass eClass) const = 0;
+
+        enum TaskQueueState
+        {
+            QS_PENDING = 0,     // not handed to the executor yet
+            QS_RUNNING,
+            QS_THROTTLED,       // paused by the scheduler, will be resumed when a slot is available
+            QS_USER_PAUSED,
+            QS_FINISHED,
+        };
+        virtual TaskQueueState GetTaskQueueState(BackgroundTask::Holder hTask) const = 0;
+
+        struct QueueStats
+        {
+            int aRunningCnt[BackgroundTask::RC_COUNT]{0};
+            int aMaxConcurrency[BackgroundTask::RC_COUNT]{0};
+            int aWorkerBudget[BackgroundTask::RC_COUNT]{0};
+            int iPendingCnt{0};
+            int iThrottledCnt{0};
+            int iUserPausedCnt{0};
+        };
+        virtual QueueStats GetQueueStats() const = 0;
+
+        virtual void SetLogLevel(Logger::Level l) = 0;
+
+        static std::string GetResourceClassName(BackgroundTask::ResourceClass eClass);
+        static std::string GetPriorityName(BackgroundTask::Priority ePriority);
+    };
+}
@@ -4,7 +4,14 @@
 #include <iomanip>
 #include <vector>
 #include <cmath>
+#include <cstring>
+#include <cstdio>
 #include <cassert>
+#include <fstream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
 #include <TimeUtils.h>
 #include <FileSystemUtils.h>
 #include <MediaParser.h>
@@ -13,13 +20,16 @@
 #include <FFUtils.h>
 #include <imgui.h>
 #include "BackgroundTask.h"
+#include "SharedSourceDecoder.h"
 #include "MediaTimeline.h"
 extern "C"
 {
 #include "libavutil/avutil.h"
+#include "libavutil/opt.h"
 #include "libavfilter/avfilter.h"
 #include "libavfilter/buffersrc.h"
 #include "libavfilter/buffersink.h"
+#include "libavformat/avformat.h"
 }
 
 
@@ -39,7 +49,7 @@ public:
 
     ~BgtaskVidstab()
     {
-        ReleaseFilterGraph();
+        ReleaseFilterGraph(m_tDetectFg);
     }
 
     bool Initialize(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings)
@@ -113,6 +123,13 @@ public:
             return false;
         }
         m_bIsImageSeq = jnTask[strAttrName].get<json::boolean>();
+        // read 'priority'
+        strAttrName = "priority";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+        {
+            const auto iPriority = (int)jnTask[strAttrName].get<json::number>();
+            m_ePriority = (Priority)max((int)PRIORITY_LOW, min(iPriority, (int)PRIORITY_HIGH));
+        }
         // read 'clip_id'
         strAttrName = "clip_id";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
@@ -303,6 +320,7 @@ public:
             return false;
         }
         m_hVclip = hVclip;
+        m_hSrcDecoder = SharedSourceDecoder::GetInstance(m_strSrcUrl, m_hSettings);
         // read 'vidstabdetect' arguments
         strAttrName = "vidstab_arg_shakiness";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
@@ -564,6 +582,25 @@ public:
             m_bVidstabTransformFinished = jnTask[strAttrName].get<json::boolean>();
         else
             m_bVidstabTransformFinished = false;
+        strAttrName = "vidstab_parallel_transform";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            m_bParallelTransform = jnTask[strAttrName].get<json::boolean>();
+        strAttrName = "vidstab_static_optzoom";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_fStaticOptZoom = (float)jnTask[strAttrName].get<json::number>();
+        strAttrName = "vidstab_transform_segments";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_array())
+        {
+            const auto& jnSegments = jnTask[strAttrName].get<json::array>();
+            for (const auto& jnElem : jnSegments)
+            {
+                auto tSeg = _TransformSegment::FromJson(jnElem);
+                // a segment file lost since the last run invalidates itself and all the segments after it
+                if (!SysUtils::IsFile(tSeg.strPath))
+                    break;
+                m_aTransformSegments.push_back(std::move(tSeg));
+            }
+        }
         bool bFailed = false;
         strAttrName = "is_task_failed";
         if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
@@ -586,6 +623,32 @@ public:
         m_pCb = pCb;
     }
 
+    Priority GetPriority() const override
+    {
+        return m_ePriority;
+    }
+
+    void SetPriority(Priority ePriority) override
+    {
+        m_ePriority = ePriority;
+    }
+
+    ResourceClass GetResourceClass() const override
+    {
+        // the detect pass is bound by decoding, the transform pass is bound by encoding
+        return m_bVidstabDetectFinished ? RC_ENCODE : RC_DECODE;
+    }
+
+    void SetMaxWorkerCount(int iMaxCnt) override
+    {
+        m_i32MaxWorkerCnt = iMaxCnt < 1 ? 1 : iMaxCnt;
+    }
+
+    int GetMaxWorkerCount() const override
+    {
+        return m_i32MaxWorkerCnt;
+    }
+
     bool CanPause()
     {
         return m_eState == PROCESSING;
@@ -724,7 +787,12 @@ public:
 
     void DrawContentCompact() override
     {
+        GetMetrics().DrawCompact();
+    }
 
+    Metrics GetMetrics() const override
+    {
+        return m_tMetricsRecorder.GetSnapshot(m_fProgress);
     }
 
     bool SaveAsJson(json::value& jnTask) override
@@ -738,6 +806,7 @@ public:
         jnTask["source_url"] = m_strSrcUrl;
         jnTask["is_image_seq"] = m_bIsImageSeq;
         jnTask["clip_id"] = json::number(m_i64ClipId);
+        jnTask["priority"] = json::number((int)m_ePriority);
         json::value jnSettings;
         if (!m_hSettings->SaveAsJson(jnSettings))
         {
@@ -808,9 +877,19 @@ public:
         jnTask["videnc_extra_opts"] = jnExtraOpts;
         // save task status
         jnTask["is_vidstab_detect_done"] = m_bVidstabDetectFinished;
+        jnTask["vidstab_parallel_transform"] = m_bParallelTransform;
+        jnTask["vidstab_static_optzoom"] = json::number(m_fStaticOptZoom);
         jnTask["is_vidstab_transform_done"] = m_bVidstabTransformFinished;
+        json::array jnSegments;
+        {
+            lock_guard<mutex> lk(m_mtxWorkerLock);
+            for (const auto& elem : m_aTransformSegments)
+                jnSegments.push_back(elem.SaveAsJson());
+        }
+        jnTask["vidstab_transform_segments"] = jnSegments;
         jnTask["is_task_failed"] = IsFailed();
         jnTask["error_message"] = m_errMsg;
+        jnTask["metrics"] = GetMetrics().SaveAsJson();
         return true;
     }
 
@@ -852,6 +931,7 @@ public:
 protected:
     bool _TaskProc () override
     {
+        MEC_TRACE_SCOPE("Bgtask::Run");
         m_pLogger->Log(INFO) << "Start background task 'Vidstab' for '" << m_strSrcUrl << "'." << endl;
         if (!m_bInited)
         {
@@ -868,71 +948,103 @@ protected:
         ImMatToAVFrameConverter tMat2AvfrmCvter;
         tMat2AvfrmCvter.SetOutPixelFormat(m_eFgInputPixfmt);
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        const int64_t i64FrameCount = (int64_t)ceil((double)i64ClipDur*tFrameRate.num/((double)tFrameRate.den*1000));
+        {
+            // frames left to go through in this run, both passes count
+            int64_t i64TotalFrames = 0;
+            if (!m_bVidstabDetectFinished)
+                i64TotalFrames += max(i64FrameCount-CountTrfFrames(m_strTrfPath), (int64_t)0);
+            if (!m_bVidstabTransformFinished)
+            {
+                int64_t i64TransformedFrmCnt = 0;
+                for (const auto& tSeg : m_aTransformSegments)
+                    i64TransformedFrmCnt += tSeg.i64FrameCount;
+                i64TotalFrames += max(i64FrameCount-i64TransformedFrmCnt, (int64_t)0);
+            }
+            m_tMetricsRecorder.SetTotalFrames(i64TotalFrames);
+        }
+        bool bEof = false;
         if (!m_bVidstabDetectFinished)
         {
+            // frames already detected in the previous runs are kept in the transforms file, resume after them.
+            // 'vidstabdetect' always rewrites its result file, so the remaining frames are detected into a segment
+            // file, which is appended to the transforms file when the pass stops.
+            const string strTrfSegPath = m_strTrfPath+".seg";
+            if (SysUtils::IsFile(strTrfSegPath))
+                AppendTrfSegment(strTrfSegPath);
+            const int64_t i64DetectedFrmCnt = CountTrfFrames(m_strTrfPath);
+            const bool bDetectIntoSegment = i64DetectedFrmCnt > 0;
+            if (bDetectIntoSegment)
+            {
+                // start from the last detected frame, which is fed only to provide the reference for the next one
+                i64FrmIdx = i64DetectedFrmCnt-1;
+                m_hVclip->SeekTo(FrameIndexToMillisec(i64FrmIdx));
+                m_pLogger->Log(INFO) << "Resume 'vidstabdetect' pass from frame #" << i64DetectedFrmCnt << "." << endl;
+            }
+            // the detect pass reads the source through the shared decoder, other analyses on the same source can reuse its frames
+            auto hSrcReader = m_hSrcDecoder->AttachReader(this);
             SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
+            bool bPaused = false;
+            m_tMetricsRecorder.SetActive(true);
             while (!IsCancelled())
             {
                 if (m_bPause)
                 {
+                    if (!bPaused)
+                    {
+                        m_tMetricsRecorder.SetActive(false);
+                        bPaused = true;
+                    }
                     m_bPauseCheckPointHit = true;
                     this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
                     continue;
                 }
+                if (bPaused)
+                {
+                    m_tMetricsRecorder.SetActive(true);
+                    bPaused = false;
+                }
 
                 int fferr;
                 SelfFreeAVFramePtr hFgInfrmPtr;
-                const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
-                bool bEof = false;
-                auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
-                ImMatWrapper_AVFrame tAvfrmWrapper;
-                if (hVfrm)
+                const int64_t i64ReadPos = FrameIndexToMillisec(i64FrmIdx);
+                MediaCore::VideoFrame::Holder hVfrm;
                 {
-                    auto tNativeData = hVfrm->GetNativeData();
-                    if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
-                        hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
-                        hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
-                    {
-                        const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
-                        if (vmat.device != IM_DD_CPU)
-                        {
-                            hFgInfrmPtr = AllocSelfFreeAVFramePtr();
-                            tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
-                        }
-                        else
-                        {
-                            tAvfrmWrapper.SetMat(vmat);
-                            hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
-                        }
-                    }
+                    MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                    hVfrm = m_hSrcDecoder->ReadSourceFrame(hSrcReader, m_hVclip, i64ReadPos, bEof);
                 }
+                ImMatWrapper_AVFrame tAvfrmWrapper;
+                if (hVfrm)
+                    hFgInfrmPtr = GetFilterGraphInputFrame(hVfrm, tMat2AvfrmCvter, tAvfrmWrapper, i64FrmIdx);
                 if (hFgInfrmPtr)
                 {
+                    MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                    m_tMetricsRecorder.AddFrames();
                     hFgInfrmPtr->pts = i64FrmIdx;
                     if (!bFilterGraphInited)
                     {
-                        if (!SetupVidstabDetectFilterGraph(hFgInfrmPtr.get()))
+                        if (!SetupVidstabDetectFilterGraph(m_tDetectFg, hFgInfrmPtr.get(), bDetectIntoSegment ? strTrfSegPath : m_strTrfPath))
                         {
                             m_pLogger->Log(Error) << "'SetupVidstabDetectFilterGraph()' FAILED!" << endl;
+                            m_tMetricsRecorder.SetActive(false);
                             return false;
                         }
                         bFilterGraphInited = true;
                     }
 
-                    fferr = av_buffersrc_add_frame(m_pBufsrcCtx, hFgInfrmPtr.get());
+                    fferr = av_buffersrc_add_frame(m_tDetectFg.pBufsrcCtx, hFgInfrmPtr.get());
                     if (fferr < 0)
                     {
                         ostringstream oss; oss << "Background task 'Vidstab-detect' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << (i64FrmIdx-1)
                                 << ". fferr=" << fferr << ".";
                         m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                        m_tMetricsRecorder.SetActive(false);
                         return false;
                     }
                     i64FrmIdx++;
 
                     av_frame_unref(hFgOutfrmPtr.get());
-                    fferr = av_buffersink_get_frame(m_pBufsinkCtx, hFgOutfrmPtr.get());
+                    fferr = av_buffersink_get_frame(m_tDetectFg.pBufsinkCtx, hFgOutfrmPtr.get());
                     if (fferr != AVERROR(EAGAIN))
                     {
                         if (fferr < 0)
@@ -940,6 +1052,7 @@ protected:
                             ostringstream oss; oss << "Background task 'Vidstab-detect' FAILED when invoking 'av_buff5ersink_get_frame()' at frame #" << (i64FrmIdx-1)
                                     << ". fferr=" << fferr << ".";
                             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                            m_tMetricsRecorder.SetActive(false);
                             return false;
                         }
                     }
@@ -949,149 +1062,820 @@ protected:
                 if (bEof)
                     break;
             }
+            if (!bPaused)
+                m_tMetricsRecorder.SetActive(false);
+            // releasing the filter-graph closes the result file
+            ReleaseFilterGraph(m_tDetectFg);
+            if (bDetectIntoSegment && !AppendTrfSegment(strTrfSegPath))
+            {
+                m_errMsg = "FAILED to append the detected transforms segment!"; m_pLogger->Log(Error) << m_errMsg << endl;
+                return false;
+            }
+            if (!bEof)
+            {
+                Save("");
+                m_pLogger->Log(INFO) << "Quit background task 'Vidstab' for '" << m_strSrcUrl << "' during the detect pass." << endl;
+                return true;
+            }
             m_bVidstabDetectFinished = true;
-            ReleaseFilterGraph();
         }
         fAccumShares += fStageShare;
         m_fProgress = fAccumShares;
 
         fStageProgress = 0.f; fStageShare = 0.5f;
-        i64FrmIdx = 0;
-        m_hVclip->SeekTo(0);
-        bFilterGraphInited = false;
-        bool bEncoderInited = false;
         if (!m_bVidstabTransformFinished)
         {
-            SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
+            // the frames not yet covered by any encoded segment are split into ranges, and each range is transformed
+            // and encoded into its own segment by a worker thread. The segments are concatenated in order at the end.
+            // Ranges are only split when each of them can start from a short lead-in, otherwise every worker would
+            // feed all the frames before its range again. The worker count follows the budget of the scheduler.
+            // the static optimal zoom depends on the whole clip, it's computed once so that all the ranges use the same zoom
+            if (m_bParallelTransform && m_u8OptZoom == 1 && m_fStaticOptZoom < 0 && m_aTransformSegments.empty()
+                && m_u8OptAlgo == 0 && m_u8CropMode == 1 && m_u32Smoothing > 0)
+            {
+                float fZoom;
+                if (CalcStaticOptimalZoom(fZoom))
+                {
+                    m_fStaticOptZoom = fZoom;
+                    m_pLogger->Log(INFO) << "Static optimal zoom for the transform pass is " << fZoom << "%." << endl;
+                }
+            }
+            const bool bSplitRanges = m_bParallelTransform && IsTransformWindowLocal();
+            int64_t i64TransformedFrmCnt = 0;
+            for (const auto& tSeg : m_aTransformSegments)
+                i64TransformedFrmCnt += tSeg.i64FrameCount;
+            m_i64TransformedFrmCnt = i64TransformedFrmCnt;
+            m_i64TransformEofFrmIdx = -1;
             while (!IsCancelled())
             {
-                if (m_bPause)
+                const int iWorkerCnt = bSplitRanges ? min(GetMaxWorkerCount(), MAX_TRANSFORM_WORKER_COUNT) : 1;
+                auto aRanges = GetPendingTransformRanges(i64FrameCount, iWorkerCnt);
+                if (aRanges.empty())
+                    break;
+                if ((int)aRanges.size() > iWorkerCnt)
+                    aRanges.resize(iWorkerCnt);
+                const int64_t i64PrevTransformedFrmCnt = m_i64TransformedFrmCnt;
+                const int64_t i64PrevEofFrmIdx = m_i64TransformEofFrmIdx;
+                atomic_bool bFailed{false};
+                vector<thread> aWorkerThreads;
+                m_i32RunningWorkerCnt = 0;
+                m_i32PausedWorkerCnt = 0;
+                for (const auto& tRange : aRanges)
                 {
-                    m_bPauseCheckPointHit = true;
+                    auto hVclip = aWorkerThreads.empty() ? m_hVclip : m_hVclip->Clone(m_hSettings);
+                    if (!hVclip)
+                    {
+                        m_errMsg = "FAILED to clone VideoClip instance for transform worker!"; m_pLogger->Log(Error) << m_errMsg << endl;
+                        bFailed = true;
+                        break;
+                    }
+                    m_pLogger->Log(DEBUG) << "Transform frame range [" << tRange.first << ", " << tRange.second << ")." << endl;
+                    m_i32RunningWorkerCnt++;
+                    aWorkerThreads.push_back(thread([this, tRange, hVclip, &bFailed] () {
+                        bool bYielded = false;
+                        if (!TransformFrameRange(tRange.first, tRange.second, hVclip, bFailed, bYielded))
+                            bFailed = true;
+                        // a yielded worker has already given its slot back
+                        if (!bYielded)
+                            m_i32RunningWorkerCnt--;
+                    }));
+                    ostringstream oss; oss << "VidstabTrans#" << tRange.first;
+                    Tracer::NameThread(aWorkerThreads.back(), oss.str());
+                }
+                while (m_i32RunningWorkerCnt > 0)
+                {
+                    m_bPauseCheckPointHit = m_bPause && m_i32PausedWorkerCnt >= m_i32RunningWorkerCnt;
+                    fStageProgress = i64FrameCount > 0 ? min((float)((double)m_i64TransformedFrmCnt/i64FrameCount), 1.f) : 0.f;
+                    m_fProgress = fAccumShares+(fStageProgress*fStageShare);
                     this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                }
+                for (auto& t : aWorkerThreads)
+                    t.join();
+                if (bFailed)
+                    return false;
+                if (!IsCancelled() && m_i64TransformedFrmCnt == i64PrevTransformedFrmCnt && m_i64TransformEofFrmIdx == i64PrevEofFrmIdx)
+                {
+                    m_errMsg = "Vidstab transform pass makes no progress!"; m_pLogger->Log(Error) << m_errMsg << endl;
+                    return false;
+                }
+            }
+            if (IsCancelled())
+            {
+                Save("");
+                m_pLogger->Log(INFO) << "Quit background task 'Vidstab' for '" << m_strSrcUrl << "' during the transform pass." << endl;
+                return true;
+            }
+            if (!ConcatTransformSegments())
+                return false;
+            m_bVidstabTransformFinished = true;
+        }
+        fAccumShares += fStageShare;
+        m_fProgress = fAccumShares;
+
+        m_pLogger->Log(INFO) << "Quit background task 'Vidstab' for '" << m_strSrcUrl << "'." << endl;
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        ReleaseFilterGraph(m_tDetectFg);
+        return true;
+    }
+
+private:
+    struct _FilterGraph
+    {
+        AVFilterGraph* pFilterGraph{nullptr};
+        AVFilterContext* pBufsrcCtx{nullptr};
+        AVFilterContext* pBufsinkCtx{nullptr};
+        AVFilterInOut* pFilterOutputs{nullptr};
+        AVFilterInOut* pFilterInputs{nullptr};
+    };
+
+    struct _TransformSegment
+    {
+        string strPath;
+        int64_t i64StartFrmIdx;
+        int64_t i64FrameCount;
+
+        json::value SaveAsJson() const
+        {
+            json::value j;
+            j["path"] = strPath;
+            j["start_frame_index"] = json::number(i64StartFrmIdx);
+            j["frame_count"] = json::number(i64FrameCount);
+            return std::move(j);
+        }
+
+        static _TransformSegment FromJson(const json::value& j)
+        {
+            _TransformSegment newinst{"", 0, 0};
+            string strAttrName;
+            strAttrName = "path";
+            if (j.contains(strAttrName) && j[strAttrName].is_string())
+                newinst.strPath = j[strAttrName].get<json::string>();
+            strAttrName = "start_frame_index";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64StartFrmIdx = (int64_t)j[strAttrName].get<json::number>();
+            strAttrName = "frame_count";
+            if (j.contains(strAttrName) && j[strAttrName].is_number())
+                newinst.i64FrameCount = (int64_t)j[strAttrName].get<json::number>();
+            return std::move(newinst);
+        }
+    };
+
+    int64_t FrameIndexToMillisec(int64_t i64FrmIdx) const
+    {
+        const auto tFrameRate = m_hSettings->VideoOutFrameRate();
+        return round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
+    }
+
+    SelfFreeAVFramePtr GetFilterGraphInputFrame(MediaCore::VideoFrame::Holder hVfrm, ImMatToAVFrameConverter& tMat2AvfrmCvter, ImMatWrapper_AVFrame& tAvfrmWrapper, int64_t i64FrmIdx)
+    {
+        SelfFreeAVFramePtr hFgInfrmPtr;
+        auto tNativeData = hVfrm->GetNativeData();
+        if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
+            hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
+            hFgInfrmPtr = CloneSelfFreeAVFramePtr(((SelfFreeAVFramePtr*)tNativeData.pData)->get());  // the frame may be shared with other tasks
+        else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
+        {
+            const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
+            if (vmat.device != IM_DD_CPU)
+            {
+                hFgInfrmPtr = AllocSelfFreeAVFramePtr();
+                tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
+            }
+            else
+            {
+                tAvfrmWrapper.SetMat(vmat);
+                hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
+            }
+        }
+        return hFgInfrmPtr;
+    }
+
+    // Read the lines of a transforms file written by 'vidstabdetect' in ascii mode. Only the complete 'Frame' lines
+    // are returned in 'aFrameLines', the header and comment lines go into 'aHeaderLines'.
+    static bool ReadTrfFile(const string& strPath, vector<string>& aHeaderLines, vector<string>& aFrameLines)
+    {
+        ifstream ifs(strPath, ios::in|ios::binary);
+        if (!ifs.is_open())
+            return false;
+        string strLine;
+        if (!getline(ifs, strLine) || strLine.compare(0, 8, "VID.STAB") != 0)
+        {
+            if (!strLine.empty())
+                Log(WARN) << "Transforms file '" << strPath << "' is not in ascii format, it can not be resumed or sliced." << endl;
+            return false;
+        }
+        aHeaderLines.push_back(strLine);
+        while (getline(ifs, strLine))
+        {
+            if (ifs.eof())
+                break;  // the last line is not terminated, it's partially written
+            if (strLine.compare(0, 6, "Frame ") == 0)
+            {
+                if (strLine.empty() || strLine.back() != ')')
+                    break;
+                aFrameLines.push_back(strLine);
+            }
+            else if (aFrameLines.empty())
+            {
+                aHeaderLines.push_back(strLine);
+            }
+        }
+        return true;
+    }
+
+    int64_t CountTrfFrames(const string& strPath)
+    {
+        vector<string> aHeaderLines, aFrameLines;
+        if (!ReadTrfFile(strPath, aHeaderLines, aFrameLines))
+            return 0;
+        return (int64_t)aFrameLines.size();
+    }
+
+    // Append the frames detected into the segment file to the transforms file. The first frame of the segment is
+    // the last frame of the transforms file, it is dropped and the rest are renumbered to follow it.
+    bool AppendTrfSegment(const string& strSegPath)
+    {
+        vector<string> aHeaderLines, aFrameLines, aSegHeaderLines, aSegFrameLines;
+        const bool bHasTrf = ReadTrfFile(m_strTrfPath, aHeaderLines, aFrameLines);
+        if (bHasTrf && ReadTrfFile(strSegPath, aSegHeaderLines, aSegFrameLines) && !aSegFrameLines.empty())
+        {
+            ofstream ofs(m_strTrfPath, ios::out|ios::binary|ios::trunc);
+            if (!ofs.is_open())
+            {
+                m_pLogger->Log(Error) << "FAILED to open transforms file '" << m_strTrfPath << "' for writing!" << endl;
+                return false;
+            }
+            for (const auto& strLine : aHeaderLines)
+                ofs << strLine << '\n';
+            for (const auto& strLine : aFrameLines)
+                ofs << strLine << '\n';
+            int64_t i64FrameNum = (int64_t)aFrameLines.size();
+            for (size_t i = 1; i < aSegFrameLines.size(); i++)
+            {
+                const auto& strLine = aSegFrameLines[i];
+                const auto szNumEnd = strLine.find(' ', 6);
+                if (szNumEnd == string::npos)
+                    break;
+                ofs << "Frame " << ++i64FrameNum << strLine.substr(szNumEnd) << '\n';
+            }
+            ofs.close();
+            m_pLogger->Log(DEBUG) << "Appended " << (i64FrameNum-(int64_t)aFrameLines.size()) << " frames to the transforms file." << endl;
+        }
+        SysUtils::DeleteFileAt(strSegPath);
+        return true;
+    }
+
+    // The transform filter applies the transforms in the order of the frames it receives. With the gaussian camera
+    // path, a fixed zoom and black borders, the transform of a frame only depends on the detected motions within
+    // its smoothing window. A frame range can then be transformed with a transforms file sliced around it, starting
+    // from a short lead-in instead of the first frame. The static optimal zoom counts as fixed once it's computed.
+    bool IsTransformWindowLocal() const
+    {
+        const bool bFixedZoom = m_u8OptZoom == 0 || (m_u8OptZoom == 1 && m_fStaticOptZoom >= 0);
+        return m_u8OptAlgo == 0 && m_u32Smoothing > 0 && m_u8CropMode == 1 && bFixedZoom;
+    }
+
+    struct _LocalMotion
+    {
+        double dVx, dVy;
+        double dFx, dFy, dSize;
+    };
+
+    // mean of the values without the smallest and the largest fifth
+    static double _CleanMean(vector<double>& aValues)
+    {
+        if (aValues.empty())
+            return 0;
+        sort(aValues.begin(), aValues.end());
+        const size_t szCut = aValues.size()/5;
+        double dSum = 0;
+        for (size_t i = szCut; i < aValues.size()-szCut; i++)
+            dSum += aValues[i];
+        return dSum/(aValues.size()-szCut*2);
+    }
+
+    // Estimate the transform of one frame from its local motions, the same way as the simple motion model of vid.stab
+    static void _EstimateFrameTransform(const vector<_LocalMotion>& aMotions, double dWidth, double dHeight, double& dX, double& dY, double& dAlpha)
+    {
+        dX = dY = dAlpha = 0;
+        if (aMotions.empty())
+            return;
+        double dCenterX = 0, dCenterY = 0;
+        vector<double> aVx, aVy;
+        for (const auto& tLm : aMotions)
+        {
+            dCenterX += tLm.dFx; dCenterY += tLm.dFy;
+            aVx.push_back(tLm.dVx); aVy.push_back(tLm.dVy);
+        }
+        dCenterX /= aMotions.size(); dCenterY /= aMotions.size();
+        const double dMeanVx = _CleanMean(aVx), dMeanVy = _CleanMean(aVy);
+        // the angle is too inaccurate with less than 6 fields
+        if (aMotions.size() >= 6)
+        {
+            vector<double> aAngles;
+            for (const auto& tLm : aMotions)
+            {
+                const double dVx = tLm.dVx-dMeanVx, dVy = tLm.dVy-dMeanVy;
+                double dDiff = 0;
+                // the fields close to the rotation center are ignored
+                if (fabs(tLm.dFx-dCenterX)+fabs(tLm.dFy-dCenterY) >= tLm.dSize*2)
+                {
+                    dDiff = atan2(tLm.dFy-dCenterY+dVy, tLm.dFx-dCenterX+dVx)-atan2(tLm.dFy-dCenterY, tLm.dFx-dCenterX);
+                    if (dDiff > M_PI) dDiff -= 2*M_PI;
+                    else if (dDiff < -M_PI) dDiff += 2*M_PI;
+                }
+                aAngles.push_back(dDiff);
+            }
+            const double dRange = *max_element(aAngles.begin(), aAngles.end())-*min_element(aAngles.begin(), aAngles.end());
+            dAlpha = dRange > 1. ? 0 : -_CleanMean(aAngles);
+        }
+        // compensate for the off-center rotation
+        const double dPx = dCenterX-dWidth/2, dPy = dCenterY-dHeight/2;
+        dX = dMeanVx+(cos(dAlpha)-1)*dPx-sin(dAlpha)*dPy;
+        dY = dMeanVy+sin(dAlpha)*dPx+(cos(dAlpha)-1)*dPy;
+    }
+
+    // With 'optzoom=1', vid.stab computes one zoom from the corrections of all the frames, a slice would get its own.
+    // The zoom is computed here once over the whole transforms file, following the gaussian path optimization of
+    // vid.stab, and then passed to all the slices as a fixed zoom. The zoom required by each frame is a bound making
+    // the rotated and shifted frame cover the output, it can be slightly larger than the one found by vid.stab.
+    bool CalcStaticOptimalZoom(float& fZoom)
+    {
+        vector<string> aHeaderLines, aFrameLines;
+        if (!ReadTrfFile(m_strTrfPath, aHeaderLines, aFrameLines) || aFrameLines.size() < 2)
+            return false;
+        const double dWidth = m_hSettings->VideoOutWidth(), dHeight = m_hSettings->VideoOutHeight();
+        if (dWidth <= 0 || dHeight <= 0)
+            return false;
+        // camera path, as (x, y, alpha) of each frame
+        const size_t szFrmCnt = aFrameLines.size();
+        vector<double> aPathX(szFrmCnt), aPathY(szFrmCnt), aPathA(szFrmCnt);
+        vector<_LocalMotion> aMotions;
+        for (size_t i = 0; i < szFrmCnt; i++)
+        {
+            const auto& strLine = aFrameLines[i];
+            aMotions.clear();
+            size_t szPos = 0;
+            while ((szPos = strLine.find("(LM ", szPos)) != string::npos)
+            {
+                szPos += 4;
+                _LocalMotion tLm;
+                if (sscanf(strLine.c_str()+szPos, "%lf %lf %lf %lf %lf", &tLm.dVx, &tLm.dVy, &tLm.dFx, &tLm.dFy, &tLm.dSize) == 5)
+                    aMotions.push_back(tLm);
+            }
+            double dX, dY, dAlpha;
+            _EstimateFrameTransform(aMotions, dWidth, dHeight, dX, dY, dAlpha);
+            if (m_bRelative && i > 0)
+            {
+                dX += aPathX[i-1]; dY += aPathY[i-1]; dAlpha += aPathA[i-1];
+            }
+            aPathX[i] = dX; aPathY[i] = dY; aPathA[i] = dAlpha;
+        }
+        // the correction of a frame is its distance to the gaussian low-passed path
+        const int64_t i64Mu = (int64_t)m_u32Smoothing;
+        const double dSigma2 = (i64Mu/2.)*(i64Mu/2.);
+        vector<double> aKernel(i64Mu*2+1);
+        for (int64_t k = 0; k <= i64Mu*2; k++)
+            aKernel[k] = exp(-(double)(k-i64Mu)*(k-i64Mu)/dSigma2);
+        double dMaxZoom = 0;
+        for (int64_t i = 0; i < (int64_t)szFrmCnt; i++)
+        {
+            double dWeightSum = 0, dAvgX = 0, dAvgY = 0, dAvgA = 0;
+            for (int64_t k = 0; k <= i64Mu*2; k++)
+            {
+                const int64_t i64Idx = i+k-i64Mu;
+                if (i64Idx < 0 || i64Idx >= (int64_t)szFrmCnt)
                     continue;
+                dWeightSum += aKernel[k];
+                dAvgX += aPathX[i64Idx]*aKernel[k]; dAvgY += aPathY[i64Idx]*aKernel[k]; dAvgA += aPathA[i64Idx]*aKernel[k];
+            }
+            double dX = aPathX[i]-dAvgX/dWeightSum, dY = aPathY[i]-dAvgY/dWeightSum, dAlpha = aPathA[i]-dAvgA/dWeightSum;
+            if (m_i32MaxShift >= 0)
+            {
+                dX = min(max(dX, -(double)m_i32MaxShift), (double)m_i32MaxShift);
+                dY = min(max(dY, -(double)m_i32MaxShift), (double)m_i32MaxShift);
+            }
+            if (m_fMaxAngle >= 0)
+                dAlpha = min(max(dAlpha, -(double)m_fMaxAngle), (double)m_fMaxAngle);
+            const double dCos = fabs(cos(dAlpha)), dSin = fabs(sin(dAlpha));
+            const double dScaleX = (dCos*(dWidth+2*fabs(dX))+dSin*(dHeight+2*fabs(dY)))/dWidth;
+            const double dScaleY = (dSin*(dWidth+2*fabs(dX))+dCos*(dHeight+2*fabs(dY)))/dHeight;
+            dMaxZoom = max(dMaxZoom, (max(dScaleX, dScaleY)-1)*100);
+        }
+        fZoom = (float)dMaxZoom;
+        return true;
+    }
+
+    int64_t GetTransformLeadInFrameCount() const
+    {
+        // (smoothing*2+1) frames are used for lowpass filtering, plus one for the motion into the first frame
+        return (int64_t)m_u32Smoothing+1;
+    }
+
+    // Write the frames [i64FirstFrmIdx, i64EndFrmIdx) of the transforms file into 'strSlicePath', renumbered from 1.
+    // An end index of -1 means till the last frame. The relative motions are accumulated by the filter starting
+    // from the first frame of the file, which shifts the camera path by a constant, the smoothed corrections are the same.
+    bool WriteTrfSlice(const string& strSlicePath, int64_t i64FirstFrmIdx, int64_t i64EndFrmIdx)
+    {
+        vector<string> aHeaderLines, aFrameLines;
+        if (!ReadTrfFile(m_strTrfPath, aHeaderLines, aFrameLines))
+        {
+            m_pLogger->Log(Error) << "FAILED to read transforms file '" << m_strTrfPath << "'!" << endl;
+            return false;
+        }
+        const int64_t i64TrfFrmCnt = (int64_t)aFrameLines.size();
+        if (i64EndFrmIdx < 0 || i64EndFrmIdx > i64TrfFrmCnt)
+            i64EndFrmIdx = i64TrfFrmCnt;
+        ofstream ofs(strSlicePath, ios::out|ios::binary|ios::trunc);
+        if (!ofs.is_open())
+        {
+            m_pLogger->Log(Error) << "FAILED to open transforms slice file '" << strSlicePath << "' for writing!" << endl;
+            return false;
+        }
+        for (const auto& strLine : aHeaderLines)
+            ofs << strLine << '\n';
+        int64_t i64FrameNum = 0;
+        for (int64_t i = i64FirstFrmIdx; i < i64EndFrmIdx; i++)
+        {
+            const auto& strLine = aFrameLines[i];
+            const auto szNumEnd = strLine.find(' ', 6);
+            if (szNumEnd == string::npos)
+                break;
+            ofs << "Frame " << ++i64FrameNum << strLine.substr(szNumEnd) << '\n';
+        }
+        ofs.close();
+        if (ofs.fail())
+        {
+            m_pLogger->Log(Error) << "FAILED to write transforms slice file '" << strSlicePath << "'!" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Returns the frame ranges which are not covered by the encoded segments, an end index of -1 means till the end
+    // of the clip. Big ranges are split, so that each worker gets a range.
+    vector<pair<int64_t, int64_t>> GetPendingTransformRanges(int64_t i64FrameCount, int iWorkerCnt)
+    {
+        lock_guard<mutex> lk(m_mtxWorkerLock);
+        sort(m_aTransformSegments.begin(), m_aTransformSegments.end(), [] (const _TransformSegment& a, const _TransformSegment& b) {
+            return a.i64StartFrmIdx < b.i64StartFrmIdx;
+        });
+        vector<pair<int64_t, int64_t>> aRanges;
+        int64_t i64Pos = 0;
+        for (const auto& tSeg : m_aTransformSegments)
+        {
+            if (tSeg.i64StartFrmIdx > i64Pos)
+                aRanges.push_back({i64Pos, tSeg.i64StartFrmIdx});
+            i64Pos = max(i64Pos, tSeg.i64StartFrmIdx+tSeg.i64FrameCount);
+        }
+        if (m_i64TransformEofFrmIdx < 0)
+            aRanges.push_back({i64Pos, -1});
+        else if (i64Pos < m_i64TransformEofFrmIdx)
+            aRanges.push_back({i64Pos, m_i64TransformEofFrmIdx});
+        while ((int)aRanges.size() < iWorkerCnt)
+        {
+            auto itLargest = aRanges.end();
+            int64_t i64LargestLen = 0;
+            for (auto it = aRanges.begin(); it != aRanges.end(); it++)
+            {
+                const int64_t i64Len = (it->second >= 0 ? it->second : i64FrameCount)-it->first;
+                if (i64Len > i64LargestLen)
+                {
+                    itLargest = it;
+                    i64LargestLen = i64Len;
                 }
+            }
+            if (itLargest == aRanges.end() || i64LargestLen < 2*MIN_TRANSFORM_RANGE_FRAMES)
+                break;
+            const int64_t i64SplitIdx = itLargest->first+i64LargestLen/2;
+            const int64_t i64EndIdx = itLargest->second;
+            itLargest->second = i64SplitIdx;
+            aRanges.insert(itLargest+1, make_pair(i64SplitIdx, i64EndIdx));
+        }
+        return aRanges;
+    }
 
-                int fferr;
-                SelfFreeAVFramePtr hFgInfrmPtr;
-                const int64_t i64ReadPos = round((double)i64FrmIdx*1000*tFrameRate.den/tFrameRate.num);
-                bool bEof = false;
-                auto hVfrm = m_hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
-                ImMatWrapper_AVFrame tAvfrmWrapper;
-                if (hVfrm)
+    // When the scheduler lowers the worker budget, a worker whose range can be resumed from a lead-in stops after the
+    // frames it has encoded and sets 'bYielded', the rest of its range is picked up by the next round.
+    bool TransformFrameRange(int64_t i64StartFrmIdx, int64_t i64EndFrmIdx, MediaCore::VideoClip::Holder hVclip, const atomic_bool& bStop, bool& bYielded)
+    {
+        _FilterGraph tFg;
+        MediaCore::MediaEncoder::Holder hEncoder;
+        ImMatToAVFrameConverter tMat2AvfrmCvter;
+        tMat2AvfrmCvter.SetOutPixelFormat(m_eFgInputPixfmt);
+        ostringstream oss; oss << "TaskOutput.part" << i64StartFrmIdx << ".mp4";
+        const string strSegPath = SysUtils::JoinPath(m_strTaskDir, oss.str());
+        // the frames before the range are only fed to bring the filter to the right transform, their outputs are dropped.
+        // If the transform of a frame depends on the whole clip, all of them are fed with the complete transforms file.
+        int64_t i64FrmIdx = 0;
+        string strTrfPath = m_strTrfPath, strTrfSlicePath;
+        string strErrMsg;
+        const bool bCanYield = IsTransformWindowLocal();
+        bYielded = false;
+        if (i64StartFrmIdx > 0 && IsTransformWindowLocal())
+        {
+            const int64_t i64LeadInFrmCnt = GetTransformLeadInFrameCount();
+            i64FrmIdx = max(i64StartFrmIdx-i64LeadInFrmCnt, (int64_t)0);
+            oss.str(""); oss << "transforms.part" << i64StartFrmIdx << ".trf";
+            strTrfSlicePath = SysUtils::JoinPath(m_strTaskDir, oss.str());
+            if (!WriteTrfSlice(strTrfSlicePath, i64FrmIdx, i64EndFrmIdx >= 0 ? i64EndFrmIdx+i64LeadInFrmCnt : -1))
+                strErrMsg = "FAILED to write the transforms slice for frame range starting at #"+to_string(i64StartFrmIdx)+"!";
+            strTrfPath = strTrfSlicePath;
+        }
+        hVclip->SeekTo(FrameIndexToMillisec(i64FrmIdx));
+        int64_t i64EncodedFrmCnt = 0;
+        bool bPaused = false, bEof = false;
+        SelfFreeAVFramePtr hFgOutfrmPtr = AllocSelfFreeAVFramePtr();
+        m_tMetricsRecorder.SetActive(true);
+        while (strErrMsg.empty() && !IsCancelled() && !bStop)
+        {
+            if (m_bPause)
+            {
+                if (!bPaused)
                 {
-                    auto tNativeData = hVfrm->GetNativeData();
-                    if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME)
-                        hFgInfrmPtr = CloneSelfFreeAVFramePtr((AVFrame*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::AVFRAME_HOLDER)
-                        hFgInfrmPtr = *((SelfFreeAVFramePtr*)tNativeData.pData);
-                    else if (tNativeData.eType == MediaCore::VideoFrame::NativeData::MAT)
-                    {
-                        const auto& vmat = *((ImGui::ImMat*)tNativeData.pData);
-                        if (vmat.device != IM_DD_CPU)
-                        {
-                            hFgInfrmPtr = AllocSelfFreeAVFramePtr();
-                            tMat2AvfrmCvter.ConvertImage(vmat, hFgInfrmPtr.get(), i64FrmIdx);
-                        }
-                        else
-                        {
-                            tAvfrmWrapper.SetMat(vmat);
-                            hFgInfrmPtr = tAvfrmWrapper.GetWrapper(i64FrmIdx);
-                        }
-                    }
+                    m_i32PausedWorkerCnt++;
+                    m_tMetricsRecorder.SetActive(false);
+                    bPaused = true;
                 }
-                if (hFgInfrmPtr)
+                this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                continue;
+            }
+            if (bPaused)
+            {
+                m_i32PausedWorkerCnt--;
+                m_tMetricsRecorder.SetActive(true);
+                bPaused = false;
+            }
+            if (i64EndFrmIdx >= 0 && i64FrmIdx >= i64EndFrmIdx)
+                break;
+            if (bCanYield && i64EncodedFrmCnt > 0)
+            {
+                int32_t i32RunningCnt = m_i32RunningWorkerCnt;
+                if (i32RunningCnt > GetMaxWorkerCount() && m_i32RunningWorkerCnt.compare_exchange_strong(i32RunningCnt, i32RunningCnt-1))
                 {
-                    hFgInfrmPtr->pts = i64FrmIdx;
-                    hFgInfrmPtr->pict_type = AV_PICTURE_TYPE_NONE;
-                    if (!bFilterGraphInited)
+                    bYielded = true;
+                    break;
+                }
+            }
+
+            int fferr;
+            SelfFreeAVFramePtr hFgInfrmPtr;
+            const int64_t i64ReadPos = FrameIndexToMillisec(i64FrmIdx);
+            MediaCore::VideoFrame::Holder hVfrm;
+            {
+                MetricsRecorder::StageTimer tDecodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_DECODE);
+                hVfrm = hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+            }
+            ImMatWrapper_AVFrame tAvfrmWrapper;
+            if (hVfrm)
+                hFgInfrmPtr = GetFilterGraphInputFrame(hVfrm, tMat2AvfrmCvter, tAvfrmWrapper, i64FrmIdx);
+            if (hFgInfrmPtr)
+            {
+                hFgInfrmPtr->pts = i64FrmIdx;
+                hFgInfrmPtr->pict_type = AV_PICTURE_TYPE_NONE;
+                if (!tFg.pFilterGraph)
+                {
+                    lock_guard<mutex> lk(m_mtxWorkerLock);
+                    if (!SetupVidstabTransformFilterGraph(tFg, hFgInfrmPtr.get(), strTrfPath))
                     {
-                        if (!SetupVidstabTransformFilterGraph(hFgInfrmPtr.get()))
-                        {
-                            m_pLogger->Log(Error) << "'SetupVidstabTransformFilterGraph()' FAILED! Error is '" << m_errMsg << "'." << endl;
-                            return false;
-                        }
-                        bFilterGraphInited = true;
+                        strErrMsg = "'SetupVidstabTransformFilterGraph()' FAILED! Error is '"+m_errMsg+"'.";
+                        break;
                     }
+                }
 
-                    fferr = av_buffersrc_add_frame(m_pBufsrcCtx, hFgInfrmPtr.get());
+                {
+                    MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                    fferr = av_buffersrc_add_frame(tFg.pBufsrcCtx, hFgInfrmPtr.get());
+                }
+                if (fferr < 0)
+                {
+                    ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << i64FrmIdx
+                            << ". fferr=" << fferr << ".";
+                    strErrMsg = oss.str();
+                    break;
+                }
+                av_frame_unref(hFgOutfrmPtr.get());
+                {
+                    MetricsRecorder::StageTimer tFilterTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_FILTER);
+                    fferr = av_buffersink_get_frame(tFg.pBufsinkCtx, hFgOutfrmPtr.get());
+                }
+                if (fferr != AVERROR(EAGAIN))
+                {
                     if (fferr < 0)
                     {
-                        ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED when invoking 'av_buffersrc_add_frame()' at frame #" << (i64FrmIdx-1)
+                        ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED when invoking 'av_buffersink_get_frame()' at frame #" << i64FrmIdx
                                 << ". fferr=" << fferr << ".";
-                        m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                        return false;
+                        strErrMsg = oss.str();
+                        break;
                     }
-                    av_frame_unref(hFgOutfrmPtr.get());
-                    fferr = av_buffersink_get_frame(m_pBufsinkCtx, hFgOutfrmPtr.get());
-                    if (fferr != AVERROR(EAGAIN))
+                    if (hFgOutfrmPtr->pts >= i64StartFrmIdx)
                     {
-                        if (fferr < 0)
-                        {
-                            ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED when invoking 'av_buff5ersink_get_frame()' at frame #" << (i64FrmIdx-1)
-                                    << ". fferr=" << fferr << ".";
-                            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                            return false;
-                        }
-                        if (!bEncoderInited)
+                        if (!hEncoder)
                         {
-                            // setup MediaEncoder
-                            if (!SetupEncoder(hFgOutfrmPtr.get()))
+                            lock_guard<mutex> lk(m_mtxWorkerLock);
+                            if (!SetupEncoder(hFgOutfrmPtr.get(), strSegPath, hEncoder))
                             {
-                                m_pLogger->Log(Error) << "'SetupEncoder()' FAILED!" << endl;
-                                return false;
+                                strErrMsg = "'SetupEncoder()' FAILED! Error is '"+m_errMsg+"'.";
+                                break;
                             }
-                            bEncoderInited = true;
                         }
-                        auto hVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(hFgOutfrmPtr.get()), i64ReadPos);
-                        if (!m_hEncoder->EncodeVideoFrame(hVfrm))
+                        const int64_t i64OutPos = FrameIndexToMillisec(hFgOutfrmPtr->pts);
+                        auto hVfrm = FFUtils::CreateVideoFrameFromAVFrame(CloneSelfFreeAVFramePtr(hFgOutfrmPtr.get()), i64OutPos);
+                        bool bEncoded;
                         {
-                            ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED to encode video frame! pos=" << i64ReadPos;
-                            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                            return false;
+                            MetricsRecorder::StageTimer tEncodeTimer(m_tMetricsRecorder, MetricsRecorder::STAGE_ENCODE);
+                            bEncoded = hEncoder->EncodeVideoFrame(hVfrm);
                         }
+                        if (!bEncoded)
+                        {
+                            ostringstream oss; oss << "Background task 'Vidstab-transform' FAILED to encode video frame! pos=" << i64OutPos;
+                            strErrMsg = oss.str();
+                            break;
+                        }
+                        i64EncodedFrmCnt++;
+                        m_i64TransformedFrmCnt++;
+                        m_tMetricsRecorder.AddFrames();
                     }
-                    i64FrmIdx++;
                 }
-                float fStageProgress = (float)((double)i64ReadPos/i64ClipDur);
-                m_fProgress = fAccumShares+(fStageProgress*fStageShare);
-                if (bEof)
-                    break;
+                i64FrmIdx++;
             }
-            if (bEncoderInited)
+            if (bEof)
+                break;
+        }
+        if (bPaused)
+            m_i32PausedWorkerCnt--;
+        else
+            m_tMetricsRecorder.SetActive(false);
+        ReleaseFilterGraph(tFg);
+        if (!strTrfSlicePath.empty())
+            SysUtils::DeleteFileAt(strTrfSlicePath);
+        if (hEncoder)
+        {
+            if (strErrMsg.empty() && !hEncoder->FinishEncoding())
             {
-                if (!m_hEncoder->FinishEncoding())
-                {
-                    ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << m_hEncoder->GetError() << "'.";
-                    m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
-                    return false;
-                }
-                m_hEncoder->Close();
+                ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << hEncoder->GetError() << "'.";
+                strErrMsg = oss.str();
             }
-            m_bVidstabTransformFinished = true;
+            if (!hEncoder->Close())
+                m_pLogger->Log(Error) << "In bg-task '" << m_name << "', FAILED to close the encoder! Error is '" << hEncoder->GetError() << "'." << endl;
+            if (!strErrMsg.empty() || i64EncodedFrmCnt == 0)
+                SysUtils::DeleteFileAt(strSegPath);
         }
-        fAccumShares += fStageShare;
-        m_fProgress = fAccumShares;
 
-        m_pLogger->Log(INFO) << "Quit background task 'Vidstab' for '" << m_strSrcUrl << "'." << endl;
+        lock_guard<mutex> lk(m_mtxWorkerLock);
+        if (!strErrMsg.empty())
+        {
+            m_errMsg = strErrMsg; m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (i64EncodedFrmCnt > 0)
+            m_aTransformSegments.push_back({strSegPath, i64StartFrmIdx, i64EncodedFrmCnt});
+        if (bEof)
+        {
+            const int64_t i64EofFrmIdx = i64StartFrmIdx+i64EncodedFrmCnt;
+            if (m_i64TransformEofFrmIdx < 0 || i64EofFrmIdx < m_i64TransformEofFrmIdx)
+                m_i64TransformEofFrmIdx = i64EofFrmIdx;
+        }
         return true;
     }
 
-    bool _AfterTaskProc() override
+    static bool _IsSameCodecPar(const AVCodecParameters* pA, const AVCodecParameters* pB)
     {
-        ReleaseFilterGraph();
-        ReleaseEncoder();
-        return true;
+        if (pA->codec_id != pB->codec_id || pA->width != pB->width || pA->height != pB->height || pA->format != pB->format
+            || pA->profile != pB->profile || pA->extradata_size != pB->extradata_size)
+            return false;
+        return pA->extradata_size <= 0 || memcmp(pA->extradata, pB->extradata, pA->extradata_size) == 0;
     }
 
-private:
-    bool SetupVidstabDetectFilterGraph(const AVFrame* pInAvfrm)
+    // Remux the encoded segments into the task output file
+    bool ConcatTransformSegments()
+    {
+        if (m_aTransformSegments.empty())
+        {
+            m_errMsg = "No transform segment is encoded!"; m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        sort(m_aTransformSegments.begin(), m_aTransformSegments.end(), [] (const _TransformSegment& a, const _TransformSegment& b) {
+            return a.i64StartFrmIdx < b.i64StartFrmIdx;
+        });
+        if (SysUtils::IsFile(m_strOutputPath))
+            SysUtils::DeleteFileAt(m_strOutputPath);
+        if (m_aTransformSegments.size() == 1)
+        {
+            if (!SysUtils::RenameFile(m_aTransformSegments.front().strPath, m_strOutputPath))
+            {
+                ostringstream oss; oss << "FAILED to rename '" << m_aTransformSegments.front().strPath << "' to '" << m_strOutputPath << "'!";
+                m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                return false;
+            }
+            m_aTransformSegments.clear();
+            return true;
+        }
+
+        AVFormatContext* pOutFmtCtx = nullptr;
+        int fferr = avformat_alloc_output_context2(&pOutFmtCtx, nullptr, nullptr, m_strOutputPath.c_str());
+        if (fferr < 0 || !pOutFmtCtx)
+        {
+            ostringstream oss; oss << "FAILED to allocate output format context for '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        bool bSucc = true;
+        AVStream* pOutStream = nullptr;
+        AVPacket* pPkt = av_packet_alloc();
+        int64_t i64LastDts = INT64_MIN;
+        for (const auto& tSeg : m_aTransformSegments)
+        {
+            AVFormatContext* pInFmtCtx = nullptr;
+            fferr = avformat_open_input(&pInFmtCtx, tSeg.strPath.c_str(), nullptr, nullptr);
+            if (fferr < 0 || (fferr = avformat_find_stream_info(pInFmtCtx, nullptr)) < 0)
+            {
+                ostringstream oss; oss << "FAILED to open transform segment '" << tSeg.strPath << "'! fferr=" << fferr << ".";
+                m_errMsg = oss.str(); bSucc = false;
+            }
+            const int iInStmIdx = bSucc ? av_find_best_stream(pInFmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0) : -1;
+            if (bSucc && iInStmIdx < 0)
+            {
+                ostringstream oss; oss << "No video stream in transform segment '" << tSeg.strPath << "'!";
+                m_errMsg = oss.str(); bSucc = false;
+            }
+            // the packets are remuxed with the parameters of the first segment, all the segments must be encoded the same way
+            if (bSucc && pOutStream && !_IsSameCodecPar(pOutStream->codecpar, pInFmtCtx->streams[iInStmIdx]->codecpar))
+            {
+                ostringstream oss; oss << "Codec parameters of transform segment '" << tSeg.strPath << "' differ from the first segment!";
+                m_errMsg = oss.str(); bSucc = false;
+            }
+            if (bSucc && !pOutStream)
+            {
+                pOutStream = avformat_new_stream(pOutFmtCtx, nullptr);
+                avcodec_parameters_copy(pOutStream->codecpar, pInFmtCtx->streams[iInStmIdx]->codecpar);
+                pOutStream->codecpar->codec_tag = 0;
+                pOutStream->time_base = pInFmtCtx->streams[iInStmIdx]->time_base;
+                if (!(pOutFmtCtx->oformat->flags&AVFMT_NOFILE))
+                    fferr = avio_open(&pOutFmtCtx->pb, m_strOutputPath.c_str(), AVIO_FLAG_WRITE);
+                if (fferr < 0 || (fferr = avformat_write_header(pOutFmtCtx, nullptr)) < 0)
+                {
+                    ostringstream oss; oss << "FAILED to start writing output file '" << m_strOutputPath << "'! fferr=" << fferr << ".";
+                    m_errMsg = oss.str(); bSucc = false;
+                }
+            }
+            // the segments keep the absolute timestamps, only keep dts increasing across the segment boundaries
+            int64_t i64DtsShift = 0;
+            bool bFirstPacket = true;
+            while (bSucc && av_read_frame(pInFmtCtx, pPkt) >= 0)
+            {
+                if (pPkt->stream_index == iInStmIdx)
+                {
+                    av_packet_rescale_ts(pPkt, pInFmtCtx->streams[iInStmIdx]->time_base, pOutStream->time_base);
+                    if (bFirstPacket && pPkt->dts != AV_NOPTS_VALUE && i64LastDts != INT64_MIN && pPkt->dts <= i64LastDts)
+                        i64DtsShift = i64LastDts+1-pPkt->dts;
+                    bFirstPacket = false;
+                    if (pPkt->pts != AV_NOPTS_VALUE) pPkt->pts += i64DtsShift;
+                    if (pPkt->dts != AV_NOPTS_VALUE) { pPkt->dts += i64DtsShift; i64LastDts = pPkt->dts; }
+                    pPkt->stream_index = pOutStream->index;
+                    pPkt->pos = -1;
+                    fferr = av_interleaved_write_frame(pOutFmtCtx, pPkt);
+                    if (fferr < 0)
+                    {
+                        ostringstream oss; oss << "FAILED to write packet from transform segment '" << tSeg.strPath << "'! fferr=" << fferr << ".";
+                        m_errMsg = oss.str(); bSucc = false;
+                    }
+                }
+                av_packet_unref(pPkt);
+            }
+            if (pInFmtCtx)
+                avformat_close_input(&pInFmtCtx);
+            if (!bSucc)
+                break;
+        }
+        if (bSucc)
+            av_write_trailer(pOutFmtCtx);
+        av_packet_free(&pPkt);
+        if (pOutFmtCtx->pb)
+            avio_closep(&pOutFmtCtx->pb);
+        avformat_free_context(pOutFmtCtx);
+        if (!bSucc)
+        {
+            m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        for (const auto& tSeg : m_aTransformSegments)
+            SysUtils::DeleteFileAt(tSeg.strPath);
+        m_aTransformSegments.clear();
+        return true;
+    }
+    bool SetupVidstabDetectFilterGraph(_FilterGraph& tFg, const AVFrame* pInAvfrm, const string& strTrfPath)
     {
         const AVFilter *buffersink = avfilter_get_by_name("buffersink");
         const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
 
-        m_pFilterGraph = avfilter_graph_alloc();
-        if (!m_pFilterGraph)
+        tFg.pFilterGraph = avfilter_graph_alloc();
+        if (!tFg.pFilterGraph)
         {
             m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
             return false;
@@ -1099,13 +1883,13 @@ private:
 
         int fferr;
         ostringstream oss;
-        m_eFgInputPixfmt = (AVPixelFormat)pInAvfrm->format;
+        const auto eInputPixfmt = (AVPixelFormat)pInAvfrm->format;
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
-        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)m_eFgInputPixfmt << ":sar=1"
+        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)eInputPixfmt << ":sar=1"
                 << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
         string bufsrcArg = oss.str();
-        m_pBufsrcCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
+        tFg.pBufsrcCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
@@ -1119,13 +1903,13 @@ private:
             return false;
         }
         filtInOutPtr->name       = av_strdup("in");
-        filtInOutPtr->filter_ctx = m_pBufsrcCtx;
+        filtInOutPtr->filter_ctx = tFg.pBufsrcCtx;
         filtInOutPtr->pad_idx    = 0;
         filtInOutPtr->next       = nullptr;
-        m_pFilterOutputs = filtInOutPtr;
+        tFg.pFilterOutputs = filtInOutPtr;
 
-        m_pBufsinkCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
+        tFg.pBufsinkCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
@@ -1139,10 +1923,10 @@ private:
             return false;
         }
         filtInOutPtr->name        = av_strdup("out");
-        filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
+        filtInOutPtr->filter_ctx  = tFg.pBufsinkCtx;
         filtInOutPtr->pad_idx     = 0;
         filtInOutPtr->next        = nullptr;
-        m_pFilterInputs = filtInOutPtr;
+        tFg.pFilterInputs = filtInOutPtr;
 
         const int iOutW = (int)m_hSettings->VideoOutWidth();
         const int iOutH = (int)m_hSettings->VideoOutHeight();
@@ -1156,10 +1940,15 @@ private:
         {
             oss << "format=yuv420p,";
         }
-        oss << "vidstabdetect=result=" << m_strTrfPath << ":shakiness=" << (int)m_u8Shakiness << ":accuracy=" << (int)m_u8Accuracy << ":stepsize=" << (int)m_u16StepSize
+        oss << "vidstabdetect=result=" << strTrfPath << ":shakiness=" << (int)m_u8Shakiness << ":accuracy=" << (int)m_u8Accuracy << ":stepsize=" << (int)m_u16StepSize
                 << ":mincontrast=" << m_fMinContrast;
+        // the resume and the slicing of the transforms file only understand the ascii format. The newer versions
+        // write binary by default, while the older ones have no 'fileformat' option and always write ascii.
+        const AVFilter* pVidstabDetect = avfilter_get_by_name("vidstabdetect");
+        if (pVidstabDetect && pVidstabDetect->priv_class && av_opt_find(&pVidstabDetect->priv_class, "fileformat", nullptr, 0, AV_OPT_SEARCH_FAKE_OBJ))
+            oss << ":fileformat=ascii";
         string filterArgs = oss.str();
-        fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
+        fferr = avfilter_graph_parse_ptr(tFg.pFilterGraph, filterArgs.c_str(), &tFg.pFilterInputs, &tFg.pFilterOutputs, nullptr);
         if (fferr < 0)
         {
             oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
@@ -1168,7 +1957,7 @@ private:
         }
         m_pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
 
-        fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
+        fferr = avfilter_graph_config(tFg.pFilterGraph, nullptr);
         if (fferr < 0)
         {
             oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
@@ -1176,20 +1965,20 @@ private:
             return false;
         }
 
-        if (m_pFilterOutputs)
-            avfilter_inout_free(&m_pFilterOutputs);
-        if (m_pFilterInputs)
-            avfilter_inout_free(&m_pFilterInputs);
+        if (tFg.pFilterOutputs)
+            avfilter_inout_free(&tFg.pFilterOutputs);
+        if (tFg.pFilterInputs)
+            avfilter_inout_free(&tFg.pFilterInputs);
         return true;
     }
 
-    bool SetupVidstabTransformFilterGraph(const AVFrame* pInAvfrm)
+    bool SetupVidstabTransformFilterGraph(_FilterGraph& tFg, const AVFrame* pInAvfrm, const string& strTrfPath)
     {
         const AVFilter *buffersink = avfilter_get_by_name("buffersink");
         const AVFilter *buffersrc  = avfilter_get_by_name("buffer");
 
-        m_pFilterGraph = avfilter_graph_alloc();
-        if (!m_pFilterGraph)
+        tFg.pFilterGraph = avfilter_graph_alloc();
+        if (!tFg.pFilterGraph)
         {
             m_errMsg = "FAILED to allocate new 'AVFilterGraph'!";
             return false;
@@ -1197,13 +1986,13 @@ private:
 
         int fferr;
         ostringstream oss;
-        m_eFgInputPixfmt = (AVPixelFormat)pInAvfrm->format;
+        const auto eInputPixfmt = (AVPixelFormat)pInAvfrm->format;
         const auto tFrameRate = m_hSettings->VideoOutFrameRate();
-        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)m_eFgInputPixfmt << ":sar=1"
+        oss << pInAvfrm->width << ":" << pInAvfrm->height << ":pix_fmt=" << (int)eInputPixfmt << ":sar=1"
                 << ":time_base=" << tFrameRate.den << "/" << tFrameRate.num << ":frame_rate=" << tFrameRate.num << "/" << tFrameRate.den;
         string bufsrcArg = oss.str();
-        m_pBufsrcCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, m_pFilterGraph);
+        tFg.pBufsrcCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsrcCtx, buffersrc, "buffer_source", bufsrcArg.c_str(), nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for INPUT 'buffer_source'! fferr=" << fferr << ".";
@@ -1217,13 +2006,13 @@ private:
             return false;
         }
         filtInOutPtr->name       = av_strdup("in");
-        filtInOutPtr->filter_ctx = m_pBufsrcCtx;
+        filtInOutPtr->filter_ctx = tFg.pBufsrcCtx;
         filtInOutPtr->pad_idx    = 0;
         filtInOutPtr->next       = nullptr;
-        m_pFilterOutputs = filtInOutPtr;
+        tFg.pFilterOutputs = filtInOutPtr;
 
-        m_pBufsinkCtx = nullptr;
-        fferr = avfilter_graph_create_filter(&m_pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, m_pFilterGraph);
+        tFg.pBufsinkCtx = nullptr;
+        fferr = avfilter_graph_create_filter(&tFg.pBufsinkCtx, buffersink, "buffer_sink", nullptr, nullptr, tFg.pFilterGraph);
         if (fferr < 0)
         {
             oss << "FAILED when invoking 'avfilter_graph_create_filter' for OUTPUT 'out'! fferr=" << fferr << ".";
@@ -1237,10 +2026,10 @@ private:
             return false;
         }
         filtInOutPtr->name        = av_strdup("out");
-        filtInOutPtr->filter_ctx  = m_pBufsinkCtx;
+        filtInOutPtr->filter_ctx  = tFg.pBufsinkCtx;
         filtInOutPtr->pad_idx     = 0;
         filtInOutPtr->next        = nullptr;
-        m_pFilterInputs = filtInOutPtr;
+        tFg.pFilterInputs = filtInOutPtr;
 
         const int iOutW = (int)m_hSettings->VideoOutWidth();
         const int iOutH = (int)m_hSettings->VideoOutHeight();
@@ -1263,11 +2052,19 @@ private:
         if (m_u8InterpMode == 0) strInterpMode = "no";
         else if (m_u8InterpMode == 1) strInterpMode = "linear";
         else if (m_u8InterpMode == 3) strInterpMode = "bicubic";
-        oss << "vidstabtransform=input=" << m_strTrfPath << ":smoothing=" << m_u32Smoothing << ":optalgo=" << strOptAlgo << ":maxshift=" << m_i32MaxShift
+        // the precomputed static optimal zoom is applied as a fixed zoom
+        float fZoom = m_fPresetZoom;
+        int iOptZoom = (int)m_u8OptZoom;
+        if (m_u8OptZoom == 1 && m_fStaticOptZoom >= 0)
+        {
+            fZoom += m_fStaticOptZoom;
+            iOptZoom = 0;
+        }
+        oss << "vidstabtransform=input=" << strTrfPath << ":smoothing=" << m_u32Smoothing << ":optalgo=" << strOptAlgo << ":maxshift=" << m_i32MaxShift
                 << ":maxangle=" << m_fMaxAngle << ":crop=" << strCropMode << ":invert=" << (m_bInvertTrans?1:0) << ":relative=" << (m_bRelative?1:0)
-                << ":zoom=" << m_fPresetZoom << ":optzoom=" << (int)m_u8OptZoom << ":zoomspeed=" << m_fZoomSpeed << ":interpol=" << strInterpMode;
+                << ":zoom=" << fZoom << ":optzoom=" << iOptZoom << ":zoomspeed=" << m_fZoomSpeed << ":interpol=" << strInterpMode;
         string filterArgs = oss.str();
-        fferr = avfilter_graph_parse_ptr(m_pFilterGraph, filterArgs.c_str(), &m_pFilterInputs, &m_pFilterOutputs, nullptr);
+        fferr = avfilter_graph_parse_ptr(tFg.pFilterGraph, filterArgs.c_str(), &tFg.pFilterInputs, &tFg.pFilterOutputs, nullptr);
         if (fferr < 0)
         {
             oss.str(""); oss << "FAILED to invoke 'avfilter_graph_parse_ptr'! fferr=" << fferr << ". Arguments are \"" << filterArgs << "\".";
@@ -1276,7 +2073,7 @@ private:
         }
         m_pLogger->Log(INFO) << "Setup filter-graph with arguments: '" << filterArgs << "'." << endl;
 
-        fferr = avfilter_graph_config(m_pFilterGraph, nullptr);
+        fferr = avfilter_graph_config(tFg.pFilterGraph, nullptr);
         if (fferr < 0)
         {
             oss << "FAILED to invoke 'avfilter_graph_config'! fferr=" << fferr << ".";
@@ -1284,40 +2081,40 @@ private:
             return false;
         }
 
-        if (m_pFilterOutputs)
-            avfilter_inout_free(&m_pFilterOutputs);
-        if (m_pFilterInputs)
-            avfilter_inout_free(&m_pFilterInputs);
+        if (tFg.pFilterOutputs)
+            avfilter_inout_free(&tFg.pFilterOutputs);
+        if (tFg.pFilterInputs)
+            avfilter_inout_free(&tFg.pFilterInputs);
         return true;
     }
 
-    void ReleaseFilterGraph()
+    void ReleaseFilterGraph(_FilterGraph& tFg)
     {
-        if (m_pFilterOutputs)
+        if (tFg.pFilterOutputs)
         {
-            avfilter_inout_free(&m_pFilterOutputs);
-            m_pFilterOutputs = nullptr;
+            avfilter_inout_free(&tFg.pFilterOutputs);
+            tFg.pFilterOutputs = nullptr;
         }
-        if (m_pFilterInputs)
+        if (tFg.pFilterInputs)
         {
-            avfilter_inout_free(&m_pFilterInputs);
-            m_pFilterInputs = nullptr;
+            avfilter_inout_free(&tFg.pFilterInputs);
+            tFg.pFilterInputs = nullptr;
         }
-        m_pBufsrcCtx = nullptr;
-        m_pBufsinkCtx = nullptr;
-        if (m_pFilterGraph)
+        tFg.pBufsrcCtx = nullptr;
+        tFg.pBufsinkCtx = nullptr;
+        if (tFg.pFilterGraph)
         {
-            avfilter_graph_free(&m_pFilterGraph);
-            m_pFilterGraph = nullptr;
+            avfilter_graph_free(&tFg.pFilterGraph);
+            tFg.pFilterGraph = nullptr;
         }
     }
 
-    bool SetupEncoder(const AVFrame* pInAvfrm)
+    bool SetupEncoder(const AVFrame* pInAvfrm, const string& strOutputPath, MediaCore::MediaEncoder::Holder& hOutEncoder)
     {
         auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
-        if (!hEncoder->Open(m_strOutputPath))
+        if (!hEncoder->Open(strOutputPath))
         {
-            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << m_strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
+            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
             return false;
         }
@@ -1341,20 +2138,10 @@ private:
             m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
             return false;
         }
-        m_hEncoder = hEncoder;
+        hOutEncoder = hEncoder;
         return true;
     }
 
-    void ReleaseEncoder()
-    {
-        if (m_hEncoder)
-        {
-            if (!m_hEncoder->Close())
-                m_pLogger->Log(Error) << "In bg-task '" << m_name << "', FAILED to close the encoder! Error is '" << m_hEncoder->GetError() << "'." << endl;
-            m_hEncoder = nullptr;
-        }
-    }
-
 private:
     string m_name;
     size_t m_szHash;
@@ -1363,16 +2150,13 @@ private:
     Callbacks* m_pCb{nullptr};
     bool m_bInited{false};
     string m_strTaskDir;
-    AVFilterGraph* m_pFilterGraph{nullptr};
-    AVFilterContext* m_pBufsrcCtx;
-    AVFilterContext* m_pBufsinkCtx;
-    AVFilterInOut* m_pFilterOutputs{nullptr};
-    AVFilterInOut* m_pFilterInputs{nullptr};
-    AVPixelFormat m_eFgInputPixfmt;
+    _FilterGraph m_tDetectFg;
+    AVPixelFormat m_eFgInputPixfmt{AV_PIX_FMT_YUV420P};
     string m_strTrfPath;
     string m_strSrcUrl;
     int64_t m_i64ClipId;
     MediaCore::VideoClip::Holder m_hVclip;
+    SharedSourceDecoder::Holder m_hSrcDecoder;
     const MediaCore::VideoStream* m_pVidstm{nullptr};
     MediaCore::SharedSettings::Holder m_hSettings;
     bool m_bIsImageSeq{false};
@@ -1396,15 +2180,27 @@ private:
     float m_fZoomSpeed{0.25f};      // Set percent to zoom maximally each frame (enabled when optzoom is set to 2). Range is from 0 to 5.
     uint8_t m_u8InterpMode{2};      // 0: nearest, 1: linear, 2: bilinear, 3: bicubic.
     bool m_bVidstabTransformFinished{false};
+    vector<_TransformSegment> m_aTransformSegments;
+    bool m_bParallelTransform{true};
+    float m_fStaticOptZoom{-1.f};   // static optimal zoom computed over the whole transforms file, negative if not computed
+    static constexpr int MAX_TRANSFORM_WORKER_COUNT = 4;
+    static constexpr int64_t MIN_TRANSFORM_RANGE_FRAMES = 250;
+    mutex m_mtxWorkerLock;
+    atomic_int32_t m_i32RunningWorkerCnt{0};
+    atomic_int32_t m_i32PausedWorkerCnt{0};
+    atomic_int64_t m_i64TransformedFrmCnt{0};
+    int64_t m_i64TransformEofFrmIdx{-1};
     // output settings
-    MediaCore::MediaEncoder::Holder m_hEncoder;
     string m_strVidencCodecName;
     string m_strVidencPixfmt;
     uint64_t m_u64VidencBitrate;
     vector<MediaCore::MediaEncoder::Option> m_aVidencExtraOpts;
     string m_strOutputPath;
     float m_fProgress{0.f};
+    MetricsRecorder m_tMetricsRecorder;
     // task control
+    Priority m_ePriority{PRIORITY_NORMAL};
+    atomic_int32_t m_i32MaxWorkerCnt{max((int)thread::hardware_concurrency()/4, 1)};
     bool m_bPause{false};
     bool m_bPauseCheckPointHit{false};
 };
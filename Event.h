@@ -27,7 +27,9 @@ namespace MEC
         virtual int32_t Z() const = 0;
         virtual uint32_t Status() const = 0;
         virtual bool IsInRange(int64_t pos) const = 0;
+        // The blueprint of an event loaded from json is built when it's accessed for the first time
         virtual BluePrint::BluePrintUI* GetBp() = 0;
+        virtual bool IsBpReady() const = 0;
         virtual ImGui::KeyPointEditor* GetKeyPoint() = 0;
         virtual bool ChangeRange(int64_t start, int64_t end) = 0;
         virtual void ChangeId(int64_t id) = 0;
@@ -51,6 +53,15 @@ namespace MEC
         virtual const ImGui::MaskCreator::Holder GetMaskCreator(int64_t nodeId, size_t index) const = 0;
         virtual bool RemoveMask(size_t index) = 0;
         virtual bool RemoveMask(int64_t nodeId, size_t index) = 0;
+        virtual void InvalidateMaskCache() = 0;
+
+        // Tiled execution runs the event blueprint on horizontal bands of the frame in parallel. It's only valid for
+        // filters that work on local pixels, 'haloRows' is the vertical footprint needed by such filters. A blueprint
+        // containing any other node, or a node whose footprint exceeds 'haloRows', still runs on the full frame.
+        virtual void EnableTiledExecution(bool enable, int32_t haloRows = 0) = 0;
+        virtual bool IsTiledExecutionEnabled() const = 0;
+        virtual int32_t GetTileHaloRows() const = 0;
+        virtual void InvalidateTileBluePrints() = 0;
     };
 
     struct AudioEvent : virtual Event
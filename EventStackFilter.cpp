@@ -1,9 +1,19 @@
 #include <algorithm>
 #include <functional>
 #include <sstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <list>
+#include <cstring>
+#include <cctype>
+#include <cmath>
 #include <VideoBlender.h>
 #include <MatMath.h>
 #include "EventStackFilter.h"
+#include "FrameBufferPool.h"
+#include "MecAsyncLog.h"
 
 using namespace std;
 using namespace MediaCore;
@@ -38,7 +48,8 @@ public:
     int32_t Z() const override { return m_z; }
     uint32_t Status() const override { return m_status; }
     bool IsInRange(int64_t pos) const override { return pos >= m_start && pos < m_end; }
-    BluePrint::BluePrintUI* GetBp() override { return m_pBp; }
+    BluePrint::BluePrintUI* GetBp() override { return EnsureBp(); }
+    bool IsBpReady() const override { return !m_bBpPending; }
     ImGui::KeyPointEditor* GetKeyPoint() override { return m_pKp; }
     void ChangeId(int64_t id) override { m_id = id; }
     bool ChangeRange(int64_t start, int64_t end) override;
@@ -55,7 +66,11 @@ public:
 
     void SetBluePrintCallbacks(const BluePrint::BluePrintCallbackFunctions& bpCallbacks)
     {
-        m_pBp->SetCallbacks(bpCallbacks, reinterpret_cast<void*>(&m_filterCtx));
+        lock_guard<mutex> lk(m_mtxBpLock);
+        m_tBpCallbacks = bpCallbacks;
+        if (!m_bBpPending)
+            m_pBp->SetCallbacks(bpCallbacks, reinterpret_cast<void*>(&m_filterCtx));
+        OnBluePrintCallbacksChanged();
     }
 
     imgui_json::value SaveAsJson() const override
@@ -65,7 +80,10 @@ public:
         json["start"] = imgui_json::number(m_start);
         json["end"] = imgui_json::number(m_end);
         json["z"] = imgui_json::number(m_z);
-        json["bp"] = m_pBp->m_Document->Serialize();
+        {
+            lock_guard<mutex> lk(m_mtxBpLock);
+            json["bp"] = m_bBpPending ? m_jnPendingBp : m_pBp->m_Document->Serialize();
+        }
         imgui_json::value kpJson;
         m_pKp->Save(kpJson);
         json["kp"] = kpJson;
@@ -76,6 +94,11 @@ protected:
     Event_Base(EventStack_Base* owner, int64_t id, int64_t start, int64_t end, int32_t z,
             const BluePrint::BluePrintCallbackFunctions& bpCallbacks);
     Event_Base(EventStack_Base* owner);
+    // only keeps the blueprint json, the blueprint is built by 'EnsureBp()' when it's needed
+    void SetPendingBp(const imgui_json::value& bpJson, const BluePrint::BluePrintCallbackFunctions& bpCallbacks, const string& strBpName, const string& strBpType);
+    BluePrint::BluePrintUI* EnsureBp();
+    // called with 'm_mtxBpLock' held
+    virtual void OnBluePrintCallbacksChanged() {}
 
 protected:
     EventStack_Base* m_owner;
@@ -87,6 +110,13 @@ protected:
     int64_t m_end;
     int32_t m_z{-1};
     uint32_t m_status{0};
+    mutable mutex m_mtxBpLock;
+    atomic_bool m_bBpPending{false};
+    imgui_json::value m_jnPendingBp;
+    // the callbacks of the blueprint, also given to the copies made for tiled execution
+    BluePrint::BluePrintCallbackFunctions m_tBpCallbacks;
+    string m_strBpName;
+    string m_strBpType;
 };
 
 class EventStack_Base : public virtual EventStack
@@ -331,7 +361,7 @@ public:
     }
 
     string GetError() const override { return m_errMsg; }
-    void SetLogLevel(Level l) override { m_logger->SetShowLevels(l); }
+    void SetLogLevel(Level l) override { MEC::AsyncLog::SetLoggerLevel(m_logger, l); }
 
 
     bool EnrollEvent(Event::Holder hEvt)
@@ -384,6 +414,7 @@ Event_Base::Event_Base(EventStack_Base* owner, int64_t id, int64_t start, int64_
     m_pBp = new BluePrint::BluePrintUI();
     m_pBp->Initialize();
     m_filterCtx = {reinterpret_cast<void*>(static_cast<EventStack*>(owner)), reinterpret_cast<void*>(static_cast<Event*>(this))};
+    m_tBpCallbacks = bpCallbacks;
     m_pBp->SetCallbacks(bpCallbacks, reinterpret_cast<void*>(&m_filterCtx));
 }
 
@@ -392,6 +423,36 @@ Event_Base::Event_Base(EventStack_Base* owner) : m_owner(owner)
     m_filterCtx = {reinterpret_cast<void*>(static_cast<EventStack*>(owner)), reinterpret_cast<void*>(static_cast<Event*>(this))};
 }
 
+void Event_Base::SetPendingBp(const imgui_json::value& bpJson, const BluePrint::BluePrintCallbackFunctions& bpCallbacks, const string& strBpName, const string& strBpType)
+{
+    lock_guard<mutex> lk(m_mtxBpLock);
+    m_jnPendingBp = bpJson;
+    m_tBpCallbacks = bpCallbacks;
+    m_strBpName = strBpName;
+    m_strBpType = strBpType;
+    m_bBpPending = true;
+}
+
+BluePrint::BluePrintUI* Event_Base::EnsureBp()
+{
+    if (!m_bBpPending)
+        return m_pBp;
+    lock_guard<mutex> lk(m_mtxBpLock);
+    if (m_bBpPending)
+    {
+        auto pBp = new BluePrint::BluePrintUI();
+        pBp->Initialize();
+        pBp->SetCallbacks(m_tBpCallbacks, reinterpret_cast<void*>(&m_filterCtx));
+        pBp->File_New_Filter(m_jnPendingBp, m_strBpName, m_strBpType);
+        if (!pBp->Blueprint_IsValid())
+            m_owner->m_logger->Log(WARN) << "Event#" << m_id << " has INVALID blueprint json, it won't be executed." << endl;
+        m_pBp = pBp;
+        m_jnPendingBp = imgui_json::value();
+        m_bBpPending = false;
+    }
+    return m_pBp;
+}
+
 bool Event_Base::ChangeRange(int64_t start, int64_t end)
 {
     return m_owner->ChangeEventRange(m_id, start, end);
@@ -429,6 +490,235 @@ ostream& operator<<(ostream& os, const EventStack& estk)
     return os;
 }
 
+// A small worker pool shared by all the video event filters, used to run the bands of a tiled filter chain.
+// The calling thread always takes part in the work, so concurrent callers can not dead-lock on a busy pool.
+class TileWorkerPool
+{
+public:
+    static TileWorkerPool& GetInstance()
+    {
+        static TileWorkerPool s_tileWorkerPool;
+        return s_tileWorkerPool;
+    }
+
+    uint32_t GetWorkerCount() const { return m_aWorkers.size(); }
+
+    void Run(vector<function<void()>>& aTasks)
+    {
+        if (aTasks.empty())
+            return;
+        auto hBatch = make_shared<_Batch>();
+        hBatch->szPendingCnt = aTasks.size();
+        {
+            lock_guard<mutex> lk(m_mtxQueue);
+            for (auto& task : aTasks)
+                m_aTaskQueue.push_back({hBatch, &task});
+        }
+        m_cvQueue.notify_all();
+        while (true)
+        {
+            _Task tTask;
+            {
+                unique_lock<mutex> lk(m_mtxQueue);
+                if (hBatch->szPendingCnt == 0)
+                    break;
+                if (m_aTaskQueue.empty())
+                {
+                    m_cvDone.wait(lk);
+                    continue;
+                }
+                tTask = m_aTaskQueue.front();
+                m_aTaskQueue.pop_front();
+            }
+            _ExecuteTask(tTask);
+        }
+    }
+
+private:
+    struct _Batch
+    {
+        size_t szPendingCnt{0};
+    };
+
+    struct _Task
+    {
+        shared_ptr<_Batch> hBatch;
+        function<void()>* pTaskFn{nullptr};
+    };
+
+    TileWorkerPool()
+    {
+        const uint32_t u32HwThreadCnt = thread::hardware_concurrency();
+        const uint32_t u32WorkerCnt = u32HwThreadCnt > 1 ? min(u32HwThreadCnt-1, 15u) : 0;
+        for (uint32_t i = 0; i < u32WorkerCnt; i++)
+            m_aWorkers.push_back(thread(&TileWorkerPool::_WorkerProc, this));
+    }
+
+    ~TileWorkerPool()
+    {
+        {
+            lock_guard<mutex> lk(m_mtxQueue);
+            m_bQuit = true;
+        }
+        m_cvQueue.notify_all();
+        for (auto& t : m_aWorkers)
+        {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    void _WorkerProc()
+    {
+        while (true)
+        {
+            _Task tTask;
+            {
+                unique_lock<mutex> lk(m_mtxQueue);
+                m_cvQueue.wait(lk, [this] { return m_bQuit || !m_aTaskQueue.empty(); });
+                if (m_bQuit)
+                    break;
+                tTask = m_aTaskQueue.front();
+                m_aTaskQueue.pop_front();
+            }
+            _ExecuteTask(tTask);
+        }
+    }
+
+    void _ExecuteTask(_Task& tTask)
+    {
+        (*tTask.pTaskFn)();
+        {
+            lock_guard<mutex> lk(m_mtxQueue);
+            tTask.hBatch->szPendingCnt--;
+        }
+        m_cvDone.notify_all();
+    }
+
+private:
+    vector<thread> m_aWorkers;
+    list<_Task> m_aTaskQueue;
+    mutex m_mtxQueue;
+    condition_variable m_cvQueue;
+    condition_variable m_cvDone;
+    bool m_bQuit{false};
+};
+
+// Bytes of one image row if the mat can be split into horizontal bands, otherwise 0.
+static size_t GetTileRowBytes(const ImGui::ImMat& m)
+{
+    if (m.empty() || m.device != IM_DD_CPU || m.w <= 0 || m.h <= 0)
+        return 0;
+    // planar data can not be split into contiguous bands
+    if (m.c > 1 && m.elempack != m.c)
+        return 0;
+    return (size_t)m.w*m.elempack*m.elemsize;
+}
+
+static const int32_t MAX_TILE_HALO_ROWS = 256;
+
+// Nodes which compute each output pixel from the input pixel at the same position only
+static const char* const TILE_POINTWISE_NODE_TYPES[] = {
+    "Entry", "Exit", "CommentNode", "GroupNode",
+    "Brightness", "Contrast", "Exposure", "Saturation", "Vibrance", "Gamma", "Hue", "White Balance",
+    "Color Balance", "Color Invert", "Color Curve", "Lut 3D", "Chroma Key", "Binary",
+};
+
+// Nodes which read a neighbourhood of each pixel. The footprint is 'i32FixedRows', or taken from the node parameter
+// matched by 'pcParamKey' when it's not negative. The parameter is scaled by 'fParamScale', e.g. 3 for a sigma.
+struct _TileFootprintNode
+{
+    const char* pcNodeType;
+    int32_t i32FixedRows;
+    const char* pcParamKey;
+    float fParamScale;
+};
+static const _TileFootprintNode TILE_FOOTPRINT_NODE_TYPES[] = {
+    { "Sobel Edge",         1, nullptr,     0.f },
+    { "Laplacian Edge",     1, nullptr,     0.f },
+    { "Emboss",             1, nullptr,     0.f },
+    { "CAS Sharpen",        1, nullptr,     0.f },
+    { "Box Blur",          -1, "size",      1.f },
+    { "Gaussian Blur",     -1, "sigma",     3.f },
+    { "Bilateral Blur",    -1, "size",      1.f },
+    { "Guided Filter",     -1, "radius",    1.f },
+    { "Kuwahara",          -1, "radius",    1.f },
+    { "USM Sharpen",       -1, "sigma",     3.f },
+    { "Dilation",          -1, "size",      1.f },
+    { "Erosion",           -1, "size",      1.f },
+};
+
+// Returns the largest numeric value of the node parameters whose name contains 'strKey', or a negative value
+static double _FindNodeParam(const imgui_json::value& jnNode, const string& strKey)
+{
+    double dValue = -1;
+    if (!jnNode.is_object())
+        return dValue;
+    for (const auto& elem : jnNode.get<imgui_json::object>())
+    {
+        string strName = elem.first;
+        transform(strName.begin(), strName.end(), strName.begin(), [] (unsigned char c) { return (char)tolower(c); });
+        if (elem.second.is_number() && strName.find(strKey) != string::npos)
+            dValue = max(dValue, (double)elem.second.get<imgui_json::number>());
+        else if (elem.second.is_object())
+            dValue = max(dValue, _FindNodeParam(elem.second, strKey));
+    }
+    return dValue;
+}
+
+// Checks whether a filter blueprint can be run on horizontal bands extended by 'i32HaloRows'. Every node must be a
+// point-wise one, or a neighbourhood one whose footprint fits in the halo. Nodes that move pixels, work on the whole
+// frame or are unknown need the full frame, 'strBlockingNode' tells the first of them.
+static bool IsBluePrintTileable(const imgui_json::value& bpJson, int32_t i32HaloRows, string& strBlockingNode)
+{
+    strBlockingNode.clear();
+    const imgui_json::value* pjnBp = &bpJson;
+    if (bpJson.is_object() && bpJson.contains("document") && bpJson["document"].is_object())
+        pjnBp = &bpJson["document"];
+    if (pjnBp->is_object() && pjnBp->contains("blueprint"))
+        pjnBp = &(*pjnBp)["blueprint"];
+    const imgui_json::array* pNodeArray = nullptr;
+    if (!pjnBp->is_object() || !imgui_json::GetPtrTo(*pjnBp, "nodes", pNodeArray))
+        return false;
+    for (const auto& jnNode : *pNodeArray)
+    {
+        string strType;
+        if (!imgui_json::GetTo<imgui_json::string>(jnNode, "type", strType))
+            return false;
+        bool bTileable = false;
+        for (auto pcType : TILE_POINTWISE_NODE_TYPES)
+        {
+            if (strType == pcType)
+            {
+                bTileable = true;
+                break;
+            }
+        }
+        if (!bTileable)
+        {
+            for (const auto& tDef : TILE_FOOTPRINT_NODE_TYPES)
+            {
+                if (strType != tDef.pcNodeType)
+                    continue;
+                double dFootprint = tDef.i32FixedRows;
+                if (tDef.pcParamKey)
+                {
+                    const auto dParam = _FindNodeParam(jnNode, tDef.pcParamKey);
+                    dFootprint = dParam >= 0 ? ceil(dParam*tDef.fParamScale) : -1;
+                }
+                bTileable = dFootprint >= 0 && dFootprint <= i32HaloRows;
+                break;
+            }
+        }
+        if (!bTileable)
+        {
+            strBlockingNode = strType;
+            return false;
+        }
+    }
+    return true;
+}
+
 class VideoEventStackFilter_Impl final : public VideoEventStackFilter, public EventStack_Base
 {
 public:
@@ -506,7 +796,8 @@ public:
             eventJsonAry.push_back(pEvtImpl->SaveAsJson());
         }
         json["events"] = eventJsonAry;
-        m_logger->Log(DEBUG) << "Save filter-json : " << json.dump() << std::endl;
+        if (MEC::AsyncLog::IsEnabled(m_logger, DEBUG))
+            MEC::AsyncLog::PostLazy(m_logger, DEBUG, [json] (ostream& os) { os << "Save filter-json : " << json.dump(); });
         return std::move(json);
     }
 
@@ -543,14 +834,16 @@ public:
         }
 
         ~VideoEvent_Impl()
-        {}
+        {
+            ReleaseTileBluePrints();
+        }
 
         static Event::Holder LoadFromJson(VideoEventStackFilter_Impl* owner, const imgui_json::value& bpJson, const BluePrint::BluePrintCallbackFunctions& bpCallbacks, SharedSettings::Holder hSettings = nullptr);
 
         ImGui::ImMat FilterImage(const ImGui::ImMat& vmat, int64_t pos) override
         {
             ImGui::ImMat outMat(vmat);
-            if (m_pBp->Blueprint_IsExecutable())
+            if (EnsureBp()->Blueprint_IsExecutable())
             {
                 // setup bp input curve
                 const int iCurveCnt = m_pKp->GetCurveCount();
@@ -561,27 +854,13 @@ public:
                     m_pBp->Blueprint_SetFilter(name, value);
                 }
                 ImGui::ImMat inMat(vmat);
-                m_pBp->Blueprint_RunFilter(inMat, outMat, pos, Length());
+                if (!m_bTiledExec || !RunBluePrintTiled(inMat, outMat, pos))
+                    m_pBp->Blueprint_RunFilter(inMat, outMat, pos, Length());
 
                 if (!m_ahMaskCreators.empty())
                 {
-                    const int64_t i64Tick = pos;
-                    ImGui::ImMat mCombinedMask;
                     const MatUtils::Size2i szImageSize(outMat.w, outMat.h);
-                    const auto szMaskCnt = m_ahMaskCreators.size();
-                    for (auto i = 0; i < szMaskCnt; i++)
-                    {
-                        auto& hMaskCreator = m_ahMaskCreators[i];
-                        if (szImageSize != hMaskCreator->GetMaskSize())
-                            hMaskCreator->ChangeMaskSize(szImageSize, true);
-                        if (!hMaskCreator->IsMaskReady())
-                            continue;
-                        auto mMask = m_ahMaskCreators[i]->GetMask(ImGui::MaskCreator::AA, true, IM_DT_FLOAT32, 1, 0, i64Tick);
-                        if (mCombinedMask.empty())
-                            mCombinedMask = mMask.clone();
-                        else
-                            MatUtils::Max(mCombinedMask, mMask);
-                    }
+                    auto mCombinedMask = GetCombinedMask(szImageSize, pos);
                     if (!mCombinedMask.empty())
                     {
                         if (!m_hBlender) m_hBlender = MediaCore::VideoBlender::CreateInstance();
@@ -597,6 +876,46 @@ public:
             Event_Base::UpdateKeyPointRange();
             for (auto& hMaskCreator : m_ahMaskCreators)
                 hMaskCreator->SetTickRange(0, Length());
+            InvalidateMaskCache();
+        }
+
+        void EnableTiledExecution(bool enable, int32_t haloRows) override
+        {
+            m_bTiledExec = enable;
+            m_i32TileHaloRows = min(max(haloRows, (int32_t)0), MAX_TILE_HALO_ROWS);
+            m_bTileExecSupported = true;
+            m_bTileBpsDirty = true;
+        }
+
+        bool IsTiledExecutionEnabled() const override
+        {
+            return m_bTiledExec;
+        }
+
+        int32_t GetTileHaloRows() const override
+        {
+            return m_i32TileHaloRows;
+        }
+
+        void OnBluePrintCallbacksChanged() override
+        {
+            // the blueprint copies keep the old callbacks
+            m_bTileBpsDirty = true;
+        }
+
+        void InvalidateTileBluePrints() override
+        {
+            // the edited blueprint may be tileable again even if the previous one was not
+            m_bTileExecSupported = true;
+            m_bTileBpsDirty = true;
+        }
+
+        void InvalidateMaskCache() override
+        {
+            lock_guard<mutex> lk(m_mtxMaskCache);
+            m_amStaticMasks.clear();
+            m_mStaticCombinedMask.release();
+            m_amAnimatedMaskCache.clear();
         }
 
         ImGui::MaskCreator::Holder CreateNewMask(const string& name) override
@@ -607,6 +926,7 @@ public:
             auto hMaskCreator = ImGui::MaskCreator::CreateInstance(szMaskSize, name);
             hMaskCreator->SetTickRange(0, Length());
             m_ahMaskCreators.push_back(hMaskCreator);
+            InvalidateMaskCache();
             return hMaskCreator;
         }
 
@@ -665,6 +985,7 @@ public:
             }
             auto itDel = m_ahMaskCreators.begin()+index;
             m_ahMaskCreators.erase(itDel);
+            InvalidateMaskCache();
             return true;
         }
 
@@ -724,11 +1045,287 @@ public:
                 maskTableJson.push_back(subj);
             }
             j["effect_mask_table"] = maskTableJson;
+            j["tiled_exec"] = m_bTiledExec.load();
+            j["tile_halo_rows"] = imgui_json::number(m_i32TileHaloRows.load());
             return j;
         }
 
+    private:
+        // Run the blueprint on horizontal bands of the frame in parallel. Each band except the first one is processed
+        // by its own copy of the blueprint, and is extended by 'm_i32TileHaloRows' rows on both sides so that filters
+        // with a spatial footprint still see their neighbourhood. Returns false if the frame can not be processed this way.
+        bool RunBluePrintTiled(ImGui::ImMat& inMat, ImGui::ImMat& outMat, int64_t pos)
+        {
+            if (!m_bTileExecSupported)
+                return false;
+            const int iHalo = m_i32TileHaloRows;
+            const size_t szInRowBytes = GetTileRowBytes(inMat);
+            auto& tileWorkerPool = TileWorkerPool::GetInstance();
+            const int iBandCnt = min((int)tileWorkerPool.GetWorkerCount()+1, inMat.h/MIN_TILE_BAND_HEIGHT);
+            if (szInRowBytes == 0 || iBandCnt < 2)
+                return false;
+
+            lock_guard<mutex> lk(m_mtxTileBps);
+            if (m_bTileBpsDirty.exchange(false))
+            {
+                ReleaseTileBluePrints();
+                string strBlockingNode;
+                if (!IsBluePrintTileable(m_pBp->m_Document->Serialize(), iHalo, strBlockingNode))
+                {
+                    m_owner->m_logger->Log(WARN) << "Event#" << m_id << " has node '" << strBlockingNode << "' which needs the full frame with "
+                            << iHalo << " halo rows, fall back to full frame mode." << endl;
+                    m_bTileExecSupported = false;
+                    return false;
+                }
+            }
+            if (m_apTileBps.size() < iBandCnt-1)
+            {
+                auto bpJson = m_pBp->m_Document->Serialize();
+                BluePrint::BluePrintCallbackFunctions tBpCallbacks;
+                {
+                    lock_guard<mutex> lk2(m_mtxBpLock);
+                    tBpCallbacks = m_tBpCallbacks;
+                }
+                while (m_apTileBps.size() < iBandCnt-1)
+                {
+                    auto pBp = new BluePrint::BluePrintUI();
+                    pBp->Initialize();
+                    pBp->SetCallbacks(tBpCallbacks, reinterpret_cast<void*>(&m_filterCtx));
+                    pBp->File_New_Filter(bpJson, "VideoEventBp", "Video");
+                    if (!pBp->Blueprint_IsExecutable())
+                    {
+                        m_owner->m_logger->Log(WARN) << "Event#" << m_id << " FAILED to create blueprint copy for tiled execution, fall back to full frame mode." << endl;
+                        pBp->Finalize();
+                        delete pBp;
+                        m_bTileExecSupported = false;
+                        return false;
+                    }
+                    m_apTileBps.push_back(pBp);
+                }
+            }
+            const int iCurveCnt = m_pKp->GetCurveCount();
+            for (auto i = 0; i < iBandCnt-1; i++)
+            {
+                for (int j = 0; j < iCurveCnt; j++)
+                {
+                    auto name = m_pKp->GetCurveName(j);
+                    auto value = m_pKp->GetValueByDim(j, pos, ImGui::ImCurveEdit::DIM_X);
+                    m_apTileBps[i]->Blueprint_SetFilter(name, value);
+                }
+            }
+
+            const int iBandHeight = (inMat.h+iBandCnt-1)/iBandCnt;
+            const int64_t i64Length = Length();
+            vector<ImGui::ImMat> amBandOuts(iBandCnt);
+            vector<int> aiBandTops(iBandCnt), aiBandBottoms(iBandCnt), aiHaloTops(iBandCnt);
+            vector<function<void()>> aTasks;
+            aTasks.reserve(iBandCnt);
+            for (auto i = 0; i < iBandCnt; i++)
+            {
+                aiBandTops[i] = i*iBandHeight;
+                aiBandBottoms[i] = min(inMat.h, aiBandTops[i]+iBandHeight);
+                aiHaloTops[i] = max(0, aiBandTops[i]-iHalo);
+                const int iHaloBottom = min(inMat.h, aiBandBottoms[i]+iHalo);
+                auto pBp = i == 0 ? m_pBp : m_apTileBps[i-1];
+                aTasks.push_back([&inMat, &amBandOuts, &aiHaloTops, szInRowBytes, iHaloBottom, pBp, pos, i64Length, i] () {
+                    const int iHaloTop = aiHaloTops[i];
+                    auto mBandIn = FrameBufferPool::GetDefaultInstance()->AcquireMat(inMat.w, iHaloBottom-iHaloTop, inMat.c, inMat.type, inMat.elempack);
+                    if (GetTileRowBytes(mBandIn) != szInRowBytes)
+                        return;
+                    mBandIn.copy_attribute(inMat);
+                    memcpy(mBandIn.data, (const uint8_t*)inMat.data+szInRowBytes*iHaloTop, szInRowBytes*mBandIn.h);
+                    pBp->Blueprint_RunFilter(mBandIn, amBandOuts[i], pos, i64Length);
+                });
+            }
+            tileWorkerPool.Run(aTasks);
+
+            // every band must come out with the layout of the first one and keep its size, otherwise the
+            // blueprint is not suitable for tiling (e.g. it scales the image)
+            const auto& mFirstOut = amBandOuts[0];
+            const size_t szOutRowBytes = GetTileRowBytes(mFirstOut);
+            bool bBandsValid = szOutRowBytes > 0;
+            for (auto i = 0; i < iBandCnt && bBandsValid; i++)
+            {
+                const auto& mBandOut = amBandOuts[i];
+                const int iExpectedHeight = min(inMat.h, aiBandBottoms[i]+iHalo)-aiHaloTops[i];
+                if (mBandOut.w != inMat.w || mBandOut.h != iExpectedHeight || mBandOut.type != mFirstOut.type
+                    || mBandOut.c != mFirstOut.c || GetTileRowBytes(mBandOut) != szOutRowBytes)
+                    bBandsValid = false;
+            }
+            if (!bBandsValid)
+            {
+                m_owner->m_logger->Log(WARN) << "Event#" << m_id << " blueprint output is not suitable for tiled execution, fall back to full frame mode." << endl;
+                m_bTileExecSupported = false;
+                return false;
+            }
+
+            auto mTiledOut = FrameBufferPool::GetDefaultInstance()->AcquireMat(inMat.w, inMat.h, mFirstOut.c, mFirstOut.type, mFirstOut.elempack);
+            if (GetTileRowBytes(mTiledOut) != szOutRowBytes)
+            {
+                m_bTileExecSupported = false;
+                return false;
+            }
+            mTiledOut.copy_attribute(mFirstOut);
+            for (auto i = 0; i < iBandCnt; i++)
+            {
+                const int iSkipRows = aiBandTops[i]-aiHaloTops[i];
+                memcpy((uint8_t*)mTiledOut.data+szOutRowBytes*aiBandTops[i], (const uint8_t*)amBandOuts[i].data+szOutRowBytes*iSkipRows,
+                        szOutRowBytes*(aiBandBottoms[i]-aiBandTops[i]));
+            }
+            outMat = mTiledOut;
+            return true;
+        }
+
+        void ReleaseTileBluePrints()
+        {
+            for (auto pBp : m_apTileBps)
+            {
+                pBp->Finalize();
+                delete pBp;
+            }
+            m_apTileBps.clear();
+        }
+
+        // Rasterizing a mask is expensive, so it should not be done for every frame. Masks without key-frames
+        // are rasterized once per output size, while key-framed masks are combined and kept for a few recent ticks.
+        ImGui::ImMat GetCombinedMask(const MatUtils::Size2i& szImageSize, int64_t i64Tick)
+        {
+            lock_guard<mutex> lk(m_mtxMaskCache);
+            const auto szMaskCnt = m_ahMaskCreators.size();
+            if (szImageSize != m_szMaskCacheSize || m_amStaticMasks.size() != szMaskCnt)
+            {
+                m_amStaticMasks.clear();
+                m_amStaticMasks.resize(szMaskCnt);
+                m_mStaticCombinedMask.release();
+                m_amAnimatedMaskCache.clear();
+                m_szMaskCacheSize = szImageSize;
+            }
+
+            bool bHasAnimatedMask = false;
+            for (const auto& hMaskCreator : m_ahMaskCreators)
+            {
+                if (hMaskCreator->IsKeyFrameEnabled())
+                {
+                    bHasAnimatedMask = true;
+                    break;
+                }
+            }
+            if (!bHasAnimatedMask)
+            {
+                if (!m_mStaticCombinedMask.empty())
+                    return m_mStaticCombinedMask;
+            }
+            else
+            {
+                auto itCache = find_if(m_amAnimatedMaskCache.begin(), m_amAnimatedMaskCache.end(), [i64Tick] (const pair<int64_t, ImGui::ImMat>& elem) {
+                    return elem.first == i64Tick;
+                });
+                if (itCache != m_amAnimatedMaskCache.end())
+                    return itCache->second;
+            }
+
+            vector<ImGui::ImMat> amMasks;
+            amMasks.reserve(szMaskCnt);
+            for (auto i = 0; i < szMaskCnt; i++)
+            {
+                auto& hMaskCreator = m_ahMaskCreators[i];
+                if (szImageSize != hMaskCreator->GetMaskSize())
+                    hMaskCreator->ChangeMaskSize(szImageSize, true);
+                if (!hMaskCreator->IsMaskReady())
+                    continue;
+                if (hMaskCreator->IsKeyFrameEnabled())
+                {
+                    amMasks.push_back(FrameBufferPool::GetDefaultInstance()->CloneMat(hMaskCreator->GetMask(ImGui::MaskCreator::AA, true, IM_DT_FLOAT32, 1, 0, i64Tick)));
+                }
+                else
+                {
+                    auto& mStaticMask = m_amStaticMasks[i];
+                    if (mStaticMask.empty())
+                        mStaticMask = hMaskCreator->GetMask(ImGui::MaskCreator::AA, true, IM_DT_FLOAT32, 1, 0, i64Tick).clone();
+                    amMasks.push_back(mStaticMask);
+                }
+            }
+            auto mCombinedMask = CombineMasks(amMasks);
+            if (!bHasAnimatedMask)
+            {
+                m_mStaticCombinedMask = mCombinedMask;
+            }
+            else if (!mCombinedMask.empty())
+            {
+                if (m_amAnimatedMaskCache.size() >= MAX_ANIMATED_MASK_CACHE_SIZE)
+                    m_amAnimatedMaskCache.pop_front();
+                m_amAnimatedMaskCache.push_back({i64Tick, mCombinedMask});
+            }
+            return mCombinedMask;
+        }
+
+        // Combine all the masks into one with per-pixel maximum. The cpu float path walks the output in
+        // cache-sized blocks and applies every source mask to a block before moving on, and the inner loop is kept
+        // simple enough for the compiler to vectorize it.
+        static ImGui::ImMat CombineMasks(const vector<ImGui::ImMat>& amMasks)
+        {
+            if (amMasks.empty())
+                return ImGui::ImMat();
+            if (amMasks.size() == 1)
+                return amMasks[0];
+            const auto& mFirst = amMasks[0];
+            bool bFastPath = true;
+            for (const auto& m : amMasks)
+            {
+                if (m.device != IM_DD_CPU || m.type != IM_DT_FLOAT32 || m.c != 1 || m.elempack != 1 || m.w != mFirst.w || m.h != mFirst.h)
+                {
+                    bFastPath = false;
+                    break;
+                }
+            }
+            if (!bFastPath)
+            {
+                auto mCombinedMask = mFirst.clone();
+                for (auto i = 1; i < amMasks.size(); i++)
+                    MatUtils::Max(mCombinedMask, amMasks[i]);
+                return mCombinedMask;
+            }
+
+            auto mCombinedMask = FrameBufferPool::GetDefaultInstance()->AcquireMat(mFirst.w, mFirst.h, IM_DT_FLOAT32);
+            mCombinedMask.time_stamp = mFirst.time_stamp;
+            const size_t szPixCnt = (size_t)mFirst.w*mFirst.h;
+            const size_t szSrcCnt = amMasks.size();
+            float* pDst = (float*)mCombinedMask.data;
+            const size_t szBlockSize = 4096;
+            for (size_t szBlkOff = 0; szBlkOff < szPixCnt; szBlkOff += szBlockSize)
+            {
+                const size_t szBlkLen = min(szBlockSize, szPixCnt-szBlkOff);
+                float* __restrict pBlkDst = pDst+szBlkOff;
+                const float* __restrict pSrc0 = (const float*)amMasks[0].data+szBlkOff;
+                const float* __restrict pSrc1 = (const float*)amMasks[1].data+szBlkOff;
+                for (size_t j = 0; j < szBlkLen; j++)
+                    pBlkDst[j] = pSrc0[j] > pSrc1[j] ? pSrc0[j] : pSrc1[j];
+                for (size_t k = 2; k < szSrcCnt; k++)
+                {
+                    const float* __restrict pSrcK = (const float*)amMasks[k].data+szBlkOff;
+                    for (size_t j = 0; j < szBlkLen; j++)
+                        pBlkDst[j] = pSrcK[j] > pBlkDst[j] ? pSrcK[j] : pBlkDst[j];
+                }
+            }
+            return mCombinedMask;
+        }
+
     private:
         MediaCore::VideoBlender::Holder m_hBlender;
+        mutex m_mtxMaskCache;
+        MatUtils::Size2i m_szMaskCacheSize{0, 0};
+        vector<ImGui::ImMat> m_amStaticMasks;
+        ImGui::ImMat m_mStaticCombinedMask;
+        list<pair<int64_t, ImGui::ImMat>> m_amAnimatedMaskCache;
+        static const size_t MAX_ANIMATED_MASK_CACHE_SIZE = 8;
+        atomic_bool m_bTiledExec{false};
+        atomic_int32_t m_i32TileHaloRows{0};
+        atomic_bool m_bTileExecSupported{true};
+        // the tileability is checked when the tile blueprints are rebuilt, so it starts dirty
+        atomic_bool m_bTileBpsDirty{true};
+        mutex m_mtxTileBps;
+        vector<BluePrint::BluePrintUI*> m_apTileBps;
+        static const int MIN_TILE_BAND_HEIGHT = 64;
 
     private:
         VideoEvent_Impl(VideoEventStackFilter_Impl* owner) : Event_Base(owner) {}
@@ -754,7 +1351,7 @@ Event::Holder
 VideoEventStackFilter_Impl::VideoEvent_Impl::LoadFromJson(
         VideoEventStackFilter_Impl* owner, const imgui_json::value& eventJson, const BluePrint::BluePrintCallbackFunctions& bpCallbacks, SharedSettings::Holder hSettings)
 {
-    owner->m_logger->Log(DEBUG) << "Load EventJson : " << eventJson.dump() << endl;
+    MEC_ASYNC_LOG(owner->m_logger, DEBUG) << "Load EventJson : " << eventJson.dump();
     auto pEvtImpl = new VideoEventStackFilter_Impl::VideoEvent_Impl(owner);
     Event::Holder hEvt(pEvtImpl, VIDEO_EVENT_DELETER);
     string itemName = "id";
@@ -798,18 +1395,9 @@ VideoEventStackFilter_Impl::VideoEvent_Impl::LoadFromJson(
         return nullptr;
     }
     itemName = "bp";
-    if (eventJson.contains(itemName))
+    if (eventJson.contains(itemName) && eventJson[itemName].is_object())
     {
-        auto pBp = pEvtImpl->m_pBp = new BluePrint::BluePrintUI();
-        pBp->Initialize();
-        pBp->SetCallbacks(bpCallbacks, reinterpret_cast<void*>(&pEvtImpl->m_filterCtx));
-        auto bpJson = eventJson[itemName];
-        pBp->File_New_Filter(bpJson, "VideoEventBp", "Video");
-        if (!pBp->Blueprint_IsValid())
-        {
-            owner->m_errMsg = "BAD event json! Invalid blueprint json.";
-            return nullptr;
-        }
+        pEvtImpl->SetPendingBp(eventJson[itemName], bpCallbacks, "VideoEventBp", "Video");
     }
     else
     {
@@ -862,6 +1450,19 @@ VideoEventStackFilter_Impl::VideoEvent_Impl::LoadFromJson(
             pEvtImpl->m_mapEffectMaskTable.emplace(nodeId, ahMaskCreators);
         }
     }
+    // the masks may have been rasterized already while the event was built, drop anything cached before they were loaded
+    pEvtImpl->InvalidateMaskCache();
+    itemName = "tiled_exec";
+    if (eventJson.contains(itemName) && eventJson[itemName].is_boolean())
+    {
+        pEvtImpl->m_bTiledExec = eventJson[itemName].get<imgui_json::boolean>();
+    }
+    itemName = "tile_halo_rows";
+    if (eventJson.contains(itemName) && eventJson[itemName].is_number())
+    {
+        const auto i32HaloRows = (int32_t)min(max(eventJson[itemName].get<imgui_json::number>(), 0.), (double)MAX_TILE_HALO_ROWS);
+        pEvtImpl->m_i32TileHaloRows = i32HaloRows;
+    }
     return hEvt;
 }
 
@@ -985,7 +1586,8 @@ public:
             eventJsonAry.push_back(pEvtImpl->SaveAsJson());
         }
         json["events"] = eventJsonAry;
-        m_logger->Log(DEBUG) << "Save filter-json : " << json.dump() << std::endl;
+        if (MEC::AsyncLog::IsEnabled(m_logger, DEBUG))
+            MEC::AsyncLog::PostLazy(m_logger, DEBUG, [json] (ostream& os) { os << "Save filter-json : " << json.dump(); });
         return std::move(json);
     }
 
@@ -1029,7 +1631,7 @@ public:
         ImGui::ImMat FilterPcm(const ImGui::ImMat& amat, int64_t pos, int64_t dur) override
         {
             ImGui::ImMat outMat(amat);
-            if (m_pBp->Blueprint_IsExecutable())
+            if (EnsureBp()->Blueprint_IsExecutable())
             {
                 // setup bp input curve
                 for (int i = 0; i < m_pKp->GetCurveCount(); i++)
@@ -1066,7 +1668,7 @@ Event::Holder
 AudioEventStackFilter_Impl::AudioEvent_Impl::LoadFromJson(
         AudioEventStackFilter_Impl* owner, const imgui_json::value& eventJson, const BluePrint::BluePrintCallbackFunctions& bpCallbacks)
 {
-    owner->m_logger->Log(DEBUG) << "Load EventJson : " << eventJson.dump() << endl;
+    MEC_ASYNC_LOG(owner->m_logger, DEBUG) << "Load EventJson : " << eventJson.dump();
     auto pEvtImpl = new AudioEventStackFilter_Impl::AudioEvent_Impl(owner);
     Event::Holder hEvt(pEvtImpl, AUDIO_EVENT_DELETER);
     string itemName = "id";
@@ -1110,18 +1712,9 @@ AudioEventStackFilter_Impl::AudioEvent_Impl::LoadFromJson(
         return nullptr;
     }
     itemName = "bp";
-    if (eventJson.contains(itemName))
+    if (eventJson.contains(itemName) && eventJson[itemName].is_object())
     {
-        auto pBp = pEvtImpl->m_pBp = new BluePrint::BluePrintUI();
-        pBp->Initialize();
-        pBp->SetCallbacks(bpCallbacks, reinterpret_cast<void*>(&pEvtImpl->m_filterCtx));
-        auto bpJson = eventJson[itemName];
-        pBp->File_New_Filter(bpJson, "AudioEventBp", "Audio");
-        if (!pBp->Blueprint_IsValid())
-        {
-            owner->m_errMsg = "BAD event json! Invalid blueprint json.";
-            return nullptr;
-        }
+        pEvtImpl->SetPendingBp(eventJson[itemName], bpCallbacks, "AudioEventBp", "Audio");
     }
     else
     {
@@ -0,0 +1,262 @@
+#include <mutex>
+#include <list>
+#include <map>
+#include <tuple>
+#include <cstring>
+#include <chrono>
+#include "FrameBufferPool.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+class FrameBufferPool_Impl : public FrameBufferPool
+{
+public:
+    FrameBufferPool_Impl(const string& name, size_t capacity)
+        : m_name(name), m_szCapacity(capacity), m_i64IdleTimeout(DEFAULT_IDLE_TIMEOUT), m_tLastIdleCheck(chrono::steady_clock::now())
+    {
+        m_logger = GetLogger("FrameBufferPool");
+    }
+
+    ~FrameBufferPool_Impl()
+    {
+        m_mapBuckets.clear();
+    }
+
+    ImGui::ImMat AcquireMat(int w, int h, int c, ImDataType type, int elempack) override
+    {
+        if (w <= 0 || h <= 0 || c <= 0)
+            return ImGui::ImMat();
+        const _BucketKey tKey(w, h, c, type, elempack);
+        const auto tNow = chrono::steady_clock::now();
+        lock_guard<mutex> lk(m_mtxLock);
+        if (tNow-m_tLastIdleCheck >= chrono::seconds(1))
+            EvictIdleMats(tNow);
+        auto& aBucket = m_mapBuckets[tKey];
+        for (auto& tPooled : aBucket)
+        {
+            if (IsFree(tPooled.m))
+            {
+                m_u64HitCount++;
+                tPooled.tLastUsed = tNow;
+                return tPooled.m;
+            }
+        }
+
+        m_u64MissCount++;
+        ImGui::ImMat mNew;
+        if (c > 1)
+            mNew.create_type(w, h, c, type);
+        else
+            mNew.create_type(w, h, type);
+        mNew.elempack = elempack;
+        const size_t szMatBytes = GetMatBytes(mNew);
+        if (m_szPooledBytes+szMatBytes > m_szCapacity)
+            EvictFreeMats(m_szPooledBytes+szMatBytes-m_szCapacity);
+        if (m_szPooledBytes+szMatBytes > m_szCapacity)
+        {
+            // pool is full of buffers still in use, this one won't be kept
+            m_u64BypassCount++;
+            return mNew;
+        }
+        aBucket.push_back({mNew, tNow});
+        m_szPooledBytes += szMatBytes;
+        if (m_szPooledBytes > m_szPeakPooledBytes)
+            m_szPeakPooledBytes = m_szPooledBytes;
+        return mNew;
+    }
+
+    ImGui::ImMat AcquireMat(int w, int h, ImDataType type) override
+    {
+        return AcquireMat(w, h, 1, type, 1);
+    }
+
+    ImGui::ImMat CloneMat(const ImGui::ImMat& m) override
+    {
+        if (m.empty() || m.device != IM_DD_CPU || m.dims > 3)
+            return m.clone();
+        auto mClone = AcquireMat(m.w, m.h, m.c, m.type, m.elempack);
+        if (mClone.empty() || GetMatBytes(mClone) != GetMatBytes(m))
+            return m.clone();
+        memcpy(mClone.data, m.data, GetMatBytes(m));
+        mClone.copy_attribute(m);
+        return mClone;
+    }
+
+    void SetCapacity(size_t capacity) override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        m_szCapacity = capacity;
+        if (m_szPooledBytes > m_szCapacity)
+            EvictFreeMats(m_szPooledBytes-m_szCapacity);
+    }
+
+    void Trim() override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        EvictFreeMats(m_szPooledBytes);
+    }
+
+    void SetIdleTimeout(int64_t i64TimeoutMs) override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        m_i64IdleTimeout = i64TimeoutMs > 0 ? i64TimeoutMs : 0;
+    }
+
+    void TrimIdle() override
+    {
+        const auto tNow = chrono::steady_clock::now();
+        lock_guard<mutex> lk(m_mtxLock);
+        if (tNow-m_tLastIdleCheck >= chrono::seconds(1))
+            EvictIdleMats(tNow);
+    }
+
+    Stats GetStats() const override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        Stats tStats;
+        tStats.u64HitCount = m_u64HitCount;
+        tStats.u64MissCount = m_u64MissCount;
+        tStats.u64BypassCount = m_u64BypassCount;
+        tStats.u64IdleTrimCount = m_u64IdleTrimCount;
+        tStats.szPooledBytes = m_szPooledBytes;
+        tStats.szPeakPooledBytes = m_szPeakPooledBytes;
+        tStats.szCapacity = m_szCapacity;
+        for (const auto& elem : m_mapBuckets)
+        {
+            for (const auto& tPooled : elem.second)
+            {
+                if (!IsFree(tPooled.m))
+                    tStats.szInUseBytes += GetMatBytes(tPooled.m);
+            }
+        }
+        return tStats;
+    }
+
+    void LogStats(Level l) const override
+    {
+        const auto tStats = GetStats();
+        const uint64_t u64ReqCount = tStats.u64HitCount+tStats.u64MissCount;
+        const double dHitRate = u64ReqCount > 0 ? (double)tStats.u64HitCount*100/u64ReqCount : 0;
+        m_logger->Log(l) << "[" << m_name << "] hit=" << tStats.u64HitCount << ", miss=" << tStats.u64MissCount << " (hit rate " << dHitRate << "%)"
+                << ", bypass=" << tStats.u64BypassCount << ", idle-trimmed=" << tStats.u64IdleTrimCount << ", pooled=" << (tStats.szPooledBytes>>20) << "MB, in-use=" << (tStats.szInUseBytes>>20)
+                << "MB, peak=" << (tStats.szPeakPooledBytes>>20) << "MB, capacity=" << (tStats.szCapacity>>20) << "MB." << endl;
+    }
+
+private:
+    using _BucketKey = tuple<int, int, int, int, int>;
+
+    struct _PooledMat
+    {
+        ImGui::ImMat m;
+        chrono::steady_clock::time_point tLastUsed;
+    };
+
+    // a pooled mat is free when the pool holds the only reference to its data
+    static bool IsFree(const ImGui::ImMat& m)
+    {
+        return m.refcount && *m.refcount == 1;
+    }
+
+    static size_t GetMatBytes(const ImGui::ImMat& m)
+    {
+        return (size_t)m.total()*m.elemsize;
+    }
+
+    void EvictFreeMats(size_t szBytesToFree)
+    {
+        size_t szFreed = 0;
+        auto itBucket = m_mapBuckets.begin();
+        while (itBucket != m_mapBuckets.end() && szFreed < szBytesToFree)
+        {
+            auto& aBucket = itBucket->second;
+            auto itMat = aBucket.begin();
+            while (itMat != aBucket.end() && szFreed < szBytesToFree)
+            {
+                if (IsFree(itMat->m))
+                {
+                    szFreed += GetMatBytes(itMat->m);
+                    itMat = aBucket.erase(itMat);
+                }
+                else
+                {
+                    itMat++;
+                }
+            }
+            if (aBucket.empty())
+                itBucket = m_mapBuckets.erase(itBucket);
+            else
+                itBucket++;
+        }
+        m_szPooledBytes -= szFreed;
+    }
+
+    void EvictIdleMats(const chrono::steady_clock::time_point& tNow)
+    {
+        m_tLastIdleCheck = tNow;
+        if (m_i64IdleTimeout <= 0)
+            return;
+        const auto tExpireTime = tNow-chrono::milliseconds(m_i64IdleTimeout);
+        auto itBucket = m_mapBuckets.begin();
+        while (itBucket != m_mapBuckets.end())
+        {
+            auto& aBucket = itBucket->second;
+            auto itMat = aBucket.begin();
+            while (itMat != aBucket.end())
+            {
+                if (itMat->tLastUsed < tExpireTime && IsFree(itMat->m))
+                {
+                    m_szPooledBytes -= GetMatBytes(itMat->m);
+                    m_u64IdleTrimCount++;
+                    itMat = aBucket.erase(itMat);
+                }
+                else
+                {
+                    itMat++;
+                }
+            }
+            if (aBucket.empty())
+                itBucket = m_mapBuckets.erase(itBucket);
+            else
+                itBucket++;
+        }
+    }
+
+private:
+    string m_name;
+    ALogger* m_logger;
+    mutable mutex m_mtxLock;
+    map<_BucketKey, list<_PooledMat>> m_mapBuckets;
+    size_t m_szCapacity;
+    int64_t m_i64IdleTimeout;
+    chrono::steady_clock::time_point m_tLastIdleCheck;
+    size_t m_szPooledBytes{0};
+    size_t m_szPeakPooledBytes{0};
+    uint64_t m_u64HitCount{0};
+    uint64_t m_u64MissCount{0};
+    uint64_t m_u64BypassCount{0};
+    uint64_t m_u64IdleTrimCount{0};
+};
+
+// 1GB is enough to hold several full pipelines of 4K float frames
+const size_t FrameBufferPool::DEFAULT_CAPACITY = (size_t)1<<30;
+const int64_t FrameBufferPool::DEFAULT_IDLE_TIMEOUT = 10000;
+
+static const auto FRAME_BUFFER_POOL_DELETER = [] (FrameBufferPool* p) {
+    FrameBufferPool_Impl* ptr = dynamic_cast<FrameBufferPool_Impl*>(p);
+    delete ptr;
+};
+
+FrameBufferPool::Holder FrameBufferPool::CreateInstance(const string& name, size_t capacity)
+{
+    return FrameBufferPool::Holder(new FrameBufferPool_Impl(name, capacity), FRAME_BUFFER_POOL_DELETER);
+}
+
+FrameBufferPool::Holder FrameBufferPool::GetDefaultInstance()
+{
+    static FrameBufferPool::Holder s_hDefaultPool = CreateInstance("Default", DEFAULT_CAPACITY);
+    return s_hDefaultPool;
+}
+}
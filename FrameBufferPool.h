@@ -0,0 +1,47 @@
+#pragma once
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <immat.h>
+#include <Logger.h>
+
+namespace MEC
+{
+    // Pool of cpu ImMat buffers used on the per-frame rendering path. Buffers are grouped by their geometry (w, h, c,
+    // data type and elempack), and a pooled buffer is handed out again once all the ImMat instances sharing it,
+    // except the one kept by the pool, are released. A free buffer which is not handed out for the idle timeout is
+    // released, so the pool shrinks back after a resolution change or when the rendering stops.
+    struct FrameBufferPool
+    {
+        using Holder = std::shared_ptr<FrameBufferPool>;
+        static Holder CreateInstance(const std::string& name, size_t capacity);
+        static Holder GetDefaultInstance();
+
+        static const size_t DEFAULT_CAPACITY;
+        static const int64_t DEFAULT_IDLE_TIMEOUT;
+
+        virtual ImGui::ImMat AcquireMat(int w, int h, int c, ImDataType type, int elempack = 1) = 0;
+        virtual ImGui::ImMat AcquireMat(int w, int h, ImDataType type) = 0;
+        virtual ImGui::ImMat CloneMat(const ImGui::ImMat& m) = 0;
+        virtual void SetCapacity(size_t capacity) = 0;
+        virtual void Trim() = 0;
+        // 0 disables the idle trimming
+        virtual void SetIdleTimeout(int64_t i64TimeoutMs) = 0;
+        // Releases the idle buffers, it's also done while acquiring, at most once per second
+        virtual void TrimIdle() = 0;
+
+        struct Stats
+        {
+            uint64_t u64HitCount{0};
+            uint64_t u64MissCount{0};
+            uint64_t u64BypassCount{0};
+            uint64_t u64IdleTrimCount{0};
+            size_t szPooledBytes{0};
+            size_t szInUseBytes{0};
+            size_t szPeakPooledBytes{0};
+            size_t szCapacity{0};
+        };
+        virtual Stats GetStats() const = 0;
+        virtual void LogStats(Logger::Level l) const = 0;
+    };
+}
@@ -0,0 +1,297 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <ThreadUtils.h>
+#include "MecAsyncLog.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+struct _LogMessage
+{
+    ALogger* pLogger{nullptr};
+    Level eLevel{INFO};
+    string strMsg;
+    AsyncLog::Formatter formatter;
+    size_t szBytes{0};
+};
+
+// Bounded multi-producer queue, each slot carries a sequence number telling whether it's ready for push or pop
+struct _MessageQueue
+{
+    struct _Slot
+    {
+        atomic_uint64_t u64Seq;
+        _LogMessage tMsg;
+    };
+
+    _MessageQueue(size_t szCapacity) : aSlots(szCapacity)
+    {
+        for (size_t i = 0; i < szCapacity; i++)
+            aSlots[i].u64Seq.store(i, memory_order_relaxed);
+    }
+
+    bool Push(_LogMessage& tMsg)
+    {
+        uint64_t u64Pos = u64PushPos.load(memory_order_relaxed);
+        _Slot* pSlot;
+        while (true)
+        {
+            pSlot = &aSlots[u64Pos%aSlots.size()];
+            const auto u64Seq = pSlot->u64Seq.load(memory_order_acquire);
+            const auto i64Diff = (int64_t)u64Seq-(int64_t)u64Pos;
+            if (i64Diff == 0)
+            {
+                if (u64PushPos.compare_exchange_weak(u64Pos, u64Pos+1, memory_order_relaxed))
+                    break;
+            }
+            else if (i64Diff < 0)
+                return false;
+            else
+                u64Pos = u64PushPos.load(memory_order_relaxed);
+        }
+        pSlot->tMsg = std::move(tMsg);
+        pSlot->u64Seq.store(u64Pos+1, memory_order_release);
+        return true;
+    }
+
+    // only called by the writer thread
+    bool Pop(_LogMessage& tMsg)
+    {
+        const uint64_t u64Pos = u64PopPos.load(memory_order_relaxed);
+        _Slot* pSlot = &aSlots[u64Pos%aSlots.size()];
+        const auto u64Seq = pSlot->u64Seq.load(memory_order_acquire);
+        if ((int64_t)u64Seq-(int64_t)(u64Pos+1) < 0)
+            return false;
+        tMsg = std::move(pSlot->tMsg);
+        pSlot->tMsg = _LogMessage();
+        u64PopPos.store(u64Pos+1, memory_order_relaxed);
+        pSlot->u64Seq.store(u64Pos+aSlots.size(), memory_order_release);
+        return true;
+    }
+
+    vector<_Slot> aSlots;
+    atomic_uint64_t u64PushPos{0};
+    atomic_uint64_t u64PopPos{0};
+};
+
+static int _GetInitialLevel()
+{
+    const char* pcEnv = getenv("MEC_LOG_LEVEL");
+    if (pcEnv && pcEnv[0] >= '0' && pcEnv[0] <= '4' && pcEnv[1] == 0)
+        return pcEnv[0]-'0';
+    return (int)INFO;
+}
+
+const size_t AsyncLog::QUEUE_CAPACITY = 8192;
+const size_t AsyncLog::MAX_QUEUED_BYTES = 16*1024*1024;
+std::atomic_int AsyncLog::s_iLevel{_GetInitialLevel()};
+std::atomic_int AsyncLog::s_iMinLoggerLevel{(int)Error+1};
+std::atomic_int AsyncLog::s_iMaxLoggerLevel{(int)VERBOSE};
+
+static _MessageQueue s_tQueue(AsyncLog::QUEUE_CAPACITY);
+static atomic_int64_t s_i64QueuedBytes{0};
+static atomic_uint64_t s_u64PostedCount{0};
+static atomic_uint64_t s_u64WrittenCount{0};
+static atomic_uint64_t s_u64DroppedCount{0};
+static mutex s_mtxWriterLock;
+// serializes the start and the stop of the writer thread
+static mutex s_mtxLifeLock;
+static condition_variable s_cvWriter;
+static atomic_bool s_bWriterWaiting{false};
+static atomic_bool s_bWriterRunning{false};
+static atomic_bool s_bQuitWriter{false};
+static thread s_thWriter;
+static mutex s_mtxLoggerLevelLock;
+static unordered_map<ALogger*, int> s_mapLoggerLevels;
+// 'Flush()' waits on it, the writer only notifies while there are waiters
+static mutex s_mtxFlushLock;
+static condition_variable s_cvFlushed;
+static atomic_int s_iFlushWaiters{0};
+
+static void _NotifyFlushWaiters()
+{
+    if (s_iFlushWaiters.load() <= 0)
+        return;
+    lock_guard<mutex> lk(s_mtxFlushLock);
+    s_cvFlushed.notify_all();
+}
+
+static void _WriteMessage(_LogMessage& tMsg)
+{
+    ostream& os = tMsg.pLogger ? tMsg.pLogger->Log(tMsg.eLevel) : Log(tMsg.eLevel);
+    if (tMsg.formatter)
+        tMsg.formatter(os);
+    else
+        os << tMsg.strMsg;
+    os << endl;
+}
+
+static void _WriterProc()
+{
+    _LogMessage tMsg;
+    while (true)
+    {
+        if (s_tQueue.Pop(tMsg))
+        {
+            _WriteMessage(tMsg);
+            s_i64QueuedBytes -= (int64_t)tMsg.szBytes;
+            tMsg = _LogMessage();
+            s_u64WrittenCount++;
+            _NotifyFlushWaiters();
+            continue;
+        }
+        if (s_bQuitWriter)
+            break;
+        unique_lock<mutex> lk(s_mtxWriterLock);
+        s_bWriterWaiting = true;
+        // the timeout covers the race between the last pop and a post that saw no waiting writer
+        s_cvWriter.wait_for(lk, chrono::milliseconds(20));
+        s_bWriterWaiting = false;
+    }
+    const auto u64Dropped = s_u64DroppedCount.load();
+    if (u64Dropped > 0)
+        Log(WARN) << "AsyncLog dropped " << u64Dropped << " message(s) since the queue was full." << endl;
+}
+
+static void _EnsureWriterStarted()
+{
+    if (s_bWriterRunning.load(memory_order_acquire))
+        return;
+    lock_guard<mutex> lk(s_mtxLifeLock);
+    if (s_bWriterRunning.load(memory_order_relaxed))
+        return;
+    s_bQuitWriter = false;
+    s_thWriter = thread(_WriterProc);
+    SysUtils::SetThreadName(s_thWriter, "AsyncLogWriter");
+    s_bWriterRunning.store(true, memory_order_release);
+}
+
+static bool _PostMessage(_LogMessage& tMsg)
+{
+    if (s_i64QueuedBytes.load(memory_order_relaxed)+(int64_t)tMsg.szBytes > (int64_t)AsyncLog::MAX_QUEUED_BYTES)
+    {
+        s_u64DroppedCount++;
+        return false;
+    }
+    _EnsureWriterStarted();
+    const auto szBytes = tMsg.szBytes;
+    s_i64QueuedBytes += (int64_t)szBytes;
+    if (!s_tQueue.Push(tMsg))
+    {
+        s_i64QueuedBytes -= (int64_t)szBytes;
+        s_u64DroppedCount++;
+        return false;
+    }
+    s_u64PostedCount++;
+    if (s_bWriterWaiting.load(memory_order_relaxed))
+        s_cvWriter.notify_one();
+    return true;
+}
+
+void AsyncLog::SetLevel(Logger::Level l)
+{
+    s_iLevel = (int)l;
+}
+
+void AsyncLog::SetLoggerLevel(Logger::ALogger* pLogger, Logger::Level l)
+{
+    // the messages posted to nullptr go to the default logger, so its level is the one to follow
+    if (!pLogger)
+        pLogger = GetDefaultLogger();
+    pLogger->SetShowLevels(l);
+    lock_guard<mutex> lk(s_mtxLoggerLevelLock);
+    s_mapLoggerLevels[pLogger] = (int)l;
+    int iMinLevel = (int)Error+1;
+    int iMaxLevel = (int)VERBOSE;
+    for (auto& elem : s_mapLoggerLevels)
+    {
+        iMinLevel = min(iMinLevel, elem.second);
+        iMaxLevel = max(iMaxLevel, elem.second);
+    }
+    s_iMinLoggerLevel = iMinLevel;
+    s_iMaxLoggerLevel = iMaxLevel;
+}
+
+bool AsyncLog::IsEnabledByLoggerLevel(Logger::ALogger* pLogger, Logger::Level l)
+{
+    if (!pLogger)
+        pLogger = GetDefaultLogger();
+    lock_guard<mutex> lk(s_mtxLoggerLevelLock);
+    auto iter = s_mapLoggerLevels.find(pLogger);
+    // the loggers whose level is not set here follow the global level
+    const int iLevel = iter != s_mapLoggerLevels.end() ? iter->second : s_iLevel.load();
+    return (int)l >= iLevel;
+}
+
+bool AsyncLog::Post(Logger::ALogger* pLogger, Logger::Level l, std::string&& strMsg)
+{
+    if (!IsEnabled(pLogger, l))
+        return false;
+    _LogMessage tMsg;
+    tMsg.pLogger = pLogger;
+    tMsg.eLevel = l;
+    tMsg.szBytes = sizeof(_LogMessage)+strMsg.capacity();
+    tMsg.strMsg = std::move(strMsg);
+    return _PostMessage(tMsg);
+}
+
+bool AsyncLog::PostLazy(Logger::ALogger* pLogger, Logger::Level l, Formatter&& formatter)
+{
+    if (!IsEnabled(pLogger, l) || !formatter)
+        return false;
+    _LogMessage tMsg;
+    tMsg.pLogger = pLogger;
+    tMsg.eLevel = l;
+    tMsg.formatter = std::move(formatter);
+    tMsg.szBytes = sizeof(_LogMessage);
+    return _PostMessage(tMsg);
+}
+
+void AsyncLog::Flush()
+{
+    const auto u64Target = s_u64PostedCount.load();
+    if (s_u64WrittenCount.load() >= u64Target)
+        return;
+    // the waiter is counted before the written count is checked under the lock, so the writer can't miss it
+    s_iFlushWaiters++;
+    {
+        unique_lock<mutex> lk(s_mtxFlushLock);
+        s_cvWriter.notify_one();
+        s_cvFlushed.wait(lk, [u64Target] { return !s_bWriterRunning || s_u64WrittenCount.load() >= u64Target; });
+    }
+    s_iFlushWaiters--;
+}
+
+void AsyncLog::Shutdown()
+{
+    lock_guard<mutex> lk(s_mtxLifeLock);
+    if (!s_bWriterRunning)
+        return;
+    s_bQuitWriter = true;
+    s_cvWriter.notify_one();
+    if (s_thWriter.joinable())
+        s_thWriter.join();
+    s_thWriter = thread();
+    s_bWriterRunning = false;
+    _NotifyFlushWaiters();
+}
+
+uint64_t AsyncLog::GetDroppedCount()
+{
+    return s_u64DroppedCount.load();
+}
+
+// a joinable thread must not be destroyed, in case 'Shutdown()' is not called before exiting
+static struct _WriterGuard
+{
+    ~_WriterGuard() { AsyncLog::Shutdown(); }
+} s_tWriterGuard;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <sstream>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+#include <Logger.h>
+
+namespace MEC
+{
+    // Backend for the heavy log messages on the hot paths. The level is checked before anything is formatted, and the
+    // messages are handed to a background writer thread through a bounded lock-free queue, so the calling thread never
+    // waits for the logger output. When the queue is full the new messages are dropped and counted.
+    // The messages still go through the target logger, whose own level filter applies when they are written. They
+    // can appear out of order with the ones logged directly through 'Logger::Log()'.
+    struct AsyncLog
+    {
+        using Formatter = std::function<void(std::ostream&)>;
+
+        // Messages below this level are discarded without formatting, the default is INFO, or the value of the
+        // environment variable 'MEC_LOG_LEVEL' (0=VERBOSE ... 4=Error)
+        static void SetLevel(Logger::Level l);
+        static Logger::Level GetLevel() { return (Logger::Level)s_iLevel.load(std::memory_order_relaxed); }
+        // Sets the show levels of 'pLogger', nullptr means the default logger. The messages posted to it are checked
+        // against its own level 'l' from then on, instead of the global level.
+        static void SetLoggerLevel(Logger::ALogger* pLogger, Logger::Level l);
+        static bool IsEnabled(Logger::ALogger* pLogger, Logger::Level l)
+        {
+            const int iLevel = (int)l;
+            const int iGlobalLevel = s_iLevel.load(std::memory_order_relaxed);
+            if (iLevel >= iGlobalLevel && iLevel >= s_iMaxLoggerLevel.load(std::memory_order_relaxed))
+                return true;
+            if (iLevel < iGlobalLevel && iLevel < s_iMinLoggerLevel.load(std::memory_order_relaxed))
+                return false;
+            return IsEnabledByLoggerLevel(pLogger, l);
+        }
+
+        // 'pLogger' must live until the message is written, nullptr means the default logger
+        static bool Post(Logger::ALogger* pLogger, Logger::Level l, std::string&& strMsg);
+        // The formatter runs on the writer thread, everything it captures must stay valid and unchanged until then
+        static bool PostLazy(Logger::ALogger* pLogger, Logger::Level l, Formatter&& formatter);
+        // Waits until the messages posted before this call are written
+        static void Flush();
+        // Writes the pending messages and stops the writer thread, it's restarted by the next post
+        static void Shutdown();
+        static uint64_t GetDroppedCount();
+
+        // Collects a message with the stream operators, and posts it on destruction
+        class Line
+        {
+        public:
+            Line(Logger::ALogger* pLogger, Logger::Level l) : m_pLogger(pLogger), m_eLevel(l) {}
+            ~Line() { Post(m_pLogger, m_eLevel, m_oss.str()); }
+            std::ostream& Stream() { return m_oss; }
+            Line(const Line&) = delete;
+            Line& operator=(const Line&) = delete;
+
+        private:
+            Logger::ALogger* m_pLogger;
+            Logger::Level m_eLevel;
+            std::ostringstream m_oss;
+        };
+
+        static const size_t QUEUE_CAPACITY;
+        static const size_t MAX_QUEUED_BYTES;
+
+    private:
+        static bool IsEnabledByLoggerLevel(Logger::ALogger* pLogger, Logger::Level l);
+
+        static std::atomic_int s_iLevel;
+        // the range of the levels set by 'SetLoggerLevel()', the registered levels are only looked up when the global
+        // level and the range don't agree on a message
+        static std::atomic_int s_iMinLoggerLevel;
+        static std::atomic_int s_iMaxLoggerLevel;
+    };
+}
+
+// Usage: MEC_ASYNC_LOG(pLogger, Logger::DEBUG) << "..." << obj;   the stream expression is not evaluated if the level is disabled
+#define MEC_ASYNC_LOG(logger, level) if (!MEC::AsyncLog::IsEnabled(logger, level)) ; else MEC::AsyncLog::Line(logger, level).Stream()
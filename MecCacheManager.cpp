@@ -0,0 +1,525 @@
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <imgui_json.h>
+#include "FileSystemUtils.h"
+#include "MecCacheManager.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+class CacheManager_Impl : public CacheManager
+{
+public:
+    CacheManager_Impl(const string& strCacheDir) : m_strCacheDir(strCacheDir)
+    {
+        m_pLogger = GetLogger("CacheMgr");
+        while (m_strCacheDir.size() > 1 && (m_strCacheDir.back() == '/' || m_strCacheDir.back() == '\\'))
+            m_strCacheDir.pop_back();
+        LoadIndex();
+    }
+
+    ~CacheManager_Impl()
+    {
+        SaveIndex();
+    }
+
+    string GetCacheDir() const override
+    {
+        return m_strCacheDir;
+    }
+
+    bool AddEntry(const string& strPath, int64_t i64Size) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+        {
+            m_pLogger->Log(WARN) << "Path '" << strPath << "' is NOT under the cache directory '" << m_strCacheDir << "', it's not added." << endl;
+            return false;
+        }
+        if (i64Size < 0)
+            i64Size = MeasureSize(strPath);
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end())
+        {
+            itEntry = m_mapEntries.emplace(strRelPath, _Entry()).first;
+            itEntry->second.iPinCnt = CountPins(strRelPath);
+        }
+        else
+        {
+            m_i64UsedSize -= itEntry->second.i64Size;
+        }
+        auto& tEntry = itEntry->second;
+        tEntry.i64Size = i64Size;
+        tEntry.i64LastAccess = GetTimestamp();
+        m_i64UsedSize += i64Size;
+        m_bIndexDirty = true;
+        m_pLogger->Log(DEBUG) << "Add cache entry '" << strRelPath << "' (" << i64Size << " bytes)." << endl;
+        EvictIfOverQuota();
+        return true;
+    }
+
+    bool UpdateEntrySize(const string& strPath, int64_t i64Size) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return false;
+        if (i64Size < 0)
+            i64Size = MeasureSize(strPath);
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end())
+            return false;
+        auto& tEntry = itEntry->second;
+        m_i64UsedSize += i64Size-tEntry.i64Size;
+        tEntry.i64Size = i64Size;
+        tEntry.i64LastAccess = GetTimestamp();
+        m_bIndexDirty = true;
+        EvictIfOverQuota();
+        return true;
+    }
+
+    bool RemoveEntry(const string& strPath, bool bDeleteFiles) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return false;
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end())
+            return false;
+        m_i64UsedSize -= itEntry->second.i64Size;
+        m_mapEntries.erase(itEntry);
+        m_bIndexDirty = true;
+        if (bDeleteFiles)
+            DeleteFromDisk(strPath);
+        return true;
+    }
+
+    bool HasEntry(const string& strPath) const override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return false;
+        lock_guard<mutex> _lk(m_mtxLock);
+        return m_mapEntries.find(strRelPath) != m_mapEntries.end();
+    }
+
+    void TouchEntry(const string& strPath) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return;
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end())
+            return;
+        itEntry->second.i64LastAccess = GetTimestamp();
+        m_bIndexDirty = true;
+    }
+
+    void AddReference(const string& strPath) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return;
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end())
+            return;
+        itEntry->second.iRefCnt++;
+        itEntry->second.i64LastAccess = GetTimestamp();
+        m_bIndexDirty = true;
+    }
+
+    void ReleaseReference(const string& strPath) override
+    {
+        string strRelPath;
+        if (!GetRelativePath(strPath, strRelPath))
+            return;
+        lock_guard<mutex> _lk(m_mtxLock);
+        auto itEntry = m_mapEntries.find(strRelPath);
+        if (itEntry == m_mapEntries.end() || itEntry->second.iRefCnt <= 0)
+            return;
+        itEntry->second.iRefCnt--;
+        itEntry->second.i64LastAccess = GetTimestamp();
+        m_bIndexDirty = true;
+        EvictIfOverQuota();
+    }
+
+    void PinEntries(const string& strOwnerPath, const vector<string>& aPaths) override
+    {
+        vector<string> aRelPaths;
+        for (const auto& strPath : aPaths)
+        {
+            string strRelPath;
+            if (GetRelativePath(strPath, strRelPath))
+                aRelPaths.push_back(strRelPath);
+        }
+        lock_guard<mutex> _lk(m_mtxLock);
+        UnpinEntries_(strOwnerPath);
+        if (!aRelPaths.empty())
+        {
+            for (const auto& strRelPath : aRelPaths)
+            {
+                auto itEntry = m_mapEntries.find(strRelPath);
+                if (itEntry != m_mapEntries.end())
+                    itEntry->second.iPinCnt++;
+            }
+            m_mapPins[strOwnerPath] = std::move(aRelPaths);
+            m_bIndexDirty = true;
+        }
+        // the entries dropped by the owner can be evicted now
+        EvictIfOverQuota();
+    }
+
+    void UnpinEntries(const string& strOwnerPath) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        if (UnpinEntries_(strOwnerPath))
+            EvictIfOverQuota();
+    }
+
+    void SetQuota(int64_t i64Quota) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        m_i64Quota = i64Quota > 0 ? i64Quota : 0;
+        EvictIfOverQuota();
+    }
+
+    int64_t GetQuota() const override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        return m_i64Quota;
+    }
+
+    int64_t GetTotalUsedSize() const override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        return m_i64UsedSize;
+    }
+
+    int64_t Evict(int64_t i64TargetSize) override
+    {
+        lock_guard<mutex> _lk(m_mtxLock);
+        if (i64TargetSize < 0)
+        {
+            if (m_i64Quota <= 0)
+                return 0;
+            i64TargetSize = (int64_t)(m_i64Quota*EVICT_TARGET_RATIO);
+        }
+        return Evict_(i64TargetSize);
+    }
+
+    bool SaveIndex() override
+    {
+        string strIndexData;
+        {
+            lock_guard<mutex> _lk(m_mtxLock);
+            if (!m_bIndexDirty)
+                return true;
+            imgui_json::array aEntries;
+            for (const auto& elem : m_mapEntries)
+            {
+                imgui_json::value jnEntry;
+                jnEntry["path"] = elem.first;
+                jnEntry["size"] = imgui_json::number(elem.second.i64Size);
+                jnEntry["last_access"] = imgui_json::number(elem.second.i64LastAccess);
+                aEntries.push_back(jnEntry);
+            }
+            imgui_json::array aPins;
+            for (const auto& elem : m_mapPins)
+            {
+                imgui_json::value jnPin;
+                jnPin["owner"] = elem.first;
+                imgui_json::array aPaths;
+                for (const auto& strRelPath : elem.second)
+                    aPaths.push_back(imgui_json::string(strRelPath));
+                jnPin["paths"] = aPaths;
+                aPins.push_back(jnPin);
+            }
+            imgui_json::value jnIndex;
+            jnIndex["version"] = imgui_json::number(INDEX_VERSION);
+            jnIndex["entries"] = aEntries;
+            jnIndex["pins"] = aPins;
+            strIndexData = jnIndex.dump();
+            m_bIndexDirty = false;
+        }
+        const auto strIndexPath = SysUtils::JoinPath(m_strCacheDir, INDEX_FILE_NAME);
+        const auto strTempPath = strIndexPath+".saving";
+        {
+            ofstream ofs(strTempPath, ios::out|ios::binary|ios::trunc);
+            if (ofs.is_open())
+            {
+                ofs.write(strIndexData.data(), strIndexData.size());
+                ofs.flush();
+            }
+            if (!ofs.good())
+            {
+                ofs.close();
+                SysUtils::DeleteFileAt(strTempPath);
+                m_pLogger->Log(Error) << "FAILED to write cache index file at '" << strTempPath << "'!" << endl;
+                return false;
+            }
+        }
+        if (rename(strTempPath.c_str(), strIndexPath.c_str()) != 0)
+        {
+            // the index is only a cache of the accounting, losing it on a failed replacement is acceptable
+            SysUtils::DeleteFileAt(strIndexPath);
+            if (rename(strTempPath.c_str(), strIndexPath.c_str()) != 0)
+            {
+                m_pLogger->Log(Error) << "FAILED to replace cache index file at '" << strIndexPath << "'!" << endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SetLogLevel(Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+private:
+    struct _Entry
+    {
+        int64_t i64Size{0};
+        int64_t i64LastAccess{0};
+        int iRefCnt{0};
+        int iPinCnt{0};
+    };
+
+    static int64_t GetTimestamp()
+    {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t MeasureSize(const string& strPath)
+    {
+        error_code ec;
+        const filesystem::path fsPath(strPath);
+        if (filesystem::is_regular_file(fsPath, ec))
+        {
+            const auto u64Size = filesystem::file_size(fsPath, ec);
+            return ec ? 0 : (int64_t)u64Size;
+        }
+        if (!filesystem::is_directory(fsPath, ec))
+            return 0;
+        int64_t i64Total = 0;
+        for (filesystem::recursive_directory_iterator it(fsPath, ec), itEnd; !ec && it != itEnd; it.increment(ec))
+        {
+            error_code ec2;
+            if (it->is_regular_file(ec2))
+            {
+                const auto u64Size = it->file_size(ec2);
+                if (!ec2)
+                    i64Total += (int64_t)u64Size;
+            }
+        }
+        return i64Total;
+    }
+
+    bool GetRelativePath(const string& strPath, string& strRelPath) const
+    {
+        const auto szPrefixLen = m_strCacheDir.size();
+        if (strPath.size() <= szPrefixLen+1 || strPath.compare(0, szPrefixLen, m_strCacheDir) != 0)
+            return false;
+        const char c = strPath[szPrefixLen];
+        if (c != '/' && c != '\\')
+            return false;
+        strRelPath = strPath.substr(szPrefixLen+1);
+        while (!strRelPath.empty() && (strRelPath.back() == '/' || strRelPath.back() == '\\'))
+            strRelPath.pop_back();
+        if (strRelPath.empty() || strRelPath == INDEX_FILE_NAME)
+            return false;
+        // use the same separator in the index on all platforms
+        replace(strRelPath.begin(), strRelPath.end(), '\\', '/');
+        return true;
+    }
+
+    void DeleteFromDisk(const string& strPath)
+    {
+        bool bDeleted = true;
+        if (SysUtils::IsDirectory(strPath))
+            bDeleted = SysUtils::DeleteDirectoryAt(strPath);
+        else if (SysUtils::IsFile(strPath))
+            bDeleted = SysUtils::DeleteFileAt(strPath);
+        if (!bDeleted)
+            m_pLogger->Log(WARN) << "FAILED to delete cache entry at '" << strPath << "'!" << endl;
+    }
+
+    void LoadIndex()
+    {
+        const auto strIndexPath = SysUtils::JoinPath(m_strCacheDir, INDEX_FILE_NAME);
+        if (!SysUtils::IsFile(strIndexPath))
+            return;
+        const auto res = imgui_json::value::load(strIndexPath);
+        if (!res.second || !res.first.is_object())
+        {
+            m_pLogger->Log(WARN) << "FAILED to parse cache index file at '" << strIndexPath << "', the cache accounting restarts from empty." << endl;
+            return;
+        }
+        const auto& jnIndex = res.first;
+        string attrName = "version";
+        const uint32_t u32Version = jnIndex.contains(attrName) && jnIndex[attrName].is_number() ? (uint32_t)jnIndex[attrName].get<imgui_json::number>() : 0;
+        // the older versions only differ in the 'category' attribute of the entries, which is ignored now
+        if (u32Version < 1 || u32Version > INDEX_VERSION)
+        {
+            m_pLogger->Log(WARN) << "Cache index file at '" << strIndexPath << "' has UNSUPPORTED version, the cache accounting restarts from empty." << endl;
+            return;
+        }
+        attrName = "entries";
+        if (!jnIndex.contains(attrName) || !jnIndex[attrName].is_array())
+            return;
+        const auto& aEntries = jnIndex[attrName].get<imgui_json::array>();
+        for (const auto& jnEntry : aEntries)
+        {
+            if (!jnEntry.contains("path") || !jnEntry["path"].is_string()
+                || !jnEntry.contains("size") || !jnEntry["size"].is_number())
+                continue;
+            _Entry tEntry;
+            tEntry.i64Size = (int64_t)jnEntry["size"].get<imgui_json::number>();
+            if (jnEntry.contains("last_access") && jnEntry["last_access"].is_number())
+                tEntry.i64LastAccess = (int64_t)jnEntry["last_access"].get<imgui_json::number>();
+            m_i64UsedSize += tEntry.i64Size;
+            m_mapEntries[jnEntry["path"].get<imgui_json::string>()] = tEntry;
+        }
+        attrName = "pins";
+        if (jnIndex.contains(attrName) && jnIndex[attrName].is_array())
+        {
+            for (const auto& jnPin : jnIndex[attrName].get<imgui_json::array>())
+            {
+                if (!jnPin.contains("owner") || !jnPin["owner"].is_string() || !jnPin.contains("paths") || !jnPin["paths"].is_array())
+                    continue;
+                const auto& strOwnerPath = jnPin["owner"].get<imgui_json::string>();
+                // the owner project is deleted outside of the application
+                if (!SysUtils::IsFile(strOwnerPath))
+                {
+                    m_bIndexDirty = true;
+                    continue;
+                }
+                auto& aRelPaths = m_mapPins[strOwnerPath];
+                for (const auto& jnPath : jnPin["paths"].get<imgui_json::array>())
+                {
+                    if (!jnPath.is_string())
+                        continue;
+                    aRelPaths.push_back(jnPath.get<imgui_json::string>());
+                    auto itEntry = m_mapEntries.find(aRelPaths.back());
+                    if (itEntry != m_mapEntries.end())
+                        itEntry->second.iPinCnt++;
+                }
+            }
+        }
+        m_pLogger->Log(DEBUG) << "Loaded " << m_mapEntries.size() << " cache entries from index, total size is " << m_i64UsedSize << " bytes." << endl;
+    }
+
+    int CountPins(const string& strRelPath) const
+    {
+        int iPinCnt = 0;
+        for (const auto& elem : m_mapPins)
+            iPinCnt += (int)count(elem.second.begin(), elem.second.end(), strRelPath);
+        return iPinCnt;
+    }
+
+    bool UnpinEntries_(const string& strOwnerPath)
+    {
+        auto itPin = m_mapPins.find(strOwnerPath);
+        if (itPin == m_mapPins.end())
+            return false;
+        for (const auto& strRelPath : itPin->second)
+        {
+            auto itEntry = m_mapEntries.find(strRelPath);
+            if (itEntry != m_mapEntries.end() && itEntry->second.iPinCnt > 0)
+                itEntry->second.iPinCnt--;
+        }
+        m_mapPins.erase(itPin);
+        m_bIndexDirty = true;
+        return true;
+    }
+
+    void EvictIfOverQuota()
+    {
+        if (m_i64Quota <= 0 || m_i64UsedSize <= m_i64Quota)
+            return;
+        // evict a bit more than needed, so the eviction does not happen on every new entry
+        Evict_((int64_t)(m_i64Quota*EVICT_TARGET_RATIO));
+    }
+
+    int64_t Evict_(int64_t i64TargetSize)
+    {
+        int64_t i64UsedSize = m_i64UsedSize;
+        if (i64UsedSize <= i64TargetSize)
+            return 0;
+        vector<unordered_map<string, _Entry>::iterator> aCandidates;
+        for (auto it = m_mapEntries.begin(); it != m_mapEntries.end(); it++)
+        {
+            if (it->second.iRefCnt <= 0 && it->second.iPinCnt <= 0)
+                aCandidates.push_back(it);
+        }
+        sort(aCandidates.begin(), aCandidates.end(), [] (const unordered_map<string, _Entry>::iterator& a, const unordered_map<string, _Entry>::iterator& b) {
+            return a->second.i64LastAccess < b->second.i64LastAccess;
+        });
+        int64_t i64Freed = 0;
+        int iEvictedCnt = 0;
+        for (auto& it : aCandidates)
+        {
+            if (i64UsedSize <= i64TargetSize)
+                break;
+            const auto i64Size = it->second.i64Size;
+            DeleteFromDisk(SysUtils::JoinPath(m_strCacheDir, it->first));
+            m_i64UsedSize -= i64Size;
+            m_mapEntries.erase(it);
+            i64UsedSize -= i64Size;
+            i64Freed += i64Size;
+            iEvictedCnt++;
+        }
+        if (iEvictedCnt > 0)
+        {
+            m_bIndexDirty = true;
+            m_pLogger->Log(INFO) << "Evicted " << iEvictedCnt << " cache entries, " << i64Freed << " bytes are freed." << endl;
+        }
+        if (i64UsedSize > i64TargetSize)
+            m_pLogger->Log(WARN) << "Cache size " << i64UsedSize << " bytes is still above the target " << i64TargetSize << " bytes, the rest entries are referenced or pinned." << endl;
+        return i64Freed;
+    }
+
+private:
+    ALogger* m_pLogger;
+    string m_strCacheDir;
+    mutable mutex m_mtxLock;
+    unordered_map<string, _Entry> m_mapEntries;
+    unordered_map<string, vector<string>> m_mapPins;
+    int64_t m_i64UsedSize{0};
+    int64_t m_i64Quota{0};
+    bool m_bIndexDirty{false};
+
+    static const uint32_t INDEX_VERSION;
+    static const double EVICT_TARGET_RATIO;
+};
+
+const uint32_t CacheManager_Impl::INDEX_VERSION = 3;
+const double CacheManager_Impl::EVICT_TARGET_RATIO = 0.9;
+
+const string CacheManager::INDEX_FILE_NAME = ".mec_cache_index";
+
+static const auto CACHE_MANAGER_DELETER = [] (CacheManager* p) {
+    CacheManager_Impl* ptr = dynamic_cast<CacheManager_Impl*>(p);
+    delete ptr;
+};
+
+CacheManager::Holder CacheManager::CreateInstance(const string& strCacheDir)
+{
+    if (strCacheDir.empty() || !SysUtils::IsDirectory(strCacheDir))
+        return nullptr;
+    return CacheManager::Holder(new CacheManager_Impl(strCacheDir), CACHE_MANAGER_DELETER);
+}
+}
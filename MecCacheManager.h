@@ -0,0 +1,49 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Logger.h>
+
+namespace MEC
+{
+    // Keeps the accounting of what is stored in the cache directory. Each entry is a file or a directory under the
+    // cache directory, currently only the background task directories are stored there. When the total size exceeds the quota, the least recently used
+    // entries that are neither referenced nor pinned are deleted. The entries and the pins are tracked by an index file
+    // in the cache directory, which is loaded on startup instead of walking through the directory.
+    struct CacheManager
+    {
+        using Holder = std::shared_ptr<CacheManager>;
+        static Holder CreateInstance(const std::string& strCacheDir);
+
+        virtual std::string GetCacheDir() const = 0;
+        // Entries outside the cache directory are rejected. If 'i64Size' is negative, the size is measured from the disk.
+        // Adding an entry that already exists updates its size.
+        virtual bool AddEntry(const std::string& strPath, int64_t i64Size = -1) = 0;
+        virtual bool UpdateEntrySize(const std::string& strPath, int64_t i64Size = -1) = 0;
+        virtual bool RemoveEntry(const std::string& strPath, bool bDeleteFiles = true) = 0;
+        virtual bool HasEntry(const std::string& strPath) const = 0;
+        // Marks the entry as used just now
+        virtual void TouchEntry(const std::string& strPath) = 0;
+        // Referenced entries are never evicted, the references are not persisted in the index
+        virtual void AddReference(const std::string& strPath) = 0;
+        virtual void ReleaseReference(const std::string& strPath) = 0;
+        // Replaces the paths pinned by the owner file, the pinned entries are never evicted. The pins are persisted in
+        // the index, and they are dropped on loading if the owner file does not exist any more.
+        virtual void PinEntries(const std::string& strOwnerPath, const std::vector<std::string>& aPaths) = 0;
+        virtual void UnpinEntries(const std::string& strOwnerPath) = 0;
+
+        // Quota in bytes, 0 means unlimited
+        virtual void SetQuota(int64_t i64Quota) = 0;
+        virtual int64_t GetQuota() const = 0;
+        virtual int64_t GetTotalUsedSize() const = 0;
+        // Evicts the unreferenced entries until the used size is not larger than 'i64TargetSize', a negative value means
+        // the eviction target derived from the quota. Returns the number of bytes freed.
+        virtual int64_t Evict(int64_t i64TargetSize = -1) = 0;
+        virtual bool SaveIndex() = 0;
+
+        virtual void SetLogLevel(Logger::Level l) = 0;
+
+        static const std::string INDEX_FILE_NAME;
+    };
+}
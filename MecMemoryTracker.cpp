@@ -0,0 +1,259 @@
+#include <mutex>
+#include <map>
+#include <list>
+#include <utility>
+#include <algorithm>
+#include <Logger.h>
+#include "MecMemoryTracker.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+struct _ProviderEntry
+{
+    int64_t i64Id;
+    string strName;
+    MemoryTracker::Provider provider;
+    MemoryTracker::Trimmer trimmer;
+};
+
+struct _UsageEntry
+{
+    int64_t i64PushedBytes{0};
+    int64_t i64PushedCount{0};
+    int64_t i64SampledBytes{0};
+    int64_t i64SampledCount{0};
+    bool bSampledBytesUnknown{false};
+    int64_t i64PeakBytes{0};
+    int64_t i64PeakCount{0};
+    int64_t i64SoftLimit{0};
+    bool bOverLimit{false};
+
+    int64_t GetBytes() const
+    {
+        if (bSampledBytesUnknown && i64PushedBytes == 0)
+            return -1;
+        return i64PushedBytes+(bSampledBytesUnknown ? 0 : i64SampledBytes);
+    }
+    int64_t GetCount() const { return i64PushedCount+i64SampledCount; }
+    void UpdatePeaks()
+    {
+        const auto i64Bytes = GetBytes();
+        if (i64Bytes > i64PeakBytes)
+            i64PeakBytes = i64Bytes;
+        const auto i64Count = GetCount();
+        if (i64Count > i64PeakCount)
+            i64PeakCount = i64Count;
+    }
+};
+
+static mutex s_mtxUsageLock;
+// serializes the calls of the providers and the trimmers with the unregistration
+static recursive_mutex s_mtxSampleLock;
+static map<string, _UsageEntry> s_mapUsages;
+static list<_ProviderEntry> s_aProviders;
+static int64_t s_i64NextProviderId = 1;
+
+int64_t MemoryTracker::RegisterProvider(const std::string& strName, Provider provider, Trimmer trimmer)
+{
+    if (!provider)
+        return 0;
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    const auto i64Id = s_i64NextProviderId++;
+    s_aProviders.push_back({i64Id, strName, provider, trimmer});
+    s_mapUsages[strName];
+    return i64Id;
+}
+
+void MemoryTracker::UnregisterProvider(int64_t i64ProviderId)
+{
+    lock_guard<recursive_mutex> lk(s_mtxSampleLock);
+    lock_guard<mutex> lk2(s_mtxUsageLock);
+    s_aProviders.remove_if([i64ProviderId] (const _ProviderEntry& e) { return e.i64Id == i64ProviderId; });
+}
+
+void MemoryTracker::Add(const std::string& strName, int64_t i64Bytes, int64_t i64Count)
+{
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    auto& tEntry = s_mapUsages[strName];
+    tEntry.i64PushedBytes += i64Bytes;
+    tEntry.i64PushedCount += i64Count;
+    tEntry.UpdatePeaks();
+}
+
+void MemoryTracker::SetSoftLimit(const std::string& strName, int64_t i64Bytes)
+{
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    auto& tEntry = s_mapUsages[strName];
+    tEntry.i64SoftLimit = i64Bytes > 0 ? i64Bytes : 0;
+    if (tEntry.i64SoftLimit == 0)
+        tEntry.bOverLimit = false;
+}
+
+int64_t MemoryTracker::GetSoftLimit(const std::string& strName)
+{
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    auto iter = s_mapUsages.find(strName);
+    return iter != s_mapUsages.end() ? iter->second.i64SoftLimit : 0;
+}
+
+void MemoryTracker::Sample()
+{
+    lock_guard<recursive_mutex> lk(s_mtxSampleLock);
+    list<_ProviderEntry> aProviders;
+    {
+        lock_guard<mutex> lk2(s_mtxUsageLock);
+        aProviders = s_aProviders;
+    }
+
+    struct _SampleResult
+    {
+        int64_t i64Bytes{0};
+        int64_t i64Count{0};
+        bool bBytesUnknown{false};
+    };
+    map<string, _SampleResult> mapResults;
+    for (auto& tProvider : aProviders)
+    {
+        int64_t i64Bytes = 0, i64Count = 0;
+        tProvider.provider(i64Bytes, i64Count);
+        auto& tResult = mapResults[tProvider.strName];
+        if (i64Bytes < 0)
+            tResult.bBytesUnknown = true;
+        else
+            tResult.i64Bytes += i64Bytes;
+        tResult.i64Count += i64Count;
+    }
+
+    list<pair<MemoryTracker::Trimmer, int64_t>> aTrimJobs;
+    {
+        lock_guard<mutex> lk2(s_mtxUsageLock);
+        for (auto& elem : s_mapUsages)
+        {
+            auto& tEntry = elem.second;
+            auto itResult = mapResults.find(elem.first);
+            if (itResult != mapResults.end())
+            {
+                // a size is unknown only if none of the providers of this name knows it
+                tEntry.bSampledBytesUnknown = itResult->second.bBytesUnknown && itResult->second.i64Bytes == 0;
+                tEntry.i64SampledBytes = itResult->second.i64Bytes;
+                tEntry.i64SampledCount = itResult->second.i64Count;
+            }
+            else
+            {
+                tEntry.bSampledBytesUnknown = false;
+                tEntry.i64SampledBytes = tEntry.i64SampledCount = 0;
+            }
+            tEntry.UpdatePeaks();
+
+            const bool bOverLimit = tEntry.i64SoftLimit > 0 && tEntry.GetBytes() > tEntry.i64SoftLimit;
+            if (bOverLimit && !tEntry.bOverLimit)
+                Log(WARN) << "Memory usage of '" << elem.first << "' (" << tEntry.GetBytes() << " bytes) exceeds its soft limit " << tEntry.i64SoftLimit << " bytes." << endl;
+            tEntry.bOverLimit = bOverLimit;
+            if (bOverLimit)
+            {
+                for (auto& tProvider : aProviders)
+                {
+                    if (tProvider.trimmer && tProvider.strName == elem.first)
+                        aTrimJobs.push_back({tProvider.trimmer, tEntry.i64SoftLimit});
+                }
+            }
+        }
+    }
+    for (auto& tJob : aTrimJobs)
+        tJob.first(tJob.second);
+}
+
+std::vector<MemoryTracker::Usage> MemoryTracker::GetUsages()
+{
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    vector<Usage> aUsages;
+    aUsages.reserve(s_mapUsages.size());
+    for (auto& elem : s_mapUsages)
+    {
+        const auto& tEntry = elem.second;
+        Usage tUsage;
+        tUsage.strName = elem.first;
+        tUsage.i64Bytes = tEntry.GetBytes();
+        tUsage.i64PeakBytes = tEntry.i64PeakBytes;
+        tUsage.i64Count = tEntry.GetCount();
+        tUsage.i64PeakCount = tEntry.i64PeakCount;
+        tUsage.i64SoftLimit = tEntry.i64SoftLimit;
+        tUsage.bOverLimit = tEntry.bOverLimit;
+        aUsages.push_back(std::move(tUsage));
+    }
+    return aUsages;
+}
+
+void MemoryTracker::ResetPeaks()
+{
+    lock_guard<mutex> lk(s_mtxUsageLock);
+    for (auto& elem : s_mapUsages)
+    {
+        auto& tEntry = elem.second;
+        tEntry.i64PeakBytes = max<int64_t>(tEntry.GetBytes(), 0);
+        tEntry.i64PeakCount = tEntry.GetCount();
+    }
+}
+
+imgui_json::value MemoryTracker::SaveAsJson()
+{
+    const auto aUsages = GetUsages();
+    imgui_json::value jnReport;
+    imgui_json::array aSubsystems;
+    int64_t i64TotalBytes = 0;
+    for (const auto& tUsage : aUsages)
+    {
+        imgui_json::value jnUsage;
+        jnUsage["name"] = tUsage.strName;
+        jnUsage["bytes"] = imgui_json::number(tUsage.i64Bytes);
+        jnUsage["peak_bytes"] = imgui_json::number(tUsage.i64PeakBytes);
+        jnUsage["count"] = imgui_json::number(tUsage.i64Count);
+        jnUsage["peak_count"] = imgui_json::number(tUsage.i64PeakCount);
+        jnUsage["soft_limit"] = imgui_json::number(tUsage.i64SoftLimit);
+        jnUsage["over_limit"] = imgui_json::boolean(tUsage.bOverLimit);
+        aSubsystems.push_back(jnUsage);
+        if (tUsage.i64Bytes > 0)
+            i64TotalBytes += tUsage.i64Bytes;
+    }
+    jnReport["subsystems"] = aSubsystems;
+    jnReport["total_bytes"] = imgui_json::number(i64TotalBytes);
+    return jnReport;
+}
+
+bool MemoryTracker::DumpAsJson(const std::string& strFilePath)
+{
+    auto jnReport = SaveAsJson();
+    if (!jnReport.save(strFilePath))
+    {
+        Log(Error) << "FAILED to save memory usage report to '" << strFilePath << "'!" << endl;
+        return false;
+    }
+    Log(INFO) << "Memory usage report is saved to '" << strFilePath << "'." << endl;
+    return true;
+}
+
+int64_t MemoryTracker::EstimateJsonSize(const imgui_json::value& jnVal)
+{
+    // each value carries its type tag and the storage of a double or a pointer
+    int64_t i64Size = 16;
+    if (jnVal.is_string())
+    {
+        i64Size += jnVal.get<imgui_json::string>().size();
+    }
+    else if (jnVal.is_array())
+    {
+        for (const auto& jnItem : jnVal.get<imgui_json::array>())
+            i64Size += EstimateJsonSize(jnItem);
+    }
+    else if (jnVal.is_object())
+    {
+        // map node overhead plus the key string
+        for (const auto& elem : jnVal.get<imgui_json::object>())
+            i64Size += 48+elem.first.size()+EstimateJsonSize(elem.second);
+    }
+    return i64Size;
+}
+}
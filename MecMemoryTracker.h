@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <imgui_json.h>
+
+namespace MEC
+{
+    // Collects the memory usage of the subsystems under their names. A subsystem either pushes the changes of its usage
+    // with 'Add()', or registers a provider which is polled by 'Sample()'. The usages of the same name are summed up.
+    // A subsystem able to release memory on demand can also register a trimmer, it's called by 'Sample()' when the usage
+    // exceeds the soft limit of that name. The providers and the trimmers are called on the thread calling 'Sample()'.
+    struct MemoryTracker
+    {
+        struct Usage
+        {
+            std::string strName;
+            int64_t i64Bytes{0};
+            int64_t i64PeakBytes{0};
+            int64_t i64Count{0};
+            int64_t i64PeakCount{0};
+            int64_t i64SoftLimit{0};    // 0 means no limit
+            bool bOverLimit{false};
+        };
+        // Sets 'i64Bytes' to -1 if the size is unknown, then only the object count is reported
+        using Provider = std::function<void(int64_t& i64Bytes, int64_t& i64Count)>;
+        using Trimmer = std::function<void(int64_t i64TargetBytes)>;
+
+        static int64_t RegisterProvider(const std::string& strName, Provider provider, Trimmer trimmer = nullptr);
+        // After this returns, the provider and the trimmer are not called anymore
+        static void UnregisterProvider(int64_t i64ProviderId);
+        static void Add(const std::string& strName, int64_t i64Bytes, int64_t i64Count = 0);
+        static void SetSoftLimit(const std::string& strName, int64_t i64Bytes);
+        static int64_t GetSoftLimit(const std::string& strName);
+
+        static void Sample();
+        static std::vector<Usage> GetUsages();
+        static void ResetPeaks();
+        static imgui_json::value SaveAsJson();
+        static bool DumpAsJson(const std::string& strFilePath);
+
+        // Rough size of a json value kept in memory, it's meant for comparing, not an exact accounting
+        static int64_t EstimateJsonSize(const imgui_json::value& jnVal);
+    };
+}
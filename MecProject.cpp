@@ -1,8 +1,18 @@
 #include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "imgui_helper.h"
 #include "FileSystemUtils.h"
 #include "MecProject.h"
+#include "MecProjectContainer.h"
 #include "MediaTimeline.h"
+#include "MecTracer.h"
 
 using namespace std;
 using namespace Logger;
@@ -217,6 +227,11 @@ string Project::GetCacheDir()
 
 Project::ErrorCode Project::SetCacheDir(const string& path)
 {
+    {
+        lock_guard<mutex> _lk(s_mtxCacheMgrLock);
+        if (s_hCacheMgr && s_hCacheMgr->GetCacheDir() != path)
+            s_hCacheMgr = nullptr;
+    }
     if (path.empty())
     {
         s_CACHEDIR.clear();
@@ -237,6 +252,83 @@ Project::ErrorCode Project::SetCacheDir(const string& path)
     return OK;
 }
 
+CacheManager::Holder Project::GetCacheManager()
+{
+    lock_guard<mutex> _lk(s_mtxCacheMgrLock);
+    if (!s_hCacheMgr)
+    {
+        const auto strCacheDir = GetCacheDir();
+        if (strCacheDir.empty())
+            return nullptr;
+        s_hCacheMgr = CacheManager::CreateInstance(strCacheDir);
+        if (!s_hCacheMgr)
+        {
+            auto pLogger = GetLogger("MecProject");
+            pLogger->Log(Error) << "FAILED to create cache manager for cache dir '" << strCacheDir << "'!" << endl;
+            return nullptr;
+        }
+        s_hCacheMgr->SetQuota(s_i64CacheQuota);
+    }
+    return s_hCacheMgr;
+}
+
+void Project::SetCacheQuota(int64_t i64Quota)
+{
+    lock_guard<mutex> _lk(s_mtxCacheMgrLock);
+    s_i64CacheQuota = i64Quota > 0 ? i64Quota : 0;
+    if (s_hCacheMgr)
+        s_hCacheMgr->SetQuota(s_i64CacheQuota);
+}
+
+void Project::TrackBgtaskCacheEntry(BackgroundTask::Holder hTask)
+{
+    const auto strTaskDir = hTask->GetTaskDir();
+    if (strTaskDir.empty())
+        return;
+    auto hCacheMgr = GetCacheManager();
+    if (!hCacheMgr || strTaskDir.compare(0, hCacheMgr->GetCacheDir().size(), hCacheMgr->GetCacheDir()) != 0)
+        return;
+    if (!hCacheMgr->HasEntry(strTaskDir) && !hCacheMgr->AddEntry(strTaskDir))
+        return;
+    hCacheMgr->AddReference(strTaskDir);
+}
+
+void Project::UntrackBgtaskCacheEntry(BackgroundTask::Holder hTask, bool bRemoved)
+{
+    const auto strTaskDir = hTask->GetTaskDir();
+    if (strTaskDir.empty())
+        return;
+    auto hCacheMgr = GetCacheManager();
+    if (!hCacheMgr || !hCacheMgr->HasEntry(strTaskDir))
+        return;
+    if (bRemoved)
+    {
+        hCacheMgr->RemoveEntry(strTaskDir, false);
+        return;
+    }
+    // the task outputs are written after the entry is added, measure the size again
+    hCacheMgr->UpdateEntrySize(strTaskDir);
+    hCacheMgr->ReleaseReference(strTaskDir);
+}
+
+void Project::PinBgtaskCacheEntries(const string& projFilePath, const list<BackgroundTask::Holder>& aBgtasks)
+{
+    auto hCacheMgr = GetCacheManager();
+    if (!hCacheMgr)
+        return;
+    vector<string> aTaskDirs;
+    for (auto& hTask : aBgtasks)
+    {
+        const auto strTaskDir = hTask->GetTaskDir();
+        if (!strTaskDir.empty())
+            aTaskDirs.push_back(strTaskDir);
+    }
+    if (aTaskDirs.empty())
+        hCacheMgr->UnpinEntries(projFilePath);
+    else
+        hCacheMgr->PinEntries(projFilePath, aTaskDirs);
+}
+
 Project::ErrorCode Project::Move(const string& newProjDir, bool overwrite)
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
@@ -257,19 +349,32 @@ Project::ErrorCode Project::Move(const string& newProjDir, bool overwrite)
         m_pLogger->Log(Error) << "FAILED to move project to directory at '" << newProjDir << "'! Target path is already OCCUPIED." << endl;
         return ALREADY_EXISTS;
     }
+    WaitSaveDone();
+    {
+        lock_guard<mutex> _lk2(m_mtxJournalLock);
+        if (m_fpJournal)
+        {
+            fclose(m_fpJournal);
+            m_fpJournal = nullptr;
+        }
+    }
     if (!SysUtils::RenameFile(m_projDir, newProjDir))
     {
         m_pLogger->Log(Error) << "FAILED to move project to directory at '" << newProjDir << "'! Move directory failed." << endl;
         return IO_ERROR;
     }
+    const auto oldProjFilePath = m_projFilePath;
     m_projDir = newProjDir;
     m_projFilePath = SysUtils::JoinPath(m_projDir, m_projName+s_PROJ_FILE_EXT);
     m_bUntitled = false;
+    PinBgtaskCacheEntries(oldProjFilePath, {});
+    PinBgtaskCacheEntries(m_projFilePath, GetBackgroundTaskList());
     return OK;
 }
 
 Project::ErrorCode Project::Load(const string& projFilePath)
 {
+    MEC_TRACE_SCOPE("Project::Load");
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (m_bOpened)
     {
@@ -285,13 +390,10 @@ Project::ErrorCode Project::Load(const string& projFilePath)
         m_pLogger->Log(Error) << "FAILED to load project from '" << projFilePath << "'! Target is NOT a file." << endl;
         return FILE_INVALID;
     }
-    auto res = imgui_json::value::load(projFilePath);
-    if (!res.second)
-    {
-        m_pLogger->Log(Error) << "FAILED to parse project json from '" << projFilePath << "'!" << endl;
+    imgui_json::value jnProj;
+    m_hContainer = nullptr;
+    if (!ReadProjectFile(projFilePath, jnProj, m_bBinaryFormat, &m_hContainer))
         return PARSE_FAILED;
-    }
-    const auto& jnProj = res.first;
     string attrName = "mec_proj_version";
     if (jnProj.contains(attrName) && jnProj[attrName].is_number())
     {
@@ -309,6 +411,12 @@ Project::ErrorCode Project::Load(const string& projFilePath)
             m_bUntitled = true;
         }
         m_projDir = SysUtils::ExtractDirectoryPath(projFilePath);
+        int64_t i64ProjJournalSeq = 0;
+        attrName = "journal_seq";
+        if (jnProj.contains(attrName) && jnProj[attrName].is_number())
+            i64ProjJournalSeq = jnProj[attrName].get<imgui_json::number>();
+        LoadSnapshot(projFilePath, i64ProjJournalSeq);
+        LoadJournal(projFilePath, i64ProjJournalSeq);
         attrName = "bg_tasks";
         if (jnProj.contains(attrName) && jnProj[attrName].is_array())
         {
@@ -328,10 +436,11 @@ Project::ErrorCode Project::Load(const string& projFilePath)
                         {
                             hTask->SetCallbacks(this);
                             hTask->Pause();
-                            if (m_hBgtaskExctor)
-                                if (!m_hBgtaskExctor->EnqueueTask(hTask))
+                            if (m_hBgtaskScheduler)
+                                if (!m_hBgtaskScheduler->EnqueueTask(hTask))
                                     m_pLogger->Log(Error) << "FAILED to enqueue background task from json '" << strTaskJsonPath << "'!" << endl;
                             m_aBgtasks.push_back(hTask);
+                            TrackBgtaskCacheEntry(hTask);
                         }
                         else
                             m_pLogger->Log(Error) << "FAILED to parse background task from json '" << strTaskJsonPath << "'!" << endl;
@@ -358,6 +467,115 @@ Project::ErrorCode Project::Load(const string& projFilePath)
     return OK;
 }
 
+bool Project::ReadProjectFile(const string& strFilePath, imgui_json::value& jnProj, bool& bBinaryFormat, ProjectContainer::Holder* phContainer)
+{
+    bBinaryFormat = ProjectContainer::IsContainerFile(strFilePath);
+    if (bBinaryFormat)
+    {
+        string strErrMsg;
+        auto hContainer = ProjectContainer::Open(strFilePath, strErrMsg);
+        if (!hContainer || !(phContainer ? hContainer->HeaderToJson(jnProj) : hContainer->ToJson(jnProj)))
+        {
+            m_pLogger->Log(Error) << "FAILED to decode project container from '" << strFilePath << "'! "
+                    << (hContainer ? hContainer->GetError() : strErrMsg) << endl;
+            return false;
+        }
+        if (phContainer)
+            *phContainer = hContainer;
+    }
+    else
+    {
+        auto res = imgui_json::value::load(strFilePath);
+        if (!res.second)
+        {
+            m_pLogger->Log(Error) << "FAILED to parse project json from '" << strFilePath << "'!" << endl;
+            return false;
+        }
+        jnProj = std::move(res.first);
+    }
+    return true;
+}
+
+void Project::LoadSnapshot(const string& projFilePath, int64_t& i64ProjJournalSeq)
+{
+    const auto strSnapshotPath = GetSnapshotFilePath(projFilePath);
+    if (!SysUtils::IsFile(strSnapshotPath))
+        return;
+    imgui_json::value jnSnapshot;
+    bool bBinaryFormat;
+    if (!ReadProjectFile(strSnapshotPath, jnSnapshot, bBinaryFormat) || !jnSnapshot.contains("journal_seq") || !jnSnapshot["journal_seq"].is_number())
+    {
+        m_pLogger->Log(WARN) << "Ignore the INVALID project snapshot at '" << strSnapshotPath << "'." << endl;
+        return;
+    }
+    // a snapshot older than the project file is left by a failed deletion
+    const int64_t i64SnapshotJournalSeq = jnSnapshot["journal_seq"].get<imgui_json::number>();
+    if (i64SnapshotJournalSeq <= i64ProjJournalSeq)
+    {
+        SysUtils::DeleteFileAt(strSnapshotPath);
+        return;
+    }
+    m_hContainer = nullptr;
+    m_jnProjContent = std::move(jnSnapshot["proj_content"]);
+    i64ProjJournalSeq = i64SnapshotJournalSeq;
+    m_pLogger->Log(INFO) << "Recovered unsaved edits from project snapshot at '" << strSnapshotPath << "'." << endl;
+}
+
+void Project::MaterializeContent()
+{
+    if (!m_hContainer)
+        return;
+    MEC_TRACE_SCOPE("Project::MaterializeContent");
+    if (!m_hContainer->ContentToJson(m_jnProjContent))
+    {
+        m_pLogger->Log(Error) << "FAILED to decode project content from '" << m_projFilePath << "'! " << m_hContainer->GetError() << endl;
+        m_jnProjContent = imgui_json::value();
+    }
+    m_hContainer = nullptr;
+}
+
+const imgui_json::value& Project::GetProjectContentJson()
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    MaterializeContent();
+    return m_jnProjContent;
+}
+
+const imgui_json::value* Project::GetContentItem(const string& strPath, imgui_json::value& jnHolder)
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    if (m_hContainer)
+    {
+        if (!m_hContainer->GetContentItem(strPath, jnHolder))
+        {
+            m_pLogger->Log(Error) << "FAILED to decode project content item '" << strPath << "' from '" << m_projFilePath << "'! " << m_hContainer->GetError() << endl;
+            return nullptr;
+        }
+        return jnHolder.is_null() ? nullptr : &jnHolder;
+    }
+    const imgui_json::value* pItem = &m_jnProjContent;
+    size_t szPos = 0;
+    while (szPos <= strPath.size())
+    {
+        auto szEnd = strPath.find('/', szPos);
+        if (szEnd == string::npos)
+            szEnd = strPath.size();
+        const auto strKey = strPath.substr(szPos, szEnd-szPos);
+        if (!pItem->is_object() || !pItem->contains(strKey))
+            return nullptr;
+        pItem = &(*pItem)[strKey];
+        szPos = szEnd+1;
+    }
+    return pItem;
+}
+
+void Project::SetContentJson(const imgui_json::value& jnProjContent)
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    m_hContainer = nullptr;
+    m_jnProjContent = jnProjContent;
+}
+
 Project::ErrorCode Project::Save()
 {
     return SaveTo(m_projFilePath);
@@ -400,12 +618,115 @@ Project::ErrorCode Project::SaveTo(const string& projFilePath)
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return NOT_OPENED;
+    // an older snapshot still in the queue must not overwrite this one
+    WaitSaveDone();
+    _SaveJob tJob;
+    if (!MakeSaveJob(projFilePath, tJob))
+        return FAILED;
+    return RunSaveJob(tJob);
+}
+
+Project::ErrorCode Project::SaveAsync()
+{
+    return RequestSaveJob(false);
+}
+
+Project::ErrorCode Project::RequestSaveJob(bool bSidecarSnapshot)
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    if (!m_bOpened)
+        return NOT_OPENED;
+    unique_ptr<_SaveJob> pJob(new _SaveJob());
+    if (!MakeSaveJob(m_projFilePath, *pJob, true))
+        return FAILED;
+    pJob->bSidecarSnapshot = bSidecarSnapshot;
+    lock_guard<mutex> _lk2(m_mtxSaveLock);
+    if (m_pPendingSaveJob)
+    {
+        // the pending save of the project file also compacts the journal
+        if (bSidecarSnapshot && !m_pPendingSaveJob->bSidecarSnapshot)
+            return OK;
+        m_pLogger->Log(DEBUG) << "Project save request is coalesced with the pending one." << endl;
+    }
+    m_pPendingSaveJob = std::move(pJob);
+    if (!m_thSaveThread.joinable())
+    {
+        m_thSaveThread = thread(&Project::SaveThreadProc, this);
+        Tracer::NameThread(m_thSaveThread, "ProjSave");
+    }
+    m_cvSaveUpdated.notify_all();
+    return OK;
+}
+
+bool Project::IsSaving()
+{
+    lock_guard<mutex> _lk(m_mtxSaveLock);
+    return m_pPendingSaveJob || m_bSaveInProgress;
+}
+
+Project::ErrorCode Project::WaitSaveDone()
+{
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    while (m_pPendingSaveJob || m_bSaveInProgress)
+    {
+        // the saving thread can't take the snapshot while the caller is holding the timeline edit lock, take it here instead
+        if (m_pSavingJob && m_pSavingJob->bNeedContentSnapshot)
+        {
+            unique_lock<recursive_mutex> lkEdit(*m_pTlEditLock, try_to_lock);
+            if (lkEdit.owns_lock())
+                TakeContentSnapshot(*m_pSavingJob);
+        }
+        m_cvSaveUpdated.wait_for(_lk, chrono::milliseconds(2));
+    }
+    return m_eLastSaveResult;
+}
+
+Project::ErrorCode Project::GetLastSaveResult()
+{
+    lock_guard<mutex> _lk(m_mtxSaveLock);
+    return m_eLastSaveResult;
+}
 
+Project::~Project()
+{
+    {
+        lock_guard<mutex> _lk(m_mtxSaveLock);
+        m_bQuitSaveThread = true;
+        m_cvSaveUpdated.notify_all();
+    }
+    if (m_thSaveThread.joinable())
+        m_thSaveThread.join();
+}
+
+bool Project::MakeSaveJob(const string& projFilePath, _SaveJob& tJob, bool bDeferContentSnapshot)
+{
+    MEC_TRACE_SCOPE("Project::MakeSaveJob");
     imgui_json::value jnProj;
     jnProj["mec_proj_version"] = imgui_json::number(m_projVer);
     if (!m_bUntitled)
         jnProj["proj_name"] = imgui_json::string(m_projName);
 
+    tJob.strProjFilePath = projFilePath;
+    tJob.jnProj = std::move(jnProj);
+    tJob.bBinaryFormat = m_bBinaryFormat;
+    {
+        lock_guard<mutex> _lk(m_mtxBgtaskLock);
+        tJob.aBgtasks = m_aBgtasks;
+    }
+    // the content comes from the timeline now, and the mapped project file can't be replaced on some systems
+    if (m_pTlHandle)
+        m_hContainer = nullptr;
+    if (bDeferContentSnapshot && m_pTlHandle && m_pTlEditLock)
+        tJob.bNeedContentSnapshot = true;
+    else
+        TakeContentSnapshot(tJob);
+    return true;
+}
+
+// called with the timeline edit lock held, or on the editing thread
+void Project::TakeContentSnapshot(_SaveJob& tJob)
+{
+    MEC_TRACE_SCOPE("Project::TakeContentSnapshot");
     if (m_pTlHandle)
     {
         MediaTimeline::TimeLine* pTl = (MediaTimeline::TimeLine*)m_pTlHandle;
@@ -426,40 +747,318 @@ Project::ErrorCode Project::SaveTo(const string& projFilePath)
         // save timeline
         imgui_json::value jnTimeLine;
         pTl->Save(jnTimeLine);
-        jnProjContent["TimeLine"] = jnTimeLine;
-        m_jnProjContent = std::move(jnProjContent);
+        jnProjContent["TimeLine"] = std::move(jnTimeLine);
+        tJob.jnProj["proj_content"] = std::move(jnProjContent);
     }
-    jnProj["proj_content"] = m_jnProjContent;
+    else
+    {
+        MaterializeContent();
+        tJob.jnProj["proj_content"] = m_jnProjContent;
+    }
+    {
+        // the journal entries up to this one are covered by the snapshot
+        lock_guard<mutex> _lk(m_mtxJournalLock);
+        tJob.i64JournalSeq = m_i64JournalSeq;
+    }
+    tJob.jnProj["journal_seq"] = imgui_json::number(tJob.i64JournalSeq);
+    tJob.bNeedContentSnapshot = false;
+}
 
-    // save background tasks
+// the editing thread holds the timeline edit lock while it's changing the timeline, the snapshot is taken in between
+bool Project::WaitContentSnapshot(_SaveJob& tJob)
+{
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    while (tJob.bNeedContentSnapshot)
+    {
+        if (m_bQuitSaveThread)
+            return false;
+        _lk.unlock();
+        {
+            unique_lock<recursive_mutex> lkEdit(*m_pTlEditLock, try_to_lock);
+            if (lkEdit.owns_lock() && tJob.bNeedContentSnapshot)
+                TakeContentSnapshot(tJob);
+        }
+        _lk.lock();
+        if (tJob.bNeedContentSnapshot)
+            m_cvSaveUpdated.wait_for(_lk, chrono::milliseconds(2));
+    }
+    return true;
+}
+
+// write to a temporary file beside the target first, so a crash in the middle never leaves a truncated project file
+static bool WriteFileByReplacing(const string& strFilePath, const string& strContent)
+{
+    const auto strTempPath = strFilePath+".saving";
+    {
+        ofstream ofs(strTempPath, ios::out|ios::binary|ios::trunc);
+        if (!ofs.is_open())
+            return false;
+        ofs.write(strContent.data(), strContent.size());
+        ofs.flush();
+        if (!ofs.good())
+        {
+            ofs.close();
+            SysUtils::DeleteFileAt(strTempPath);
+            return false;
+        }
+    }
+    // 'rename' replaces the existing target atomically on POSIX systems, while on Windows it fails if the target exists
+    if (rename(strTempPath.c_str(), strFilePath.c_str()) == 0)
+        return true;
+    if (!SysUtils::IsFile(strFilePath) || !SysUtils::DeleteFileAt(strFilePath))
+    {
+        SysUtils::DeleteFileAt(strTempPath);
+        return false;
+    }
+    // the temporary file is kept if this fails, it's the only complete copy now
+    return rename(strTempPath.c_str(), strFilePath.c_str()) == 0;
+}
+
+Project::ErrorCode Project::RunSaveJob(_SaveJob& tJob)
+{
+    MEC_TRACE_SCOPE("Project::RunSaveJob");
+    // save background tasks, the snapshot only recovers the project content
     imgui_json::array aTaskSavePaths;
-    for (auto& hTask : m_aBgtasks)
+    if (!tJob.bSidecarSnapshot)
     {
-        const auto strTaskSavePath = hTask->Save();
-        aTaskSavePaths.push_back(strTaskSavePath);
+        for (auto& hTask : tJob.aBgtasks)
+        {
+            const auto strTaskSavePath = hTask->Save();
+            aTaskSavePaths.push_back(strTaskSavePath);
+        }
     }
-    jnProj["bg_tasks"] = aTaskSavePaths;
-    if (!jnProj.save(projFilePath))
+    tJob.jnProj["bg_tasks"] = aTaskSavePaths;
+    const auto strFileData = tJob.bBinaryFormat ? ProjectContainer::Encode(tJob.jnProj) : tJob.jnProj.dump(4);
+    const auto strSnapshotPath = GetSnapshotFilePath(tJob.strProjFilePath);
+    const auto& strTargetPath = tJob.bSidecarSnapshot ? strSnapshotPath : tJob.strProjFilePath;
+    if (!WriteFileByReplacing(strTargetPath, strFileData))
     {
-        m_pLogger->Log(Error) << "FAILED to save project json file at '" << projFilePath << "'!" << endl;
+        m_pLogger->Log(Error) << "FAILED to save project json file at '" << strTargetPath << "'!" << endl;
         return FAILED;
     }
+    if (!tJob.bSidecarSnapshot)
+    {
+        // the task dirs referenced by the project file must not be evicted after the project is closed
+        PinBgtaskCacheEntries(tJob.strProjFilePath, tJob.aBgtasks);
+        // the project file covers all the edits in the snapshot now
+        if (SysUtils::IsFile(strSnapshotPath) && !SysUtils::DeleteFileAt(strSnapshotPath))
+            m_pLogger->Log(WARN) << "CANNOT delete the project snapshot at '" << strSnapshotPath << "'!" << endl;
+    }
+    CompactJournal(tJob.strProjFilePath, tJob.i64JournalSeq);
     return OK;
 }
 
+void Project::SaveThreadProc()
+{
+    m_pLogger->Log(DEBUG) << "Enter project saving thread." << endl;
+    unique_lock<mutex> _lk(m_mtxSaveLock);
+    while (true)
+    {
+        m_cvSaveUpdated.wait(_lk, [this] { return m_bQuitSaveThread || m_pPendingSaveJob; });
+        // the pending save is still written on quit
+        if (!m_pPendingSaveJob)
+            break;
+        auto pJob = std::move(m_pPendingSaveJob);
+        m_pSavingJob = pJob.get();
+        m_bSaveInProgress = true;
+        _lk.unlock();
+        ErrorCode eErrCd;
+        if (WaitContentSnapshot(*pJob))
+        {
+            eErrCd = RunSaveJob(*pJob);
+        }
+        else
+        {
+            m_pLogger->Log(WARN) << "Project save request is dropped on quit, the timeline snapshot is NOT taken." << endl;
+            eErrCd = FAILED;
+        }
+        _lk.lock();
+        // the results of the snapshots are not reported, the project file is still unsaved
+        if (!pJob->bSidecarSnapshot)
+            m_eLastSaveResult = eErrCd;
+        m_pSavingJob = nullptr;
+        pJob = nullptr;
+        m_bSaveInProgress = false;
+        m_cvSaveUpdated.notify_all();
+    }
+    m_pLogger->Log(DEBUG) << "Leave project saving thread." << endl;
+}
+
+static int SyncFileToDisk(FILE* fp)
+{
+#if defined(_WIN32)
+    return _commit(_fileno(fp));
+#else
+    return fsync(fileno(fp));
+#endif
+}
+
+Project::ErrorCode Project::AppendJournal(const imgui_json::value& jnEntry)
+{
+    lock_guard<recursive_mutex> _lk(m_mtxApiLock);
+    if (!m_bOpened)
+        return NOT_OPENED;
+    bool bNeedCompact;
+    {
+        lock_guard<mutex> _lk2(m_mtxJournalLock);
+        const auto i64Seq = m_i64JournalSeq+1;
+        imgui_json::value jnLine = jnEntry;
+        jnLine["seq"] = imgui_json::number(i64Seq);
+        auto strLine = jnLine.dump();
+        strLine.push_back('\n');
+        if (!m_fpJournal)
+        {
+            const auto strJournalPath = GetJournalFilePath(m_projFilePath);
+            m_fpJournal = fopen(strJournalPath.c_str(), "ab");
+            if (!m_fpJournal)
+            {
+                m_pLogger->Log(Error) << "FAILED to open project journal at '" << strJournalPath << "'!" << endl;
+                return IO_ERROR;
+            }
+        }
+        if (fwrite(strLine.data(), 1, strLine.size(), m_fpJournal) != strLine.size() || fflush(m_fpJournal) != 0 || SyncFileToDisk(m_fpJournal) != 0)
+        {
+            m_pLogger->Log(Error) << "FAILED to write project journal entry #" << i64Seq << "!" << endl;
+            fclose(m_fpJournal);
+            m_fpJournal = nullptr;
+            return IO_ERROR;
+        }
+        m_i64JournalSeq = i64Seq;
+        m_aJournalLines.push_back({i64Seq, std::move(strLine)});
+        bNeedCompact = m_aJournalLines.size() >= JOURNAL_COMPACT_THRESHOLD;
+    }
+    // the journal is compacted into the sidecar snapshot, the project file is only written when the user saves it
+    if (bNeedCompact && !IsSaving())
+        return RequestSaveJob(true);
+    return OK;
+}
+
+list<imgui_json::value> Project::TakeRecoveredJournal()
+{
+    lock_guard<mutex> _lk(m_mtxJournalLock);
+    list<imgui_json::value> aRecoveredJournal;
+    aRecoveredJournal.swap(m_aRecoveredJournal);
+    return aRecoveredJournal;
+}
+
+void Project::LoadJournal(const string& projFilePath, int64_t i64ProjJournalSeq)
+{
+    lock_guard<mutex> _lk(m_mtxJournalLock);
+    if (m_fpJournal)
+    {
+        fclose(m_fpJournal);
+        m_fpJournal = nullptr;
+    }
+    m_i64JournalSeq = i64ProjJournalSeq;
+    m_aJournalLines.clear();
+    m_aRecoveredJournal.clear();
+    const auto strJournalPath = GetJournalFilePath(projFilePath);
+    if (!SysUtils::IsFile(strJournalPath))
+        return;
+    bool bTruncated = false;
+    {
+        ifstream ifs(strJournalPath, ios::in|ios::binary);
+        string strLine;
+        while (getline(ifs, strLine))
+        {
+            if (strLine.empty())
+                continue;
+            const auto jnEntry = imgui_json::value::parse(strLine);
+            if (!jnEntry.is_object() || !jnEntry.contains("seq") || !jnEntry["seq"].is_number())
+            {
+                // the last entry can be incomplete if the application crashed while writing it
+                m_pLogger->Log(WARN) << "Stop recovering project journal at '" << strJournalPath << "', INVALID entry is found." << endl;
+                bTruncated = true;
+                break;
+            }
+            const int64_t i64Seq = jnEntry["seq"].get<imgui_json::number>();
+            if (i64Seq <= m_i64JournalSeq)
+                continue;
+            m_i64JournalSeq = i64Seq;
+            strLine.push_back('\n');
+            m_aJournalLines.push_back({i64Seq, std::move(strLine)});
+            m_aRecoveredJournal.push_back(jnEntry);
+        }
+    }
+    // drop the broken tail, otherwise the entries appended after it can not be recovered
+    if (bTruncated)
+    {
+        string strContent;
+        for (const auto& tLine : m_aJournalLines)
+            strContent += tLine.second;
+        if (!WriteFileByReplacing(strJournalPath, strContent))
+            m_pLogger->Log(WARN) << "FAILED to truncate project journal at '" << strJournalPath << "'!" << endl;
+    }
+    if (!m_aRecoveredJournal.empty())
+        m_pLogger->Log(INFO) << "Recovered " << m_aRecoveredJournal.size() << " unsaved edit(s) from project journal at '" << strJournalPath << "'." << endl;
+}
+
+void Project::CompactJournal(const string& projFilePath, int64_t i64JournalSeq)
+{
+    lock_guard<mutex> _lk(m_mtxJournalLock);
+    if (m_fpJournal)
+    {
+        fclose(m_fpJournal);
+        m_fpJournal = nullptr;
+    }
+    auto itLine = m_aJournalLines.begin();
+    while (itLine != m_aJournalLines.end() && itLine->first <= i64JournalSeq)
+        itLine = m_aJournalLines.erase(itLine);
+    // keep the entries appended after the snapshot was taken
+    const auto strJournalPath = GetJournalFilePath(projFilePath);
+    if (m_aJournalLines.empty())
+    {
+        if (SysUtils::IsFile(strJournalPath) && !SysUtils::DeleteFileAt(strJournalPath))
+            m_pLogger->Log(WARN) << "CANNOT delete the compacted project journal at '" << strJournalPath << "'!" << endl;
+        return;
+    }
+    string strContent;
+    for (const auto& tLine : m_aJournalLines)
+        strContent += tLine.second;
+    if (!WriteFileByReplacing(strJournalPath, strContent))
+        m_pLogger->Log(WARN) << "FAILED to compact project journal at '" << strJournalPath << "'!" << endl;
+}
+
+void Project::CloseJournal(bool bDiscard)
+{
+    lock_guard<mutex> _lk(m_mtxJournalLock);
+    if (m_fpJournal)
+    {
+        fclose(m_fpJournal);
+        m_fpJournal = nullptr;
+    }
+    const auto strJournalPath = GetJournalFilePath(m_projFilePath);
+    if (bDiscard && !m_aJournalLines.empty() && SysUtils::IsFile(strJournalPath))
+        SysUtils::DeleteFileAt(strJournalPath);
+    const auto strSnapshotPath = GetSnapshotFilePath(m_projFilePath);
+    if (bDiscard && SysUtils::IsFile(strSnapshotPath))
+        SysUtils::DeleteFileAt(strSnapshotPath);
+    m_aJournalLines.clear();
+    m_aRecoveredJournal.clear();
+    m_i64JournalSeq = 0;
+}
+
 Project::ErrorCode Project::Close(bool bSaveBeforeClose)
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return OK;
+    WaitSaveDone();
     list<BackgroundTask::Holder> aBgtaskList;
     {
         lock_guard<mutex> _lk2(m_mtxBgtaskLock);
         aBgtaskList = m_aBgtasks;
-        m_aBgtasks.clear();
     }
+    // let the running tasks reach their checkpoints, so they can be resumed after the project is reopened
     for (auto& hTask : aBgtaskList)
         hTask->Cancel();
+    for (auto& hTask : aBgtaskList)
+    {
+        if (!hTask->IsWaiting())
+            hTask->WaitDone();
+        if (m_hBgtaskScheduler)
+            m_hBgtaskScheduler->RemoveTask(hTask);
+    }
     if (bSaveBeforeClose)
     {
         const auto errcode = Save();
@@ -469,6 +1068,18 @@ Project::ErrorCode Project::Close(bool bSaveBeforeClose)
             return errcode;
         }
     }
+    for (auto& hTask : aBgtaskList)
+        UntrackBgtaskCacheEntry(hTask, false);
+    auto hCacheMgr = GetCacheManager();
+    if (hCacheMgr)
+        hCacheMgr->SaveIndex();
+    {
+        lock_guard<mutex> _lk2(m_mtxBgtaskLock);
+        m_aBgtasks.clear();
+    }
+    // closing without saving drops the unsaved edits, don't let them be recovered next time
+    CloseJournal(!bSaveBeforeClose);
+    m_hContainer = nullptr;
     m_jnProjContent = nullptr;
     m_projDir.clear();
     m_projName.clear();
@@ -485,7 +1096,10 @@ Project::ErrorCode Project::Delete()
     if (!m_bOpened)
         return NOT_OPENED;
     const auto projDir = m_projDir;
+    const auto projFilePath = m_projFilePath;
+    const auto aBgtaskList = GetBackgroundTaskList();
     Close(false);
+    PinBgtaskCacheEntries(projFilePath, {});
     if (SysUtils::IsDirectory(projDir))
     {
         if (!SysUtils::DeleteDirectoryAt(projDir))
@@ -494,21 +1108,23 @@ Project::ErrorCode Project::Delete()
             return IO_ERROR;
         }
     }
+    for (auto& hTask : aBgtaskList)
+        UntrackBgtaskCacheEntry(hTask, true);
     return OK;
 }
 
-void Project::SetBgtaskExecutor(SysUtils::ThreadPoolExecutor::Holder hBgtaskExctor)
+void Project::SetBgtaskScheduler(BgtaskScheduler::Holder hBgtaskScheduler)
 {
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
-    m_hBgtaskExctor = hBgtaskExctor;
-    if (!hBgtaskExctor)
+    m_hBgtaskScheduler = hBgtaskScheduler;
+    if (!hBgtaskScheduler)
         return;
     lock_guard<mutex> _lk2(m_mtxBgtaskLock);
     for (auto& hTask : m_aBgtasks)
     {
         if (hTask->IsWaiting())
         {
-            if (!hBgtaskExctor->EnqueueTask(hTask))
+            if (!hBgtaskScheduler->EnqueueTask(hTask))
                 m_pLogger->Log(Error) << "Enqueue background task FAILED!" << endl;
         }
     }
@@ -532,6 +1148,14 @@ Project::ErrorCode Project::ChangeProjectName(const string& newName)
     if (SysUtils::IsFile(newProjFilePath))
         if (!SysUtils::DeleteFileAt(newProjFilePath))
             m_pLogger->Log(WARN) << "CANNOT delete the old project file at '" << newProjFilePath << "'!" << endl;
+    // all the journal entries are covered by the new project file
+    const auto oldJournalFilePath = GetJournalFilePath(newProjFilePath);
+    if (SysUtils::IsFile(oldJournalFilePath))
+        SysUtils::DeleteFileAt(oldJournalFilePath);
+    const auto oldSnapshotFilePath = GetSnapshotFilePath(newProjFilePath);
+    if (SysUtils::IsFile(oldSnapshotFilePath))
+        SysUtils::DeleteFileAt(oldSnapshotFilePath);
+    PinBgtaskCacheEntries(newProjFilePath, {});
     m_bUntitled = false;
     return OK;
 }
@@ -541,17 +1165,18 @@ Project::ErrorCode Project::EnqueueBackgroundTask(BackgroundTask::Holder hTask)
     lock_guard<recursive_mutex> _lk(m_mtxApiLock);
     if (!m_bOpened)
         return NOT_OPENED;
-    if (!m_hBgtaskExctor)
+    if (!m_hBgtaskScheduler)
     {
-        m_pLogger->Log(Error) << "Current MEC::Project instance has NOT been set with background task executor!" << endl;
+        m_pLogger->Log(Error) << "Current MEC::Project instance has NOT been set with background task scheduler!" << endl;
         return NOT_READY;
     }
-    if (!m_hBgtaskExctor->EnqueueTask(hTask))
+    if (!m_hBgtaskScheduler->EnqueueTask(hTask))
     {
         m_pLogger->Log(Error) << "Enqueue background task FAILED!" << endl;
         return FAILED;
     }
     hTask->SetCallbacks(this);
+    TrackBgtaskCacheEntry(hTask);
     lock_guard<mutex> _lk2(m_mtxBgtaskLock);
     m_aBgtasks.push_back(hTask);
     return OK;
@@ -573,12 +1198,15 @@ Project::ErrorCode Project::RemoveBackgroundTask(BackgroundTask::Holder hTask, b
     if (itRem == m_aBgtasks.end())
         return INVALID_ARG;
     m_aBgtasks.erase(itRem);
+    if (m_hBgtaskScheduler)
+        m_hBgtaskScheduler->RemoveTask(hTask);
     if (bRemoveTaskDir)
     {
         const auto strTaskDir = hTask->GetTaskDir();
         if (!strTaskDir.empty())
             SysUtils::DeleteDirectoryAt(strTaskDir);
     }
+    UntrackBgtaskCacheEntry(hTask, bRemoveTaskDir);
     return OK;
 }
 
@@ -618,9 +1246,13 @@ const imgui_json::value& Project::OnCheckMediaItemMetaData(const std::string& fi
 const uint8_t Project::VER_MAJOR = 1;
 const uint8_t Project::VER_MINOR = 1;
 const string Project::UNTITLED_PROJECT_NAME = "Untitled";
+const size_t Project::JOURNAL_COMPACT_THRESHOLD = 64;
 
 string Project::s_PROJ_FILE_EXT = ".mep";
 string Project::s_CACHEDIR;
+CacheManager::Holder Project::s_hCacheMgr;
+mutex Project::s_mtxCacheMgrLock;
+int64_t Project::s_i64CacheQuota = 0;
 
 string Project::TryCacheDirPath(const string& strParentDir, const string& strCacheDirName)
 {
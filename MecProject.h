@@ -1,8 +1,11 @@
 #pragma once
 #include <cstdint>
+#include <cstdio>
 #include <string>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
 #include <list>
 #include <vector>
 #include <imgui_json.h>
@@ -10,6 +13,9 @@
 #include <Logger.h>
 #include <HwaccelManager.h>
 #include "BackgroundTask.h"
+#include "BgtaskScheduler.h"
+#include "MecCacheManager.h"
+#include "MecProjectContainer.h"
 
 namespace MEC
 {
@@ -38,25 +44,46 @@ public:
     static Holder CreateUntitledProject(ErrorCode& ec);
     static Holder OpenProjectDir(ErrorCode& ec, const std::string& projDir);
     static Holder OpenProjectFile(ErrorCode& ec, const std::string& mepFilePath);
+    ~Project();
 
     static const uint8_t VER_MAJOR;
     static const uint8_t VER_MINOR;
     static const std::string UNTITLED_PROJECT_NAME;
+    static const size_t JOURNAL_COMPACT_THRESHOLD;
 
     static Logger::ALogger* GetDefaultLogger();
     static std::string s_PROJ_FILE_EXT;
     static std::string GetDefaultProjectBaseDir();
     static std::string GetCacheDir();
     static ErrorCode SetCacheDir(const std::string& path);
+    // The cache manager of current cache dir, it's recreated when the cache dir is changed
+    static CacheManager::Holder GetCacheManager();
+    // Size quota of the cache dir in bytes, 0 means unlimited
+    static void SetCacheQuota(int64_t i64Quota);
 
     ErrorCode Move(const std::string& newProjDir, bool overwrite = false);
     ErrorCode Load(const std::string& mepFilePath);
     ErrorCode Save();
     ErrorCode SaveAs(const std::string& newProjName, const std::string& newProjDir, bool overwrite = false);
     ErrorCode SaveTo(const std::string& projFilePath);
+    // The snapshot of the timeline, its serialization and the file writing are all done on the project saving thread.
+    // The snapshot is taken while the timeline edit lock is free, see 'SetTimelineEditLock()', without the lock it's taken
+    // on the calling thread. Requests made while a save is in progress are coalesced, only the latest one is written.
+    ErrorCode SaveAsync();
+    bool IsSaving();
+    // Blocks until all the requested async saves are done, returns the result of the last one
+    ErrorCode WaitSaveDone();
+    // Result of the last finished async save, it doesn't block
+    ErrorCode GetLastSaveResult();
+    // Appends one timeline edit to the journal beside the project file and syncs it to disk. The journal is compacted by
+    // every save, and by a sidecar snapshot beside the project file when it grows long, the project file is only written
+    // by the saves. The snapshot and the entries newer than the project file are recovered by 'Load()', and they are
+    // deleted when the project is closed without saving.
+    ErrorCode AppendJournal(const imgui_json::value& jnEntry);
+    std::list<imgui_json::value> TakeRecoveredJournal();
     ErrorCode Close(bool bSaveBeforeClose = true);
     ErrorCode Delete();
-    void SetBgtaskExecutor(SysUtils::ThreadPoolExecutor::Holder hBgtaskExctor);
+    void SetBgtaskScheduler(BgtaskScheduler::Holder hBgtaskScheduler);
     std::string GetProjectName() const { return m_projName; }
     ErrorCode ChangeProjectName(const std::string& newName);
     std::string GetProjectDir() const { return m_projDir; }
@@ -66,8 +93,16 @@ public:
     uint8_t GetProjectMinorVersion() const { return (uint8_t)((m_projVer>>16)&0xff); }
     bool IsOpened() const { return m_bOpened; }
     bool IsUntitled() const { return m_bUntitled; }
-    void SetContentJson(const imgui_json::value& jnProjContent) { m_jnProjContent = jnProjContent; }
-    const imgui_json::value& GetProjectContentJson() const { return m_jnProjContent; }
+    // Saves the project file as a binary 'ProjectContainer' instead of json, the format of a loaded file is kept by default
+    void SetBinaryFormat(bool bBinary) { m_bBinaryFormat = bBinary; }
+    bool IsBinaryFormat() const { return m_bBinaryFormat; }
+    void SetContentJson(const imgui_json::value& jnProjContent);
+    // The content of a binary project file is decoded on the first call
+    const imgui_json::value& GetProjectContentJson();
+    // Gets one item of the content by its path, like 'MediaBank' or 'TimeLine/MediaClip', nullptr if it doesn't exist.
+    // The item of a binary project file is decoded into 'jnHolder' on each call, without decoding the whole content,
+    // and its 'TimeLine' has only the timeline attributes. Otherwise it points into the content json.
+    const imgui_json::value* GetContentItem(const std::string& strPath, imgui_json::value& jnHolder);
     Project::ErrorCode EnqueueBackgroundTask(BackgroundTask::Holder hTask);
     std::list<BackgroundTask::Holder> GetBackgroundTaskList();
     Project::ErrorCode RemoveBackgroundTask(BackgroundTask::Holder hTask, bool bRemoveTaskDir = true);
@@ -80,32 +115,85 @@ public:
     const imgui_json::value& OnCheckMediaItemMetaData(const std::string& fileUrl, const std::string& metaName) override;
 
     void SetTimelineHandle(void* pHandle) { m_pTlHandle = pHandle; }
+    // The lock held by the thread editing the timeline, it must be set before any async save is requested
+    void SetTimelineEditLock(std::recursive_mutex* pTlEditLock) { m_pTlEditLock = pTlEditLock; }
     void SetLogLevel(Logger::Level l) { m_pLogger->SetShowLevels(l); }
 
 protected:
-    Project() : m_bUntitled(true) {}
+    Project() : m_pLogger(GetDefaultLogger()), m_bUntitled(true) {}
     Project(const std::string& projName, const std::string& projDir, const std::string& mepFileName);
     void SetUntitled() { m_bUntitled = true; }
 
     static std::string s_CACHEDIR;
     static std::string TryCacheDirPath(const std::string& strParentDir, const std::string& strCacheDirName);
+    static CacheManager::Holder s_hCacheMgr;
+    static std::mutex s_mtxCacheMgrLock;
+    static int64_t s_i64CacheQuota;
+
+private:
+    struct _SaveJob
+    {
+        std::string strProjFilePath;
+        imgui_json::value jnProj;
+        std::list<BackgroundTask::Holder> aBgtasks;
+        int64_t i64JournalSeq;
+        bool bBinaryFormat;
+        bool bNeedContentSnapshot{false};
+        bool bSidecarSnapshot{false};
+    };
+    ErrorCode RequestSaveJob(bool bSidecarSnapshot);
+    bool MakeSaveJob(const std::string& projFilePath, _SaveJob& tJob, bool bDeferContentSnapshot = false);
+    void TakeContentSnapshot(_SaveJob& tJob);
+    bool WaitContentSnapshot(_SaveJob& tJob);
+    ErrorCode RunSaveJob(_SaveJob& tJob);
+    void SaveThreadProc();
+    static std::string GetJournalFilePath(const std::string& projFilePath) { return projFilePath+".journal"; }
+    static std::string GetSnapshotFilePath(const std::string& projFilePath) { return projFilePath+".snapshot"; }
+    // With 'phContainer', a binary project file is opened without its content, which is decoded by 'MaterializeContent()'
+    bool ReadProjectFile(const std::string& strFilePath, imgui_json::value& jnProj, bool& bBinaryFormat, ProjectContainer::Holder* phContainer = nullptr);
+    void MaterializeContent();
+    void LoadSnapshot(const std::string& projFilePath, int64_t& i64ProjJournalSeq);
+    void LoadJournal(const std::string& projFilePath, int64_t i64ProjJournalSeq);
+    void CompactJournal(const std::string& projFilePath, int64_t i64JournalSeq);
+    void CloseJournal(bool bDiscard);
+    // The task dirs under the cache dir are accounted by the cache manager, and they are not evicted while the task is in the project
+    void TrackBgtaskCacheEntry(BackgroundTask::Holder hTask);
+    void UntrackBgtaskCacheEntry(BackgroundTask::Holder hTask, bool bRemoved);
+    // The task dirs in a saved project file are pinned by the file, so they are kept after the project is closed
+    static void PinBgtaskCacheEntries(const std::string& projFilePath, const std::list<BackgroundTask::Holder>& aBgtasks);
 
 private:
     Logger::ALogger* m_pLogger;
     bool m_bOpened{false};
     bool m_bUntitled{false};
+    bool m_bBinaryFormat{false};
     std::string m_projName;
     std::string m_projDir;
     std::string m_projFilePath;
     uint32_t m_projVer{0};
     imgui_json::value m_jnProjContent;
+    ProjectContainer::Holder m_hContainer;
     std::recursive_mutex m_mtxApiLock;
     std::list<BackgroundTask::Holder> m_aBgtasks;
     std::mutex m_mtxBgtaskLock;
-    SysUtils::ThreadPoolExecutor::Holder m_hBgtaskExctor;
+    BgtaskScheduler::Holder m_hBgtaskScheduler;
     MediaCore::HwaccelManager::Holder m_hHwMgr;
+    std::thread m_thSaveThread;
+    std::mutex m_mtxSaveLock;
+    std::condition_variable m_cvSaveUpdated;
+    std::unique_ptr<_SaveJob> m_pPendingSaveJob;
+    _SaveJob* m_pSavingJob{nullptr};
+    bool m_bSaveInProgress{false};
+    bool m_bQuitSaveThread{false};
+    ErrorCode m_eLastSaveResult{OK};
+    std::mutex m_mtxJournalLock;
+    FILE* m_fpJournal{nullptr};
+    int64_t m_i64JournalSeq{0};
+    std::list<std::pair<int64_t, std::string>> m_aJournalLines;
+    std::list<imgui_json::value> m_aRecoveredJournal;
 
     // this ugly reference to the TimeLine instance should be removed after global TimeLine pointer is opted out
     void* m_pTlHandle{nullptr};
+    std::recursive_mutex* m_pTlEditLock{nullptr};
 };
 }
\ No newline at end of file
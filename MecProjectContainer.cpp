@@ -0,0 +1,653 @@
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "MecProjectContainer.h"
+
+using namespace std;
+
+namespace MEC
+{
+// Layout of the container file: 'MECP' | u32 container version | u32 project version | u32 section count
+// | {u32 name length, name, u64 offset, u64 size} section table | section payloads
+//
+// Binary json encoding of the payloads: u8 tag followed by the value, numbers are stored as i32 if they are integral
+// and fit in, strings as u32 length + bytes, arrays as u32 count + items, objects as u32 count + {string key, item}.
+// All the integers and the doubles are stored in little-endian, whatever the byte order of the host is.
+enum BinJsonTag : uint8_t
+{
+    BJ_NULL = 0,
+    BJ_FALSE,
+    BJ_TRUE,
+    BJ_INT32,
+    BJ_NUMBER,
+    BJ_STRING,
+    BJ_ARRAY,
+    BJ_OBJECT,
+};
+
+static const char* const SECTION_PROJECT = "project";
+static const char* const SECTION_BGTASKS = "bg_tasks";
+static const char* const SECTION_CONTENT = "content";
+static const char* const SECTION_MEDIABANK = "media_bank";
+static const char* const SECTION_TIMELINE = "timeline";
+static const string SECTION_TIMELINE_LIST_PREFIX = "timeline/";
+static const string TIMELINE_ITEM_PREFIX = "TimeLine/";
+static const int MAX_BINJSON_DEPTH = 256;
+
+static void AppendBytes(string& strBuf, const void* pData, size_t szBytes)
+{
+    strBuf.append((const char*)pData, szBytes);
+}
+
+static void AppendU32(string& strBuf, uint32_t u32Val)
+{
+    for (int i = 0; i < 4; i++)
+        strBuf.push_back((char)(uint8_t)(u32Val>>(i*8)));
+}
+
+static void AppendU64(string& strBuf, uint64_t u64Val)
+{
+    for (int i = 0; i < 8; i++)
+        strBuf.push_back((char)(uint8_t)(u64Val>>(i*8)));
+}
+
+static uint32_t LoadU32(const char* pData)
+{
+    uint32_t u32Val = 0;
+    for (int i = 3; i >= 0; i--)
+        u32Val = (u32Val<<8)|(uint8_t)pData[i];
+    return u32Val;
+}
+
+static uint64_t LoadU64(const char* pData)
+{
+    uint64_t u64Val = 0;
+    for (int i = 7; i >= 0; i--)
+        u64Val = (u64Val<<8)|(uint8_t)pData[i];
+    return u64Val;
+}
+
+static void AppendString(string& strBuf, const string& strVal)
+{
+    AppendU32(strBuf, (uint32_t)strVal.size());
+    strBuf.append(strVal);
+}
+
+static void EncodeBinJson(string& strBuf, const imgui_json::value& jnVal)
+{
+    if (jnVal.is_boolean())
+    {
+        strBuf.push_back(jnVal.get<imgui_json::boolean>() ? BJ_TRUE : BJ_FALSE);
+    }
+    else if (jnVal.is_number())
+    {
+        const double dVal = jnVal.get<imgui_json::number>();
+        if (dVal >= INT32_MIN && dVal <= INT32_MAX && floor(dVal) == dVal)
+        {
+            strBuf.push_back(BJ_INT32);
+            AppendU32(strBuf, (uint32_t)(int32_t)dVal);
+        }
+        else
+        {
+            strBuf.push_back(BJ_NUMBER);
+            uint64_t u64Bits;
+            memcpy(&u64Bits, &dVal, sizeof(dVal));
+            AppendU64(strBuf, u64Bits);
+        }
+    }
+    else if (jnVal.is_string())
+    {
+        strBuf.push_back(BJ_STRING);
+        AppendString(strBuf, jnVal.get<imgui_json::string>());
+    }
+    else if (jnVal.is_array())
+    {
+        const auto& aItems = jnVal.get<imgui_json::array>();
+        strBuf.push_back(BJ_ARRAY);
+        AppendU32(strBuf, (uint32_t)aItems.size());
+        for (const auto& jnItem : aItems)
+            EncodeBinJson(strBuf, jnItem);
+    }
+    else if (jnVal.is_object())
+    {
+        const auto& mapItems = jnVal.get<imgui_json::object>();
+        strBuf.push_back(BJ_OBJECT);
+        AppendU32(strBuf, (uint32_t)mapItems.size());
+        for (const auto& elem : mapItems)
+        {
+            AppendString(strBuf, elem.first);
+            EncodeBinJson(strBuf, elem.second);
+        }
+    }
+    else
+    {
+        strBuf.push_back(BJ_NULL);
+    }
+}
+
+struct BinJsonReader
+{
+    const char* pCur;
+    const char* pEnd;
+
+    bool Read(void* pDst, size_t szBytes)
+    {
+        if ((size_t)(pEnd-pCur) < szBytes)
+            return false;
+        memcpy(pDst, pCur, szBytes);
+        pCur += szBytes;
+        return true;
+    }
+
+    bool ReadU32(uint32_t& u32Val)
+    {
+        char acBytes[4];
+        if (!Read(acBytes, sizeof(acBytes)))
+            return false;
+        u32Val = LoadU32(acBytes);
+        return true;
+    }
+
+    bool ReadU64(uint64_t& u64Val)
+    {
+        char acBytes[8];
+        if (!Read(acBytes, sizeof(acBytes)))
+            return false;
+        u64Val = LoadU64(acBytes);
+        return true;
+    }
+
+    bool ReadString(string& strVal)
+    {
+        uint32_t u32Len;
+        if (!ReadU32(u32Len) || (size_t)(pEnd-pCur) < u32Len)
+            return false;
+        strVal.assign(pCur, u32Len);
+        pCur += u32Len;
+        return true;
+    }
+
+    bool Decode(imgui_json::value& jnVal, int iDepth = 0)
+    {
+        uint8_t u8Tag;
+        if (iDepth > MAX_BINJSON_DEPTH || !Read(&u8Tag, 1))
+            return false;
+        switch (u8Tag)
+        {
+        case BJ_NULL:
+            jnVal = imgui_json::value();
+            return true;
+        case BJ_FALSE:
+        case BJ_TRUE:
+            jnVal = imgui_json::boolean(u8Tag == BJ_TRUE);
+            return true;
+        case BJ_INT32:
+        {
+            uint32_t u32Val;
+            if (!ReadU32(u32Val))
+                return false;
+            jnVal = imgui_json::number((int32_t)u32Val);
+            return true;
+        }
+        case BJ_NUMBER:
+        {
+            uint64_t u64Bits;
+            if (!ReadU64(u64Bits))
+                return false;
+            double dVal;
+            memcpy(&dVal, &u64Bits, sizeof(dVal));
+            jnVal = imgui_json::number(dVal);
+            return true;
+        }
+        case BJ_STRING:
+        {
+            string strVal;
+            if (!ReadString(strVal))
+                return false;
+            jnVal = imgui_json::string(std::move(strVal));
+            return true;
+        }
+        case BJ_ARRAY:
+        {
+            uint32_t u32Count;
+            if (!ReadU32(u32Count) || (size_t)(pEnd-pCur) < u32Count)
+                return false;
+            imgui_json::array aItems(u32Count);
+            for (auto& jnItem : aItems)
+                if (!Decode(jnItem, iDepth+1))
+                    return false;
+            jnVal = imgui_json::value(std::move(aItems));
+            return true;
+        }
+        case BJ_OBJECT:
+        {
+            uint32_t u32Count;
+            if (!ReadU32(u32Count))
+                return false;
+            imgui_json::object mapItems;
+            for (uint32_t i = 0; i < u32Count; i++)
+            {
+                string strKey;
+                if (!ReadString(strKey) || !Decode(mapItems[strKey], iDepth+1))
+                    return false;
+            }
+            jnVal = imgui_json::value(std::move(mapItems));
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+};
+
+// Splits the project json into the container sections, 'AssembleSections()' does the reverse
+static vector<pair<string, imgui_json::value>> SplitSections(const imgui_json::value& jnProj)
+{
+    vector<pair<string, imgui_json::value>> aSections;
+    imgui_json::object mapProjAttrs;
+    if (jnProj.is_object())
+    {
+        for (const auto& elem : jnProj.get<imgui_json::object>())
+        {
+            if (elem.first != "proj_content" && elem.first != SECTION_BGTASKS)
+                mapProjAttrs[elem.first] = elem.second;
+        }
+    }
+    aSections.push_back({SECTION_PROJECT, imgui_json::value(std::move(mapProjAttrs))});
+    if (jnProj.contains(SECTION_BGTASKS))
+        aSections.push_back({SECTION_BGTASKS, jnProj[SECTION_BGTASKS]});
+    if (!jnProj.contains("proj_content"))
+        return aSections;
+
+    const auto& jnContent = jnProj["proj_content"];
+    if (!jnContent.is_object())
+    {
+        aSections.push_back({SECTION_CONTENT, jnContent});
+        return aSections;
+    }
+    imgui_json::object mapOtherContent;
+    for (const auto& elem : jnContent.get<imgui_json::object>())
+    {
+        if (elem.first == "MediaBank")
+        {
+            aSections.push_back({SECTION_MEDIABANK, elem.second});
+        }
+        else if (elem.first == "TimeLine" && elem.second.is_object())
+        {
+            // the big lists of the timeline go to their own sections
+            imgui_json::object mapTlAttrs;
+            for (const auto& tlElem : elem.second.get<imgui_json::object>())
+            {
+                if (tlElem.second.is_array())
+                    aSections.push_back({SECTION_TIMELINE_LIST_PREFIX+tlElem.first, tlElem.second});
+                else
+                    mapTlAttrs[tlElem.first] = tlElem.second;
+            }
+            aSections.push_back({SECTION_TIMELINE, imgui_json::value(std::move(mapTlAttrs))});
+        }
+        else
+        {
+            mapOtherContent[elem.first] = elem.second;
+        }
+    }
+    if (!mapOtherContent.empty())
+        aSections.push_back({SECTION_CONTENT, imgui_json::value(std::move(mapOtherContent))});
+    return aSections;
+}
+
+class ProjectContainer_Impl : public ProjectContainer
+{
+public:
+    ~ProjectContainer_Impl()
+    {
+        UnmapFile();
+    }
+
+    bool Open(const string& strFilePath)
+    {
+        m_strFilePath = strFilePath;
+        if (!MapFile(strFilePath))
+        {
+            m_errMsg = "CANNOT map file '"+strFilePath+"'!";
+            return false;
+        }
+        BinJsonReader tReader{m_pFileData, m_pFileData+m_u64FileSize};
+        char acMagic[4];
+        uint32_t u32Version, u32SectionCnt;
+        if (!tReader.Read(acMagic, sizeof(acMagic)) || memcmp(acMagic, FILE_MAGIC, 4) != 0
+            || !tReader.ReadU32(u32Version) || !tReader.ReadU32(m_u32ProjVer) || !tReader.ReadU32(u32SectionCnt))
+        {
+            m_errMsg = "File '"+strFilePath+"' is NOT a project container!";
+            return false;
+        }
+        if (u32Version != FILE_VERSION)
+        {
+            ostringstream oss; oss << "UNSUPPORTED project container version " << u32Version << "!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        for (uint32_t i = 0; i < u32SectionCnt; i++)
+        {
+            string strName;
+            _SectionEntry tEntry;
+            if (!tReader.ReadString(strName) || !tReader.ReadU64(tEntry.u64Offset) || !tReader.ReadU64(tEntry.u64Size)
+                || tEntry.u64Offset > m_u64FileSize || tEntry.u64Size > m_u64FileSize-tEntry.u64Offset)
+                break;
+            m_aSectionNames.push_back(strName);
+            m_mapSections[strName] = tEntry;
+        }
+        if (m_mapSections.size() != u32SectionCnt)
+        {
+            m_errMsg = "Section table of project container '"+strFilePath+"' is BROKEN!";
+            return false;
+        }
+        return true;
+    }
+
+    uint32_t GetProjectVersion() const override
+    {
+        return m_u32ProjVer;
+    }
+
+    vector<string> GetSectionNames() const override
+    {
+        return m_aSectionNames;
+    }
+
+    bool GetSection(const string& strName, imgui_json::value& jnSection) override
+    {
+        auto itSection = m_mapSections.find(strName);
+        if (itSection == m_mapSections.end())
+        {
+            m_errMsg = "Section '"+strName+"' does NOT exist!";
+            return false;
+        }
+        const auto& tEntry = itSection->second;
+        const char* pPayload = m_pFileData+tEntry.u64Offset;
+        BinJsonReader tReader{pPayload, pPayload+tEntry.u64Size};
+        if (!tReader.Decode(jnSection))
+        {
+            m_errMsg = "FAILED to decode section '"+strName+"' of project container '"+m_strFilePath+"'!";
+            return false;
+        }
+        return true;
+    }
+
+    bool GetContentItem(const string& strPath, imgui_json::value& jnItem) override
+    {
+        jnItem = imgui_json::value();
+        string strSection;
+        if (strPath == "MediaBank")
+            strSection = SECTION_MEDIABANK;
+        else if (strPath == "TimeLine")
+            strSection = SECTION_TIMELINE;
+        else if (strPath.compare(0, TIMELINE_ITEM_PREFIX.size(), TIMELINE_ITEM_PREFIX) == 0)
+            strSection = SECTION_TIMELINE_LIST_PREFIX+strPath.substr(TIMELINE_ITEM_PREFIX.size());
+        if (!strSection.empty())
+            return m_mapSections.count(strSection) == 0 || GetSection(strSection, jnItem);
+        // the other items are kept together in the 'content' section
+        if (m_mapSections.count(SECTION_CONTENT) == 0)
+            return true;
+        imgui_json::value jnContent;
+        if (!GetSection(SECTION_CONTENT, jnContent))
+            return false;
+        if (jnContent.is_object() && jnContent.contains(strPath))
+            jnItem = std::move(jnContent[strPath]);
+        return true;
+    }
+
+    bool ToJson(imgui_json::value& jnProj) override
+    {
+        if (!HeaderToJson(jnProj))
+            return false;
+        imgui_json::value jnContent;
+        if (!ContentToJson(jnContent))
+            return false;
+        if (!jnContent.is_null())
+            jnProj["proj_content"] = std::move(jnContent);
+        return true;
+    }
+
+    bool HeaderToJson(imgui_json::value& jnProj) override
+    {
+        if (!GetSection(SECTION_PROJECT, jnProj) || !jnProj.is_object())
+            return false;
+        if (m_mapSections.count(SECTION_BGTASKS))
+        {
+            if (!GetSection(SECTION_BGTASKS, jnProj[SECTION_BGTASKS]))
+                return false;
+        }
+        return true;
+    }
+
+    bool ContentToJson(imgui_json::value& jnContent) override
+    {
+        jnContent = imgui_json::value();
+        if (m_mapSections.count(SECTION_CONTENT))
+        {
+            if (!GetSection(SECTION_CONTENT, jnContent))
+                return false;
+            if (!jnContent.is_object())
+                return true;
+        }
+        // the sections are decoded in place, so each of them exists only once in memory
+        if (m_mapSections.count(SECTION_MEDIABANK))
+        {
+            if (!GetSection(SECTION_MEDIABANK, jnContent["MediaBank"]))
+                return false;
+        }
+        if (m_mapSections.count(SECTION_TIMELINE))
+        {
+            auto& jnTimeLine = jnContent["TimeLine"];
+            if (!GetSection(SECTION_TIMELINE, jnTimeLine))
+                return false;
+            for (const auto& strName : m_aSectionNames)
+            {
+                if (strName.compare(0, SECTION_TIMELINE_LIST_PREFIX.size(), SECTION_TIMELINE_LIST_PREFIX) != 0)
+                    continue;
+                if (!GetSection(strName, jnTimeLine[strName.substr(SECTION_TIMELINE_LIST_PREFIX.size())]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+private:
+    bool MapFile(const string& strFilePath)
+    {
+#if defined(_WIN32)
+        m_hFile = CreateFileA(strFilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_hFile == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER liFileSize;
+        if (!GetFileSizeEx(m_hFile, &liFileSize) || liFileSize.QuadPart <= 0)
+            return false;
+        m_u64FileSize = (uint64_t)liFileSize.QuadPart;
+        m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!m_hMapping)
+            return false;
+        m_pFileData = (const char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+        return m_pFileData != nullptr;
+#else
+        const int fd = open(strFilePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat tStat;
+        if (fstat(fd, &tStat) != 0 || tStat.st_size <= 0)
+        {
+            close(fd);
+            return false;
+        }
+        m_u64FileSize = (uint64_t)tStat.st_size;
+        // the mapping stays valid after the descriptor is closed
+        void* pData = mmap(nullptr, (size_t)m_u64FileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (pData == MAP_FAILED)
+            return false;
+        m_pFileData = (const char*)pData;
+        return true;
+#endif
+    }
+
+    void UnmapFile()
+    {
+#if defined(_WIN32)
+        if (m_pFileData)
+            UnmapViewOfFile(m_pFileData);
+        if (m_hMapping)
+            CloseHandle(m_hMapping);
+        if (m_hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(m_hFile);
+        m_hMapping = NULL;
+        m_hFile = INVALID_HANDLE_VALUE;
+#else
+        if (m_pFileData)
+            munmap((void*)m_pFileData, (size_t)m_u64FileSize);
+#endif
+        m_pFileData = nullptr;
+        m_u64FileSize = 0;
+    }
+
+private:
+    struct _SectionEntry
+    {
+        uint64_t u64Offset{0};
+        uint64_t u64Size{0};
+    };
+
+    string m_strFilePath;
+#if defined(_WIN32)
+    HANDLE m_hFile{INVALID_HANDLE_VALUE};
+    HANDLE m_hMapping{NULL};
+#endif
+    const char* m_pFileData{nullptr};
+    uint64_t m_u64FileSize{0};
+    uint32_t m_u32ProjVer{0};
+    vector<string> m_aSectionNames;
+    map<string, _SectionEntry> m_mapSections;
+    string m_errMsg;
+};
+
+const char ProjectContainer::FILE_MAGIC[] = "MECP";
+const uint32_t ProjectContainer::FILE_VERSION = 1;
+
+static const auto PROJECT_CONTAINER_DELETER = [] (ProjectContainer* p) {
+    ProjectContainer_Impl* ptr = dynamic_cast<ProjectContainer_Impl*>(p);
+    delete ptr;
+};
+
+ProjectContainer::Holder ProjectContainer::Open(const string& strFilePath, string& strErrMsg)
+{
+    auto p = new ProjectContainer_Impl();
+    if (!p->Open(strFilePath))
+    {
+        strErrMsg = p->GetError();
+        delete p;
+        return nullptr;
+    }
+    return ProjectContainer::Holder(p, PROJECT_CONTAINER_DELETER);
+}
+
+bool ProjectContainer::IsContainerFile(const string& strFilePath)
+{
+    ifstream ifs(strFilePath, ios::in|ios::binary);
+    char acMagic[4];
+    ifs.read(acMagic, 4);
+    return ifs.good() && memcmp(acMagic, FILE_MAGIC, 4) == 0;
+}
+
+string ProjectContainer::Encode(const imgui_json::value& jnProj)
+{
+    const auto aSections = SplitSections(jnProj);
+    vector<string> aPayloads;
+    aPayloads.reserve(aSections.size());
+    for (const auto& tSection : aSections)
+    {
+        string strPayload;
+        EncodeBinJson(strPayload, tSection.second);
+        aPayloads.push_back(std::move(strPayload));
+    }
+
+    uint64_t u64Offset = 4+sizeof(uint32_t)*3;
+    for (const auto& tSection : aSections)
+        u64Offset += sizeof(uint32_t)+tSection.first.size()+sizeof(uint64_t)*2;
+    const uint32_t u32ProjVer = jnProj.contains("mec_proj_version") && jnProj["mec_proj_version"].is_number() ?
+            (uint32_t)jnProj["mec_proj_version"].get<imgui_json::number>() : 0;
+    string strData;
+    AppendBytes(strData, FILE_MAGIC, 4);
+    AppendU32(strData, FILE_VERSION);
+    AppendU32(strData, u32ProjVer);
+    AppendU32(strData, (uint32_t)aSections.size());
+    for (size_t i = 0; i < aSections.size(); i++)
+    {
+        const uint64_t u64Size = aPayloads[i].size();
+        AppendString(strData, aSections[i].first);
+        AppendU64(strData, u64Offset);
+        AppendU64(strData, u64Size);
+        u64Offset += u64Size;
+    }
+    for (const auto& strPayload : aPayloads)
+        strData.append(strPayload);
+    return strData;
+}
+
+bool ProjectContainer::ConvertFile(const string& strSrcPath, const string& strDstPath, bool bToBinary, string& strErrMsg)
+{
+    imgui_json::value jnProj;
+    if (IsContainerFile(strSrcPath))
+    {
+        auto hContainer = Open(strSrcPath, strErrMsg);
+        if (!hContainer)
+            return false;
+        if (!hContainer->ToJson(jnProj))
+        {
+            strErrMsg = hContainer->GetError();
+            return false;
+        }
+    }
+    else
+    {
+        auto res = imgui_json::value::load(strSrcPath);
+        if (!res.second)
+        {
+            strErrMsg = "FAILED to parse project json from '"+strSrcPath+"'!";
+            return false;
+        }
+        jnProj = std::move(res.first);
+    }
+    if (!bToBinary)
+    {
+        if (!jnProj.save(strDstPath))
+        {
+            strErrMsg = "FAILED to save project json file at '"+strDstPath+"'!";
+            return false;
+        }
+        return true;
+    }
+    const auto strData = Encode(jnProj);
+    ofstream ofs(strDstPath, ios::out|ios::binary|ios::trunc);
+    ofs.write(strData.data(), strData.size());
+    if (!ofs.good())
+    {
+        strErrMsg = "FAILED to write project container at '"+strDstPath+"'!";
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <imgui_json.h>
+
+namespace MEC
+{
+    // Binary layout of the project file. The project json is split into sections: the project attributes, the
+    // background task list, the media bank, the timeline attributes and one section per timeline list (clips, tracks,
+    // groups, overlaps). Each section is encoded as binary json, and it's only decoded when it's accessed. The file is
+    // memory mapped while the container is open, the sections are decoded from the mapped bytes into the caller's json.
+    struct ProjectContainer
+    {
+        using Holder = std::shared_ptr<ProjectContainer>;
+        // Returns nullptr if 'strFilePath' is not a valid container file, the reason is put into 'strErrMsg'
+        static Holder Open(const std::string& strFilePath, std::string& strErrMsg);
+        static bool IsContainerFile(const std::string& strFilePath);
+        // Encodes the project json, which has the same layout as the json project file, into the container data
+        static std::string Encode(const imgui_json::value& jnProj);
+        // Converts a project file between the json and the binary format, the format of the source file is detected
+        static bool ConvertFile(const std::string& strSrcPath, const std::string& strDstPath, bool bToBinary, std::string& strErrMsg);
+
+        static const char FILE_MAGIC[];
+        static const uint32_t FILE_VERSION;
+
+        virtual uint32_t GetProjectVersion() const = 0;
+        virtual std::vector<std::string> GetSectionNames() const = 0;
+        // The section is decoded on each call, the container doesn't keep the decoded json
+        virtual bool GetSection(const std::string& strName, imgui_json::value& jnSection) = 0;
+        // Decodes one item of 'proj_content': 'MediaBank', 'TimeLine' which has only the timeline attributes here, or
+        // one timeline list as 'TimeLine/<list name>'. 'jnItem' is null if the project has no such item.
+        virtual bool GetContentItem(const std::string& strPath, imgui_json::value& jnItem) = 0;
+        // Decodes all the sections and assembles them into the json project layout
+        virtual bool ToJson(imgui_json::value& jnProj) = 0;
+        // The json project layout without 'proj_content', only the small sections are decoded
+        virtual bool HeaderToJson(imgui_json::value& jnProj) = 0;
+        // Assembles the 'proj_content' of the json project layout, it's null if the project has no content
+        virtual bool ContentToJson(imgui_json::value& jnContent) = 0;
+        virtual std::string GetError() const = 0;
+    };
+}
@@ -0,0 +1,333 @@
+#include <vector>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <ThreadUtils.h>
+#include <Logger.h>
+#include "MecTracer.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+struct _TraceEvent
+{
+    const char* pcName{nullptr};
+    int64_t i64BeginNs{0};
+    int64_t i64DurNs{-1};   // negative value means an instant event
+};
+
+struct _ThreadBuffer
+{
+    // the members below are guarded by the registry lock, the trace tid is never reused and identifies the thread
+    thread::id tThreadId;
+    uint32_t u32TraceTid{0};
+    string strThreadName;
+    bool bRetired{false};
+    vector<_TraceEvent> aEvents;
+    // only the owner thread increases it, the exporter reads it before and after copying the events
+    atomic_uint64_t u64WriteCount{0};
+    atomic_uint64_t u64ClearedCount{0};
+};
+
+// Retires the buffer when its owner thread exits, the retired buffers are kept for the export and reused by the new threads
+struct _ThreadBufferOwner
+{
+    ~_ThreadBufferOwner();
+    shared_ptr<_ThreadBuffer> hBuffer;
+};
+
+static mutex s_mtxRegistryLock;
+static list<shared_ptr<_ThreadBuffer>> s_aThreadBuffers;
+// names given to the threads which have not recorded any event yet
+static unordered_map<thread::id, string> s_mapPendingThreadNames;
+static size_t s_szRetiredCount = 0;
+static uint32_t s_u32NextTraceTid = 1;
+static const Tracer::Clock::time_point s_tpTraceBase = Tracer::Clock::now();
+static thread_local _ThreadBufferOwner t_tBufferOwner;
+
+static bool _IsEnabledByEnv()
+{
+    const char* pcEnv = getenv(Tracer::ENV_VAR_NAME.c_str());
+    return pcEnv && strlen(pcEnv) > 0 && strcmp(pcEnv, "0") != 0;
+}
+
+const size_t Tracer::EVENTS_PER_THREAD = 32768;
+const size_t Tracer::MAX_RETIRED_BUFFERS = 8;
+const std::string Tracer::ENV_VAR_NAME = "MEC_TRACE";
+std::atomic_bool Tracer::s_bEnabled{_IsEnabledByEnv()};
+
+// must be called with the registry lock held
+static void _EraseOldestRetiredBuffer()
+{
+    auto itBuffer = find_if(s_aThreadBuffers.begin(), s_aThreadBuffers.end(), [] (const shared_ptr<_ThreadBuffer>& hBuffer) { return hBuffer->bRetired; });
+    if (itBuffer != s_aThreadBuffers.end())
+    {
+        s_aThreadBuffers.erase(itBuffer);
+        s_szRetiredCount--;
+    }
+}
+
+_ThreadBufferOwner::~_ThreadBufferOwner()
+{
+    if (!hBuffer)
+        return;
+    lock_guard<mutex> lk(s_mtxRegistryLock);
+    hBuffer->bRetired = true;
+    s_szRetiredCount++;
+    hBuffer = nullptr;
+    while (s_szRetiredCount > Tracer::MAX_RETIRED_BUFFERS)
+        _EraseOldestRetiredBuffer();
+}
+
+static _ThreadBuffer* _GetThreadBuffer()
+{
+    auto& hThreadBuffer = t_tBufferOwner.hBuffer;
+    if (!hThreadBuffer)
+    {
+        const auto tThreadId = this_thread::get_id();
+        lock_guard<mutex> lk(s_mtxRegistryLock);
+        shared_ptr<_ThreadBuffer> hBuffer;
+        if (s_szRetiredCount >= Tracer::MAX_RETIRED_BUFFERS)
+        {
+            // reuse the oldest retired buffer instead of allocating a new one, unless an export is still reading it
+            auto itBuffer = find_if(s_aThreadBuffers.begin(), s_aThreadBuffers.end(), [] (const shared_ptr<_ThreadBuffer>& h) { return h->bRetired; });
+            if (itBuffer != s_aThreadBuffers.end() && itBuffer->use_count() <= 1)
+            {
+                hBuffer = *itBuffer;
+                s_aThreadBuffers.erase(itBuffer);
+                s_szRetiredCount--;
+                hBuffer->bRetired = false;
+                hBuffer->strThreadName.clear();
+                hBuffer->u64WriteCount.store(0, memory_order_relaxed);
+                hBuffer->u64ClearedCount.store(0, memory_order_relaxed);
+            }
+        }
+        if (!hBuffer)
+        {
+            hBuffer = make_shared<_ThreadBuffer>();
+            hBuffer->aEvents.resize(Tracer::EVENTS_PER_THREAD);
+        }
+        hBuffer->tThreadId = tThreadId;
+        hBuffer->u32TraceTid = s_u32NextTraceTid++;
+        auto itName = s_mapPendingThreadNames.find(tThreadId);
+        if (itName != s_mapPendingThreadNames.end())
+        {
+            hBuffer->strThreadName = std::move(itName->second);
+            s_mapPendingThreadNames.erase(itName);
+        }
+        s_aThreadBuffers.push_back(hBuffer);
+        hThreadBuffer = hBuffer;
+    }
+    return hThreadBuffer.get();
+}
+
+// must be called with the registry lock held
+static void _SetThreadName(const thread::id& tThreadId, const string& strName)
+{
+    for (auto& hBuffer : s_aThreadBuffers)
+    {
+        if (!hBuffer->bRetired && hBuffer->tThreadId == tThreadId)
+        {
+            hBuffer->strThreadName = strName;
+            return;
+        }
+    }
+    s_mapPendingThreadNames[tThreadId] = strName;
+}
+
+static void _RecordEvent(const _TraceEvent& tEvent)
+{
+    auto pBuffer = _GetThreadBuffer();
+    const auto u64Idx = pBuffer->u64WriteCount.load(memory_order_relaxed);
+    pBuffer->aEvents[u64Idx%Tracer::EVENTS_PER_THREAD] = tEvent;
+    pBuffer->u64WriteCount.store(u64Idx+1, memory_order_release);
+}
+
+static int64_t _ToTraceNs(const Tracer::Clock::time_point& tp)
+{
+    return chrono::duration_cast<chrono::nanoseconds>(tp-s_tpTraceBase).count();
+}
+
+static void _WriteJsonString(ostream& os, const string& str)
+{
+    os << '"';
+    for (auto c : str)
+    {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            os << ' ';
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+static void _WriteTimeUs(ostream& os, int64_t i64Ns)
+{
+    os << i64Ns/1000 << '.' << (char)('0'+(i64Ns%1000)/100) << (char)('0'+(i64Ns%100)/10) << (char)('0'+i64Ns%10);
+}
+
+void Tracer::SetEnabled(bool bEnable)
+{
+    const bool bPrevEnabled = s_bEnabled.exchange(bEnable);
+    if (bPrevEnabled != bEnable)
+        Log(INFO) << "Tracing is " << (bEnable ? "enabled" : "disabled") << "." << endl;
+}
+
+void Tracer::NameThread(std::thread& th, const std::string& strName)
+{
+    SysUtils::SetThreadName(th, strName);
+    lock_guard<mutex> lk(s_mtxRegistryLock);
+    _SetThreadName(th.get_id(), strName);
+}
+
+void Tracer::NameCurrentThread(const std::string& strName)
+{
+    lock_guard<mutex> lk(s_mtxRegistryLock);
+    _SetThreadName(this_thread::get_id(), strName);
+}
+
+void Tracer::AddCompleteEvent(const char* pcName, const Clock::time_point& tpBegin, const Clock::time_point& tpEnd)
+{
+    _TraceEvent tEvent;
+    tEvent.pcName = pcName;
+    tEvent.i64BeginNs = _ToTraceNs(tpBegin);
+    tEvent.i64DurNs = chrono::duration_cast<chrono::nanoseconds>(tpEnd-tpBegin).count();
+    _RecordEvent(tEvent);
+}
+
+void Tracer::AddInstantEvent(const char* pcName)
+{
+    if (!IsEnabled())
+        return;
+    _TraceEvent tEvent;
+    tEvent.pcName = pcName;
+    tEvent.i64BeginNs = _ToTraceNs(Clock::now());
+    _RecordEvent(tEvent);
+}
+
+bool Tracer::ExportChromeTrace(const std::string& strFilePath, std::string& strErrMsg)
+{
+    struct _BufferRef
+    {
+        shared_ptr<_ThreadBuffer> hBuffer;
+        uint32_t u32TraceTid;
+        string strThreadName;
+    };
+    list<_BufferRef> aThreadBuffers;
+    {
+        // a referenced buffer is not reused, its tid and name are copied since they are guarded by the lock
+        lock_guard<mutex> lk(s_mtxRegistryLock);
+        for (auto& hBuffer : s_aThreadBuffers)
+            aThreadBuffers.push_back({hBuffer, hBuffer->u32TraceTid, hBuffer->strThreadName});
+    }
+
+    ofstream ofs(strFilePath, ios::out|ios::trunc);
+    if (!ofs.is_open())
+    {
+        ostringstream oss; oss << "FAILED to open file '" << strFilePath << "' for writing!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool bFirst = true;
+    size_t szEventCount = 0;
+    vector<_TraceEvent> aEvents;
+    for (auto& tRef : aThreadBuffers)
+    {
+        auto& hBuffer = tRef.hBuffer;
+        const auto u64Count1 = hBuffer->u64WriteCount.load(memory_order_acquire);
+        const uint64_t u64ClearedCount = hBuffer->u64ClearedCount.load(memory_order_relaxed);
+        uint64_t u64Start = u64Count1 > EVENTS_PER_THREAD ? u64Count1-EVENTS_PER_THREAD : 0;
+        if (u64Start < u64ClearedCount)
+            u64Start = u64ClearedCount;
+        aEvents.clear();
+        for (auto i = u64Start; i < u64Count1; i++)
+            aEvents.push_back(hBuffer->aEvents[i%EVENTS_PER_THREAD]);
+        // the owner thread keeps recording while copying, drop the slots that may have been overwritten
+        const auto u64Count2 = hBuffer->u64WriteCount.load(memory_order_acquire);
+        const uint64_t u64SafeStart = u64Count2 > EVENTS_PER_THREAD ? u64Count2-EVENTS_PER_THREAD : 0;
+        const size_t szSkip = u64SafeStart > u64Start ? (size_t)min<uint64_t>(u64SafeStart-u64Start, aEvents.size()) : 0;
+
+        if (!tRef.strThreadName.empty())
+        {
+            if (!bFirst) ofs << ",";
+            bFirst = false;
+            ofs << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tRef.u32TraceTid << ",\"args\":{\"name\":";
+            _WriteJsonString(ofs, tRef.strThreadName);
+            ofs << "}}";
+        }
+        for (auto i = szSkip; i < aEvents.size(); i++)
+        {
+            const auto& tEvent = aEvents[i];
+            if (!tEvent.pcName)
+                continue;
+            if (!bFirst) ofs << ",";
+            bFirst = false;
+            ofs << "\n{\"name\":";
+            _WriteJsonString(ofs, tEvent.pcName);
+            if (tEvent.i64DurNs >= 0)
+            {
+                ofs << ",\"ph\":\"X\",\"ts\":"; _WriteTimeUs(ofs, tEvent.i64BeginNs);
+                ofs << ",\"dur\":"; _WriteTimeUs(ofs, tEvent.i64DurNs);
+            }
+            else
+            {
+                ofs << ",\"ph\":\"i\",\"s\":\"t\",\"ts\":"; _WriteTimeUs(ofs, tEvent.i64BeginNs);
+            }
+            ofs << ",\"pid\":1,\"tid\":" << tRef.u32TraceTid << "}";
+            szEventCount++;
+        }
+    }
+    ofs << "\n]}\n";
+    ofs.close();
+    if (ofs.fail())
+    {
+        ostringstream oss; oss << "FAILED to write trace into file '" << strFilePath << "'!";
+        strErrMsg = oss.str();
+        return false;
+    }
+    Log(INFO) << "Exported " << szEventCount << " trace events of " << aThreadBuffers.size() << " threads into '" << strFilePath << "'." << endl;
+    return true;
+}
+
+void Tracer::Clear()
+{
+    lock_guard<mutex> lk(s_mtxRegistryLock);
+    // the buffers of the exited threads are released
+    auto itBuffer = s_aThreadBuffers.begin();
+    while (itBuffer != s_aThreadBuffers.end())
+    {
+        auto& hBuffer = *itBuffer;
+        if (hBuffer->bRetired)
+        {
+            itBuffer = s_aThreadBuffers.erase(itBuffer);
+            continue;
+        }
+        hBuffer->u64ClearedCount.store(hBuffer->u64WriteCount.load(memory_order_acquire), memory_order_relaxed);
+        itBuffer++;
+    }
+    s_szRetiredCount = 0;
+}
+
+size_t Tracer::GetRecordedEventCount()
+{
+    lock_guard<mutex> lk(s_mtxRegistryLock);
+    size_t szCount = 0;
+    for (auto& hBuffer : s_aThreadBuffers)
+    {
+        const auto u64Count = hBuffer->u64WriteCount.load(memory_order_acquire);
+        const uint64_t u64Start = max<uint64_t>(u64Count > EVENTS_PER_THREAD ? u64Count-EVENTS_PER_THREAD : 0, hBuffer->u64ClearedCount.load(memory_order_relaxed));
+        szCount += (size_t)(u64Count-u64Start);
+    }
+    return szCount;
+}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace MEC
+{
+    // Low overhead tracing which is always compiled in and switched on/off at runtime. Each thread records its events
+    // into a thread-local ring buffer, only the latest events are kept. When a thread exits its buffer is retired, at most
+    // 'MAX_RETIRED_BUFFERS' retired buffers are kept for the export, and they are reused by the newly started threads.
+    // The recorded events can be exported as a Chrome trace json file, which can be opened with 'chrome://tracing' or
+    // 'https://ui.perfetto.dev'.
+    // The event names are stored as pointers, they must be string literals or strings living until the process exits.
+    struct Tracer
+    {
+        using Clock = std::chrono::steady_clock;
+
+        static void SetEnabled(bool bEnable);
+        static bool IsEnabled() { return s_bEnabled.load(std::memory_order_relaxed); }
+        // Sets the system thread name, and the name of this thread in the exported trace
+        static void NameThread(std::thread& th, const std::string& strName);
+        static void NameCurrentThread(const std::string& strName);
+
+        static void AddCompleteEvent(const char* pcName, const Clock::time_point& tpBegin, const Clock::time_point& tpEnd);
+        static void AddInstantEvent(const char* pcName);
+        // Writes the events of all the threads into 'strFilePath', the recording is not interrupted
+        static bool ExportChromeTrace(const std::string& strFilePath, std::string& strErrMsg);
+        static void Clear();
+        static size_t GetRecordedEventCount();
+
+        // Records one complete event from its construction to its destruction
+        class Scope
+        {
+        public:
+            Scope(const char* pcName) : m_pcName(pcName), m_bActive(IsEnabled())
+            {
+                if (m_bActive)
+                    m_tpBegin = Clock::now();
+            }
+            ~Scope()
+            {
+                if (m_bActive)
+                    AddCompleteEvent(m_pcName, m_tpBegin, Clock::now());
+            }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            const char* m_pcName;
+            bool m_bActive;
+            Clock::time_point m_tpBegin;
+        };
+
+        static const size_t EVENTS_PER_THREAD;
+        static const size_t MAX_RETIRED_BUFFERS;
+        static const std::string ENV_VAR_NAME;
+
+    private:
+        static std::atomic_bool s_bEnabled;
+    };
+}
+
+#define MEC_TRACE_CONCAT_INNER(a, b) a##b
+#define MEC_TRACE_CONCAT(a, b) MEC_TRACE_CONCAT_INNER(a, b)
+#define MEC_TRACE_SCOPE(name) MEC::Tracer::Scope MEC_TRACE_CONCAT(_mecTraceScope, __LINE__)(name)
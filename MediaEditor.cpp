@@ -35,8 +35,12 @@
 #include <ThreadUtils.h>
 #include <MatUtilsImVecHelper.h>
 #include "MecProject.h"
+#include "MecTracer.h"
+#include "MecMemoryTracker.h"
+#include "MecAsyncLog.h"
 #include "MediaTimeline.h"
 #include "EventStackFilter.h"
+#include "FrameBufferPool.h"
 #include "MediaEncoder.h"
 #include "HwaccelManager.h"
 #include "TextureManager.h"
@@ -47,6 +51,7 @@
 #include "DebugHelper.h"
 #include <sstream>
 #include <iomanip>
+#include <ctime>
 #include <getopt.h>
 #if !IMGUI_APPLICATION_PLATFORM_SDL2
 #include <SDL.h>
@@ -422,6 +427,10 @@ struct MediaEditorSettings
     std::string project_path;               // Editor Recently project file path
     int BankViewStyle {1};                  // Bank view style type, 0 = icons, 1 = tree vide, and ... 
     bool ShowHelpTooltips {false};          // Show UI help tool tips
+    bool ProjectBinaryFormat {false};       // Save project file in binary container format instead of json
+    int CacheQuotaGB {0};                   // Cache directory size quota in GB, 0 = unlimited
+    int FrameBufferPoolMB {1024};           // Capacity of the frame buffer pool in MB
+    std::map<std::string, int> MemorySoftLimitsMB; // Memory soft limits of the subsystems in MB
 
     // clip filter editor layout
     float video_clip_timeline_height {0.5}; // video clip filter view timelime height
@@ -565,11 +574,13 @@ struct MediaEditorSettings
 
 static MEC::Project::Holder g_hProject;
 static SysUtils::ThreadPoolExecutor::Holder g_hBgtaskExctor;
+static MEC::BgtaskScheduler::Holder g_hBgtaskScheduler;
 static std::string ini_file = "Media_Editor.ini";
 static std::string icon_file;
 static std::vector<std::string> import_url;    // import file url from system drag
 static short main_mon = 0;
 static TimeLine * timeline = nullptr;
+static std::recursive_mutex g_timeline_edit_lock;  // held while a frame is running, the async project save takes its snapshot in between
 static ImTextureID codewin_texture = nullptr;
 static ImTextureID logo_texture = nullptr;
 static std::thread * g_loading_project_thread {nullptr};
@@ -587,6 +598,7 @@ static bool g_env_scanning = false;
 static ImGui::TabLabelStyle * tab_style = &ImGui::TabLabelStyle::Get();
 static MediaEditorSettings g_media_editor_settings;
 static MediaEditorSettings g_new_setting;
+static int64_t g_frame_buffer_pool_mem_provider_id = 0;
 static bool g_vidEncSelChanged = true;
 static std::vector<MediaCore::MediaEncoder::Description> g_currVidEncDescList;
 static bool g_audEncSelChanged = true;
@@ -594,6 +606,8 @@ static std::vector<MediaCore::MediaEncoder::Description> g_currAudEncDescList;
 static std::string g_encoderConfigErrorMessage;
 static bool quit_save_confirm = true;
 static bool project_need_save = false;
+static bool project_save_pending = false;   // an async save is requested, the project is saved only after it's written
+static bool project_save_failed = false;
 static bool project_changed = false;
 static bool mouse_hold = false;
 static uint32_t scope_flags = 0xFFFFFFFF;
@@ -1346,6 +1360,104 @@ static void SetPreviewScale(MediaEditorSettings & config, int index)
     }
 }
 
+static std::string GetDumpFilePath(const std::string& prefix)
+{
+    char time_str[32];
+    auto now = std::time(nullptr);
+    std::strftime(time_str, sizeof(time_str), "%Y%m%d_%H%M%S", std::localtime(&now));
+    return SysUtils::JoinPath(MEC::Project::GetCacheDir(), prefix + time_str + ".json");
+}
+
+static bool DumpTraceFile(std::string& trace_path, std::string& err_msg)
+{
+    trace_path = GetDumpFilePath("mec_trace_");
+    return MEC::Tracer::ExportChromeTrace(trace_path, err_msg);
+}
+
+static std::string MemorySizeToString(int64_t bytes)
+{
+    if (bytes < 0)
+        return "-";
+    char buf[32];
+    if (bytes >= (1LL << 30))
+        snprintf(buf, sizeof(buf), "%.2f GB", (double)bytes / (1024.0 * 1024.0 * 1024.0));
+    else if (bytes >= (1LL << 20))
+        snprintf(buf, sizeof(buf), "%.2f MB", (double)bytes / (1024.0 * 1024.0));
+    else
+        snprintf(buf, sizeof(buf), "%.2f KB", (double)bytes / 1024.0);
+    return std::string(buf);
+}
+
+static void ShowMemoryUsageWindow(bool* p_open)
+{
+    static std::string dump_msg;
+    ImGui::SetNextWindowSize(ImVec2(720, 320), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Memory Usage", p_open))
+    {
+        ImGui::End();
+        return;
+    }
+    const auto usages = MEC::MemoryTracker::GetUsages();
+    ImGuiTableFlags table_flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("Memory usage table", 6, table_flags))
+    {
+        ImGui::TableSetupColumn("Subsystem", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoHide);
+        ImGui::TableSetupColumn("Current", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Peak", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Peak Count", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Soft Limit (MB)", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableHeadersRow();
+        for (auto& usage : usages)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            if (usage.bOverLimit)
+                ImGui::TextColored(ImVec4(1.0, 0.4, 0.4, 1.0), "%s", usage.strName.c_str());
+            else
+                ImGui::TextUnformatted(usage.strName.c_str());
+            ImGui::TableSetColumnIndex(1); ImGui::TextUnformatted(MemorySizeToString(usage.i64Bytes).c_str());
+            ImGui::TableSetColumnIndex(2); ImGui::TextUnformatted(usage.i64Bytes < 0 ? "-" : MemorySizeToString(usage.i64PeakBytes).c_str());
+            ImGui::TableSetColumnIndex(3); ImGui::Text("%lld", (long long)usage.i64Count);
+            ImGui::TableSetColumnIndex(4); ImGui::Text("%lld", (long long)usage.i64PeakCount);
+            ImGui::TableSetColumnIndex(5);
+            if (usage.i64Bytes >= 0)
+            {
+                // 0 means no limit, the limits are kept in the settings
+                int limit_mb = (int)(usage.i64SoftLimit >> 20);
+                ImGui::PushItemWidth(100);
+                if (ImGui::InputInt(("##soft_limit_" + usage.strName).c_str(), &limit_mb, 16, 256, ImGuiInputTextFlags_EnterReturnsTrue))
+                {
+                    limit_mb = limit_mb > 0 ? limit_mb : 0;
+                    if (limit_mb > 0)
+                        g_media_editor_settings.MemorySoftLimitsMB[usage.strName] = limit_mb;
+                    else
+                        g_media_editor_settings.MemorySoftLimitsMB.erase(usage.strName);
+                    g_new_setting.MemorySoftLimitsMB = g_media_editor_settings.MemorySoftLimitsMB;
+                    MEC::MemoryTracker::SetSoftLimit(usage.strName, (int64_t)limit_mb << 20);
+                    ImGui::MarkIniSettingsDirty();
+                }
+                ImGui::PopItemWidth();
+            }
+        }
+        ImGui::EndTable();
+    }
+    if (ImGui::Button("Reset Peaks"))
+        MEC::MemoryTracker::ResetPeaks();
+    ImGui::SameLine();
+    if (ImGui::Button("Dump Json"))
+    {
+        const auto dump_path = GetDumpFilePath("mec_memory_");
+        dump_msg = MEC::MemoryTracker::DumpAsJson(dump_path) ? "Report saved to " + dump_path : "FAILED to save report to " + dump_path;
+    }
+    if (!dump_msg.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(dump_msg.c_str());
+    }
+    ImGui::End();
+}
+
 static void ShowConfigure(MediaEditorSettings & config)
 {
     ImGuiIO &io = ImGui::GetIO();
@@ -1408,6 +1520,49 @@ static void ShowConfigure(MediaEditorSettings & config)
                 ImGui::BulletText("UI PowerSaving");
                 ImGui::ToggleButton("##ui_power_saving", &config.powerSaving);
                 ImGui::Separator();
+                ImGui::BulletText("Save Project In Binary Format");
+                ImGui::ToggleButton("##project_binary_format", &config.ProjectBinaryFormat);
+                ImGui::Separator();
+                ImGui::BulletText("Cache Size Quota");
+                ImGui::PushItemWidth(200);
+                ImGui::SliderInt("##cache_quota", &config.CacheQuotaGB, 0, 500, config.CacheQuotaGB > 0 ? "%d GB" : "Unlimited");
+                ImGui::PopItemWidth();
+                if (auto hCacheMgr = MEC::Project::GetCacheManager())
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("Used %.2f GB", (double)hCacheMgr->GetTotalUsedSize() / (1024.0 * 1024.0 * 1024.0));
+                }
+                ImGui::Separator();
+                ImGui::BulletText("Frame Buffer Pool Size");
+                ImGui::PushItemWidth(200);
+                ImGui::SliderInt("##frame_buffer_pool_size", &config.FrameBufferPoolMB, 128, 8192, "%d MB", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::PopItemWidth();
+                ImGui::ShowTooltipOnHover("The rendering buffers are reused up to this size, the buffers left unused for a while are released.");
+                ImGui::Separator();
+                ImGui::BulletText("Performance Tracing");
+                {
+                    // tracing is switched on immediately, it's not part of the settings
+                    static std::string trace_dump_msg;
+                    bool tracing = MEC::Tracer::IsEnabled();
+                    ImGui::ToggleButton("##performance_tracing", &tracing);
+                    if (tracing != MEC::Tracer::IsEnabled())
+                        MEC::Tracer::SetEnabled(tracing);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Dump Trace"))
+                    {
+                        std::string trace_path, err_msg;
+                        if (DumpTraceFile(trace_path, err_msg))
+                            trace_dump_msg = "Trace saved to " + trace_path;
+                        else
+                            trace_dump_msg = err_msg;
+                    }
+                    ImGui::ShowTooltipOnHover("Save the recorded events as Chrome trace json, which can be opened with 'chrome://tracing' or Perfetto UI.");
+                    ImGui::SameLine();
+                    ImGui::Text("%zu events", MEC::Tracer::GetRecordedEventCount());
+                    if (!trace_dump_msg.empty())
+                        ImGui::TextUnformatted(trace_dump_msg.c_str());
+                }
+                ImGui::Separator();
                 ImGui::BulletText("Bank View Style");
                 // ImGui::TextUnformatted("Bank View Style");
                 ImGui::RadioButton("Icons",  (int *)&config.BankViewStyle, 0); ImGui::SameLine();
@@ -1676,6 +1831,7 @@ static void NewTimeline()
         return;
 
     g_hProject->SetTimelineHandle(timeline);
+    g_hProject->SetTimelineEditLock(&g_timeline_edit_lock);
     g_media_editor_settings.SyncSettingsFromTimeline(timeline);
     timeline->mhProject = g_hProject;
     timeline->mHardwareCodec = g_media_editor_settings.HardwareCodec;
@@ -1711,15 +1867,17 @@ static void CleanProject()
     }
 }
 
-static void SaveProject()
+static void SaveProject(bool bAsync = false)
 {
     if (!timeline || !g_hProject || !g_hProject->IsOpened())
         return;
 
     timeline->Play(false, true);
-    const auto errcode = g_hProject->Save();
+    const auto errcode = bAsync ? g_hProject->SaveAsync() : g_hProject->Save();
     if (errcode == MEC::Project::OK)
     {
+        // the async save is checked by 'PollProjectSaving()', the edits are marked unsaved again if it fails
+        project_save_pending = bAsync;
         project_need_save = false;
         project_changed = false;
         timeline->mIsBluePrintChanged = false;
@@ -1728,6 +1886,23 @@ static void SaveProject()
     {
         Logger::Log(Logger::Error) << "FAILED to save current project! Project name is '" << g_hProject->GetProjectName()
                 << "', save op error code is " << (int)errcode << "." << std::endl;
+        project_save_failed = true;
+    }
+}
+
+static void PollProjectSaving()
+{
+    if (!project_save_pending || !g_hProject || g_hProject->IsSaving())
+        return;
+    project_save_pending = false;
+    const auto errcode = g_hProject->GetLastSaveResult();
+    if (errcode != MEC::Project::OK)
+    {
+        Logger::Log(Logger::Error) << "FAILED to write current project! Project name is '" << g_hProject->GetProjectName()
+                << "', save op error code is " << (int)errcode << "." << std::endl;
+        project_need_save = true;
+        project_changed = true;
+        project_save_failed = true;
     }
 }
 
@@ -1741,7 +1916,8 @@ static void NewProject()
     g_hProject = MEC::Project::CreateUntitledProject(ec);
     if (ec != MEC::Project::OK)
         throw std::runtime_error("FAILED to create untitled project!");
-    g_hProject->SetBgtaskExecutor(g_hBgtaskExctor);
+    g_hProject->SetBgtaskScheduler(g_hBgtaskScheduler);
+    g_hProject->SetBinaryFormat(g_media_editor_settings.ProjectBinaryFormat);
     NewTimeline();
     quit_save_confirm = true;
     project_need_save = true;
@@ -1753,12 +1929,14 @@ static void LoadProjectThread(std::string path, bool in_splash)
 {
     if (path.empty())
         throw std::runtime_error("Project path is EMPTY!");
+    MEC::Tracer::NameCurrentThread("ProjLoad");
 
     // waiting plugin loading
     while (g_plugin_loading || !g_plugin_loaded || g_env_scanning || !g_env_scanned)
     {
         ImGui::sleep(100);
     }
+    MEC_TRACE_SCOPE("LoadProjectThread");
     if (g_env_scan_thread && g_env_scan_thread->joinable())
         g_env_scan_thread->join();
     g_project_loading = true;
@@ -1777,18 +1955,21 @@ static void LoadProjectThread(std::string path, bool in_splash)
         g_project_loading = false;
         return;
     }
-    hProj->SetBgtaskExecutor(g_hBgtaskExctor);
+    hProj->SetBgtaskScheduler(g_hBgtaskScheduler);
+    hProj->SetBinaryFormat(g_media_editor_settings.ProjectBinaryFormat);
     g_hProject = hProj;
     g_media_editor_settings.project_path = path;
     g_project_loading_percentage = 0.2;
 
     NewTimeline();
     timeline->m_in_threads = true;
-    const auto& jnProjContent = g_hProject->GetProjectContentJson();
+    // the content items are pulled one by one, a binary project file is never decoded as a whole
+    imgui_json::value jnItemHolder;
     string attrName = "MediaBank";
-    if (jnProjContent.contains(attrName) && jnProjContent[attrName].is_array())
+    auto pjnMediaBank = g_hProject->GetContentItem(attrName, jnItemHolder);
+    if (pjnMediaBank && pjnMediaBank->is_array())
     {
-        const auto& jnMediaBank = jnProjContent[attrName].get<imgui_json::array>();
+        const auto& jnMediaBank = pjnMediaBank->get<imgui_json::array>();
         const auto szItemCnt = jnMediaBank.size();
         float percentage = szItemCnt > 0 ?  0.6 / szItemCnt : 0;
         for (const auto& jnItem : jnMediaBank)
@@ -1848,10 +2029,12 @@ static void LoadProjectThread(std::string path, bool in_splash)
 
     // second load TimeLine
     attrName = "TimeLine";
-    if (jnProjContent.contains(attrName) && jnProjContent[attrName].is_object())
+    auto pjnTimeLine = g_hProject->GetContentItem(attrName, jnItemHolder);
+    if (pjnTimeLine && pjnTimeLine->is_object())
     {
-        const auto& val = jnProjContent[attrName];
-        timeline->Load(val);
+        timeline->Load(*pjnTimeLine, [&] (const std::string& name, imgui_json::value& holder) {
+            return g_hProject->GetContentItem(attrName+"/"+name, holder);
+        });
         g_media_editor_settings.SyncSettingsFromTimeline(timeline);
     }
     else
@@ -1859,6 +2042,14 @@ static void LoadProjectThread(std::string path, bool in_splash)
         Logger::Log(Logger::WARN) << "CANNOT find '" << attrName << "' attribute in MEC project content json at '" << path << "'!" << std::endl;
     }
 
+    // redo the edits that were journaled but not saved into the project file
+    auto aRecoveredJournal = g_hProject->TakeRecoveredJournal();
+    if (!aRecoveredJournal.empty())
+    {
+        Logger::Log(Logger::INFO) << "[MEC] Replay " << aRecoveredJournal.size() << " unsaved edit(s) from the project journal." << std::endl;
+        timeline->ReplayJournal(aRecoveredJournal);
+    }
+
     if (path.empty())
         quit_save_confirm = true;
     else
@@ -2846,6 +3037,10 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
 
                 static float m_sceneDetectParam_fThresh = 0.4;
                 ImGui::SliderFloat("##SceneDetectParamThresh", &m_sceneDetectParam_fThresh, 0, 1, "%.3f", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Stick);
+                // off by default until its scores are validated against ffmpeg's 'scene' filter
+                static bool m_sceneDetectParam_bNativeScorer = false;
+                ImGui::Checkbox("Fast scoring##SceneDetectParamNativeScorer", &m_sceneDetectParam_bNativeScorer);
+                ImGui::ShowTooltipOnHover("Score scene changes on a down-scaled luma plane instead of the full-size RGB frame. Experimental, the cut points may differ from the default scoring.");
 
                 bCloseDlg = false;
                 MEC::BackgroundTask::Holder hTask;
@@ -2862,6 +3057,98 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                     jnTask["use_src_attr"] = true;
                     // send scene detect params
                     jnTask["scene_detect_thresh"] = imgui_json::number(m_sceneDetectParam_fThresh);
+                    jnTask["use_native_scorer"] = m_sceneDetectParam_bNativeScorer;
+                    auto hSettings = timeline->mhMediaSettings->Clone();
+                    hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
+                    bCloseDlg = true;
+                } ImGui::SameLine(0, 10);
+                if (ImGui::Button(" Cancel "))
+                    bCloseDlg = true;
+                return hTask;
+            },
+        },
+        {
+            "Silence Detect", "SilenceDetect",
+            [] (MediaItem* pMediaItem) {
+                if (!(timeline && timeline->IsProjectDirReady()))
+                    return false;
+                const auto clipType = pMediaItem->mMediaType;
+                return !IS_IMAGE(clipType)&&!IS_IMAGESEQ(clipType)&&pMediaItem->mhParser->HasAudio();
+            },
+            [] (MediaItem* pMediaItem, bool& bCloseDlg) {
+                auto hParser = pMediaItem->mhParser;
+                ImColor tTagColor(KNOWNIMGUICOLOR_LIGHTGRAY);
+                ImColor tTextColor(KNOWNIMGUICOLOR_LIGHTGREEN);
+                ImGui::TextColored(tTagColor, "Source File: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", SysUtils::ExtractFileName(hParser->GetUrl()).c_str());
+                ImGui::ShowTooltipOnHover("Path: '%s'", hParser->GetUrl().c_str());
+                ImGui::TextColored(tTagColor, "Duration: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", ImGuiHelper::MillisecToString(pMediaItem->mSrcLength).c_str());
+
+                static float m_silenceDetectParam_fThreshDb = -50;
+                ImGui::SliderFloat("Threshold##SilenceDetectParamThresh", &m_silenceDetectParam_fThreshDb, -90, -10, "%.1f dB", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::ShowTooltipOnHover("Audio quieter than this level is considered as silence.");
+                static int m_silenceDetectParam_iMinDur = 500;
+                ImGui::SliderInt("Min Duration##SilenceDetectParamMinDur", &m_silenceDetectParam_iMinDur, 100, 5000, "%d ms", ImGuiSliderFlags_AlwaysClamp);
+
+                bCloseDlg = false;
+                MEC::BackgroundTask::Holder hTask;
+                if (ImGui::Button("   OK   "))
+                {
+                    imgui_json::value jnTask;
+                    jnTask["type"] = "SilenceDetect";
+                    jnTask["project_dir"] = timeline->mhProject->GetProjectDir();
+                    jnTask["source_url"] = hParser->GetUrl();
+                    jnTask["media_item_id"] = imgui_json::number(pMediaItem->mID);
+                    jnTask["silence_thresh_db"] = imgui_json::number(m_silenceDetectParam_fThreshDb);
+                    jnTask["min_interval_duration"] = imgui_json::number(m_silenceDetectParam_iMinDur);
+                    auto hSettings = timeline->mhMediaSettings->Clone();
+                    hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
+                    bCloseDlg = true;
+                } ImGui::SameLine(0, 10);
+                if (ImGui::Button(" Cancel "))
+                    bCloseDlg = true;
+                return hTask;
+            },
+        },
+        {
+            "Black/Freeze Detect", "BlackFreezeDetect",
+            [] (MediaItem* pMediaItem) {
+                if (!(timeline && timeline->IsProjectDirReady()))
+                    return false;
+                const auto clipType = pMediaItem->mMediaType;
+                return IS_VIDEO(clipType)&&!IS_IMAGE(clipType)&&!IS_IMAGESEQ(clipType);
+            },
+            [] (MediaItem* pMediaItem, bool& bCloseDlg) {
+                auto hParser = pMediaItem->mhParser;
+                ImColor tTagColor(KNOWNIMGUICOLOR_LIGHTGRAY);
+                ImColor tTextColor(KNOWNIMGUICOLOR_LIGHTGREEN);
+                ImGui::TextColored(tTagColor, "Source File: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", SysUtils::ExtractFileName(hParser->GetUrl()).c_str());
+                ImGui::ShowTooltipOnHover("Path: '%s'", hParser->GetUrl().c_str());
+                ImGui::TextColored(tTagColor, "Duration: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", ImGuiHelper::MillisecToString(pMediaItem->mSrcLength).c_str());
+
+                static float m_blackDetectParam_fPixelThresh = 0.1f;
+                ImGui::SliderFloat("Black Level##BlackDetectParamPixelThresh", &m_blackDetectParam_fPixelThresh, 0, 0.5f, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::ShowTooltipOnHover("Pixels with luminance below this level are considered as black.");
+                static bool m_blackDetectParam_bDetectFreeze = true;
+                ImGui::Checkbox("Detect frozen frames##BlackDetectParamDetectFreeze", &m_blackDetectParam_bDetectFreeze);
+                static int m_blackDetectParam_iMinDur = 1000;
+                ImGui::SliderInt("Min Duration##BlackDetectParamMinDur", &m_blackDetectParam_iMinDur, 100, 10000, "%d ms", ImGuiSliderFlags_AlwaysClamp);
+
+                bCloseDlg = false;
+                MEC::BackgroundTask::Holder hTask;
+                if (ImGui::Button("   OK   "))
+                {
+                    imgui_json::value jnTask;
+                    jnTask["type"] = "BlackFreezeDetect";
+                    jnTask["project_dir"] = timeline->mhProject->GetProjectDir();
+                    jnTask["source_url"] = hParser->GetUrl();
+                    jnTask["media_item_id"] = imgui_json::number(pMediaItem->mID);
+                    jnTask["black_pixel_thresh"] = imgui_json::number(m_blackDetectParam_fPixelThresh);
+                    jnTask["detect_freeze"] = m_blackDetectParam_bDetectFreeze;
+                    jnTask["min_interval_duration"] = imgui_json::number(m_blackDetectParam_iMinDur);
                     auto hSettings = timeline->mhMediaSettings->Clone();
                     hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
                     bCloseDlg = true;
@@ -5047,6 +5334,13 @@ static void ShowVideoPreviewWindow(ImDrawList *draw_list, EditingVideoClip* pVid
                     const int64_t i64TickInEvent = timeline->mCurrentTime-(start+pVidEditingClip->mMaskEventStart);
                     if (pVidEditingClip->mhMaskCreator->DrawContent({offset_x, offset_y}, {tf_x-offset_x, tf_y-offset_y}, true, i64TickInEvent))
                     {
+                        if (pVidEditingClip->mMaskEventId != -1)
+                        {
+                            auto pClip = timeline->FindClipByID(pVidEditingClip->mID);
+                            auto hEvent = pClip ? pClip->FindEventByID(pVidEditingClip->mMaskEventId) : nullptr;
+                            auto pVidEvt = dynamic_cast<MEC::VideoEvent*>(hEvent.get());
+                            if (pVidEvt) pVidEvt->InvalidateMaskCache();
+                        }
                         auto pTrack = timeline->FindTrackByClipID(pVidEditingClip->mID);
                         timeline->RefreshTrackView({ pTrack->mID });
                     }
@@ -5839,6 +6133,7 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
                     {
                         bKeyFrameEnabled = !bKeyFrameEnabled_;
                         pEdtVidClip->mhMaskCreator->EnableKeyFrames(bKeyFrameEnabled);
+                        pVidEvt->InvalidateMaskCache();
                     }
                     ImGui::EndDisabled();
                     ImGui::SetCursorScreenPos({rightIconPosX+(iconIdx++)*iconWidth, currPos.y});
@@ -5867,6 +6162,24 @@ static void DrawClipEventWindow(ImDrawList *draw_list, BaseEditingClip * pEditin
                     pVidEvt->RemoveMask(iToDelIdx);
                     RefreshPreview(track);
                 }
+                bool bTiledExec = pVidEvt->IsTiledExecutionEnabled();
+                int iTileHaloRows = pVidEvt->GetTileHaloRows();
+                std::string tiledLabel = "Tiled execution##event_tiled_exec@" + std::to_string(event->Id());
+                bool bTiledExecChanged = ImGui::Checkbox(tiledLabel.c_str(), &bTiledExec);
+                ImGui::ShowTooltipOnHover("Run the event filters on horizontal bands of the frame in parallel.\nOnly for filters that work on local pixels.");
+                ImGui::BeginDisabled(!bTiledExec);
+                ImGui::SameLine();
+                ImGui::PushItemWidth(80);
+                std::string haloLabel = "Halo rows##event_tile_halo@" + std::to_string(event->Id());
+                bTiledExecChanged |= ImGui::DragInt(haloLabel.c_str(), &iTileHaloRows, 1.f, 0, 256);
+                ImGui::PopItemWidth();
+                ImGui::ShowTooltipOnHover("Extra rows each band sees above and below it, for filters with spatial footprint like blur.");
+                ImGui::EndDisabled();
+                if (bTiledExecChanged)
+                {
+                    pVidEvt->EnableTiledExecution(bTiledExec, iTileHaloRows);
+                    RefreshPreview(track);
+                }
                 ImGui::Unindent(30);
             }
             auto pBP = event->GetBp();
@@ -8615,12 +8928,64 @@ static void ShowBgtaskTab(ImDrawList *draw_list, ImRect title_rect)
     ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Background Task Count: ");
     const auto szBgtaskCnt = aBgtasks.size();
     ImGui::SameLine(0, 10); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), "%zu", szBgtaskCnt);
+    if (g_hBgtaskScheduler)
+    {
+        const auto eFgState = g_hBgtaskScheduler->GetForegroundState();
+        const auto tQueueStats = g_hBgtaskScheduler->GetQueueStats();
+        ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Scheduler: ");
+        ImGui::SameLine(0, 10);
+        if (eFgState == MEC::BgtaskScheduler::FG_EXPORTING)
+            ImGui::TextColored(ImColor(0.85f, 0.3f, 0.3f), "Paused for exporting");
+        else if (eFgState == MEC::BgtaskScheduler::FG_PLAYING)
+            ImGui::TextColored(ImColor(0.8f, 0.8f, 0.1f), "Throttled for playback");
+        else
+            ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), "Normal");
+        for (int i = 0; i < MEC::BackgroundTask::RC_COUNT; i++)
+        {
+            const auto strClassName = MEC::BgtaskScheduler::GetResourceClassName((MEC::BackgroundTask::ResourceClass)i);
+            ImGui::SameLine(0, 16);
+            ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "%s: %d/%d (%d workers)", strClassName.c_str(), tQueueStats.aRunningCnt[i], tQueueStats.aMaxConcurrency[i], tQueueStats.aWorkerBudget[i]);
+        }
+        ImGui::SameLine(0, 16);
+        ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Pending: %d, Throttled: %d, Paused: %d",
+                tQueueStats.iPendingCnt, tQueueStats.iThrottledCnt, tQueueStats.iUserPausedCnt);
+    }
+    ImGui::BeginDisabled(aBgtasks.empty());
+    if (ImGui::Button("Copy Metrics"))
+    {
+        imgui_json::array jnTaskMetrics;
+        for (const auto& hTask : aBgtasks)
+        {
+            auto jnMetrics = hTask->GetMetrics().SaveAsJson();
+            jnMetrics["task_dir"] = hTask->GetTaskDir();
+            jnTaskMetrics.push_back(jnMetrics);
+        }
+        ImGui::SetClipboardText(imgui_json::value(jnTaskMetrics).dump().c_str());
+    }
+    ImGui::ShowTooltipOnHover("Copy the metrics of all the tasks to the clipboard as json.");
+    ImGui::EndDisabled();
     ImGui::Dummy({0, 6});
     ImGui::BeginChild("##BgTaskList", ImVec2(0, 0), ImGuiChildFlags_Border);
     auto v2TaskViewSize = ImGui::GetContentRegionAvail();
     v2TaskViewSize.y = 0;
+    static const char* s_aPriorityNames[] = { "Low", "Normal", "High" };
+    static const char* s_aQueueStateNames[] = { "Pending", "Running", "Throttled", "Paused", "Finished" };
     for (const auto& hTask : aBgtasks)
     {
+        if (g_hBgtaskScheduler)
+        {
+            ImGui::PushID(hTask.get());
+            int iPriority = (int)hTask->GetPriority();
+            ImGui::SetNextItemWidth(100);
+            if (ImGui::Combo("Priority", &iPriority, s_aPriorityNames, IM_ARRAYSIZE(s_aPriorityNames)))
+                hTask->SetPriority((MEC::BackgroundTask::Priority)iPriority);
+            const auto eQueueState = g_hBgtaskScheduler->GetTaskQueueState(hTask);
+            const auto strClassName = MEC::BgtaskScheduler::GetResourceClassName(hTask->GetResourceClass());
+            ImGui::SameLine(0, 16);
+            ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_GRAY), "Queue: %s (%s)", s_aQueueStateNames[eQueueState], strClassName.c_str());
+            ImGui::PopID();
+        }
+        hTask->DrawContentCompact();
         const bool bRemoveTask = hTask->DrawContent(v2TaskViewSize);
         ImGui::Separator();
         if (bRemoveTask)
@@ -11337,6 +11702,10 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "OldBottomViewHeight=%f", &val_float) == 1) { setting->OldBottomViewHeight = val_float; }
         else if (sscanf(line, "ShowMeters=%d", &val_int) == 1) { setting->showMeters = val_int == 1; }
         else if (sscanf(line, "PowerSaving=%d", &val_int) == 1) { setting->powerSaving = val_int == 1; }
+        else if (sscanf(line, "ProjectBinaryFormat=%d", &val_int) == 1) { setting->ProjectBinaryFormat = val_int == 1; }
+        else if (sscanf(line, "CacheQuotaGB=%d", &val_int) == 1) { setting->CacheQuotaGB = val_int > 0 ? val_int : 0; }
+        else if (sscanf(line, "FrameBufferPoolMB=%d", &val_int) == 1) { setting->FrameBufferPoolMB = ImClamp(val_int, 128, 8192); }
+        else if (sscanf(line, "MemorySoftLimitMB=%[^|\n]|%d", val_path, &val_int) == 2) { if (val_int > 0) setting->MemorySoftLimitsMB[std::string(val_path)] = val_int; }
         else if (sscanf(line, "MediaBankView=%d", &val_int) == 1) { setting->MediaBankViewType = val_int; }
         else if (sscanf(line, "ControlPanelWidth=%f", &val_float) == 1) { setting->ControlPanelWidth = val_float; }
         else if (sscanf(line, "MainViewWidth=%f", &val_float) == 1) { setting->MainViewWidth = val_float; }
@@ -11469,6 +11838,11 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("OldBottomViewHeight=%f\n", g_media_editor_settings.OldBottomViewHeight);
         out_buf->appendf("ShowMeters=%d\n", g_media_editor_settings.showMeters ? 1 : 0);
         out_buf->appendf("PowerSaving=%d\n", g_media_editor_settings.powerSaving ? 1 : 0);
+        out_buf->appendf("ProjectBinaryFormat=%d\n", g_media_editor_settings.ProjectBinaryFormat ? 1 : 0);
+        out_buf->appendf("CacheQuotaGB=%d\n", g_media_editor_settings.CacheQuotaGB);
+        out_buf->appendf("FrameBufferPoolMB=%d\n", g_media_editor_settings.FrameBufferPoolMB);
+        for (auto& limit : g_media_editor_settings.MemorySoftLimitsMB)
+            out_buf->appendf("MemorySoftLimitMB=%s|%d\n", limit.first.c_str(), limit.second);
         out_buf->appendf("MediaBankView=%d\n", g_media_editor_settings.MediaBankViewType);
         out_buf->appendf("ControlPanelWidth=%f\n", g_media_editor_settings.ControlPanelWidth);
         out_buf->appendf("MainViewWidth=%f\n", g_media_editor_settings.MainViewWidth);
@@ -11589,6 +11963,10 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
     };
     setting_ini_handler.ApplyAllFn = [](ImGuiContext* ctx, ImGuiSettingsHandler* handler)
     {
+        MEC::Project::SetCacheQuota((int64_t)g_media_editor_settings.CacheQuotaGB << 30);
+        MEC::FrameBufferPool::GetDefaultInstance()->SetCapacity((size_t)g_media_editor_settings.FrameBufferPoolMB << 20);
+        for (auto& limit : g_media_editor_settings.MemorySoftLimitsMB)
+            MEC::MemoryTracker::SetSoftLimit(limit.first, (int64_t)limit.second << 20);
         // handle project after all setting is loaded 
         if (!g_media_editor_settings.project_path.empty())
         {
@@ -11657,6 +12035,13 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
 
 static void MediaEditor_Initialize(void** handle)
 {
+    MEC::Tracer::NameCurrentThread("UI");
+    g_frame_buffer_pool_mem_provider_id = MEC::MemoryTracker::RegisterProvider("FrameBufferPool", [] (int64_t& bytes, int64_t&) {
+        const auto stats = MEC::FrameBufferPool::GetDefaultInstance()->GetStats();
+        bytes = stats.szPooledBytes;
+    }, [] (int64_t) {
+        MEC::FrameBufferPool::GetDefaultInstance()->Trim();
+    });
 #if !IMGUI_APPLICATION_PLATFORM_SDL2
     SDL_Init(SDL_INIT_AUDIO | SDL_INIT_TIMER);
 #endif
@@ -11680,7 +12065,7 @@ static void MediaEditor_Initialize(void** handle)
 #if defined(NDEBUG)
     av_log_set_level(AV_LOG_FATAL);
 #else
-    // Logger::GetDefaultLogger()->SetShowLevels(Logger::DEBUG);
+    // MEC::AsyncLog::SetLoggerLevel(Logger::GetDefaultLogger(), Logger::DEBUG);
     // MediaCore::MultiTrackVideoReader::GetLogger()->SetShowLevels(Logger::DEBUG);
     // MediaCore::MultiTrackAudioReader::GetLogger()->SetShowLevels(Logger::DEBUG);
     // MediaCore::MediaReader::GetLogger()->SetShowLevels(Logger::DEBUG);
@@ -11688,6 +12073,7 @@ static void MediaEditor_Initialize(void** handle)
     // MediaCore::MediaEncoder::GetLogger()->SetShowLevels(Logger::DEBUG);
     // MediaCore::Overview::GetLogger()->SetShowLevels(Logger::DEBUG);
     // GetSubtitleTrackLogger()->SetShowLevels(Logger::DEBUG);
+    // MEC::AsyncLog::SetLevel(Logger::DEBUG);
 #endif
 
     // create default MEC project base dir if not exists
@@ -11712,6 +12098,7 @@ static void MediaEditor_Initialize(void** handle)
     }
 
     g_hBgtaskExctor = SysUtils::ThreadPoolExecutor::CreateInstance("MecBgtaskExctor");
+    g_hBgtaskScheduler = MEC::BgtaskScheduler::CreateInstance("MecBgtaskScheduler", g_hBgtaskExctor);
 #if IMGUI_VULKAN_SHADER
     int gpu = ImGui::get_default_gpu_index();
     m_histogram = new ImGui::Histogram_vulkan(gpu);
@@ -11742,12 +12129,18 @@ static void MediaEditor_Finalize(void** handle)
     if (codewin_texture) { ImGui::ImDestroyTexture(codewin_texture); codewin_texture = nullptr; }
 
     g_hProject = nullptr;
+    g_hBgtaskScheduler = nullptr;
     g_hBgtaskExctor = nullptr;
+    MEC::MemoryTracker::UnregisterProvider(g_frame_buffer_pool_mem_provider_id);
+    g_frame_buffer_pool_mem_provider_id = 0;
+    MEC::FrameBufferPool::GetDefaultInstance()->LogStats(Logger::INFO);
+    MEC::FrameBufferPool::GetDefaultInstance()->Trim();
 
     ImPlot::DestroyContext();
     MediaCore::ReleaseSubtitleLibrary();
     RenderUtils::TextureManager::ReleaseDefaultInstance();
     SysUtils::ThreadPoolExecutor::ReleaseDefaultInstance();
+    MEC::AsyncLog::Shutdown();
 #if !IMGUI_APPLICATION_PLATFORM_SDL2
     SDL_Quit();
 #endif
@@ -11816,6 +12209,8 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
 #if UI_PERFORMANCE_ANALYSIS
     MediaCore::AutoSection _as("MEFrm");
 #endif
+    MEC_TRACE_SCOPE("MediaEditor_Frame");
+    std::lock_guard<std::recursive_mutex> lkTlEdit(g_timeline_edit_lock);
     //static bool first_display = true;
     static bool app_done = false;
     const float media_icon_size = 96; 
@@ -11824,6 +12219,8 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
     static bool show_about = false;
     static bool show_configure = false;
     static bool show_debug = false;
+    static bool show_memory_usage = false;
+    static double last_memory_sample_time = 0;
     static bool show_file_dialog = false;
     static bool show_overwrite_msg = false;
     static bool show_overwrite_new_msg = false;
@@ -11833,10 +12230,20 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
     static ImGui::MsgBox msgbox_overwrite;
     static const char* buttons_quit[] = { "Overwrite", "Quit", "Cancel", NULL };
     msgbox_overwrite.Init("Overwrite Exist Project?", ICON_MD_WARNING, "Are you really sure you want to overwrite project?", buttons_quit, false);
+    static ImGui::MsgBox msgbox_save_failed;
+    static const char* buttons_ok[] = { "OK", NULL };
+    msgbox_save_failed.Init("Save Project Failed!", ICON_MD_WARNING, "FAILED to save the project, the edits are NOT saved! Please check the log for details.", buttons_ok, false);
 
     auto platform_io = ImGui::GetPlatformIO();
     bool is_splitter_hold = false;
     if (!timeline) return app_will_quit;
+    if (g_hBgtaskScheduler)
+    {
+        // keep the background tasks away from the preview playback and the exporting
+        const auto eFgState = timeline->mIsEncoding ? MEC::BgtaskScheduler::FG_EXPORTING
+                : (timeline->mIsPreviewPlaying ? MEC::BgtaskScheduler::FG_PLAYING : MEC::BgtaskScheduler::FG_IDLE);
+        g_hBgtaskScheduler->SetForegroundState(eFgState);
+    }
     ImGuiContext& g = *GImGui;
     if (!g_media_editor_settings.UILanguage.empty() && g.LanguageName != g_media_editor_settings.UILanguage)
         g.LanguageName = g_media_editor_settings.UILanguage;
@@ -11878,6 +12285,15 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
 #ifdef DEBUG_IMGUI
     if (show_debug) ImGui::ShowMetricsWindow(&show_debug);
 #endif
+    // the soft limits are checked while sampling, so it's done even if the window is hidden
+    if (!g_project_loading && ImGui::GetTime() - last_memory_sample_time > 1.0)
+    {
+        MEC::MemoryTracker::Sample();
+        // the pool isn't trimmed while acquiring when nothing is rendered
+        MEC::FrameBufferPool::GetDefaultInstance()->TrimIdle();
+        last_memory_sample_time = ImGui::GetTime();
+    }
+    if (show_memory_usage) ShowMemoryUsageWindow(&show_memory_usage);
 
     if (!logo_texture && !icon_file.empty()) logo_texture = ImGui::ImLoadTexture(icon_file.c_str());
     if (!codewin_texture) codewin_texture = ImGui::ImCreateTexture(codewin::codewin_pixels, codewin::codewin_width, codewin::codewin_height, codewin::codewin_depth / 8);
@@ -11943,6 +12359,10 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
         {
             show_configure = false;
             g_media_editor_settings = g_new_setting;
+            if (g_hProject)
+                g_hProject->SetBinaryFormat(g_media_editor_settings.ProjectBinaryFormat);
+            MEC::Project::SetCacheQuota((int64_t)g_media_editor_settings.CacheQuotaGB << 30);
+            MEC::FrameBufferPool::GetDefaultInstance()->SetCapacity((size_t)g_media_editor_settings.FrameBufferPoolMB << 20);
             if (timeline)
             {
                 bool needReloadProject = false;
@@ -12137,7 +12557,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
             }
             else
             {
-                SaveProject();
+                SaveProject(true);
             }
         }
         ImGui::ShowTooltipOnHover("Save Project");
@@ -12155,6 +12575,11 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
             show_configure = true;
         }
         ImGui::ShowTooltipOnHover("Configure");
+        if (ImGui::Button(ICON_FA_MICROCHIP "##MemoryUsage", ImVec2(tool_icon_size, tool_icon_size)))
+        {
+            show_memory_usage = !show_memory_usage;
+        }
+        ImGui::ShowTooltipOnHover("Memory Usage");
 #ifdef DEBUG_IMGUI
         if (ImGui::Button(ICON_UI_DEBUG "##UIDebug", ImVec2(tool_icon_size, tool_icon_size)))
         {
@@ -12644,7 +13069,9 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
                 if (ec == MEC::Project::OK)
                 {
                     g_hProject->SetTimelineHandle(timeline);
-                    g_hProject->SetBgtaskExecutor(g_hBgtaskExctor);
+                    g_hProject->SetTimelineEditLock(&g_timeline_edit_lock);
+                    g_hProject->SetBgtaskScheduler(g_hBgtaskScheduler);
+                    g_hProject->SetBinaryFormat(g_media_editor_settings.ProjectBinaryFormat);
                 }
                 else
                     throw std::runtime_error("FAILED to create untitled project!");
@@ -12711,6 +13138,14 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
         }
     }
 
+    PollProjectSaving();
+    if (project_save_failed)
+    {
+        msgbox_save_failed.Open();
+        project_save_failed = false;
+    }
+    msgbox_save_failed.Draw();
+
     if (!ImGui::IsMouseDown(ImGuiMouseButton_Left))
     {
         mouse_hold = false;
@@ -12744,13 +13179,18 @@ static bool MediaEditor_Frame_wrapper(void * handle, bool app_will_quit)
     auto tspan = hPa->End();
     // if 'Application_Frame' takes more than 33 millisec, the refresh rate will drop below 30fps
     if (MediaCore::CountElapsedMillisec(tspan.first, tspan.second) > 33)
+    {
         hPa->LogAndClearStatistics(Logger::INFO);
+        MEC::FrameBufferPool::GetDefaultInstance()->LogStats(Logger::INFO);
+    }
     return ret;
 }
 #endif
 
 static void LoadPluginThread()
 {
+    MEC::Tracer::NameCurrentThread("PluginLoad");
+    MEC_TRACE_SCOPE("LoadPluginThread");
     std::vector<std::string> plugin_paths;
     plugin_paths.push_back(g_plugin_path);
     int plugins = BluePrint::BluePrintUI::CheckPlugins(plugin_paths);
@@ -12761,6 +13201,8 @@ static void LoadPluginThread()
 
 static void EnvScanThread()
 {
+    MEC::Tracer::NameCurrentThread("EnvScan");
+    MEC_TRACE_SCOPE("EnvScanThread");
     auto hHwaMgr = MediaCore::HwaccelManager::GetDefaultInstance();
     if (!hHwaMgr->Init())
         Logger::Log(Logger::Error) << "FAILED to init 'HwaccelManager' instance! Error is '" << hHwaMgr->GetError() << "'." << std::endl;
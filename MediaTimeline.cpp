@@ -29,10 +29,14 @@
 #include <ThreadUtils.h>
 #include <MatUtilsImVecHelper.h>
 #include "EventStackFilter.h"
+#include "FrameBufferPool.h"
 #include "TextureManager.h"
 #include "MatUtils.h"
 #include "Logger.h"
 #include "DebugHelper.h"
+#include "MecTracer.h"
+#include "MecMemoryTracker.h"
+#include "MecAsyncLog.h"
 
 const MediaTimeline::audio_band_config DEFAULT_BAND_CFG[10] = {
     { 32,       32,         0 },        { 64,       64,         0 },
@@ -1069,21 +1073,21 @@ int64_t Clip::Cropping(int64_t& diffTime, int type)
     return offset_time;
 }
 
-void Clip::Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_json::value>* pActionList)
+int64_t Clip::Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_json::value>* pActionList, bool updateTimeline)
 {
     TimeLine * timeline = (TimeLine *)mHandle;
     if (!timeline)
-        return;
+        return -1;
     auto track = timeline->FindTrackByClipID(mID);
     if (!track || track->mLocked)
-        return;
+        return -1;
     if (IS_DUMMY(mType))
-        return;
+        return -1;
     // check if the cut position is inside the clip
     auto cut_pos = pos;
     pos = timeline->AlignTime(pos);
     if (pos <= mStart || pos >= mEnd)
-        return;
+        return -1;
 
     // calculate new pos
     int64_t org_end = mEnd;
@@ -1114,7 +1118,8 @@ void Clip::Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_
             }
         }
     }
-    timeline->Update();
+    if (updateTimeline)
+        timeline->Update();
 
     if (pActionList)
     {
@@ -1130,6 +1135,7 @@ void Clip::Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_
         action["group_id"] = imgui_json::number(gid);
         pActionList->push_back(std::move(action));
     }
+    return newClipId;
 }
 
 int64_t Clip::Moving(int64_t& diffTime, int mouse_track)
@@ -3002,9 +3008,11 @@ imgui_json::value TextClip::SaveAsJson()
 namespace MediaTimeline
 {
 // BluePrintVideoTransition class
-BluePrintVideoTransition::BluePrintVideoTransition(void * handle)
-    : mHandle(handle)
+BluePrintVideoTransition::BluePrintVideoTransition(void * handle, bool bDeferBluePrint)
+    : mHandle(handle), mBpPending(bDeferBluePrint)
 {
+    if (bDeferBluePrint)
+        return;
     TimeLine * timeline = (TimeLine *)handle;
     imgui_json::value transition_BP; 
     mBp = new BluePrint::BluePrintUI();
@@ -3013,6 +3021,7 @@ BluePrintVideoTransition::BluePrintVideoTransition(void * handle)
     callbacks.BluePrintOnChanged = OnBluePrintChange;
     mBp->SetCallbacks(callbacks, this);
     mBp->File_New_Transition(transition_BP, "VideoTransition", "Video");
+    UpdateWorkerBluePrints(mBp->m_Document->Serialize());
 }
 
 BluePrintVideoTransition::~BluePrintVideoTransition()
@@ -3022,6 +3031,12 @@ BluePrintVideoTransition::~BluePrintVideoTransition()
         mBp->Finalize();
         delete mBp;
     }
+    for (auto pWorkerBp : mIdleWorkerBps)
+    {
+        pWorkerBp->Finalize();
+        delete pWorkerBp;
+    }
+    mIdleWorkerBps.clear();
 }
 
 int BluePrintVideoTransition::OnBluePrintChange(int type, std::string name, void* handle)
@@ -3041,6 +3056,9 @@ int BluePrintVideoTransition::OnBluePrintChange(int type, std::string name, void
             type == BluePrint::BP_CB_NODE_INSERT)
         {
             // need update
+            auto bpJson = transition->mBp->m_Document->Serialize();
+            transition->UpdateNativeTransition(bpJson);
+            transition->UpdateWorkerBluePrints(bpJson);
             if (timeline) timeline->RefreshPreview();
             ret = BluePrint::BP_CBR_AutoLink;
         }
@@ -3048,6 +3066,9 @@ int BluePrintVideoTransition::OnBluePrintChange(int type, std::string name, void
                 type == BluePrint::BP_CB_SETTING_CHANGED)
         {
             // need update
+            auto bpJson = transition->mBp->m_Document->Serialize();
+            transition->UpdateNativeTransition(bpJson);
+            transition->UpdateWorkerBluePrints(bpJson);
             if (timeline) timeline->RefreshPreview();
         }
     }
@@ -3055,10 +3076,74 @@ int BluePrintVideoTransition::OnBluePrintChange(int type, std::string name, void
     return ret;
 }
 
+void BluePrintVideoTransition::UpdateNativeTransition(const imgui_json::value& bpJson)
+{
+    auto hNativeTrans = MEC::NativeTransition::CreateFromBluePrintJson(bpJson);
+    std::atomic_store(&mhNativeTransition, hNativeTrans);
+}
+
+void BluePrintVideoTransition::UpdateWorkerBluePrints(const imgui_json::value& bpJson)
+{
+    std::lock_guard<std::mutex> lk(mWorkerBpLock);
+    mWorkerBpJson = bpJson;
+    mWorkerBpGeneration++;
+    // idle copies are out of date now, the busy ones are dropped when they are released
+    for (auto pWorkerBp : mIdleWorkerBps)
+    {
+        mWorkerBpGenerations.erase(pWorkerBp);
+        pWorkerBp->Finalize();
+        delete pWorkerBp;
+    }
+    mIdleWorkerBps.clear();
+}
+
+BluePrint::BluePrintUI* BluePrintVideoTransition::AcquireWorkerBluePrint()
+{
+    std::lock_guard<std::mutex> lk(mWorkerBpLock);
+    if (!mIdleWorkerBps.empty())
+    {
+        auto pWorkerBp = mIdleWorkerBps.front();
+        mIdleWorkerBps.pop_front();
+        return pWorkerBp;
+    }
+    if (mWorkerBpGenerations.size() >= MAX_WORKER_BP_COUNT || mWorkerBpJson.is_null())
+        return nullptr;
+    auto pWorkerBp = new BluePrint::BluePrintUI();
+    pWorkerBp->Initialize();
+    pWorkerBp->File_New_Transition(mWorkerBpJson, "VideoTransition", "Video");
+    if (!pWorkerBp->Blueprint_IsExecutable())
+    {
+        pWorkerBp->Finalize();
+        delete pWorkerBp;
+        return nullptr;
+    }
+    mWorkerBpGenerations[pWorkerBp] = mWorkerBpGeneration;
+    return pWorkerBp;
+}
+
+void BluePrintVideoTransition::ReleaseWorkerBluePrint(BluePrint::BluePrintUI* pBp)
+{
+    std::lock_guard<std::mutex> lk(mWorkerBpLock);
+    auto iter = mWorkerBpGenerations.find(pBp);
+    if (iter != mWorkerBpGenerations.end() && iter->second == mWorkerBpGeneration)
+    {
+        mIdleWorkerBps.push_back(pBp);
+        return;
+    }
+    if (iter != mWorkerBpGenerations.end())
+        mWorkerBpGenerations.erase(iter);
+    pBp->Finalize();
+    delete pBp;
+}
+
 MediaCore::VideoTransition::Holder BluePrintVideoTransition::Clone()
 {
     BluePrintVideoTransition* bpTrans = new BluePrintVideoTransition(mHandle);
-    auto bpJson = mBp->m_Document->Serialize();
+    imgui_json::value bpJson;
+    {
+        std::lock_guard<std::mutex> lk(mBpLock);
+        bpJson = mBpPending ? mPendingBpJson : mBp->m_Document->Serialize();
+    }
     bpTrans->SetBluePrintFromJson(bpJson);
     bpTrans->SetKeyPoint(mKeyPoints);
     return MediaCore::VideoTransition::Holder(bpTrans);
@@ -3067,7 +3152,10 @@ MediaCore::VideoTransition::Holder BluePrintVideoTransition::Clone()
 imgui_json::value BluePrintVideoTransition::SaveAsJson() const
 {
     imgui_json::value j;
-    j["BluePrint"] = mBp->m_Document->Serialize();
+    {
+        std::lock_guard<std::mutex> lk(mBpLock);
+        j["BluePrint"] = mBpPending ? mPendingBpJson : mBp->m_Document->Serialize();
+    }
     // TODO: KeyPointEditor::Save() CANNOT be invoked here because it needs to be changed as 'const' member function!
     // imgui_json::value jnCurve;
     // mKeyPoints.Save(jnCurve);
@@ -3075,21 +3163,62 @@ imgui_json::value BluePrintVideoTransition::SaveAsJson() const
     return std::move(j);
 }
 
+// The transition output is given a pooled buffer with the layout of the first input, so the output node which writes
+// its result into the given mat reuses it instead of allocating a new frame each time
+static ImGui::ImMat AcquireTransitionOutMat(const ImGui::ImMat& inMat)
+{
+    if (inMat.empty() || inMat.device != IM_DD_CPU || inMat.dims > 3)
+        return ImGui::ImMat();
+    auto outMat = MEC::FrameBufferPool::GetDefaultInstance()->AcquireMat(inMat.w, inMat.h, inMat.c, inMat.type, inMat.elempack);
+    if (!outMat.empty())
+        outMat.copy_attribute(inMat);
+    return outMat;
+}
+
 ImGui::ImMat BluePrintVideoTransition::MixTwoImages(const ImGui::ImMat& vmat1, const ImGui::ImMat& vmat2, int64_t pos, int64_t dur)
 {
-    std::lock_guard<std::mutex> lk(mBpLock);
-    if (mBp && mBp->Blueprint_IsExecutable())
+    // native transitions have no state, they don't need the blueprint lock. Transitions with key-frame curves
+    // still go through the blueprint, because the curves drive the node parameters.
+    auto hNativeTrans = std::atomic_load(&mhNativeTransition);
+    if (hNativeTrans && dur > 0 && mKeyPoints.GetCurveCount() == 0)
+    {
+        const int64_t i64OvlpStart = mOverlap ? mOverlap->Start() : 0;
+        auto outMat = hNativeTrans->MixTwoImages(vmat1, vmat2, (float)(pos - i64OvlpStart) / dur);
+        if (!outMat.empty())
+            return outMat;
+    }
+    // 'mBp' is used when it's free, otherwise a worker copy is taken so several frames can be mixed concurrently
+    std::unique_lock<std::mutex> lk(mBpLock, std::try_to_lock);
+    if (!lk.owns_lock())
+    {
+        auto pWorkerBp = AcquireWorkerBluePrint();
+        if (pWorkerBp)
+        {
+            auto outMat = RunBluePrint(pWorkerBp, vmat1, vmat2, pos, dur);
+            ReleaseWorkerBluePrint(pWorkerBp);
+            return outMat;
+        }
+        lk.lock();
+    }
+    BuildPendingBluePrint();
+    return RunBluePrint(mBp, vmat1, vmat2, pos, dur);
+}
+
+ImGui::ImMat BluePrintVideoTransition::RunBluePrint(BluePrint::BluePrintUI* pBp, const ImGui::ImMat& vmat1, const ImGui::ImMat& vmat2, int64_t pos, int64_t dur)
+{
+    if (pBp && pBp->Blueprint_IsExecutable())
     {
+        const int64_t i64OvlpStart = mOverlap ? mOverlap->Start() : 0;
         // setup bp input curve
         for (int i = 0; i < mKeyPoints.GetCurveCount(); i++)
         {
             auto name = mKeyPoints.GetCurveName(i);
-            auto value = mKeyPoints.GetValue(i, pos - mOverlap->Start());
-            mBp->Blueprint_SetTransition(name, value);
+            auto value = mKeyPoints.GetValue(i, pos - i64OvlpStart);
+            pBp->Blueprint_SetTransition(name, value);
         }
         ImGui::ImMat inMat1(vmat1), inMat2(vmat2);
-        ImGui::ImMat outMat;
-        mBp->Blueprint_RunTransition(inMat1, inMat2, outMat, pos - mOverlap->Start(), dur);
+        ImGui::ImMat outMat = AcquireTransitionOutMat(vmat1);
+        pBp->Blueprint_RunTransition(inMat1, inMat2, outMat, pos - i64OvlpStart, dur);
         return outMat;
     }
     return vmat1;
@@ -3098,21 +3227,65 @@ ImGui::ImMat BluePrintVideoTransition::MixTwoImages(const ImGui::ImMat& vmat1, c
 void BluePrintVideoTransition::SetBluePrintFromJson(imgui_json::value& bpJson)
 {
     // Logger::Log(Logger::DEBUG) << "Create bp transition from json " << bpJson.dump() << std::endl;
+    {
+        std::lock_guard<std::mutex> lk(mBpLock);
+        if (mBpPending)
+        {
+            // the native transition and the worker copies only need the json
+            mPendingBpJson = bpJson;
+            UpdateNativeTransition(bpJson);
+            UpdateWorkerBluePrints(bpJson);
+            return;
+        }
+    }
     mBp->File_New_Transition(bpJson, "VideoTransition", "Video");
     if (!mBp->Blueprint_IsValid())
     {
         mBp->Finalize();
         return;
     }
+    UpdateNativeTransition(bpJson);
+    UpdateWorkerBluePrints(bpJson);
+}
+
+void BluePrintVideoTransition::EnsureBluePrint()
+{
+    std::lock_guard<std::mutex> lk(mBpLock);
+    BuildPendingBluePrint();
+}
+
+bool BluePrintVideoTransition::IsBluePrintReady()
+{
+    std::lock_guard<std::mutex> lk(mBpLock);
+    return !mBpPending;
+}
+
+// 'mBpLock' must be held by the caller
+void BluePrintVideoTransition::BuildPendingBluePrint()
+{
+    if (!mBpPending)
+        return;
+    mBp = new BluePrint::BluePrintUI();
+    mBp->Initialize();
+    BluePrint::BluePrintCallbackFunctions callbacks;
+    callbacks.BluePrintOnChanged = OnBluePrintChange;
+    mBp->SetCallbacks(callbacks, this);
+    mBp->File_New_Transition(mPendingBpJson, "VideoTransition", "Video");
+    if (!mBp->Blueprint_IsValid())
+        mBp->Finalize();
+    mPendingBpJson = imgui_json::value();
+    mBpPending = false;
 }
 } // namespace MediaTimeline
 
 namespace MediaTimeline
 {
 // BluePrintAudioTransition class
-BluePrintAudioTransition::BluePrintAudioTransition(void * handle)
-    : mHandle(handle)
+BluePrintAudioTransition::BluePrintAudioTransition(void * handle, bool bDeferBluePrint)
+    : mHandle(handle), mBpPending(bDeferBluePrint)
 {
+    if (bDeferBluePrint)
+        return;
     TimeLine * timeline = (TimeLine *)handle;
     imgui_json::value transition_BP; 
     mBp = new BluePrint::BluePrintUI();
@@ -3165,7 +3338,10 @@ int BluePrintAudioTransition::OnBluePrintChange(int type, std::string name, void
 
 ImGui::ImMat BluePrintAudioTransition::MixTwoAudioMats(const ImGui::ImMat& amat1, const ImGui::ImMat& amat2, int64_t pos)
 {
+    if (!mOverlap)
+        return amat1;
     std::lock_guard<std::mutex> lk(mBpLock);
+    BuildPendingBluePrint();
     if (mBp && mBp->Blueprint_IsExecutable())
     {
         // setup bp input curve
@@ -3176,7 +3352,7 @@ ImGui::ImMat BluePrintAudioTransition::MixTwoAudioMats(const ImGui::ImMat& amat1
             mBp->Blueprint_SetTransition(name, value);
         }
         ImGui::ImMat inMat1(amat1), inMat2(amat2);
-        ImGui::ImMat outMat;
+        ImGui::ImMat outMat = AcquireTransitionOutMat(amat1);
         mBp->Blueprint_RunTransition(inMat1, inMat2, outMat, pos - mOverlap->Start(), mOverlap->End() - mOverlap->Start());
         return outMat;
     }
@@ -3186,6 +3362,14 @@ ImGui::ImMat BluePrintAudioTransition::MixTwoAudioMats(const ImGui::ImMat& amat1
 void BluePrintAudioTransition::SetBluePrintFromJson(imgui_json::value& bpJson)
 {
     // Logger::Log(Logger::DEBUG) << "Create bp transition from json " << bpJson.dump() << std::endl;
+    {
+        std::lock_guard<std::mutex> lk(mBpLock);
+        if (mBpPending)
+        {
+            mPendingBpJson = bpJson;
+            return;
+        }
+    }
     mBp->File_New_Transition(bpJson, "AudioTransition", "Audio");
     if (!mBp->Blueprint_IsValid())
     {
@@ -3194,6 +3378,35 @@ void BluePrintAudioTransition::SetBluePrintFromJson(imgui_json::value& bpJson)
     }
 }
 
+void BluePrintAudioTransition::EnsureBluePrint()
+{
+    std::lock_guard<std::mutex> lk(mBpLock);
+    BuildPendingBluePrint();
+}
+
+bool BluePrintAudioTransition::IsBluePrintReady()
+{
+    std::lock_guard<std::mutex> lk(mBpLock);
+    return !mBpPending;
+}
+
+// 'mBpLock' must be held by the caller
+void BluePrintAudioTransition::BuildPendingBluePrint()
+{
+    if (!mBpPending)
+        return;
+    mBp = new BluePrint::BluePrintUI();
+    mBp->Initialize();
+    BluePrint::BluePrintCallbackFunctions callbacks;
+    callbacks.BluePrintOnChanged = OnBluePrintChange;
+    mBp->SetCallbacks(callbacks, this);
+    mBp->File_New_Transition(mPendingBpJson, "AudioTransition", "Audio");
+    if (!mBp->Blueprint_IsValid())
+        mBp->Finalize();
+    mPendingBpJson = imgui_json::value();
+    mBpPending = false;
+}
+
 } // namespace MediaTimeline
 
 namespace MediaTimeline
@@ -4135,7 +4348,9 @@ EditingVideoOverlap::EditingVideoOverlap(int64_t id, void* handle)
         auto hOvlp = timeline->mMtvReader->GetOverlapById(ovlp->mID);
         IM_ASSERT(hOvlp);
         mTransition = dynamic_cast<BluePrintVideoTransition *>(hOvlp->GetTransition().get());
-        if (!mTransition)
+        if (mTransition)
+            mTransition->EnsureBluePrint();
+        else
         {
             mTransition = new BluePrintVideoTransition(timeline);
             mTransition->SetKeyPoint(ovlp->mTransitionKeyPoints);
@@ -4477,7 +4692,9 @@ EditingAudioOverlap::EditingAudioOverlap(int64_t id, void* handle)
         auto hOvlp = timeline->mMtaReader->GetOverlapById(ovlp->mID);
         IM_ASSERT(hOvlp);
         mTransition = dynamic_cast<BluePrintAudioTransition *>(hOvlp->GetTransition().get());
-        if (!mTransition)
+        if (mTransition)
+            mTransition->EnsureBluePrint();
+        else
         {
             mTransition = new BluePrintAudioTransition(timeline);
             mTransition->SetKeyPoint(ovlp->mTransitionKeyPoints);
@@ -5266,7 +5483,7 @@ void MediaTrack::CalculateAudioScopeData(ImGui::ImMat& mat_in)
     int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
     if (mat_in.elempack > 1)
     {
-        mat.create_type(fft_size, 1, mat_in.c, mat_in.type);
+        mat = MEC::FrameBufferPool::GetDefaultInstance()->AcquireMat(fft_size, 1, mat_in.c, mat_in.type);
         float * data = (float *)mat_in.data;
         for (int x = 0; x < mat.w; x++)
         {
@@ -5955,10 +6172,15 @@ TimeLine::TimeLine()
     mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
     mRecordIter = mHistoryRecords.begin();
     mMediaPlayer = new MEC::MediaPlayer(mTxMgr);
+    RegisterMemoryProviders();
 }
 
 TimeLine::~TimeLine()
 {    
+    for (auto id : mMemProviderIds)
+        MEC::MemoryTracker::UnregisterProvider(id);
+    mMemProviderIds.clear();
+    StopBluePrintPrewarm();
     if (mEncodingPreviewTexture) { ImGui::ImDestroyTexture(mEncodingPreviewTexture); mEncodingPreviewTexture = nullptr; }
     mAudioAttribute.channel_data.clear();
 
@@ -6732,6 +6954,176 @@ bool TimeLine::DeleteClip(int64_t id, std::list<imgui_json::value>* pActionList)
     return true;
 }
 
+int TimeLine::CutClipWithGroup(Clip* clip, int64_t pos, std::list<imgui_json::value>* pActionList, std::vector<int64_t>* pNewClipIds, bool checkOnly)
+{
+    pos = AlignTime(pos);
+    // the clip and the members of its group are cut together, same as the interactive cut
+    std::vector<Clip*> linkedClips = {clip};
+    if (clip->mGroupID != -1)
+    {
+        const auto targetGid = clip->mGroupID;
+        auto grpIter = std::find_if(m_Groups.begin(), m_Groups.end(), [targetGid] (auto& grp) {
+            return grp.mID == targetGid;
+        });
+        if (grpIter != m_Groups.end())
+        {
+            for (auto clipId : grpIter->m_Grouped_Clips)
+            {
+                auto member = clipId != clip->mID ? FindClipByID(clipId) : nullptr;
+                if (member)
+                    linkedClips.push_back(member);
+            }
+        }
+    }
+    std::vector<Clip*> cuttingClips;
+    for (auto linkedClip : linkedClips)
+    {
+        if (pos <= linkedClip->mStart || pos >= linkedClip->mEnd)
+            continue;
+        // a cut can't be made in an overlap, and cutting only some of the linked clips breaks their sync
+        auto track = FindTrackByClipID(linkedClip->mID);
+        if (!track || track->mLocked)
+            return -1;
+        for (auto ovlp : track->m_Overlaps)
+        {
+            if (pos >= ovlp->mStart && pos <= ovlp->mEnd)
+                return -1;
+        }
+        cuttingClips.push_back(linkedClip);
+    }
+    if (cuttingClips.empty() || checkOnly)
+        return (int)cuttingClips.size();
+
+    // only the new clips of the linked clips cut together are grouped, a single cut doesn't make a group of one clip
+    int64_t newGroupId = -1;
+    if (cuttingClips.size() > 1)
+    {
+        ClipGroup newGroup(this);
+        m_Groups.push_back(newGroup);
+        newGroupId = newGroup.mID;
+    }
+    int cutCount = 0;
+    for (auto cuttingClip : cuttingClips)
+    {
+        auto newClipId = cuttingClip->Cutting(pos, newGroupId, -1, pActionList, false);
+        if (newClipId == -1)
+            continue;
+        cutCount++;
+        if (pNewClipIds)
+            pNewClipIds->push_back(newClipId);
+    }
+    return cutCount;
+}
+
+int TimeLine::CutClipAtPositions(int64_t clip_id, const std::vector<int64_t>& positions, std::list<imgui_json::value>* pActionList)
+{
+    auto clip = FindClipByID(clip_id);
+    if (!clip)
+        return 0;
+    auto track = FindTrackByClipID(clip_id);
+    if (!track || track->mLocked)
+        return 0;
+    std::vector<int64_t> cutPositions;
+    for (auto pos : positions)
+    {
+        int64_t cutPos = AlignTime(clip->mStart + pos - clip->mStartOffset);
+        if (cutPos > clip->mStart && cutPos < clip->mEnd)
+            cutPositions.push_back(cutPos);
+    }
+    std::sort(cutPositions.begin(), cutPositions.end());
+    cutPositions.erase(std::unique(cutPositions.begin(), cutPositions.end()), cutPositions.end());
+
+    // cut from the end of the clip, so every cut is made on the original clip and the original members of its group
+    int cutCount = 0;
+    for (auto iter = cutPositions.rbegin(); iter != cutPositions.rend(); iter++)
+    {
+        if (CutClipWithGroup(clip, *iter, pActionList) > 0)
+            cutCount++;
+    }
+    Update();
+    return cutCount;
+}
+
+int TimeLine::RemoveClipRanges(int64_t clip_id, const std::vector<std::pair<int64_t, int64_t>>& ranges, std::list<imgui_json::value>* pActionList)
+{
+    auto clip = FindClipByID(clip_id);
+    if (!clip)
+        return 0;
+    auto track = FindTrackByClipID(clip_id);
+    if (!track || track->mLocked)
+        return 0;
+    // map the source ranges onto the timeline, and merge the overlapped ones
+    std::vector<std::pair<int64_t, int64_t>> cutRanges;
+    for (const auto& range : ranges)
+    {
+        int64_t start = AlignTime(clip->mStart + range.first - clip->mStartOffset);
+        int64_t end = AlignTime(clip->mStart + range.second - clip->mStartOffset);
+        if (start < clip->mStart) start = clip->mStart;
+        if (end > clip->mEnd) end = clip->mEnd;
+        if (start >= end)
+            continue;
+        cutRanges.push_back({start, end});
+    }
+    if (cutRanges.empty())
+        return 0;
+    std::sort(cutRanges.begin(), cutRanges.end());
+    std::vector<std::pair<int64_t, int64_t>> mergedRanges;
+    for (const auto& range : cutRanges)
+    {
+        if (!mergedRanges.empty() && range.first <= mergedRanges.back().second)
+            mergedRanges.back().second = std::max(mergedRanges.back().second, range.second);
+        else
+            mergedRanges.push_back(range);
+    }
+
+    // the clip and the members of its group are cut at the range boundaries and the pieces inside are removed together.
+    // Cut from the end of the clip, so the original clips always hold the parts before the current range.
+    std::vector<int64_t> linkedClipIds = {clip->mID};
+    if (clip->mGroupID != -1)
+    {
+        const auto targetGid = clip->mGroupID;
+        auto grpIter = std::find_if(m_Groups.begin(), m_Groups.end(), [targetGid] (auto& grp) {
+            return grp.mID == targetGid;
+        });
+        if (grpIter != m_Groups.end())
+        {
+            for (auto clipId : grpIter->m_Grouped_Clips)
+            {
+                if (clipId != clip->mID)
+                    linkedClipIds.push_back(clipId);
+            }
+        }
+    }
+    int removedCount = 0;
+    bool orgClipRemoved = false;
+    for (auto iter = mergedRanges.rbegin(); iter != mergedRanges.rend() && !orgClipRemoved; iter++)
+    {
+        // a range with a boundary in an overlap is skipped as a whole
+        if (CutClipWithGroup(clip, iter->second, nullptr, nullptr, true) < 0 || CutClipWithGroup(clip, iter->first, nullptr, nullptr, true) < 0)
+            continue;
+        CutClipWithGroup(clip, iter->second, pActionList, &linkedClipIds);
+        CutClipWithGroup(clip, iter->first, pActionList, &linkedClipIds);
+        for (auto idIter = linkedClipIds.begin(); idIter != linkedClipIds.end();)
+        {
+            auto linkedClip = FindClipByID(*idIter);
+            if (linkedClip && linkedClip->mStart >= iter->first && linkedClip->mEnd <= iter->second)
+            {
+                if (linkedClip == clip)
+                    orgClipRemoved = true;
+                if (DeleteClip(*idIter, pActionList))
+                {
+                    removedCount++;
+                    idIter = linkedClipIds.erase(idIter);
+                    continue;
+                }
+            }
+            idIter++;
+        }
+    }
+    Update();
+    return removedCount;
+}
+
 void TimeLine::DeleteOverlap(int64_t id)
 {
     for (auto iter = m_Overlaps.begin(); iter != m_Overlaps.end();)
@@ -6808,10 +7200,25 @@ void TimeLine::UpdateCurrent()
 
 void TimeLine::RefreshPreview(bool updateDuration)
 {
+    if (mDeferReaderRefresh)
+    {
+        mPendingVideoRefresh = std::max(mPendingVideoRefresh, updateDuration ? 2 : 1);
+        return;
+    }
     mMtvReader->Refresh(updateDuration);
     mIsPreviewNeedUpdate = true;
 }
 
+void TimeLine::RefreshAudio(bool updateDuration)
+{
+    if (mDeferReaderRefresh)
+    {
+        mPendingAudioRefresh = std::max(mPendingAudioRefresh, updateDuration ? 2 : 1);
+        return;
+    }
+    mMtaReader->Refresh(updateDuration);
+}
+
 void TimeLine::RefreshTrackView(const std::unordered_set<int64_t>& trackIds)
 {
     mMtvReader->RefreshTrackView(trackIds);
@@ -7826,7 +8233,7 @@ void TimeLine::CustomDraw(
     }
 }
 
-int TimeLine::Load(const imgui_json::value& value)
+int TimeLine::Load(const imgui_json::value& value, const ListLoader& listLoader)
 {
     // load ID Generator state
     if (value.contains("IDGenerateState"))
@@ -8020,9 +8427,22 @@ int TimeLine::Load(const imgui_json::value& value)
     // load data layer
     ConfigureDataLayer();
 
+    // the lists not in 'value' are pulled one at a time, so only one of them is decoded in memory
+    imgui_json::value listHolder;
+    auto GetList = [&] (const std::string& name, const imgui_json::array*& listArray) {
+        listArray = nullptr;
+        if (imgui_json::GetPtrTo(value, name, listArray) || !listLoader)
+            return listArray != nullptr;
+        listHolder = imgui_json::value();
+        auto pList = listLoader(name, listHolder);
+        if (pList && pList->is_array())
+            listArray = &pList->get<imgui_json::array>();
+        return listArray != nullptr;
+    };
+
     // load media clip
     const imgui_json::array* mediaClipArray = nullptr;
-    if (imgui_json::GetPtrTo(value, "MediaClip", mediaClipArray))
+    if (GetList("MediaClip", mediaClipArray))
     {
         for (const auto& jnClipJson : *mediaClipArray)
         {
@@ -8046,7 +8466,7 @@ int TimeLine::Load(const imgui_json::value& value)
 
     // load media group
     const imgui_json::array* mediaGroupArray = nullptr;
-    if (imgui_json::GetPtrTo(value, "MediaGroup", mediaGroupArray))
+    if (GetList("MediaGroup", mediaGroupArray))
     {
         for (auto& group : *mediaGroupArray)
         {
@@ -8058,7 +8478,7 @@ int TimeLine::Load(const imgui_json::value& value)
 
     // load media overlap
     const imgui_json::array* mediaOverlapArray = nullptr;
-    if (imgui_json::GetPtrTo(value, "MediaOverlap", mediaOverlapArray))
+    if (GetList("MediaOverlap", mediaOverlapArray))
     {
         for (auto& overlap : *mediaOverlapArray)
         {
@@ -8070,7 +8490,7 @@ int TimeLine::Load(const imgui_json::value& value)
 
     // load media track
     const imgui_json::array* mediaTrackArray = nullptr;
-    if (imgui_json::GetPtrTo(value, "MediaTrack", mediaTrackArray))
+    if (GetList("MediaTrack", mediaTrackArray))
     {
         for (auto& track : *mediaTrackArray)
         {
@@ -8081,6 +8501,7 @@ int TimeLine::Load(const imgui_json::value& value)
             }
         }
     }
+    listHolder = imgui_json::value();
 
     // load audio attribute
     if (value.contains("AudioAttribute"))
@@ -8525,34 +8946,113 @@ void TimeLine::Save(imgui_json::value& value)
     value["SortMethod"] = imgui_json::number(mSortMethod);
 }
 
+// the actions are copied and dumped on the log writer thread, nothing is done if VERBOSE is disabled
+template <typename ActionListT>
+static void PostActionList(const std::string& title, const ActionListT& actionList)
+{
+    if (!MEC::AsyncLog::IsEnabled(nullptr, Logger::VERBOSE))
+        return;
+    MEC::AsyncLog::PostLazy(nullptr, Logger::VERBOSE, [title, actionList] (std::ostream& os) {
+        os << std::endl << title << " : [" << std::endl;
+        if (actionList.empty())
+        {
+            os << "(EMPTY)" << std::endl;
+        }
+        else
+        {
+            for (auto& action : actionList)
+                os << "\t" << action.dump() << "," << std::endl;
+        }
+        os << "] #" << title << std::endl;
+    });
+}
+
 void TimeLine::PrintActionList(const std::string& title, const std::list<imgui_json::value>& actionList)
 {
-    Logger::Log(Logger::VERBOSE) << std::endl << title << " : [" << std::endl;
-    if (actionList.empty())
+    PostActionList(title, actionList);
+}
+
+void TimeLine::PrintActionList(const std::string& title, const imgui_json::array& actionList)
+{
+    PostActionList(title, actionList);
+}
+
+void TimeLine::PrewarmBluePrints()
+{
+    // start a new round when the play head has moved away from the last round, or clips are added
+    if (mBpPrewarmRunning)
+        return;
+    if (mBpPrewarmPos != INT64_MIN && std::abs(mCurrentTime-mBpPrewarmPos) < BP_PREWARM_RANGE/2 && mBpPrewarmClipCount == m_Clips.size())
+        return;
+    if (mBpPrewarmThread.joinable())
+        mBpPrewarmThread.join();
+    mBpPrewarmPos = mCurrentTime;
+    mBpPrewarmClipCount = m_Clips.size();
+
+    const int64_t i64WndStart = mCurrentTime-BP_PREWARM_RANGE;
+    const int64_t i64WndEnd = mCurrentTime+BP_PREWARM_RANGE;
+    std::list<std::function<void()>> aPrewarmJobs;
+    for (auto clip : m_Clips)
     {
-        Logger::Log(Logger::VERBOSE) << "(EMPTY)" << std::endl;
+        if (!clip->mEventStack || clip->End() < i64WndStart || clip->Start() > i64WndEnd)
+            continue;
+        for (auto& hEvent : clip->mEventStack->GetEventList())
+        {
+            if (!hEvent->IsBpReady())
+                aPrewarmJobs.push_back([hEvent] { hEvent->GetBp(); });
+        }
     }
-    else
+    for (auto ovlp : m_Overlaps)
     {
-        for (auto& action : actionList)
-            Logger::Log(Logger::VERBOSE) << "\t" << action.dump() << "," << std::endl;
+        if (ovlp->mEnd < i64WndStart || ovlp->mStart > i64WndEnd)
+            continue;
+        if (IS_VIDEO(ovlp->mType) && mMtvReader)
+        {
+            auto hOvlp = mMtvReader->GetOverlapById(ovlp->mID);
+            auto hTrans = hOvlp ? hOvlp->GetTransition() : nullptr;
+            auto pTrans = dynamic_cast<BluePrintVideoTransition*>(hTrans.get());
+            if (pTrans && !pTrans->IsBluePrintReady())
+                aPrewarmJobs.push_back([hTrans, pTrans] { pTrans->EnsureBluePrint(); });
+        }
+        else if (IS_AUDIO(ovlp->mType) && mMtaReader)
+        {
+            auto hOvlp = mMtaReader->GetOverlapById(ovlp->mID);
+            auto hTrans = hOvlp ? hOvlp->GetTransition() : nullptr;
+            auto pTrans = dynamic_cast<BluePrintAudioTransition*>(hTrans.get());
+            if (pTrans && !pTrans->IsBluePrintReady())
+                aPrewarmJobs.push_back([hTrans, pTrans] { pTrans->EnsureBluePrint(); });
+        }
     }
-    Logger::Log(Logger::VERBOSE) << "] #" << title << std::endl << std::endl;
+    if (aPrewarmJobs.empty())
+        return;
+    Logger::Log(Logger::DEBUG) << "Prewarm " << aPrewarmJobs.size() << " blueprint(s) around " << mCurrentTime << "ms." << std::endl;
+    mBpPrewarmRunning = true;
+    mBpPrewarmThread = std::thread(&TimeLine::_BpPrewarmProc, this, std::move(aPrewarmJobs));
+    MEC::Tracer::NameThread(mBpPrewarmThread, "TL-BpPrewarm");
 }
 
-void TimeLine::PrintActionList(const std::string& title, const imgui_json::array& actionList)
+void TimeLine::StopBluePrintPrewarm()
 {
-    Logger::Log(Logger::VERBOSE) << std::endl << title << " : [" << std::endl;
-    if (actionList.empty())
-    {
-        Logger::Log(Logger::VERBOSE) << "(EMPTY)" << std::endl;
-    }
-    else
+    if (!mBpPrewarmThread.joinable())
+        return;
+    mBpPrewarmQuit = true;
+    mBpPrewarmThread.join();
+    mBpPrewarmThread = std::thread();
+    mBpPrewarmQuit = false;
+    mBpPrewarmRunning = false;
+    mBpPrewarmPos = INT64_MIN;
+}
+
+void TimeLine::_BpPrewarmProc(std::list<std::function<void()>> aPrewarmJobs)
+{
+    for (auto& job : aPrewarmJobs)
     {
-        for (auto& action : actionList)
-            Logger::Log(Logger::VERBOSE) << "\t" << action.dump() << "," << std::endl;
+        if (mBpPrewarmQuit)
+            break;
+        MEC_TRACE_SCOPE("TL::PrewarmBluePrint");
+        job();
     }
-    Logger::Log(Logger::VERBOSE) << "] #" << title << std::endl << std::endl;
+    mBpPrewarmRunning = false;
 }
 
 void TimeLine::PerformUiActions()
@@ -8562,8 +9062,13 @@ void TimeLine::PerformUiActions()
 #endif
     if (mUiActions.empty())
         return;
+    MEC_TRACE_SCOPE("TL::PerformUiActions");
+    // the actions may release the event stacks and the overlaps that are being prewarmed
+    StopBluePrintPrewarm();
 
     PrintActionList("UiActions", mUiActions);
+    // a batched edit(like applying hundreds of cuts) shouldn't make the readers rebuild their clip list for each action
+    mDeferReaderRefresh = mUiActions.size() > 1;
     for (auto& action : mUiActions)
     {
         if (action["action"].get<imgui_json::string>() == "BP_OPERATION")
@@ -8589,6 +9094,12 @@ void TimeLine::PerformUiActions()
             continue;
         }
     }
+    mDeferReaderRefresh = false;
+    if (mPendingVideoRefresh > 0)
+        RefreshPreview(mPendingVideoRefresh > 1);
+    if (mPendingAudioRefresh > 0)
+        RefreshAudio(mPendingAudioRefresh > 1);
+    mPendingVideoRefresh = mPendingAudioRefresh = 0;
     if (!mUiActions.empty())
     {
         SyncDataLayer();
@@ -8599,6 +9110,7 @@ void TimeLine::PerformUiActions()
 
 void TimeLine::PerformVideoAction(imgui_json::value& action)
 {
+    MEC_TRACE_SCOPE("TL::PerformVideoAction");
     std::string actionName = action["action"].get<imgui_json::string>();
     if (actionName == "ADD_CLIP")
     {
@@ -8753,6 +9265,7 @@ void TimeLine::PerformVideoAction(imgui_json::value& action)
 
 void TimeLine::PerformAudioAction(imgui_json::value& action)
 {
+    MEC_TRACE_SCOPE("TL::PerformAudioAction");
     std::string actionName = action["action"].get<imgui_json::string>();
     if (actionName == "ADD_CLIP")
     {
@@ -8772,7 +9285,7 @@ void TimeLine::PerformAudioAction(imgui_json::value& action)
         bool updateDuration = true;
         if (action.contains("update_duration"))
             updateDuration = action["update_duration"].get<imgui_json::boolean>();
-        mMtaReader->Refresh(updateDuration);
+        RefreshAudio(updateDuration);
     }
     else if (actionName == "REMOVE_CLIP")
     {
@@ -8783,7 +9296,7 @@ void TimeLine::PerformAudioAction(imgui_json::value& action)
         bool updateDuration = true;
         if (action.contains("update_duration"))
             updateDuration = action["update_duration"].get<imgui_json::boolean>();
-        mMtaReader->Refresh(updateDuration);
+        RefreshAudio(updateDuration);
     }
     else if (actionName == "MOVE_CLIP")
     {
@@ -8805,7 +9318,7 @@ void TimeLine::PerformAudioAction(imgui_json::value& action)
         {
             dstAudTrack->MoveClip(clipId, newStart);
         }
-        mMtaReader->Refresh();
+        RefreshAudio();
     }
     else if (actionName == "CROP_CLIP")
     {
@@ -8822,7 +9335,7 @@ void TimeLine::PerformAudioAction(imgui_json::value& action)
         bool updateDuration = true;
         if (action.contains("update_duration"))
             updateDuration = action["update_duration"].get<imgui_json::boolean>();
-        mMtaReader->Refresh(updateDuration);
+        RefreshAudio(updateDuration);
     }
     else if (actionName == "CUT_CLIP")
     {
@@ -8864,7 +9377,7 @@ void TimeLine::PerformAudioAction(imgui_json::value& action)
         auto pUiClip = dynamic_cast<AudioClip*>(FindClipByID(newClipId));
         pUiClip->SetDataLayer(hNewClip, true);
         hAudTrk->InsertClip(hNewClip);
-        mMtaReader->Refresh(false);
+        RefreshAudio(false);
     }
     else if (actionName == "ADD_TRACK")
     {
@@ -9078,6 +9591,12 @@ int TimeLine::OnVideoEventStackFilterBpChanged(int type, std::string name, void*
     }
     if (needUpdateView)
     {
+        auto pVidEvt = dynamic_cast<MEC::VideoEvent*>(pEvt);
+        if (pVidEvt)
+        {
+            pVidEvt->InvalidateTileBluePrints();
+            pVidEvt->InvalidateMaskCache();
+        }
         auto pClip = pEsf->GetVideoClip();
         auto trackId = pClip->TrackId();
         timeline->mNeedUpdateTrackIds.insert(trackId);
@@ -9159,7 +9678,7 @@ void TimeLine::SyncDataLayer(bool forceRefresh)
                     if (vidOvlp->Id() != ovlp->mID)
                     {
                         vidOvlp->SetId(ovlp->mID);
-                        BluePrintVideoTransition* bpvt = new BluePrintVideoTransition(this);
+                        BluePrintVideoTransition* bpvt = new BluePrintVideoTransition(this, true);
                         bpvt->SetBluePrintFromJson(ovlp->mTransitionBP);
                         bpvt->SetKeyPoint(ovlp->mTransitionKeyPoints);
                         MediaCore::VideoTransition::Holder hTrans(bpvt);
@@ -9197,7 +9716,7 @@ void TimeLine::SyncDataLayer(bool forceRefresh)
                     if (audOvlp->Id() != ovlp->mID)
                     {
                         audOvlp->SetId(ovlp->mID);
-                        BluePrintAudioTransition* bpat = new BluePrintAudioTransition(this);
+                        BluePrintAudioTransition* bpat = new BluePrintAudioTransition(this, true);
                         bpat->SetBluePrintFromJson(ovlp->mTransitionBP);
                         bpat->SetKeyPoint(ovlp->mTransitionKeyPoints);
                         MediaCore::AudioTransition::Holder hTrans(bpat);
@@ -9223,13 +9742,14 @@ void TimeLine::SyncDataLayer(bool forceRefresh)
     int OvlpCnt = 0;
     for (auto ovlp : m_Overlaps)
     {
-        if (IS_VIDEO(ovlp->mType))
+        if (IS_VIDEO(ovlp->mType) && mMtvReader)
             OvlpCnt++;
         if (IS_AUDIO(ovlp->mType))
             OvlpCnt ++;
     }
-    Logger::Log(Logger::VERBOSE) << std::endl << mMtvReader << std::endl;
-    Logger::Log(Logger::VERBOSE) << mMtaReader << std::endl << std::endl;
+    // the readers are formatted here since they're changed after this, but only if VERBOSE is enabled
+    MEC_ASYNC_LOG(nullptr, Logger::VERBOSE) << std::endl << mMtvReader;
+    MEC_ASYNC_LOG(nullptr, Logger::VERBOSE) << mMtaReader << std::endl;
     if (syncedOverlapCount != OvlpCnt)
         Logger::Log(Logger::Error) << "Overlap SYNC FAILED! Synced count is " << syncedOverlapCount
             << ", while the count of video overlap array is " << OvlpCnt << "." << std::endl;
@@ -9375,6 +9895,14 @@ uint32_t TimeLine::SimplePcmStream::Read(uint8_t* buff, uint32_t buffSize, bool
 {
     if (!m_areader)
         return 0;
+    // this is called from the audio render thread, which is not created by us
+    static thread_local bool s_bTraceThreadNamed = false;
+    if (!s_bTraceThreadNamed)
+    {
+        MEC::Tracer::NameCurrentThread("AudioRender");
+        s_bTraceThreadNamed = true;
+    }
+    MEC_TRACE_SCOPE("TL::ReadPcm");
     std::lock_guard<std::mutex> lk(m_amatLock);
     uint32_t readSize = 0;
     while (readSize < buffSize)
@@ -9445,8 +9973,7 @@ void TimeLine::CalculateAudioScopeData(ImGui::ImMat& mat_in)
         return;
     const int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
     const int ch = mat_in.c;
-    ImGui::ImMat mat;
-    mat.create_type(fft_size, 1, ch, IM_DT_FLOAT32);
+    auto mat = MEC::FrameBufferPool::GetDefaultInstance()->AcquireMat(fft_size, 1, ch, IM_DT_FLOAT32);
     // copy fft_size samples from input mat, and convert them into float type
     {
         float** ppDstPtrs = new float*[ch];
@@ -9648,7 +10175,7 @@ void TimeLine::StartEncoding()
     mQuitEncoding = false;
     mIsEncoding = true;
     mEncodingThread = std::thread(&TimeLine::_EncodeProc, this);
-    SysUtils::SetThreadName(mEncodingThread, "TL-EncProc");
+    MEC::Tracer::NameThread(mEncodingThread, "TL-EncProc");
 }
 
 void TimeLine::StopEncoding()
@@ -9685,6 +10212,7 @@ void TimeLine::_EncodeProc()
     if (mEncMtaReader) mEncMtaReader->SeekTo(mEncodingStart);
     while (!mQuitEncoding && (!vidInputEof || !audInputEof))
     {
+        MEC_TRACE_SCOPE("TL::EncodeLoop");
         bool idleLoop = true;
         if ((!vidInputEof && vidpos <= audpos) || audInputEof)
         {
@@ -9794,12 +10322,81 @@ void TimeLine::_EncodeProc()
 void TimeLine::AddNewRecord(imgui_json::value& record)
 {
     // truncate the history record list if needed
+    for (auto iter = mRecordIter; iter != mHistoryRecords.end(); iter++)
+        mHistoryRecordsBytes -= MEC::MemoryTracker::EstimateJsonSize(*iter);
     if (mRecordIter != mHistoryRecords.end())
         mHistoryRecords.erase(mRecordIter, mHistoryRecords.end());
+    mHistoryRecordsBytes += MEC::MemoryTracker::EstimateJsonSize(record);
     mHistoryRecords.push_back(std::move(record));
     mRecordIter = mHistoryRecords.end();
 }
 
+std::list<imgui_json::value>::iterator TimeLine::InsertHistoryRecord(std::list<imgui_json::value>::iterator pos, const imgui_json::value& record)
+{
+    mHistoryRecordsBytes += MEC::MemoryTracker::EstimateJsonSize(record);
+    return mHistoryRecords.insert(pos, record);
+}
+
+void TimeLine::TrimHistoryRecords(int64_t i64TargetBytes)
+{
+    // the records after the current position are kept for redo
+    int iDropCount = 0;
+    while (mHistoryRecordsBytes > i64TargetBytes && mHistoryRecords.begin() != mRecordIter)
+    {
+        mHistoryRecordsBytes -= MEC::MemoryTracker::EstimateJsonSize(mHistoryRecords.front());
+        mHistoryRecords.pop_front();
+        iDropCount++;
+    }
+    if (iDropCount > 0)
+        Logger::Log(Logger::DEBUG) << "Dropped " << iDropCount << " oldest history record(s), " << mHistoryRecords.size() << " record(s) are kept." << std::endl;
+}
+
+void TimeLine::RegisterMemoryProviders()
+{
+    mMemProviderIds.push_back(MEC::MemoryTracker::RegisterProvider("Timeline.HistoryRecords", [this] (int64_t& i64Bytes, int64_t& i64Count) {
+        i64Bytes = mHistoryRecordsBytes;
+        i64Count = mHistoryRecords.size();
+    }, [this] (int64_t i64TargetBytes) {
+        TrimHistoryRecords(i64TargetBytes);
+    }));
+    mMemProviderIds.push_back(MEC::MemoryTracker::RegisterProvider("MediaBank.Waveforms", [this] (int64_t& i64Bytes, int64_t& i64Count) {
+        for (auto item : media_items)
+        {
+            if (!item->mMediaOverview)
+                continue;
+            auto waveform = item->mMediaOverview->GetWaveform();
+            if (!waveform)
+                continue;
+            for (auto& channel : waveform->pcm)
+                i64Bytes += channel.size()*sizeof(float);
+            i64Count++;
+        }
+    }));
+    // the textures and the snapshot caches are allocated inside MediaCore, only the holders are counted
+    mMemProviderIds.push_back(MEC::MemoryTracker::RegisterProvider("MediaBank.Thumbnails", [this] (int64_t& i64Bytes, int64_t& i64Count) {
+        i64Bytes = -1;
+        for (auto item : media_items)
+            i64Count += item->mMediaThumbnail.size()+item->mWaveformTextures.size();
+    }));
+    mMemProviderIds.push_back(MEC::MemoryTracker::RegisterProvider("Timeline.SnapshotGenerators", [this] (int64_t& i64Bytes, int64_t& i64Count) {
+        i64Bytes = -1;
+        i64Count = m_VidSsGenTable.size();
+    }));
+    mMemProviderIds.push_back(MEC::MemoryTracker::RegisterProvider("EventStack.BluePrints", [this] (int64_t& i64Bytes, int64_t& i64Count) {
+        i64Bytes = -1;
+        for (auto clip : m_Clips)
+        {
+            if (!clip->mEventStack)
+                continue;
+            for (auto& hEvent : clip->mEventStack->GetEventList())
+            {
+                if (hEvent->IsBpReady())
+                    i64Count++;
+            }
+        }
+    }));
+}
+
 bool TimeLine::UndoOneRecord()
 {
     if (mRecordIter == mHistoryRecords.begin())
@@ -10094,6 +10691,12 @@ bool TimeLine::UndoOneRecord()
             uint32_t mediaType = action["media_type"].get<imgui_json::number>();
             pBp->File_New_Filter(action["before_op_state"], "EventBp",
                     IS_VIDEO(mediaType) ? "Video" : IS_AUDIO(mediaType) ? "Audio" : IS_TEXT(mediaType) ? "Text" : "");
+            auto pVidEvt = dynamic_cast<MEC::VideoEvent*>(hEvent.get());
+            if (pVidEvt)
+            {
+                pVidEvt->InvalidateTileBluePrints();
+                pVidEvt->InvalidateMaskCache();
+            }
             auto pUiTrack = FindTrackByClipID(clipId);
             RefreshTrackView({ pUiTrack->mID });
         }
@@ -10338,6 +10941,12 @@ bool TimeLine::RedoOneRecord()
             uint32_t mediaType = action["media_type"].get<imgui_json::number>();
             pBp->File_New_Filter(action["after_op_state"], "EventBp",
                     IS_VIDEO(mediaType) ? "Video" : IS_AUDIO(mediaType) ? "Audio" : IS_TEXT(mediaType) ? "Text" : "");
+            auto pVidEvt = dynamic_cast<MEC::VideoEvent*>(hEvent.get());
+            if (pVidEvt)
+            {
+                pVidEvt->InvalidateTileBluePrints();
+                pVidEvt->InvalidateMaskCache();
+            }
             auto pUiTrack = FindTrackByClipID(clipId);
             RefreshTrackView({ pUiTrack->mID });
         }
@@ -10349,6 +10958,44 @@ bool TimeLine::RedoOneRecord()
     return true;
 }
 
+void TimeLine::ReplayJournal(const std::list<imgui_json::value>& aEntries)
+{
+    // the entries are the history records and the undo/redo steps written by 'DrawTimeLine()', redo them in order.
+    // each undo/redo step carries its record, the records made before the project was saved are not in the history.
+    for (const auto& jnEntry : aEntries)
+    {
+        bool bApplied = false;
+        const std::string strOp = jnEntry.contains("op") && jnEntry["op"].is_string() ? jnEntry["op"].get<imgui_json::string>() : "";
+        const bool bHasRecord = jnEntry.contains("record") && jnEntry["record"].is_object();
+        if (strOp == "record" && bHasRecord)
+        {
+            imgui_json::value record = jnEntry["record"];
+            AddNewRecord(record);
+            mRecordIter--;
+            bApplied = RedoOneRecord();
+        }
+        else if (strOp == "undo")
+        {
+            if (mRecordIter == mHistoryRecords.begin() && bHasRecord)
+                mRecordIter = std::next(InsertHistoryRecord(mRecordIter, jnEntry["record"]));
+            bApplied = UndoOneRecord();
+        }
+        else if (strOp == "redo")
+        {
+            if (mRecordIter == mHistoryRecords.end() && bHasRecord)
+                mRecordIter = InsertHistoryRecord(mRecordIter, jnEntry["record"]);
+            bApplied = RedoOneRecord();
+        }
+        if (!bApplied)
+        {
+            Logger::Log(Logger::WARN) << "Skip INVALID journal entry '" << strOp << "' when replaying the project journal." << std::endl;
+            continue;
+        }
+        Update();
+        PerformUiActions();
+    }
+}
+
 int64_t TimeLine::AddNewClip(const imgui_json::value& jnClipJson, int64_t track_id, std::list<imgui_json::value>* pActionList)
 {
     MediaTrack* track = FindTrackByID(track_id);
@@ -10504,9 +11151,136 @@ struct _ActionMenuItem
     std::function<std::list<imgui_json::value>(Clip*,bool&)> drawActionStartDialog;
 };
 
+static std::list<imgui_json::value> DrawApplySceneCutDialog(TimeLine* timeline, Clip* pClip, bool& bCloseDlg)
+{
+    std::list<imgui_json::value> actionList;
+    bCloseDlg = false;
+    auto pMediaItem = timeline->FindMediaItemByID(pClip->mMediaID);
+    imgui_json::value jnDetectResult;
+    if (!pMediaItem || !pMediaItem->FindMetaData("SceneDetectResult", jnDetectResult)
+        || !jnDetectResult.contains("scene_cut_points") || !jnDetectResult["scene_cut_points"].is_array())
+    {
+        bCloseDlg = true;
+        return actionList;
+    }
+    static float s_fMinScore = 0.f;
+    ImGui::SliderFloat("Min Score##ApplySceneCutMinScore", &s_fMinScore, 0, 1, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::ShowTooltipOnHover("Only the scene cuts with a score above this value are applied.");
+
+    // cut points saved without 'position' are converted with the current output frame rate
+    const auto frameRate = timeline->mhMediaSettings->VideoOutFrameRate();
+    const int64_t clipSrcStart = pClip->mStartOffset;
+    const int64_t clipSrcEnd = pClip->mStartOffset + (pClip->mEnd - pClip->mStart);
+    std::vector<int64_t> positions;
+    const auto& jnCutPoints = jnDetectResult["scene_cut_points"].get<imgui_json::array>();
+    for (const auto& jnCutPoint : jnCutPoints)
+    {
+        // the meta data may come from an edited or older project file, skip the malformed points
+        if (!jnCutPoint.is_object())
+            continue;
+        if (jnCutPoint.contains("score") && jnCutPoint["score"].is_number() && jnCutPoint["score"].get<imgui_json::number>() < s_fMinScore)
+            continue;
+        int64_t pos;
+        if (jnCutPoint.contains("position") && jnCutPoint["position"].is_number())
+            pos = jnCutPoint["position"].get<imgui_json::number>();
+        else if (jnCutPoint.contains("frame_index") && jnCutPoint["frame_index"].is_number() && frameRate.num > 0)
+            pos = (int64_t)round(jnCutPoint["frame_index"].get<imgui_json::number>() * 1000 * frameRate.den / frameRate.num);
+        else
+            continue;
+        if (pos > clipSrcStart && pos < clipSrcEnd)
+            positions.push_back(pos);
+    }
+    ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGRAY), "Cuts to apply: ");
+    ImGui::SameLine(); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), "%zu", positions.size());
+
+    ImGui::BeginDisabled(positions.empty());
+    if (ImGui::Button("   OK   "))
+    {
+        timeline->CutClipAtPositions(pClip->mID, positions, &actionList);
+        bCloseDlg = true;
+    } ImGui::SameLine(0, 10);
+    ImGui::EndDisabled();
+    if (ImGui::Button(" Cancel "))
+        bCloseDlg = true;
+    return actionList;
+}
+
+static std::list<imgui_json::value> DrawRemoveIntervalsDialog(TimeLine* timeline, Clip* pClip, const std::string& metaName, bool& bCloseDlg)
+{
+    std::list<imgui_json::value> actionList;
+    bCloseDlg = false;
+    auto pMediaItem = timeline->FindMediaItemByID(pClip->mMediaID);
+    imgui_json::value jnDetectResult;
+    if (!pMediaItem || !pMediaItem->FindMetaData(metaName, jnDetectResult) || !jnDetectResult.contains("intervals") || !jnDetectResult["intervals"].is_array())
+    {
+        bCloseDlg = true;
+        return actionList;
+    }
+    static bool s_abIncludeKinds[3] = { true, true, true };
+    static int s_iEdgePadding = 100;
+    const bool bIsSilence = metaName == "SilenceDetectResult";
+    if (!bIsSilence)
+    {
+        ImGui::Checkbox("Black frames", &s_abIncludeKinds[1]); ImGui::SameLine();
+        ImGui::Checkbox("Frozen frames", &s_abIncludeKinds[2]);
+    }
+    ImGui::SliderInt("Keep Edges##RemoveIntervalsEdgePadding", &s_iEdgePadding, 0, 1000, "%d ms", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::ShowTooltipOnHover("Keep this much of each interval at its both ends.");
+
+    // only the intervals inside the clip's source range are counted
+    const int64_t clipSrcStart = pClip->mStartOffset;
+    const int64_t clipSrcEnd = pClip->mStartOffset + (pClip->mEnd - pClip->mStart);
+    std::vector<std::pair<int64_t, int64_t>> ranges;
+    int64_t totalLength = 0;
+    const auto& jnIntervals = jnDetectResult["intervals"].get<imgui_json::array>();
+    for (const auto& jnInterval : jnIntervals)
+    {
+        if (!jnInterval.is_object() || !jnInterval.contains("kind") || !jnInterval["kind"].is_number()
+            || !jnInterval.contains("start") || !jnInterval["start"].is_number() || !jnInterval.contains("end") || !jnInterval["end"].is_number())
+            continue;
+        const int kind = (int)jnInterval["kind"].get<imgui_json::number>();
+        if (kind < 0 || kind >= 3 || !s_abIncludeKinds[kind])
+            continue;
+        int64_t start = (int64_t)jnInterval["start"].get<imgui_json::number>() + s_iEdgePadding;
+        int64_t end = (int64_t)jnInterval["end"].get<imgui_json::number>() - s_iEdgePadding;
+        start = std::max(start, clipSrcStart);
+        end = std::min(end, clipSrcEnd);
+        if (start >= end)
+            continue;
+        ranges.push_back({start, end});
+        totalLength += end - start;
+    }
+    ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGRAY), "Intervals to remove: ");
+    ImGui::SameLine(); ImGui::TextColored(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), "%zu (%s)", ranges.size(), ImGuiHelper::MillisecToString(totalLength).c_str());
+
+    ImGui::BeginDisabled(ranges.empty());
+    if (ImGui::Button("   OK   "))
+    {
+        timeline->RemoveClipRanges(pClip->mID, ranges, &actionList);
+        bCloseDlg = true;
+    } ImGui::SameLine(0, 10);
+    ImGui::EndDisabled();
+    if (ImGui::Button(" Cancel "))
+        bCloseDlg = true;
+    return actionList;
+}
+
 /***********************************************************************************************************
  * Draw Main Timeline
  ***********************************************************************************************************/
+// the journal lets the project recover the edits made after it was saved last time
+static void AppendEditJournal(TimeLine* timeline, const std::string& strOp, const imgui_json::value* pRecord = nullptr)
+{
+    if (!timeline->mhProject || !timeline->mhProject->IsOpened())
+        return;
+    imgui_json::value jnEntry;
+    jnEntry["op"] = strOp;
+    if (pRecord)
+        jnEntry["record"] = *pRecord;
+    if (timeline->mhProject->AppendJournal(jnEntry) != MEC::Project::OK)
+        Logger::Log(Logger::WARN) << "FAILED to append '" << strOp << "' to the project journal!" << std::endl;
+}
+
 bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool editable)
 {
     /************************************************************************************************************
@@ -10653,6 +11427,7 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 static float m_vidstabParam_fAutoZoomSpeed = 0.25f;
                 static int m_vidstabParam_iInterpolationMode = 2;
                 static const char* s_vidstabParam_aInterpolations[] = { "Nearest", "Linear", "Bilinear", "Bicubic" };
+                static bool m_vidstabParam_bParallelTransform = true;
                 tTagColor = ImColor(KNOWNIMGUICOLOR_LIGHTBLUE);
                 const auto v2TagTextPadding = ImGui::GetStyle().FramePadding;
                 const auto fTextHeight = ImGui::CalcTextSize("A").y;
@@ -10676,6 +11451,7 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                     m_vidstabParam_iAutoZoomMode = 0;
                     m_vidstabParam_fAutoZoomSpeed = 0.25f;
                     m_vidstabParam_iInterpolationMode = 2;
+                    m_vidstabParam_bParallelTransform = true;
                 }
                 ImGui::TextColoredWithPadding(tTagColor, v2TagTextPadding, "Shakiness:");
                 ImGui::TextColoredWithPadding(tTagColor, v2TagTextPadding, "Accuracy:");
@@ -10704,6 +11480,12 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 ImGui::TextColoredWithPadding(tTagColor, v2TagTextPadding, "Auto zoom speed:");
                 ImGui::EndDisabled();
                 ImGui::TextColoredWithPadding(tTagColor, v2TagTextPadding, "Interpolation:");
+                // the transform pass can only be split with the gaussian path, black borders and a fixed or static zoom
+                const bool bCanParallelTransform = m_vidstabParam_iOptalgo == 0 && m_vidstabParam_iCropmode == 1 && m_vidstabParam_iSmoothing > 0
+                        && m_vidstabParam_iAutoZoomMode != 2;
+                ImGui::BeginDisabled(!bCanParallelTransform);
+                ImGui::TextColoredWithPadding(tTagColor, v2TagTextPadding, "Parallel transform:");
+                ImGui::EndDisabled();
                 ImGui::EndGroup(); ImGui::SameLine();
                 ImGui::BeginGroup();
                 ImGui::PushItemWidth(80);
@@ -10754,6 +11536,11 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                     }
                     ImGui::EndCombo();
                 }
+                ImGui::BeginDisabled(!bCanParallelTransform);
+                ImGui::Checkbox("##VidstabParamParallelTransform", &m_vidstabParam_bParallelTransform);
+                ImGui::EndDisabled();
+                if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                    ImGui::SetTooltip("Transform the frame ranges in parallel. Requires 'Gauss' opt algo, 'Black' crop mode, smoothing > 0 and no adaptive zoom.");
                 ImGui::PopItemWidth();
                 ImGui::PopItemWidth();
                 ImGui::EndGroup(); ImGui::SameLine();
@@ -10787,6 +11574,7 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                     jnTask["vidstab_arg_optzoom"] = imgui_json::number(m_vidstabParam_iAutoZoomMode);
                     jnTask["vidstab_arg_zoomspeed"] = imgui_json::number(m_vidstabParam_fAutoZoomSpeed);
                     jnTask["vidstab_arg_interp"] = imgui_json::number(m_vidstabParam_iInterpolationMode);
+                    jnTask["vidstab_parallel_transform"] = m_vidstabParam_bParallelTransform;
                     auto hSettings = timeline->mhMediaSettings->Clone();
                     hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
                     bCloseDlg = true;
@@ -10814,8 +11602,39 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 return pMediaItem->HasMetaData("SceneDetectResult");
             },
             [timeline] (Clip* pClip, bool& bCloseDlg) {
-                std::list<imgui_json::value> actionList;
-                return actionList;
+                return DrawApplySceneCutDialog(timeline, pClip, bCloseDlg);
+            },
+        },
+        {
+            "Remove Silence", "RemoveSilence",
+            [timeline] (Clip* pClip) {
+                if (!timeline)
+                    return false;
+                if (IS_IMAGE(pClip->mType) || IS_DUMMY(pClip->mType))
+                    return false;
+                auto pMediaItem = timeline->FindMediaItemByID(pClip->mMediaID);
+                if (!pMediaItem)
+                    return false;
+                return pMediaItem->HasMetaData("SilenceDetectResult");
+            },
+            [timeline] (Clip* pClip, bool& bCloseDlg) {
+                return DrawRemoveIntervalsDialog(timeline, pClip, "SilenceDetectResult", bCloseDlg);
+            },
+        },
+        {
+            "Remove Black/Freeze Frames", "RemoveBlackFreeze",
+            [timeline] (Clip* pClip) {
+                if (!timeline)
+                    return false;
+                if (IS_IMAGE(pClip->mType) || IS_DUMMY(pClip->mType))
+                    return false;
+                auto pMediaItem = timeline->FindMediaItemByID(pClip->mMediaID);
+                if (!pMediaItem)
+                    return false;
+                return pMediaItem->HasMetaData("BlackFreezeDetectResult");
+            },
+            [timeline] (Clip* pClip, bool& bCloseDlg) {
+                return DrawRemoveIntervalsDialog(timeline, pClip, "BlackFreezeDetectResult", bCloseDlg);
             },
         },
     };
@@ -10824,6 +11643,10 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
     static string s_strBgtaskCreateDlgLabel;
     static int64_t s_i64BgtaskSrcClipId;
     bool bOpenCreateBgtaskDialog = false;
+    static size_t s_szActionSelIdx;
+    static string s_strActionStartDlgLabel;
+    static int64_t s_i64ActionSrcClipId;
+    bool bOpenActionStartDialog = false;
 
     float minPixelWidthTarget = ImMin(timeline->msPixelWidthTarget, (float)(timline_size.x - legendWidth) / (float)duration);
     const auto frameRate = timeline->mhMediaSettings->VideoOutFrameRate();
@@ -11724,6 +12547,10 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                         ImGui::BeginDisabled(bDisableMenuItem);
                         if (ImGui::MenuItem(menuItem.label.c_str()))
                         {
+                            bOpenActionStartDialog = true;
+                            s_szActionSelIdx = i;
+                            s_strActionStartDlgLabel = menuItem.label;
+                            s_i64ActionSrcClipId = clipMenuEntry;
                         }
                         ImGui::EndDisabled();
                     }
@@ -12860,6 +13687,27 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
             ImGui::CloseCurrentPopup();
         ImGui::EndPopup();
     }
+    if (bOpenActionStartDialog)
+        ImGui::OpenPopup(s_strActionStartDlgLabel.c_str(), ImGuiPopupFlags_AnyPopup);
+    if (ImGui::BeginPopupModal(s_strActionStartDlgLabel.c_str(), nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings))
+    {
+        const auto& actionSubMenuItem = s_aActionMenuItems[s_szActionSelIdx];
+        auto pClip = timeline->FindClipByID(s_i64ActionSrcClipId);
+        bool bCloseDlg = true;
+        if (pClip)
+        {
+            // all the actions of one menu item go into one history record
+            auto actions = actionSubMenuItem.drawActionStartDialog(pClip, bCloseDlg);
+            if (!actions.empty())
+            {
+                timeline->mUiActions.splice(timeline->mUiActions.end(), actions);
+                changed = true;
+            }
+        }
+        if (bCloseDlg)
+            ImGui::CloseCurrentPopup();
+        ImGui::EndPopup();
+    }
 
     // for debug
     //if (ImGui::BeginTooltip())
@@ -12884,7 +13732,8 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 Logger::Log(Logger::WARN) << "TimeLine::mUiActions is NOT EMPTY when UNDO is triggered!" << std::endl;
                 timeline->PrintActionList("UiActions", actionList);
             }
-            timeline->UndoOneRecord();
+            if (timeline->UndoOneRecord())
+                AppendEditJournal(timeline, "undo", &(*timeline->mRecordIter));
         }
 #ifdef __APPLE__
         else if (io.KeyMods == (ImGuiModFlags_Super|ImGuiModFlags_Shift))
@@ -12897,7 +13746,8 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 Logger::Log(Logger::WARN) << "TimeLine::mUiActions is NOT EMPTY when REDO is triggered!" << std::endl;
                 timeline->PrintActionList("UiActions", actionList);
             }
-            timeline->RedoOneRecord();
+            if (timeline->RedoOneRecord())
+                AppendEditJournal(timeline, "redo", &(*std::prev(timeline->mRecordIter)));
         }
         timeline->Update();
         timeline->PerformUiActions();
@@ -12942,12 +13792,15 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
         historyRecord["time"] = ImGui::get_current_time();
         auto& actions = timeline->mUiActions;
         historyRecord["actions"] = imgui_json::array(actions.begin(), actions.end());
+        const imgui_json::value jnJournalRecord = historyRecord;
         timeline->AddNewRecord(historyRecord);
 
         // perform actions
         timeline->PerformUiActions();
+        AppendEditJournal(timeline, "record", &jnJournalRecord);
         changed = true;
     }
+    timeline->PrewarmBluePrints();
     return changed;
 }
 
@@ -33,13 +33,17 @@
 #include "MecProject.h"
 #include "Event.h"
 #include "EventStackFilter.h"
+#include "NativeTransition.h"
 #include "VideoTransformFilterUiCtrl.h"
 #include "MediaPlayer.h"
 #include <thread>
+#include <atomic>
+#include <functional>
 #include <string>
 #include <vector>
 #include <list>
 #include <unordered_set>
+#include <unordered_map>
 #include <chrono>
 
 #define PLOT_IMPLOT   0
@@ -549,7 +553,7 @@ struct Clip
 
     virtual int64_t Moving(int64_t& diff, int mouse_track);
     virtual int64_t Cropping(int64_t& diff, int type);
-    void Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_json::value>* pActionList = nullptr);
+    int64_t Cutting(int64_t pos, int64_t gid, int64_t newClipId, std::list<imgui_json::value>* pActionList = nullptr, bool updateTimeline = true);
     bool isLinkedWith(Clip * clip);
 
     virtual void ConfigViewWindow(int64_t wndDur, float pixPerMs) { mViewWndDur = wndDur; mPixPerMs = pixPerMs; }
@@ -739,7 +743,8 @@ private:
 class BluePrintVideoTransition : public MediaCore::VideoTransition
 {
 public:
-    BluePrintVideoTransition(void * handle);
+    // a deferred transition keeps the blueprint json only, the blueprint is built when it's mixed or edited
+    BluePrintVideoTransition(void * handle, bool bDeferBluePrint = false);
     ~BluePrintVideoTransition();
 
     MediaCore::VideoTransition::Holder Clone() override;
@@ -748,6 +753,8 @@ public:
 
     void SetBluePrintFromJson(imgui_json::value& bpJson);
     void SetKeyPoint(ImGui::KeyPointEditor &keypoint) { mKeyPoints = keypoint; };
+    void EnsureBluePrint();
+    bool IsBluePrintReady();
 
     imgui_json::value SaveAsJson() const override;
 
@@ -757,21 +764,39 @@ public:
 
 private:
     static int OnBluePrintChange(int type, std::string name, void* handle);
-    MediaCore::VideoOverlap* mOverlap;
-    std::mutex mBpLock;
+    void UpdateNativeTransition(const imgui_json::value& bpJson);
+    void UpdateWorkerBluePrints(const imgui_json::value& bpJson);
+    BluePrint::BluePrintUI* AcquireWorkerBluePrint();
+    void ReleaseWorkerBluePrint(BluePrint::BluePrintUI* pBp);
+    ImGui::ImMat RunBluePrint(BluePrint::BluePrintUI* pBp, const ImGui::ImMat& vmat1, const ImGui::ImMat& vmat2, int64_t pos, int64_t dur);
+    void BuildPendingBluePrint();
+    MediaCore::VideoOverlap* mOverlap {nullptr};
+    mutable std::mutex mBpLock;
+    bool mBpPending {false};
+    imgui_json::value mPendingBpJson;
+    MEC::NativeTransition::Holder mhNativeTransition;   // set when the blueprint can be replaced by a native transition
+    // when 'mBp' is busy, other frames of the same overlap are mixed with independent copies of the blueprint
+    std::mutex mWorkerBpLock;
+    std::list<BluePrint::BluePrintUI*> mIdleWorkerBps;
+    std::unordered_map<BluePrint::BluePrintUI*, uint32_t> mWorkerBpGenerations;    // generation of every worker copy, idle or busy
+    imgui_json::value mWorkerBpJson;
+    uint32_t mWorkerBpGeneration {0};
+    static const uint32_t MAX_WORKER_BP_COUNT = 8;
     void * mHandle {nullptr};
 };
 
 class BluePrintAudioTransition : public MediaCore::AudioTransition
 {
 public:
-    BluePrintAudioTransition(void * handle);
+    BluePrintAudioTransition(void * handle, bool bDeferBluePrint = false);
     ~BluePrintAudioTransition();
     void ApplyTo(MediaCore::AudioOverlap* overlap) override { mOverlap = overlap; }
     ImGui::ImMat MixTwoAudioMats(const ImGui::ImMat& amat1, const ImGui::ImMat& amat2, int64_t pos) override;
 
     void SetBluePrintFromJson(imgui_json::value& bpJson);
     void SetKeyPoint(ImGui::KeyPointEditor &keypoint) { mKeyPoints = keypoint; };
+    void EnsureBluePrint();
+    bool IsBluePrintReady();
 
 public:
     BluePrint::BluePrintUI* mBp{nullptr};
@@ -779,8 +804,11 @@ public:
 
 private:
     static int OnBluePrintChange(int type, std::string name, void* handle);
+    void BuildPendingBluePrint();
     MediaCore::AudioOverlap* mOverlap;
     std::mutex mBpLock;
+    bool mBpPending {false};
+    imgui_json::value mPendingBpJson;
     void * mHandle {nullptr};
 };
 
@@ -1360,6 +1388,10 @@ struct TimeLine
     MediaCore::MultiTrackAudioReader::Holder mMtaReader;
     int64_t mPreviewResumePos               {0};
     bool mIsPreviewNeedUpdate               {false};
+    // while a batch of ui actions is performed, the readers are refreshed only once after the last action
+    bool mDeferReaderRefresh                {false};
+    int mPendingVideoRefresh                {0};    // 0: none, 1: refresh, 2: refresh and update duration
+    int mPendingAudioRefresh                {0};
     bool mIsPreviewPlaying                  {false};
     bool mIsPreviewForward                  {true};
     bool mIsStepMode                        {false};
@@ -1452,6 +1484,18 @@ struct TimeLine
 
     void MovingClip(int64_t id, int from_track_index, int to_track_index);
     bool DeleteClip(int64_t id, std::list<imgui_json::value>* pActionList);
+    // Cuts a clip and the members of its group at the timeline position 'pos', the new pieces are put into a new group, same as
+    // the interactive cut. The timeline is not updated. Nothing is cut if 'pos' falls in an overlap or on a locked track of any
+    // clip to cut, then -1 is returned. Otherwise returns the number of cut clips, the ids of the new clips are appended to 'pNewClipIds'.
+    // With 'checkOnly', nothing is changed and the number of clips which would be cut is returned.
+    int CutClipWithGroup(Clip* clip, int64_t pos, std::list<imgui_json::value>* pActionList, std::vector<int64_t>* pNewClipIds = nullptr, bool checkOnly = false);
+    // Removes the given source ranges(in millisecond) from a clip and the members of its group, by cutting them at all the range
+    // boundaries and deleting the pieces inside the ranges. The ranges with a boundary in an overlap are skipped. The timeline is
+    // updated only once after all the cuts. Returns the number of removed pieces.
+    int RemoveClipRanges(int64_t clip_id, const std::vector<std::pair<int64_t, int64_t>>& ranges, std::list<imgui_json::value>* pActionList);
+    // Cuts a clip and the members of its group at all the given source positions(in millisecond) in one pass, the positions in
+    // an overlap are skipped. The timeline is updated only once after all the cuts. Returns the number of positions cut.
+    int CutClipAtPositions(int64_t clip_id, const std::vector<int64_t>& positions, std::list<imgui_json::value>* pActionList);
     void DeleteOverlap(int64_t id);
 
     void DoubleClick(int index, int64_t time);
@@ -1476,6 +1520,7 @@ struct TimeLine
     void ToEnd();
     void UpdateCurrent();
     void RefreshPreview(bool updateDuration = true);
+    void RefreshAudio(bool updateDuration = true);
     void RefreshTrackView(const std::unordered_set<int64_t>& trackIds);
     int64_t ValidDuration();
 
@@ -1514,7 +1559,9 @@ struct TimeLine
     void AddClipIntoGroup(Clip * clip, int64_t group_id, std::list<imgui_json::value>* pActionList = nullptr); // Insert clip into group
     void DeleteClipFromGroup(Clip *clip, int64_t group_id, std::list<imgui_json::value>* pActionList = nullptr); // Delete clip from group
     ImU32 GetGroupColor(int64_t group_id);              // Get Group color by id
-    int Load(const imgui_json::value& value);
+    // 'listLoader' pulls the clip/group/overlap/track lists which are not in 'value', like 'Project::GetContentItem()'
+    using ListLoader = std::function<const imgui_json::value* (const std::string& name, imgui_json::value& holder)>;
+    int Load(const imgui_json::value& value, const ListLoader& listLoader = nullptr);
     void Save(imgui_json::value& value);
 
     void ConfigureDataLayer();
@@ -1522,15 +1569,33 @@ struct TimeLine
     MediaCore::Snapshot::Generator::Holder GetSnapshotGenerator(int64_t mediaItemId);
     void ConfigSnapshotWindow(int64_t viewWndDur);
     void ReflashSnapshotWindow(bool forceRefresh = false);
+    // builds the deferred blueprints of the events and transitions around the play head in the background
+    void PrewarmBluePrints();
+    void StopBluePrintPrewarm();
+    void _BpPrewarmProc(std::list<std::function<void()>> aPrewarmJobs);
+    std::thread mBpPrewarmThread;
+    std::atomic_bool mBpPrewarmRunning {false};
+    std::atomic_bool mBpPrewarmQuit {false};
+    int64_t mBpPrewarmPos {INT64_MIN};
+    size_t mBpPrewarmClipCount {0};
+    static const int64_t BP_PREWARM_RANGE = 10000;
     MatUtils::Size2i CalcPreviewSize(const MatUtils::Size2i& videoSize, float previewScale);
     void UpdateVideoSettings(MediaCore::SharedSettings::Holder hSettings, float previewScale);
     void UpdateAudioSettings(MediaCore::SharedSettings::Holder hSettings, MediaCore::AudioRender::PcmFormat pcmFormat);
 
     std::list<imgui_json::value> mHistoryRecords;
     std::list<imgui_json::value>::iterator mRecordIter;
+    // estimated size of 'mHistoryRecords', updated whenever a record is added or removed
+    int64_t mHistoryRecordsBytes {0};
     void AddNewRecord(imgui_json::value& record);
+    std::list<imgui_json::value>::iterator InsertHistoryRecord(std::list<imgui_json::value>::iterator pos, const imgui_json::value& record);
     bool UndoOneRecord();
     bool RedoOneRecord();
+    // drops the oldest undo records until the estimated size of the history is not larger than 'i64TargetBytes'
+    void TrimHistoryRecords(int64_t i64TargetBytes);
+    void RegisterMemoryProviders();
+    std::vector<int64_t> mMemProviderIds;
+    void ReplayJournal(const std::list<imgui_json::value>& aEntries);
     int64_t AddNewClip(const imgui_json::value& clip_json, int64_t track_id, std::list<imgui_json::value>* pActionList = nullptr);
     int64_t AddNewClip(int64_t media_id, uint32_t media_type, int64_t track_id, int64_t start, int64_t start_offset, int64_t end, int64_t end_offset, int64_t group_id, int64_t clip_id = -1, std::list<imgui_json::value>* pActionList = nullptr);
 };
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <algorithm>
+#include "NativeTransition.h"
+#include "FrameBufferPool.h"
+
+using namespace std;
+
+namespace MEC
+{
+struct _NativeTransitionDef
+{
+    const char* pcNodeType;
+    NativeTransition::Type eType;
+};
+
+// Built-in video transition nodes that have a native implementation. Both nodes are a plain cross dissolve without
+// parameters. The other built-in nodes have parameters and shapes that are not reproduced here, they stay on the blueprint.
+static const _NativeTransitionDef NATIVE_TRANSITION_TABLE[] = {
+    { "Fade Transition",        NativeTransition::CROSSFADE },
+    { "Alpha Transition",       NativeTransition::CROSSFADE },
+};
+
+// Only cpu mats with interleaved layout are handled natively
+static bool IsNativeImageFormat(const ImGui::ImMat& m)
+{
+    if (m.empty() || m.device != IM_DD_CPU)
+        return false;
+    if (m.type != IM_DT_INT8 && m.type != IM_DT_FLOAT32)
+        return false;
+    return m.c == 1 || m.elempack == m.c;
+}
+
+template <typename T> static inline T _MixValue(T a, T b, float w);
+template <> inline uint8_t _MixValue<uint8_t>(uint8_t a, uint8_t b, float w)
+{
+    const uint32_t k = (uint32_t)(w*256.f+0.5f);
+    return (uint8_t)((a*(256-k)+b*k)>>8);
+}
+template <> inline float _MixValue<float>(float a, float b, float w)
+{
+    return a+(b-a)*w;
+}
+
+// Blend contiguous data with a constant weight. Kept as a plain loop so it gets vectorized.
+template <typename T>
+static void _BlendData(const T* __restrict pA, const T* __restrict pB, T* __restrict pOut, size_t szCount, float w)
+{
+    if (w <= 0.f)
+    {
+        memcpy(pOut, pA, szCount*sizeof(T));
+        return;
+    }
+    if (w >= 1.f)
+    {
+        memcpy(pOut, pB, szCount*sizeof(T));
+        return;
+    }
+    for (size_t i = 0; i < szCount; i++)
+        pOut[i] = _MixValue<T>(pA[i], pB[i], w);
+}
+
+class NativeTransition_Impl : public NativeTransition
+{
+public:
+    NativeTransition_Impl(Type eType, const string& name)
+        : m_eType(eType), m_name(name)
+    {}
+
+    Type GetType() const override { return m_eType; }
+    string GetName() const override { return m_name; }
+
+    ImGui::ImMat MixTwoImages(const ImGui::ImMat& vmat1, const ImGui::ImMat& vmat2, float progress) const override
+    {
+        if (!IsNativeImageFormat(vmat1) || !IsNativeImageFormat(vmat2))
+            return ImGui::ImMat();
+        if (vmat1.w != vmat2.w || vmat1.h != vmat2.h || vmat1.c != vmat2.c || vmat1.type != vmat2.type || vmat1.elempack != vmat2.elempack)
+            return ImGui::ImMat();
+        auto mOut = FrameBufferPool::GetDefaultInstance()->AcquireMat(vmat1.w, vmat1.h, vmat1.c, vmat1.type, vmat1.elempack);
+        if (mOut.empty() || mOut.total() != vmat1.total())
+            return ImGui::ImMat();
+        mOut.copy_attribute(vmat1);
+        const float t = std::min(std::max(progress, 0.f), 1.f);
+        const size_t szCount = (size_t)vmat1.w*vmat1.h*vmat1.c;
+        if (vmat1.type == IM_DT_INT8)
+            _BlendData<uint8_t>((const uint8_t*)vmat1.data, (const uint8_t*)vmat2.data, (uint8_t*)mOut.data, szCount, t);
+        else
+            _BlendData<float>((const float*)vmat1.data, (const float*)vmat2.data, (float*)mOut.data, szCount, t);
+        return mOut;
+    }
+
+private:
+    Type m_eType;
+    string m_name;
+};
+
+NativeTransition::Holder NativeTransition::CreateFromBluePrintJson(const imgui_json::value& bpJson)
+{
+    if (!bpJson.is_object() || !bpJson.contains("document"))
+        return nullptr;
+    const auto& jnDoc = bpJson["document"];
+    if (!jnDoc.is_object() || !jnDoc.contains("blueprint"))
+        return nullptr;
+    const auto& jnBp = jnDoc["blueprint"];
+    const imgui_json::array* pNodeArray = nullptr;
+    if (!jnBp.is_object() || !imgui_json::GetPtrTo(jnBp, "nodes", pNodeArray))
+        return nullptr;
+
+    // the graph must contain exactly one node besides 'Entry' and 'Exit'
+    const imgui_json::value* pTransNode = nullptr;
+    string strTransNodeType;
+    for (const auto& jnNode : *pNodeArray)
+    {
+        string strType;
+        if (!imgui_json::GetTo<imgui_json::string>(jnNode, "type", strType))
+            return nullptr;
+        if (strType == "Entry" || strType == "Exit")
+            continue;
+        if (pTransNode)
+            return nullptr;
+        pTransNode = &jnNode;
+        strTransNodeType = strType;
+    }
+    if (!pTransNode)
+        return nullptr;
+    for (const auto& def : NATIVE_TRANSITION_TABLE)
+    {
+        if (strTransNodeType == def.pcNodeType)
+            return NativeTransition::Holder(new NativeTransition_Impl(def.eType, strTransNodeType));
+    }
+    return nullptr;
+}
+}
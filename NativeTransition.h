@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <immat.h>
+#include <imgui_json.h>
+
+namespace MEC
+{
+    // Native implementations of the common transitions. When a transition blueprint is nothing more than
+    // 'Entry -> <built-in transition node> -> Exit', the mixing can be done here directly instead of
+    // executing the blueprint graph for every frame. Only the transitions whose output is verified to match
+    // the blueprint node are listed here, everything else keeps running through the blueprint.
+    // Currently only the cross dissolve is native. Dip-to-color, the linear and radial wipes, the slide and the
+    // equal-power audio crossfade are deferred, their node parameters and shapes are defined by the blueprint sdk
+    // and must be matched against it before a native kernel can replace them.
+    struct NativeTransition
+    {
+        using Holder = std::shared_ptr<NativeTransition>;
+
+        enum Type
+        {
+            CROSSFADE = 0,
+        };
+
+        // Returns nullptr if the blueprint is not recognized as one of the native transitions
+        static Holder CreateFromBluePrintJson(const imgui_json::value& bpJson);
+
+        virtual Type GetType() const = 0;
+        virtual std::string GetName() const = 0;
+        // 'progress' is in range [0, 1]. Returns an empty mat if the input format is not supported natively,
+        // then caller should fall back to the blueprint execution.
+        virtual ImGui::ImMat MixTwoImages(const ImGui::ImMat& vmat1, const ImGui::ImMat& vmat2, float progress) const = 0;
+    };
+}
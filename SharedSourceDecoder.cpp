@@ -0,0 +1,362 @@
+#include <map>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+#include <ThreadUtils.h>
+#include "SharedSourceDecoder.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+class SharedSourceDecoder_Impl : public SharedSourceDecoder, public enable_shared_from_this<SharedSourceDecoder_Impl>
+{
+public:
+    SharedSourceDecoder_Impl(const string& strKey, MediaCore::SharedSettings::Holder hSettings, int64_t i64FrameRateNum, int64_t i64FrameRateDen)
+        : m_strKey(strKey), m_hSettings(hSettings), m_i64FrameRateNum(i64FrameRateNum), m_i64FrameRateDen(i64FrameRateDen)
+    {
+        m_pLogger = GetLogger("SharedSrcDec");
+    }
+
+    ~SharedSourceDecoder_Impl()
+    {
+        list<shared_ptr<_Stream>> aRetiredStreams;
+        {
+            lock_guard<mutex> lk(m_mtxLock);
+            while (!m_aStreams.empty())
+                RetireStream(m_aStreams.front(), aRetiredStreams);
+        }
+        JoinStreams(aRetiredStreams);
+        m_pLogger->Log(DEBUG) << "Release shared decoder '" << m_strKey << "', decoded=" << m_u64DecodedCount << ", shared=" << m_u64SharedCount << "." << endl;
+    }
+
+    Reader::Holder AttachReader(const void* pOwner) override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        auto pReader = new _Reader(shared_from_this(), pOwner);
+        m_aReaders.push_back(pReader);
+        return Reader::Holder(pReader);
+    }
+
+    MediaCore::VideoFrame::Holder ReadSourceFrame(Reader::Holder hReader, MediaCore::VideoClip::Holder hVclip, int64_t i64ReadPos, bool& bEof) override
+    {
+        auto pReader = dynamic_cast<_Reader*>(hReader.get());
+        if (!pReader)
+            return hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+        const int64_t i64FrmKey = ToFrameKey(hVclip->StartOffset()+i64ReadPos);
+        list<shared_ptr<_Stream>> aRetiredStreams;
+        unique_lock<mutex> lk(m_mtxLock);
+        pReader->i64FrmKey = i64FrmKey;
+        pReader->tLastAccessTime = chrono::steady_clock::now();
+        auto hStream = pReader->hStream;
+        if (!hStream || !CanStreamServe(hStream.get(), hVclip.get(), i64FrmKey))
+        {
+            if (hStream)
+                Unsubscribe(pReader, aRetiredStreams);
+            hStream = FindStream(pReader, hVclip.get(), i64FrmKey);
+            if (!hStream)
+            {
+                // cloning opens the source, don't block the other readers meanwhile
+                lk.unlock();
+                JoinStreams(aRetiredStreams);
+                auto hStreamVclip = hVclip->Clone(m_hSettings);
+                lk.lock();
+                if (!hStreamVclip)
+                {
+                    lk.unlock();
+                    m_pLogger->Log(WARN) << "FAILED to clone VideoClip for a decode stream of '" << m_strKey << "', read the frame directly." << endl;
+                    return hVclip->ReadSourceFrame(i64ReadPos, bEof, true);
+                }
+                hStream = FindStream(pReader, hVclip.get(), i64FrmKey);
+                if (!hStream)
+                    hStream = StartStream(hStreamVclip, i64FrmKey);
+            }
+            hStream->aSubscribers.push_back(pReader);
+            pReader->hStream = hStream;
+        }
+        // the stream may be held back by the previous position of this reader
+        m_cvUpdated.notify_all();
+
+        MediaCore::VideoFrame::Holder hVfrm;
+        while (true)
+        {
+            auto itFrame = hStream->mapFrames.find(i64FrmKey);
+            if (itFrame != hStream->mapFrames.end())
+            {
+                if (itFrame->second.iTakenCount++ > 0)
+                    m_u64SharedCount++;
+                bEof = itFrame->second.bEof;
+                hVfrm = itFrame->second.hVfrm;
+                break;
+            }
+            if (hStream->i64EofKey >= 0 && i64FrmKey > hStream->i64EofKey)
+            {
+                bEof = true;
+                break;
+            }
+            m_cvUpdated.wait_for(lk, chrono::milliseconds(5));
+            pReader->tLastAccessTime = chrono::steady_clock::now();
+        }
+        lk.unlock();
+        JoinStreams(aRetiredStreams);
+        return hVfrm;
+    }
+
+    Stats GetStats() const override
+    {
+        lock_guard<mutex> lk(m_mtxLock);
+        Stats tStats;
+        tStats.u64DecodedCount = m_u64DecodedCount;
+        tStats.u64SharedCount = m_u64SharedCount;
+        tStats.iReaderCount = (int)m_aReaders.size();
+        tStats.iStreamCount = (int)m_aStreams.size();
+        return tStats;
+    }
+
+    string GetKey() const override
+    {
+        return m_strKey;
+    }
+
+private:
+    struct _CachedFrame
+    {
+        MediaCore::VideoFrame::Holder hVfrm;
+        bool bEof;
+        int iTakenCount{0};
+    };
+
+    struct _Reader;
+    struct _Stream
+    {
+        MediaCore::VideoClip::Holder hVclip;
+        int64_t i64StartOffset;
+        int64_t i64EndOffset;
+        int64_t i64NextKey;
+        int64_t i64EofKey{-1};
+        map<int64_t, _CachedFrame> mapFrames;
+        list<_Reader*> aSubscribers;
+        bool bQuit{false};
+        thread thDecode;
+    };
+
+    struct _Reader : public Reader
+    {
+        _Reader(shared_ptr<SharedSourceDecoder_Impl> hOwner, const void* pOwner) : hDecoder(hOwner), pOwnerTag(pOwner) {}
+        ~_Reader()
+        {
+            hDecoder->DetachReader(this);
+        }
+
+        shared_ptr<SharedSourceDecoder_Impl> hDecoder;
+        const void* pOwnerTag;
+        int64_t i64FrmKey{INT64_MIN};
+        chrono::steady_clock::time_point tLastAccessTime;
+        shared_ptr<_Stream> hStream;
+    };
+
+    void DetachReader(_Reader* pReader)
+    {
+        list<shared_ptr<_Stream>> aRetiredStreams;
+        {
+            lock_guard<mutex> lk(m_mtxLock);
+            auto itRem = find(m_aReaders.begin(), m_aReaders.end(), pReader);
+            if (itRem != m_aReaders.end())
+                m_aReaders.erase(itRem);
+            if (pReader->hStream)
+                Unsubscribe(pReader, aRetiredStreams);
+            m_cvUpdated.notify_all();
+        }
+        JoinStreams(aRetiredStreams);
+    }
+
+    int64_t ToFrameKey(int64_t i64SrcPos) const
+    {
+        return (int64_t)floor((double)i64SrcPos*m_i64FrameRateNum/(m_i64FrameRateDen*1000)+0.5);
+    }
+
+    int64_t FrameKeyToSrcPos(int64_t i64FrmKey) const
+    {
+        return (int64_t)round((double)i64FrmKey*1000*m_i64FrameRateDen/m_i64FrameRateNum);
+    }
+
+    bool IsReaderActive(const _Reader* pReader) const
+    {
+        // a paused or finished analysis stops reading, don't let it hold back the others
+        return pReader->i64FrmKey != INT64_MIN
+                && chrono::steady_clock::now()-pReader->tLastAccessTime < chrono::milliseconds(READER_IDLE_TIMEOUT);
+    }
+
+    // A stream serves the positions from its oldest kept frame to a short distance ahead of its decoding position,
+    // decoding through that distance is cheaper than starting another stream
+    bool CanStreamServe(const _Stream* pStream, const MediaCore::VideoClip* pVclip, int64_t i64FrmKey) const
+    {
+        if (pStream->bQuit || pStream->i64StartOffset != pVclip->StartOffset() || pStream->i64EndOffset != pVclip->EndOffset())
+            return false;
+        const int64_t i64FirstKey = pStream->mapFrames.empty() ? pStream->i64NextKey : min(pStream->mapFrames.begin()->first, pStream->i64NextKey);
+        return i64FrmKey >= i64FirstKey && i64FrmKey <= pStream->i64NextKey+JOIN_AHEAD_FRAMES;
+    }
+
+    shared_ptr<_Stream> FindStream(const _Reader* pReader, const MediaCore::VideoClip* pVclip, int64_t i64FrmKey) const
+    {
+        for (const auto& hStream : m_aStreams)
+        {
+            const bool bSameOwner = any_of(hStream->aSubscribers.begin(), hStream->aSubscribers.end(), [pReader] (const _Reader* p) {
+                return p != pReader && p->pOwnerTag == pReader->pOwnerTag;
+            });
+            if (!bSameOwner && CanStreamServe(hStream.get(), pVclip, i64FrmKey))
+                return hStream;
+        }
+        return nullptr;
+    }
+
+    shared_ptr<_Stream> StartStream(MediaCore::VideoClip::Holder hVclip, int64_t i64FrmKey)
+    {
+        auto hStream = make_shared<_Stream>();
+        hStream->hVclip = hVclip;
+        hStream->i64StartOffset = hVclip->StartOffset();
+        hStream->i64EndOffset = hVclip->EndOffset();
+        hStream->i64NextKey = i64FrmKey;
+        hVclip->SeekTo(FrameKeyToSrcPos(i64FrmKey)-hStream->i64StartOffset);
+        hStream->thDecode = thread(&SharedSourceDecoder_Impl::DecodeProc, this, hStream.get());
+        SysUtils::SetThreadName(hStream->thDecode, "SharedSrcDec");
+        m_aStreams.push_back(hStream);
+        m_pLogger->Log(DEBUG) << "Start decode stream of '" << m_strKey << "' from frame #" << i64FrmKey << ", " << m_aStreams.size() << " stream(s) running." << endl;
+        return hStream;
+    }
+
+    void Unsubscribe(_Reader* pReader, list<shared_ptr<_Stream>>& aRetiredStreams)
+    {
+        auto hStream = pReader->hStream;
+        pReader->hStream = nullptr;
+        hStream->aSubscribers.remove(pReader);
+        if (hStream->aSubscribers.empty())
+            RetireStream(hStream, aRetiredStreams);
+        else
+            ReleaseFrames(hStream.get());
+    }
+
+    // Must be called with the lock held, the retired streams are joined by 'JoinStreams()' after it's released
+    void RetireStream(shared_ptr<_Stream> hStream, list<shared_ptr<_Stream>>& aRetiredStreams)
+    {
+        hStream->bQuit = true;
+        m_aStreams.remove(hStream);
+        aRetiredStreams.push_back(hStream);
+        m_cvUpdated.notify_all();
+    }
+
+    void JoinStreams(list<shared_ptr<_Stream>>& aRetiredStreams)
+    {
+        for (auto& hStream : aRetiredStreams)
+        {
+            if (hStream->thDecode.joinable())
+                hStream->thDecode.join();
+        }
+        aRetiredStreams.clear();
+    }
+
+    // the frames all the readers of the stream have passed are not needed anymore
+    void ReleaseFrames(_Stream* pStream)
+    {
+        int64_t i64MinKey = INT64_MAX;
+        for (const auto pReader : pStream->aSubscribers)
+        {
+            if (IsReaderActive(pReader) && pReader->i64FrmKey < i64MinKey)
+                i64MinKey = pReader->i64FrmKey;
+        }
+        auto& mapFrames = pStream->mapFrames;
+        while (!mapFrames.empty() && (mapFrames.begin()->first < i64MinKey || (int64_t)mapFrames.size() > MAX_BUFFERED_FRAMES))
+            mapFrames.erase(mapFrames.begin());
+    }
+
+    void DecodeProc(_Stream* pStream)
+    {
+        unique_lock<mutex> lk(m_mtxLock);
+        while (!pStream->bQuit)
+        {
+            ReleaseFrames(pStream);
+            // backpressure, don't run ahead of the slowest active reader by more than the buffer size
+            int64_t i64MinKey = INT64_MAX;
+            for (const auto pReader : pStream->aSubscribers)
+            {
+                if (IsReaderActive(pReader) && pReader->i64FrmKey < i64MinKey)
+                    i64MinKey = pReader->i64FrmKey;
+            }
+            if (pStream->i64EofKey >= 0 || i64MinKey == INT64_MAX || pStream->i64NextKey-i64MinKey >= MAX_BUFFERED_FRAMES)
+            {
+                m_cvUpdated.wait_for(lk, chrono::milliseconds(5));
+                continue;
+            }
+            const int64_t i64FrmKey = pStream->i64NextKey;
+            lk.unlock();
+            bool bEof = false;
+            auto hVfrm = pStream->hVclip->ReadSourceFrame(FrameKeyToSrcPos(i64FrmKey)-pStream->i64StartOffset, bEof, true);
+            lk.lock();
+            m_u64DecodedCount++;
+            pStream->mapFrames[i64FrmKey] = {hVfrm, bEof};
+            pStream->i64NextKey = i64FrmKey+1;
+            if (bEof)
+                pStream->i64EofKey = i64FrmKey;
+            m_cvUpdated.notify_all();
+        }
+    }
+
+private:
+    static const int64_t MAX_BUFFERED_FRAMES;
+    static const int64_t JOIN_AHEAD_FRAMES;
+    static const int READER_IDLE_TIMEOUT;
+
+    string m_strKey;
+    ALogger* m_pLogger;
+    MediaCore::SharedSettings::Holder m_hSettings;
+    int64_t m_i64FrameRateNum;
+    int64_t m_i64FrameRateDen;
+    mutable mutex m_mtxLock;
+    condition_variable m_cvUpdated;
+    list<_Reader*> m_aReaders;
+    list<shared_ptr<_Stream>> m_aStreams;
+    uint64_t m_u64DecodedCount{0};
+    uint64_t m_u64SharedCount{0};
+};
+
+const int64_t SharedSourceDecoder_Impl::MAX_BUFFERED_FRAMES = 48;
+const int64_t SharedSourceDecoder_Impl::JOIN_AHEAD_FRAMES = 16;
+const int SharedSourceDecoder_Impl::READER_IDLE_TIMEOUT = 500;
+
+static const auto SHARED_SOURCE_DECODER_DELETER = [] (SharedSourceDecoder* p) {
+    SharedSourceDecoder_Impl* ptr = dynamic_cast<SharedSourceDecoder_Impl*>(p);
+    delete ptr;
+};
+
+SharedSourceDecoder::Holder SharedSourceDecoder::GetInstance(const string& strSrcUrl, MediaCore::SharedSettings::Holder hSettings)
+{
+    static mutex s_mtxInstances;
+    static map<string, weak_ptr<SharedSourceDecoder>> s_mapInstances;
+    const auto tFrameRate = hSettings->VideoOutFrameRate();
+    ostringstream oss; oss << strSrcUrl << "|" << hSettings->VideoOutWidth() << "x" << hSettings->VideoOutHeight()
+            << "|" << tFrameRate.num << "/" << tFrameRate.den;
+    const auto strKey = oss.str();
+    lock_guard<mutex> lk(s_mtxInstances);
+    auto itInst = s_mapInstances.begin();
+    while (itInst != s_mapInstances.end())
+    {
+        if (itInst->second.expired())
+            itInst = s_mapInstances.erase(itInst);
+        else
+            itInst++;
+    }
+    auto hInst = s_mapInstances[strKey].lock();
+    if (!hInst)
+    {
+        hInst = SharedSourceDecoder::Holder(new SharedSourceDecoder_Impl(strKey, hSettings, tFrameRate.num, tFrameRate.den), SHARED_SOURCE_DECODER_DELETER);
+        s_mapInstances[strKey] = hInst;
+    }
+    return hInst;
+}
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <Logger.h>
+#include <SharedSettings.h>
+#include <VideoClip.h>
+
+namespace MEC
+{
+    // Lets the background analyses running on the same source decode it once. A decode stream is a thread with its own
+    // VideoClip decoding the source sequentially, and pushing the frames to the readers subscribed to it. The stream
+    // only runs a bounded number of frames ahead of its slowest active reader, and a frame is dropped once all of its
+    // readers have passed it. A reader joins the stream covering its read position, and starts a new stream if there's
+    // none, so analyses reading the same part of the source share one decode.
+    struct SharedSourceDecoder
+    {
+        using Holder = std::shared_ptr<SharedSourceDecoder>;
+        // Returns the instance shared by all the readers of 'strSrcUrl' with the same output frame size and rate
+        static Holder GetInstance(const std::string& strSrcUrl, MediaCore::SharedSettings::Holder hSettings);
+
+        struct Reader
+        {
+            using Holder = std::shared_ptr<Reader>;
+            virtual ~Reader() {}
+        };
+        // Readers with the same 'pOwner' never share a stream, they're supposed to read different ranges
+        virtual Reader::Holder AttachReader(const void* pOwner) = 0;
+        // Same as 'VideoClip::ReadSourceFrame(i64ReadPos, bEof, true)', with the frame taken from the reader's stream.
+        // 'hVclip' is only read directly if a stream can't be started, a new stream decodes with a clone of it.
+        virtual MediaCore::VideoFrame::Holder ReadSourceFrame(Reader::Holder hReader, MediaCore::VideoClip::Holder hVclip, int64_t i64ReadPos, bool& bEof) = 0;
+
+        struct Stats
+        {
+            uint64_t u64DecodedCount{0};
+            uint64_t u64SharedCount{0};
+            int iReaderCount{0};
+            int iStreamCount{0};
+        };
+        virtual Stats GetStats() const = 0;
+        virtual std::string GetKey() const = 0;
+    };
+}
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <new>
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+#include <imgui.h>
+#include <imgui_json.h>
+#include <FileSystemUtils.h>
+#include "MecProject.h"
+#include "MediaTimeline.h"
+#include "TestMediaGenerator.h"
+
+// Generates a synthetic project with locally generated test media, then times opening and saving it headlessly.
+// Usage: ProjectBenchmark [--tracks N] [--clips N] [--events N] [--overlap-ratio R] [--media N]
+//                         [--iterations N] [--binary] [--work-dir DIR] [--json FILE]
+// '--clips' and '--events' are counted per track and per clip. '--overlap-ratio' is the fraction of the clips
+// that overlap the previous clip on the same track, each of them produces one overlap.
+
+using namespace MediaTimeline;
+
+static std::atomic<uint64_t> g_u64AllocCount {0};
+static std::atomic<uint64_t> g_u64AllocBytes {0};
+
+void* operator new(size_t size)
+{
+    g_u64AllocCount++;
+    g_u64AllocBytes += size;
+    void* p = malloc(size > 0 ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static int64_t GetPeakRssKb()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return (int64_t)(pmc.PeakWorkingSetSize/1024);
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return (int64_t)ru.ru_maxrss/1024;
+#else
+    return (int64_t)ru.ru_maxrss;
+#endif
+#endif
+}
+
+struct BenchConfig
+{
+    int iTrackCount {4};
+    int iClipsPerTrack {50};
+    int iEventsPerClip {2};
+    double dOverlapRatio {0.5};
+    int iMediaCount {4};
+    int iIterations {3};
+    bool bBinaryFormat {false};
+    std::string strWorkDir;
+    std::string strJsonOutPath;
+};
+
+struct PhaseStats
+{
+    std::string strName;
+    std::vector<double> aTimeMs;
+    uint64_t u64AllocCount {0};
+    uint64_t u64AllocBytes {0};
+    int64_t i64PeakRssKb {0};
+};
+
+class PhaseTimer
+{
+public:
+    PhaseTimer(PhaseStats& tStats) : m_tStats(tStats)
+    {
+        m_u64AllocCount0 = g_u64AllocCount;
+        m_u64AllocBytes0 = g_u64AllocBytes;
+        m_tp0 = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer()
+    {
+        const auto tp1 = std::chrono::steady_clock::now();
+        m_tStats.aTimeMs.push_back(std::chrono::duration<double, std::milli>(tp1-m_tp0).count());
+        m_tStats.u64AllocCount += g_u64AllocCount-m_u64AllocCount0;
+        m_tStats.u64AllocBytes += g_u64AllocBytes-m_u64AllocBytes0;
+        m_tStats.i64PeakRssKb = GetPeakRssKb();
+    }
+
+private:
+    PhaseStats& m_tStats;
+    uint64_t m_u64AllocCount0;
+    uint64_t m_u64AllocBytes0;
+    std::chrono::steady_clock::time_point m_tp0;
+};
+
+static TimeLine* CreateTimeline(MEC::Project::Holder hProj)
+{
+    auto pTl = new TimeLine();
+    pTl->mhProject = hProj;
+    pTl->mHardwareCodec = false;
+    hProj->SetTimelineHandle(pTl);
+    return pTl;
+}
+
+static void DestroyTimeline(MEC::Project::Holder hProj, TimeLine* pTl)
+{
+    hProj->SetTimelineHandle(nullptr);
+    delete pTl;
+}
+
+static bool GenerateProject(const BenchConfig& tConfig, std::string& strProjFilePath)
+{
+    const auto strMediaDir = SysUtils::JoinPath(tConfig.strWorkDir, "media");
+    if (!SysUtils::IsDirectory(strMediaDir) && !SysUtils::CreateDirectoryAt(strMediaDir, true))
+    {
+        fprintf(stderr, "FAILED to create media directory at '%s'!\n", strMediaDir.c_str());
+        return false;
+    }
+    MEC::Project::ErrorCode ec;
+    auto hProj = MEC::Project::CreateNewProject(ec, "Benchmark", SysUtils::JoinPath(tConfig.strWorkDir, "project"), true);
+    if (!hProj)
+    {
+        fprintf(stderr, "FAILED to create project under '%s'! Error code is %d.\n", tConfig.strWorkDir.c_str(), (int)ec);
+        return false;
+    }
+    hProj->SetBinaryFormat(tConfig.bBinaryFormat);
+    auto pTl = CreateTimeline(hProj);
+
+    // even media items are videos, odd ones are audios
+    std::vector<MediaItem*> aVideoItems, aAudioItems;
+    for (int i = 0; i < tConfig.iMediaCount; i++)
+    {
+        const bool bVideo = (i%2) == 0;
+        const auto strName = std::string(bVideo ? "video_" : "audio_")+std::to_string(i)+(bVideo ? ".y4m" : ".wav");
+        const auto strPath = SysUtils::JoinPath(strMediaDir, strName);
+        if (!SysUtils::IsFile(strPath) && !(bVideo ? TestMedia::GenerateVideo(strPath, i) : TestMedia::GenerateAudio(strPath, i)))
+        {
+            fprintf(stderr, "FAILED to generate test media at '%s'!\n", strPath.c_str());
+            DestroyTimeline(hProj, pTl);
+            return false;
+        }
+        auto pItem = new MediaItem(strName, strPath, bVideo ? MEDIA_VIDEO : MEDIA_AUDIO, pTl);
+        if (!pItem->Initialize())
+        {
+            fprintf(stderr, "FAILED to open test media at '%s'!\n", strPath.c_str());
+            delete pItem;
+            continue;
+        }
+        pTl->media_items.push_back(pItem);
+        (bVideo ? aVideoItems : aAudioItems).push_back(pItem);
+    }
+
+    int iOverlapAcc = 0;
+    for (int i = 0; i < tConfig.iTrackCount; i++)
+    {
+        const bool bVideoTrack = (i%2) == 0 || aAudioItems.empty();
+        const auto& aItems = bVideoTrack ? aVideoItems : aAudioItems;
+        if (aItems.empty())
+            continue;
+        const uint32_t u32Type = bVideoTrack ? MEDIA_VIDEO : MEDIA_AUDIO;
+        pTl->NewTrack("", u32Type, true);
+        const auto i64TrackId = pTl->m_Tracks.back()->mID;
+        int64_t i64Pos = 0;
+        for (int j = 0; j < tConfig.iClipsPerTrack; j++)
+        {
+            auto pItem = aItems[j%aItems.size()];
+            const int64_t i64Length = pItem->mSrcLength;
+            const auto i64ClipId = pTl->AddNewClip(pItem->mID, u32Type, i64TrackId, i64Pos, 0, i64Pos+i64Length, 0, -1);
+            auto pClip = i64ClipId != -1 ? pTl->FindClipByID(i64ClipId) : nullptr;
+            if (pClip && pClip->mEventStack && !pClip->mEventTracks.empty() && tConfig.iEventsPerClip > 0)
+            {
+                const int64_t i64EvtDur = i64Length/tConfig.iEventsPerClip;
+                for (int k = 0; k < tConfig.iEventsPerClip; k++)
+                {
+                    const auto i64EvtId = pTl->m_IDGenerator.GenerateID();
+                    if (pClip->mEventStack->AddNewEvent(i64EvtId, k*i64EvtDur, (k+1)*i64EvtDur, 0))
+                        pClip->mEventTracks[0]->m_Events.push_back(i64EvtId);
+                }
+            }
+            // spread the overlapped clips evenly according to the ratio
+            iOverlapAcc += (int)(tConfig.dOverlapRatio*100);
+            const bool bOverlapNext = iOverlapAcc >= 100;
+            if (bOverlapNext)
+                iOverlapAcc -= 100;
+            i64Pos += bOverlapNext ? i64Length*3/4 : i64Length;
+        }
+    }
+    pTl->Update();
+
+    strProjFilePath = hProj->GetProjectFilePath();
+    const auto ec2 = hProj->Save();
+    fprintf(stdout, "Generated project '%s': %zu media items, %zu tracks, %zu clips, %zu overlaps.\n", strProjFilePath.c_str(),
+            pTl->media_items.size(), pTl->m_Tracks.size(), pTl->m_Clips.size(), pTl->m_Overlaps.size());
+    hProj->Close(false);
+    DestroyTimeline(hProj, pTl);
+    if (ec2 != MEC::Project::OK)
+    {
+        fprintf(stderr, "FAILED to save the generated project! Error code is %d.\n", (int)ec2);
+        return false;
+    }
+    return true;
+}
+
+// the same media bank loading as the editor does before loading the timeline
+static void LoadMediaBank(TimeLine* pTl, const imgui_json::value& jnProjContent)
+{
+    const imgui_json::array* pMediaBank = nullptr;
+    if (!imgui_json::GetPtrTo(jnProjContent, "MediaBank", pMediaBank))
+        return;
+    for (const auto& jnItem : *pMediaBank)
+    {
+        if (!jnItem.contains("path") || !jnItem["path"].is_string() || !jnItem.contains("type") || !jnItem["type"].is_number())
+            continue;
+        const std::string strName = jnItem.contains("name") && jnItem["name"].is_string() ? jnItem["name"].get<imgui_json::string>() : "";
+        auto pItem = new MediaItem(strName, jnItem["path"].get<imgui_json::string>(), (uint32_t)jnItem["type"].get<imgui_json::number>(), pTl);
+        if (jnItem.contains("id") && jnItem["id"].is_number())
+            pItem->mID = jnItem["id"].get<imgui_json::number>();
+        pItem->Initialize();
+        if (jnItem.contains("meta_data"))
+            pItem->mMetaData = jnItem["meta_data"];
+        pTl->media_items.push_back(pItem);
+    }
+}
+
+static bool RunIteration(const std::string& strProjFilePath, std::vector<PhaseStats>& aPhases)
+{
+    MEC::Project::ErrorCode ec;
+    MEC::Project::Holder hProj;
+    {
+        PhaseTimer _t(aPhases[0]);
+        hProj = MEC::Project::OpenProjectFile(ec, strProjFilePath);
+        // the content of a binary project is decoded on the first access, count it in the opening phase
+        if (hProj)
+            hProj->GetProjectContentJson();
+    }
+    if (!hProj)
+    {
+        fprintf(stderr, "FAILED to open project '%s'! Error code is %d.\n", strProjFilePath.c_str(), (int)ec);
+        return false;
+    }
+    auto pTl = CreateTimeline(hProj);
+    const auto& jnProjContent = hProj->GetProjectContentJson();
+    {
+        PhaseTimer _t(aPhases[1]);
+        LoadMediaBank(pTl, jnProjContent);
+    }
+    {
+        PhaseTimer _t(aPhases[2]);
+        if (jnProjContent.contains("TimeLine") && jnProjContent["TimeLine"].is_object())
+            pTl->Load(jnProjContent["TimeLine"]);
+    }
+    {
+        imgui_json::value jnTimeLine;
+        PhaseTimer _t(aPhases[3]);
+        pTl->Save(jnTimeLine);
+    }
+    const auto strSaveToPath = strProjFilePath+".bench_save";
+    {
+        PhaseTimer _t(aPhases[4]);
+        ec = hProj->SaveTo(strSaveToPath);
+    }
+    SysUtils::DeleteFileAt(strSaveToPath);
+    hProj->Close(false);
+    DestroyTimeline(hProj, pTl);
+    if (ec != MEC::Project::OK)
+    {
+        fprintf(stderr, "FAILED to save project to '%s'! Error code is %d.\n", strSaveToPath.c_str(), (int)ec);
+        return false;
+    }
+    return true;
+}
+
+static void ReportResults(const BenchConfig& tConfig, const std::vector<PhaseStats>& aPhases)
+{
+    fprintf(stdout, "\n%-24s %10s %10s %10s %14s %14s %12s\n", "Phase", "min(ms)", "avg(ms)", "max(ms)", "allocs/iter", "KB/iter", "peakRSS(KB)");
+    imgui_json::array aJnPhases;
+    for (const auto& tStats : aPhases)
+    {
+        if (tStats.aTimeMs.empty())
+            continue;
+        double dMin = tStats.aTimeMs[0], dMax = tStats.aTimeMs[0], dSum = 0;
+        for (auto d : tStats.aTimeMs)
+        {
+            dMin = std::min(dMin, d);
+            dMax = std::max(dMax, d);
+            dSum += d;
+        }
+        const size_t szIterCnt = tStats.aTimeMs.size();
+        const double dAvg = dSum/szIterCnt;
+        fprintf(stdout, "%-24s %10.2f %10.2f %10.2f %14llu %14llu %12lld\n", tStats.strName.c_str(), dMin, dAvg, dMax,
+                (unsigned long long)(tStats.u64AllocCount/szIterCnt), (unsigned long long)(tStats.u64AllocBytes/szIterCnt/1024), (long long)tStats.i64PeakRssKb);
+        imgui_json::value jnPhase;
+        jnPhase["name"] = tStats.strName;
+        jnPhase["min_ms"] = imgui_json::number(dMin);
+        jnPhase["avg_ms"] = imgui_json::number(dAvg);
+        jnPhase["max_ms"] = imgui_json::number(dMax);
+        jnPhase["allocs_per_iter"] = imgui_json::number((double)(tStats.u64AllocCount/szIterCnt));
+        jnPhase["alloc_bytes_per_iter"] = imgui_json::number((double)(tStats.u64AllocBytes/szIterCnt));
+        jnPhase["peak_rss_kb"] = imgui_json::number((double)tStats.i64PeakRssKb);
+        aJnPhases.push_back(jnPhase);
+    }
+    if (tConfig.strJsonOutPath.empty())
+        return;
+    imgui_json::value jnReport;
+    jnReport["tracks"] = imgui_json::number(tConfig.iTrackCount);
+    jnReport["clips_per_track"] = imgui_json::number(tConfig.iClipsPerTrack);
+    jnReport["events_per_clip"] = imgui_json::number(tConfig.iEventsPerClip);
+    jnReport["overlap_ratio"] = imgui_json::number(tConfig.dOverlapRatio);
+    jnReport["media_items"] = imgui_json::number(tConfig.iMediaCount);
+    jnReport["iterations"] = imgui_json::number(tConfig.iIterations);
+    jnReport["binary_format"] = imgui_json::boolean(tConfig.bBinaryFormat);
+    jnReport["phases"] = aJnPhases;
+    jnReport.save(tConfig.strJsonOutPath);
+}
+
+static bool ParseArgs(int argc, char** argv, BenchConfig& tConfig)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string strArg = argv[i];
+        const bool bHasValue = i+1 < argc;
+        if (strArg == "--tracks" && bHasValue)
+            tConfig.iTrackCount = atoi(argv[++i]);
+        else if (strArg == "--clips" && bHasValue)
+            tConfig.iClipsPerTrack = atoi(argv[++i]);
+        else if (strArg == "--events" && bHasValue)
+            tConfig.iEventsPerClip = atoi(argv[++i]);
+        else if (strArg == "--overlap-ratio" && bHasValue)
+            tConfig.dOverlapRatio = atof(argv[++i]);
+        else if (strArg == "--media" && bHasValue)
+            tConfig.iMediaCount = atoi(argv[++i]);
+        else if (strArg == "--iterations" && bHasValue)
+            tConfig.iIterations = atoi(argv[++i]);
+        else if (strArg == "--binary")
+            tConfig.bBinaryFormat = true;
+        else if (strArg == "--work-dir" && bHasValue)
+            tConfig.strWorkDir = argv[++i];
+        else if (strArg == "--json" && bHasValue)
+            tConfig.strJsonOutPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Unknown argument '%s'!\n", strArg.c_str());
+            return false;
+        }
+    }
+    if (tConfig.iTrackCount <= 0 || tConfig.iClipsPerTrack <= 0 || tConfig.iMediaCount <= 0 || tConfig.iIterations <= 0
+        || tConfig.iEventsPerClip < 0 || tConfig.dOverlapRatio < 0 || tConfig.dOverlapRatio > 1)
+    {
+        fprintf(stderr, "INVALID benchmark arguments!\n");
+        return false;
+    }
+    if (tConfig.strWorkDir.empty())
+        tConfig.strWorkDir = SysUtils::JoinPath(MEC::Project::GetCacheDir(), "ProjectBenchmark");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig tConfig;
+    if (!ParseArgs(argc, argv, tConfig))
+        return -1;
+    // no audio output is needed, the timeline still opens an audio device
+#if !defined(_WIN32)
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+#endif
+    ImGui::CreateContext();
+    MEC::Project::GetDefaultLogger()->SetShowLevels(Logger::WARN);
+
+    std::string strProjFilePath;
+    if (!GenerateProject(tConfig, strProjFilePath))
+        return -1;
+
+    std::vector<PhaseStats> aPhases(5);
+    aPhases[0].strName = "Project::OpenProjectFile";
+    aPhases[1].strName = "MediaBank load";
+    aPhases[2].strName = "TimeLine::Load";
+    aPhases[3].strName = "TimeLine::Save";
+    aPhases[4].strName = "Project::SaveTo";
+    for (int i = 0; i < tConfig.iIterations; i++)
+    {
+        if (!RunIteration(strProjFilePath, aPhases))
+            return -1;
+    }
+    ReportResults(tConfig, aPhases);
+    ImGui::DestroyContext();
+    return 0;
+}
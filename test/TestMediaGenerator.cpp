@@ -0,0 +1,59 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <fstream>
+#include "TestMediaGenerator.h"
+
+namespace TestMedia
+{
+    bool GenerateVideo(const std::string& strPath, int seed)
+    {
+        std::ofstream ofs(strPath, std::ios::out|std::ios::binary|std::ios::trunc);
+        if (!ofs.is_open())
+            return false;
+        ofs << "YUV4MPEG2 W" << VIDEO_WIDTH << " H" << VIDEO_HEIGHT << " F" << VIDEO_FPS << ":1 Ip A1:1 C420jpeg\n";
+        const int iLumaSize = VIDEO_WIDTH*VIDEO_HEIGHT;
+        const int iChromaSize = (VIDEO_WIDTH/2)*(VIDEO_HEIGHT/2);
+        std::vector<uint8_t> aFrameBuf(iLumaSize+iChromaSize*2);
+        for (int i = 0; i < VIDEO_FPS*MEDIA_DURATION; i++)
+        {
+            for (int y = 0; y < VIDEO_HEIGHT; y++)
+                for (int x = 0; x < VIDEO_WIDTH; x++)
+                    aFrameBuf[y*VIDEO_WIDTH+x] = (uint8_t)(x+y+i*4+seed*31);
+            memset(aFrameBuf.data()+iLumaSize, (uint8_t)(64+seed*16), iChromaSize);
+            memset(aFrameBuf.data()+iLumaSize+iChromaSize, (uint8_t)(192-i), iChromaSize);
+            ofs << "FRAME\n";
+            ofs.write((const char*)aFrameBuf.data(), aFrameBuf.size());
+        }
+        return ofs.good();
+    }
+
+    static void WriteLE(std::ofstream& ofs, uint32_t u32Val, int iBytes)
+    {
+        for (int i = 0; i < iBytes; i++)
+            ofs.put((char)((u32Val>>(i*8))&0xff));
+    }
+
+    bool GenerateAudio(const std::string& strPath, int seed)
+    {
+        std::ofstream ofs(strPath, std::ios::out|std::ios::binary|std::ios::trunc);
+        if (!ofs.is_open())
+            return false;
+        const uint32_t u32SampleCnt = AUDIO_SAMPLE_RATE*MEDIA_DURATION;
+        const uint32_t u32DataSize = u32SampleCnt*AUDIO_CHANNELS*2;
+        ofs.write("RIFF", 4); WriteLE(ofs, 36+u32DataSize, 4); ofs.write("WAVE", 4);
+        ofs.write("fmt ", 4); WriteLE(ofs, 16, 4); WriteLE(ofs, 1, 2); WriteLE(ofs, AUDIO_CHANNELS, 2);
+        WriteLE(ofs, AUDIO_SAMPLE_RATE, 4); WriteLE(ofs, AUDIO_SAMPLE_RATE*AUDIO_CHANNELS*2, 4);
+        WriteLE(ofs, AUDIO_CHANNELS*2, 2); WriteLE(ofs, 16, 2);
+        ofs.write("data", 4); WriteLE(ofs, u32DataSize, 4);
+        const double dFreq = 220.0*(1+seed);
+        for (uint32_t i = 0; i < u32SampleCnt; i++)
+        {
+            const int16_t i16Sample = (int16_t)(sin(2*3.14159265358979*dFreq*i/AUDIO_SAMPLE_RATE)*8000);
+            for (int c = 0; c < AUDIO_CHANNELS; c++)
+                WriteLE(ofs, (uint16_t)i16Sample, 2);
+        }
+        return ofs.good();
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef __TEST_MEDIA_GENERATOR_H_
+#define __TEST_MEDIA_GENERATOR_H_
+#include <string>
+
+namespace TestMedia
+{
+    static const int VIDEO_WIDTH = 160;
+    static const int VIDEO_HEIGHT = 90;
+    static const int VIDEO_FPS = 25;
+    static const int AUDIO_SAMPLE_RATE = 48000;
+    static const int AUDIO_CHANNELS = 2;
+    static const int MEDIA_DURATION = 4;    // in seconds
+
+    // Writes an uncompressed y4m video, it's readable by the media parser, so no encoder is needed
+    bool GenerateVideo(const std::string& strPath, int seed);
+    // Writes a 16bit pcm wav file with a sine tone
+    bool GenerateAudio(const std::string& strPath, int seed);
+}
+
+#endif // __TEST_MEDIA_GENERATOR_H_
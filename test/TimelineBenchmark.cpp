@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <algorithm>
+#include <imgui.h>
+#include <imgui_json.h>
+#include <FileSystemUtils.h>
+#include "MecProject.h"
+#include "MediaTimeline.h"
+#include "TestMediaGenerator.h"
+
+// Microbenchmarks of the timeline data model. Every case runs against timelines of 10 to 100k clips, and reports the
+// latency of one operation at each scale, so the scaling curve of the operation can be compared between builds.
+// Usage: TimelineBenchmark [--filter SUBSTR] [--max-clips N] [--max-media-clips N] [--clips-per-track N]
+//                          [--min-time MS] [--work-dir DIR] [--json FILE]
+// The cases that work on the data layer use audio clips of a generated wav file, each of them opens its own
+// reader, so they are limited by '--max-media-clips'. The other cases use text clips which have no media behind.
+
+using namespace MediaTimeline;
+
+struct BenchConfig
+{
+    std::string strFilter;
+    int64_t i64MaxClips {100000};
+    int64_t i64MaxMediaClips {1000};
+    int iClipsPerTrack {100};
+    double dMinTimeMs {200};
+    std::string strWorkDir;
+    std::string strJsonOutPath;
+};
+
+static BenchConfig g_tConfig;
+static std::string g_strTestAudioPath;
+
+// Similar to the state of Google Benchmark: the loop 'while (state.KeepRunning())' is timed until the minimum time
+// is reached, the work that should not be counted is wrapped by 'PauseTiming()' and 'ResumeTiming()'.
+class BenchState
+{
+public:
+    BenchState(int64_t i64Range, double dMinTimeMs, int64_t i64MaxIterations)
+        : m_i64Range(i64Range), m_dMinTimeNs(dMinTimeMs*1e6), m_i64MaxIterations(i64MaxIterations) {}
+
+    bool KeepRunning()
+    {
+        const auto tpNow = std::chrono::steady_clock::now();
+        if (m_i64Iterations == 0)
+        {
+            m_tpStart = tpNow;
+        }
+        else
+        {
+            const double dElapsedNs = m_dAccumNs+std::chrono::duration<double, std::nano>(tpNow-m_tpStart).count();
+            if (dElapsedNs >= m_dMinTimeNs || m_i64Iterations >= m_i64MaxIterations)
+            {
+                m_dAccumNs = dElapsedNs;
+                return false;
+            }
+        }
+        m_i64Iterations++;
+        return true;
+    }
+
+    void PauseTiming()
+    {
+        m_dAccumNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-m_tpStart).count();
+    }
+
+    void ResumeTiming()
+    {
+        m_tpStart = std::chrono::steady_clock::now();
+    }
+
+    int64_t Range() const { return m_i64Range; }
+    int64_t Iterations() const { return m_i64Iterations; }
+    double NsPerIteration() const { return m_i64Iterations > 0 ? m_dAccumNs/m_i64Iterations : 0; }
+    void SetError(const std::string& strError) { m_strError = strError; }
+    const std::string& GetError() const { return m_strError; }
+
+private:
+    int64_t m_i64Range;
+    double m_dMinTimeNs;
+    int64_t m_i64MaxIterations;
+    int64_t m_i64Iterations {0};
+    double m_dAccumNs {0};
+    std::chrono::steady_clock::time_point m_tpStart;
+    std::string m_strError;
+};
+
+// A timeline without any UI drawing, with 'i64ClipCount' clips spread over tracks of 'g_tConfig.iClipsPerTrack' clips
+struct TimelineFixture
+{
+    TimeLine* pTl {nullptr};
+    std::vector<int64_t> aClipIds;
+    MediaItem* pMediaItem {nullptr};
+
+    ~TimelineFixture()
+    {
+        if (pTl)
+            delete pTl;
+    }
+
+    // text clips are only added to the ui layer, the data layer is not involved
+    bool BuildWithTextClips(int64_t i64ClipCount)
+    {
+        pTl = new TimeLine();
+        MediaTrack* pTrack = nullptr;
+        int64_t i64Pos = 0;
+        for (int64_t i = 0; i < i64ClipCount; i++)
+        {
+            if (i%g_tConfig.iClipsPerTrack == 0)
+            {
+                pTl->NewTrack("", MEDIA_TEXT, true);
+                pTrack = pTl->m_Tracks.back();
+                i64Pos = 0;
+            }
+            auto pClip = TextClip::CreateInstance(pTl, "Benchmark", i64Pos, 1000);
+            if (!pClip)
+                return false;
+            // not using 'MediaTrack::InsertClip()' here, it checks the duplication in all the timeline clips
+            pTrack->m_Clips.push_back(pClip);
+            pTl->m_Clips.push_back(pClip);
+            aClipIds.push_back(pClip->mID);
+            i64Pos += 1000;
+        }
+        pTl->Update();
+        return true;
+    }
+
+    // audio clips are added through the ui actions, the same way as editing, so the data layer is built as well
+    bool BuildWithAudioClips(int64_t i64ClipCount)
+    {
+        pTl = new TimeLine();
+        pTl->mHardwareCodec = false;
+        pMediaItem = new MediaItem("benchmark.wav", g_strTestAudioPath, MEDIA_AUDIO, pTl);
+        if (!pMediaItem->Initialize())
+        {
+            delete pMediaItem;
+            pMediaItem = nullptr;
+            return false;
+        }
+        pTl->media_items.push_back(pMediaItem);
+        std::list<imgui_json::value> aActions;
+        int64_t i64TrackId = -1;
+        int64_t i64Pos = 0;
+        for (int64_t i = 0; i < i64ClipCount; i++)
+        {
+            if (i%g_tConfig.iClipsPerTrack == 0)
+            {
+                pTl->NewTrack("", MEDIA_AUDIO, true, -1, -1, &aActions);
+                i64TrackId = pTl->m_Tracks.back()->mID;
+                i64Pos = 0;
+            }
+            const auto i64ClipId = pTl->AddNewClip(pMediaItem->mID, MEDIA_AUDIO, i64TrackId, i64Pos, 0, i64Pos+pMediaItem->mSrcLength, 0, -1, -1, &aActions);
+            if (i64ClipId == -1)
+                return false;
+            aClipIds.push_back(i64ClipId);
+            i64Pos += pMediaItem->mSrcLength;
+        }
+        pTl->mUiActions = std::move(aActions);
+        pTl->PerformUiActions();
+        return true;
+    }
+};
+
+struct BenchCase
+{
+    std::string strName;
+    bool bUseMedia;
+    std::function<void(BenchState&, TimelineFixture&)> fnRun;
+};
+
+static void BM_FindClipByID(BenchState& state, TimelineFixture& tFixture)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> dist(0, tFixture.aClipIds.size()-1);
+    size_t szFound = 0;
+    while (state.KeepRunning())
+    {
+        if (tFixture.pTl->FindClipByID(tFixture.aClipIds[dist(rng)]))
+            szFound++;
+    }
+    if (szFound != (size_t)state.Iterations())
+        state.SetError("Some clips are NOT found!");
+}
+
+static void BM_FindTrackByClipID(BenchState& state, TimelineFixture& tFixture)
+{
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<size_t> dist(0, tFixture.aClipIds.size()-1);
+    size_t szFound = 0;
+    while (state.KeepRunning())
+    {
+        if (tFixture.pTl->FindTrackByClipID(tFixture.aClipIds[dist(rng)]))
+            szFound++;
+    }
+    if (szFound != (size_t)state.Iterations())
+        state.SetError("Some tracks are NOT found!");
+}
+
+static void BM_MediaTrackUpdate(BenchState& state, TimelineFixture& tFixture)
+{
+    auto pTrack = tFixture.pTl->m_Tracks.back();
+    while (state.KeepRunning())
+        pTrack->Update();
+}
+
+static void BM_TimeLineUpdate(BenchState& state, TimelineFixture& tFixture)
+{
+    while (state.KeepRunning())
+        tFixture.pTl->Update();
+}
+
+static void BM_InsertClip(BenchState& state, TimelineFixture& tFixture)
+{
+    auto pTl = tFixture.pTl;
+    auto pTrack = pTl->m_Tracks.back();
+    const int64_t i64Pos = pTrack->m_Clips.empty() ? 0 : pTrack->m_Clips.back()->End();
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto pClip = TextClip::CreateInstance(pTl, "Inserted", i64Pos, 1000);
+        state.ResumeTiming();
+        pTrack->InsertClip(pClip, i64Pos);
+        state.PauseTiming();
+        // take the clip away, so every iteration inserts into the same timeline
+        pTrack->m_Clips.erase(std::find(pTrack->m_Clips.begin(), pTrack->m_Clips.end(), pClip));
+        pTl->m_Clips.erase(std::find(pTl->m_Clips.begin(), pTl->m_Clips.end(), pClip));
+        delete pClip;
+        pTrack->Update();
+        state.ResumeTiming();
+    }
+}
+
+static void BM_SyncDataLayer(BenchState& state, TimelineFixture& tFixture)
+{
+    while (state.KeepRunning())
+        tFixture.pTl->SyncDataLayer(true);
+}
+
+static void BM_ClipCutting(BenchState& state, TimelineFixture& tFixture)
+{
+    // every clip is cut once at its middle, then the new clips are cut, so the timeline grows by one clip per iteration
+    auto pTl = tFixture.pTl;
+    size_t szNextIdx = 0;
+    while (state.KeepRunning())
+    {
+        state.PauseTiming();
+        auto pClip = pTl->FindClipByID(tFixture.aClipIds[szNextIdx%tFixture.aClipIds.size()]);
+        const int64_t i64CutPos = (pClip->Start()+pClip->End())/2;
+        std::list<imgui_json::value> aActions;
+        state.ResumeTiming();
+        const auto i64NewClipId = pClip->Cutting(i64CutPos, -1, -1, &aActions);
+        pTl->mUiActions = std::move(aActions);
+        pTl->PerformUiActions();
+        state.PauseTiming();
+        if (i64NewClipId < 0)
+        {
+            state.SetError("'Clip::Cutting()' FAILED!");
+            state.ResumeTiming();
+            break;
+        }
+        tFixture.aClipIds.push_back(i64NewClipId);
+        szNextIdx++;
+        state.ResumeTiming();
+    }
+}
+
+static void BM_UndoRedoRecord(BenchState& state, TimelineFixture& tFixture)
+{
+    // one cutting record is undone and redone repeatedly, each iteration is a pair of undo and redo
+    auto pTl = tFixture.pTl;
+    auto pClip = pTl->FindClipByID(tFixture.aClipIds[tFixture.aClipIds.size()/2]);
+    std::list<imgui_json::value> aActions;
+    if (pClip->Cutting((pClip->Start()+pClip->End())/2, -1, -1, &aActions) < 0)
+    {
+        state.SetError("'Clip::Cutting()' FAILED!");
+        return;
+    }
+    imgui_json::value jnRecord;
+    jnRecord["time"] = ImGui::get_current_time();
+    jnRecord["actions"] = imgui_json::array(aActions.begin(), aActions.end());
+    pTl->AddNewRecord(jnRecord);
+    pTl->mUiActions = std::move(aActions);
+    pTl->PerformUiActions();
+    while (state.KeepRunning())
+    {
+        if (!pTl->UndoOneRecord())
+        {
+            state.SetError("'TimeLine::UndoOneRecord()' FAILED!");
+            break;
+        }
+        pTl->Update();
+        pTl->PerformUiActions();
+        if (!pTl->RedoOneRecord())
+        {
+            state.SetError("'TimeLine::RedoOneRecord()' FAILED!");
+            break;
+        }
+        pTl->Update();
+        pTl->PerformUiActions();
+    }
+}
+
+static const std::vector<BenchCase> BENCH_CASES = {
+    { "FindClipByID",           false,  BM_FindClipByID },
+    { "FindTrackByClipID",      false,  BM_FindTrackByClipID },
+    { "MediaTrack::Update",     false,  BM_MediaTrackUpdate },
+    { "TimeLine::Update",       false,  BM_TimeLineUpdate },
+    { "MediaTrack::InsertClip", false,  BM_InsertClip },
+    { "SyncDataLayer",          true,   BM_SyncDataLayer },
+    { "Clip::Cutting",          true,   BM_ClipCutting },
+    { "UndoOneRecord+RedoOneRecord", true, BM_UndoRedoRecord },
+};
+
+static const std::vector<int64_t> BENCH_SCALES = { 10, 100, 1000, 10000, 100000 };
+
+static std::string FormatNs(double dNs)
+{
+    char buf[64];
+    if (dNs < 1e3)
+        snprintf(buf, sizeof(buf), "%.1f ns", dNs);
+    else if (dNs < 1e6)
+        snprintf(buf, sizeof(buf), "%.2f us", dNs/1e3);
+    else
+        snprintf(buf, sizeof(buf), "%.2f ms", dNs/1e6);
+    return buf;
+}
+
+static bool ParseArgs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string strArg = argv[i];
+        const bool bHasValue = i+1 < argc;
+        if (strArg == "--filter" && bHasValue)
+            g_tConfig.strFilter = argv[++i];
+        else if (strArg == "--max-clips" && bHasValue)
+            g_tConfig.i64MaxClips = atoll(argv[++i]);
+        else if (strArg == "--max-media-clips" && bHasValue)
+            g_tConfig.i64MaxMediaClips = atoll(argv[++i]);
+        else if (strArg == "--clips-per-track" && bHasValue)
+            g_tConfig.iClipsPerTrack = atoi(argv[++i]);
+        else if (strArg == "--min-time" && bHasValue)
+            g_tConfig.dMinTimeMs = atof(argv[++i]);
+        else if (strArg == "--work-dir" && bHasValue)
+            g_tConfig.strWorkDir = argv[++i];
+        else if (strArg == "--json" && bHasValue)
+            g_tConfig.strJsonOutPath = argv[++i];
+        else
+        {
+            fprintf(stderr, "Unknown argument '%s'!\n", strArg.c_str());
+            return false;
+        }
+    }
+    if (g_tConfig.iClipsPerTrack <= 0 || g_tConfig.dMinTimeMs <= 0)
+    {
+        fprintf(stderr, "INVALID benchmark arguments!\n");
+        return false;
+    }
+    if (g_tConfig.strWorkDir.empty())
+        g_tConfig.strWorkDir = SysUtils::JoinPath(MEC::Project::GetCacheDir(), "TimelineBenchmark");
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (!ParseArgs(argc, argv))
+        return -1;
+#if !defined(_WIN32)
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+#endif
+    ImGui::CreateContext();
+    Logger::GetDefaultLogger()->SetShowLevels(Logger::WARN);
+
+    if (!SysUtils::IsDirectory(g_tConfig.strWorkDir) && !SysUtils::CreateDirectoryAt(g_tConfig.strWorkDir, true))
+    {
+        fprintf(stderr, "FAILED to create work directory at '%s'!\n", g_tConfig.strWorkDir.c_str());
+        return -1;
+    }
+    g_strTestAudioPath = SysUtils::JoinPath(g_tConfig.strWorkDir, "benchmark.wav");
+    if (!SysUtils::IsFile(g_strTestAudioPath) && !TestMedia::GenerateAudio(g_strTestAudioPath, 0))
+    {
+        fprintf(stderr, "FAILED to generate test audio at '%s'!\n", g_strTestAudioPath.c_str());
+        return -1;
+    }
+
+    int iFailedCnt = 0;
+    imgui_json::array aJnResults;
+    fprintf(stdout, "%-40s %14s %12s\n", "Benchmark", "Time", "Iterations");
+    for (const auto& tCase : BENCH_CASES)
+    {
+        if (!g_tConfig.strFilter.empty() && tCase.strName.find(g_tConfig.strFilter) == std::string::npos)
+            continue;
+        const int64_t i64MaxScale = tCase.bUseMedia ? g_tConfig.i64MaxMediaClips : g_tConfig.i64MaxClips;
+        for (auto i64Scale : BENCH_SCALES)
+        {
+            if (i64Scale > i64MaxScale)
+                break;
+            const std::string strFullName = tCase.strName+"/"+std::to_string(i64Scale);
+            TimelineFixture tFixture;
+            const bool bBuilt = tCase.bUseMedia ? tFixture.BuildWithAudioClips(i64Scale) : tFixture.BuildWithTextClips(i64Scale);
+            if (!bBuilt)
+            {
+                fprintf(stderr, "%-40s FAILED to build the timeline fixture!\n", strFullName.c_str());
+                iFailedCnt++;
+                continue;
+            }
+            // the cases that grow the timeline are bounded by the scale, so the fixture is not changed too much
+            const int64_t i64MaxIterations = tCase.bUseMedia ? std::max<int64_t>(i64Scale, 10) : INT64_MAX;
+            BenchState state(i64Scale, g_tConfig.dMinTimeMs, i64MaxIterations);
+            tCase.fnRun(state, tFixture);
+            if (!state.GetError().empty())
+            {
+                fprintf(stderr, "%-40s ERROR: %s\n", strFullName.c_str(), state.GetError().c_str());
+                iFailedCnt++;
+                continue;
+            }
+            fprintf(stdout, "%-40s %14s %12lld\n", strFullName.c_str(), FormatNs(state.NsPerIteration()).c_str(), (long long)state.Iterations());
+            imgui_json::value jnResult;
+            jnResult["name"] = tCase.strName;
+            jnResult["clips"] = imgui_json::number(i64Scale);
+            jnResult["ns_per_op"] = imgui_json::number(state.NsPerIteration());
+            jnResult["iterations"] = imgui_json::number(state.Iterations());
+            aJnResults.push_back(jnResult);
+        }
+    }
+    if (!g_tConfig.strJsonOutPath.empty())
+    {
+        imgui_json::value jnReport;
+        jnReport["clips_per_track"] = imgui_json::number(g_tConfig.iClipsPerTrack);
+        jnReport["benchmarks"] = aJnResults;
+        jnReport.save(g_tConfig.strJsonOutPath);
+    }
+    ImGui::DestroyContext();
+    return iFailedCnt == 0 ? 0 : -1;
+}
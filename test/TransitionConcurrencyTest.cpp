@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <imgui.h>
+#include <immat.h>
+#include <imgui_json.h>
+#if IMGUI_VULKAN_SHADER
+#include <ImVulkanShader.h>
+#endif
+#include "MediaTimeline.h"
+
+// Render the frames of one video overlap serially, then render them again from several threads with the
+// same 'BluePrintVideoTransition' instance, and check the results are identical.
+// Without a blueprint file, a transition graph is built from the first loaded video transition node that has
+// no native implementation, so that the frames are really mixed by the blueprint and its worker copies.
+// Usage: TransitionConcurrencyTest <plugin_dir> [transition_blueprint.json]
+
+using namespace MediaTimeline;
+
+static const int FRAME_WIDTH = 640;
+static const int FRAME_HEIGHT = 360;
+static const int64_t OVERLAP_DURATION = 2000;
+static const int64_t FRAME_INTERVAL = 40;
+static const int THREAD_COUNT = 8;
+
+static ImGui::ImMat MakeTestFrame(int seed)
+{
+    ImGui::ImMat m;
+    m.create_type(FRAME_WIDTH, FRAME_HEIGHT, 4, IM_DT_INT8);
+    m.elempack = 4;
+    uint8_t* p = (uint8_t*)m.data;
+    for (int y = 0; y < FRAME_HEIGHT; y++)
+    {
+        for (int x = 0; x < FRAME_WIDTH; x++)
+        {
+            p[0] = (uint8_t)(x+seed);
+            p[1] = (uint8_t)(y*2+seed);
+            p[2] = (uint8_t)((x^y)+seed);
+            p[3] = 255;
+            p += 4;
+        }
+    }
+    return m;
+}
+
+static bool DownloadToCpu(const ImGui::ImMat& src, ImGui::ImMat& dst)
+{
+    if (src.empty())
+        return false;
+    if (src.device == IM_DD_CPU)
+    {
+        dst = src;
+        return true;
+    }
+#if IMGUI_VULKAN_SHADER
+    if (src.device == IM_DD_VULKAN)
+    {
+        ImGui::VkMat vkmat = src;
+        ImGui::ImVulkanVkMatToImMat(vkmat, dst);
+        return !dst.empty() && dst.device == IM_DD_CPU;
+    }
+#endif
+    return false;
+}
+
+static bool IsSameMat(const ImGui::ImMat& a, const ImGui::ImMat& b)
+{
+    if (a.w != b.w || a.h != b.h || a.c != b.c || a.type != b.type || a.elemsize != b.elemsize)
+        return false;
+    return memcmp(a.data, b.data, (size_t)a.total()*a.elemsize) == 0;
+}
+
+// Build 'Entry -> <transition node> -> Exit' with a loaded video transition node which is not run natively
+static bool BuildTransitionFixture(imgui_json::value& bpJson, std::string& nodeName)
+{
+    BluePrint::BluePrintUI bp;
+    bp.Initialize();
+    imgui_json::value emptyJson;
+    bp.File_New_Transition(emptyJson, "VideoTransition", "Video");
+    bool bNodeAdded = false;
+    auto node_reg = bp.m_Document->m_Blueprint.GetNodeRegistry();
+    for (auto node : node_reg->GetNodes())
+    {
+        auto catalog = BluePrint::GetCatalogInfo(node->GetCatalog());
+        if (catalog.size() < 2 || catalog[0].compare("Transition") != 0 || catalog[1].compare("Video") != 0)
+            continue;
+        if (!bp.Blueprint_AppendNode(node->GetTypeID()))
+            continue;
+        auto candidateJson = bp.m_Document->Serialize();
+        if (!bp.Blueprint_IsExecutable() || MEC::NativeTransition::CreateFromBluePrintJson(candidateJson))
+        {
+            bp.File_New_Transition(emptyJson, "VideoTransition", "Video");
+            continue;
+        }
+        bpJson = candidateJson;
+        nodeName = node->GetName();
+        bNodeAdded = true;
+        break;
+    }
+    bp.Finalize();
+    return bNodeAdded;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <plugin_dir> [transition_blueprint.json]\n", argv[0]);
+        return -1;
+    }
+    std::vector<std::string> plugin_paths = { argv[1] };
+    int plugins = BluePrint::BluePrintUI::CheckPlugins(plugin_paths);
+    int current_index = 0;
+    std::string loading_message;
+    float loading_percentage = 0;
+    BluePrint::BluePrintUI::LoadPlugins(plugin_paths, current_index, loading_message, loading_percentage, plugins);
+
+    imgui_json::value bpJson;
+    std::string bpName;
+    if (argc > 2)
+    {
+        auto res = imgui_json::value::load(argv[2]);
+        if (!res.second)
+        {
+            fprintf(stderr, "FAILED to load transition blueprint from '%s'!\n", argv[2]);
+            return -1;
+        }
+        bpJson = res.first;
+        bpName = argv[2];
+        if (MEC::NativeTransition::CreateFromBluePrintJson(bpJson))
+            fprintf(stdout, "NOTE: '%s' is mixed natively, the blueprint worker copies are not exercised.\n", argv[2]);
+    }
+    else if (!BuildTransitionFixture(bpJson, bpName))
+    {
+        fprintf(stderr, "FAILED to build a transition blueprint! No usable video transition node is loaded from '%s'.\n", argv[1]);
+        return -1;
+    }
+    fprintf(stdout, "Testing transition '%s'.\n", bpName.c_str());
+    BluePrintVideoTransition transition(nullptr);
+    transition.SetBluePrintFromJson(bpJson);
+    if (!transition.mBp || !transition.mBp->Blueprint_IsExecutable())
+    {
+        fprintf(stderr, "FAILED to create the transition blueprint!\n");
+        return -1;
+    }
+
+    auto frame1 = MakeTestFrame(0);
+    auto frame2 = MakeTestFrame(97);
+    std::vector<int64_t> positions;
+    for (int64_t pos = 0; pos < OVERLAP_DURATION; pos += FRAME_INTERVAL)
+        positions.push_back(pos);
+
+    std::vector<ImGui::ImMat> serial_results(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        if (!DownloadToCpu(transition.MixTwoImages(frame1, frame2, positions[i], OVERLAP_DURATION), serial_results[i]))
+        {
+            fprintf(stderr, "FAILED to get the serial result at pos %lld on cpu!\n", (long long)positions[i]);
+            return -1;
+        }
+        serial_results[i] = serial_results[i].clone();
+    }
+
+    // a transition that just passes one of the inputs through doesn't test anything
+    bool bMixed = false;
+    for (const auto& result : serial_results)
+    {
+        if (!IsSameMat(result, frame1) && !IsSameMat(result, frame2))
+        {
+            bMixed = true;
+            break;
+        }
+    }
+    if (!bMixed)
+    {
+        fprintf(stderr, "Transition output is always one of the inputs, the test is not meaningful!\n");
+        return -1;
+    }
+
+    std::vector<ImGui::ImMat> parallel_results(positions.size());
+    std::vector<char> download_ok(positions.size(), 0);
+    std::atomic<size_t> next_index {0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < THREAD_COUNT; i++)
+    {
+        workers.push_back(std::thread([&] {
+            size_t idx;
+            while ((idx = next_index++) < positions.size())
+            {
+                ImGui::ImMat result;
+                download_ok[idx] = DownloadToCpu(transition.MixTwoImages(frame1, frame2, positions[idx], OVERLAP_DURATION), result);
+                if (download_ok[idx])
+                    parallel_results[idx] = result.clone();
+            }
+        }));
+    }
+    for (auto& t : workers)
+        t.join();
+
+    int mismatch_count = 0;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        if (!download_ok[i] || !IsSameMat(serial_results[i], parallel_results[i]))
+        {
+            fprintf(stderr, "Mismatched result at pos %lld!\n", (long long)positions[i]);
+            mismatch_count++;
+        }
+    }
+    fprintf(stdout, "%zu frames rendered with %d threads, %d mismatched.\n", positions.size(), THREAD_COUNT, mismatch_count);
+    return mismatch_count == 0 ? 0 : -1;
+}